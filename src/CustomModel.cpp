@@ -1,33 +1,324 @@
+/*
+ * CustomModel.cpp
+ * Author: Montee
+ * CreateDate: 2024-11-1
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 搜索结果表格模型实现
+ */
+
 #include "CustomModel.h"
-#include "Logger.h"
-#include <QDebug>
+
+#include <QDateTime>
+#include <QLocale>
+#include <algorithm>
+
+namespace {
+const char *TimestampFormat = "yyyy-MM-dd HH:mm:ss";
+const char *Placeholder = "…";     // 属性尚未读到
+const char *const Headers[] = {"序号", "文件名", "文件路径", "文件类型", "创建时间", "修改时间", "大小"};
+}
 
 CustomModel::CustomModel(QObject *parent)
-        : QAbstractListModel(parent) {}
+        : QAbstractTableModel(parent), sortColumn(-1), sortOrder(Qt::AscendingOrder),
+          fetcher(new MetadataFetcher(this)), generation(0), requestedCount(0), resortPending(false) {
+    extensions << QString();
+    extensionIdsByName.insert(QString(), 0);
+    connect(fetcher, &MetadataFetcher::fetched, this, &CustomModel::onMetadataFetched);
+}
 
 int CustomModel::rowCount(const QModelIndex &parent) const {
-    Q_UNUSED(parent);
-    return fileList.size();
+    return parent.isValid() ? 0 : int(rows.size());
+}
+
+int CustomModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+int CustomModel::fileCount() const {
+    return int(pathEnds.size());
 }
 
+QStringView CustomModel::pathOf(int file) const {
+    const qsizetype begin = file > 0 ? pathEnds[file - 1] : 0;
+    return QStringView(pathArena).mid(begin, pathEnds[file] - begin);
+}
+
+QStringView CustomModel::nameOf(int file) const {
+    return pathOf(file).mid(nameStarts[file]);
+}
+
+QString CustomModel::filePath(int row) const {
+    return row >= 0 && row < rows.size() ? pathOf(rows[row]).toString() : QString();
+}
+
+// 视图只为可见行调用 data()，显示字符串在这里按需生成，尚未读到的属性在这里发出读取请求
 QVariant CustomModel::data(const QModelIndex &index, int role) const {
-    if (!index.isValid() || index.row() >= fileList.size() || role != Qt::DisplayRole)
+    if (!index.isValid() || index.row() >= rows.size() || role != Qt::DisplayRole) {
         return QVariant();
-    return fileList.at(index.row());
+    }
+
+    const int file = rows[index.row()];
+    switch (index.column()) {
+        case IndexColumn:
+            return file + 1;
+        case NameColumn:
+            return nameOf(file).toString();
+        case PathColumn:
+            return pathOf(file).toString();
+        case TypeColumn:
+            return extensions[extensionIds[file]];
+        case CreatedColumn:
+        case ModifiedColumn: {
+            if (sizes[file] < 0) {
+                requestMetadata(file, MetadataFetcher::Visible);
+                return QString(Placeholder);
+            }
+            const qint64 time = index.column() == CreatedColumn ? createdTimes[file] : modifiedTimes[file];
+            return time != 0 ? QDateTime::fromMSecsSinceEpoch(time).toString(TimestampFormat) : QString();
+        }
+        case SizeColumn:
+            if (sizes[file] < 0) {
+                requestMetadata(file, MetadataFetcher::Visible);
+                return QString(Placeholder);
+            }
+            return QLocale().formattedDataSize(sizes[file]);
+        default:
+            return QVariant();
+    }
+}
+
+QVariant CustomModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole || section < 0 || section >= ColumnCount) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    return QString(Headers[section]);
+}
+
+/*
+ * Summary: 请求读取文件属性，每个文件只请求一次
+ * Parameters:
+ * int file - 文件编号
+ * MetadataFetcher::Priority priority - 可见行优先，排序用的预读在后
+ * Return: void
+ */
+void CustomModel::requestMetadata(int file, MetadataFetcher::Priority priority) const {
+    if (sizes[file] != NotLoaded) {
+        return;
+    }
+    sizes[file] = Requested;
+    ++requestedCount;
+    fetcher->request((quint64(generation) << 32) | quint32(file), pathOf(file).toString(), priority);
+}
+
+/*
+ * Summary: 收到一批文件属性。视图对跨多个单元格的 dataChanged 只重绘一次视口，
+ *          因此整批只发一次覆盖全部属性列的通知
+ * Parameters:
+ * const QVector<FileMetadata> &batch - 读到的属性
+ * Return: void
+ */
+void CustomModel::onMetadataFetched(const QVector<FileMetadata> &batch) {
+    bool updated = false;
+    for (const FileMetadata &metadata : batch) {
+        const int file = int(quint32(metadata.key));
+        if (quint32(metadata.key >> 32) != generation || file >= fileCount() || sizes[file] != Requested) {
+            continue;
+        }
+        sizes[file] = metadata.size;
+        createdTimes[file] = metadata.created;
+        modifiedTimes[file] = metadata.modified;
+        --requestedCount;
+        updated = true;
+    }
+    if (!updated) {
+        return;
+    }
+
+    if (resortPending && requestedCount == 0) {
+        resortPending = false;
+        sort(sortColumn, sortOrder);
+    } else if (!rows.isEmpty()) {
+        emit dataChanged(index(0, CreatedColumn), index(int(rows.size()) - 1, SizeColumn));
+    }
+}
+
+bool CustomModel::isMetadataColumn(int column) {
+    return column == CreatedColumn || column == ModifiedColumn || column == SizeColumn;
 }
 
 void CustomModel::addFile(const QString &filePath) {
-    beginInsertRows(QModelIndex(), fileList.size(), fileList.size());
-    fileList << filePath;
+    addFiles(QStringList{filePath});
+}
+
+/*
+ * Summary: 追加一批结果。只解析路径得到文件名与扩展名，不读取文件属性；
+ *          已排序时新结果追加在末尾，再次点击表头可重新排序
+ * Parameters:
+ * const QStringList &filePaths - 文件路径
+ * Return: void
+ */
+void CustomModel::addFiles(const QStringList &filePaths) {
+    if (filePaths.isEmpty()) {
+        return;
+    }
+
+    const int first = fileCount();
+    const size_t total = size_t(first) + size_t(filePaths.size());
+    pathEnds.reserve(total);
+    nameStarts.reserve(total);
+    extensionIds.reserve(total);
+    sizes.reserve(total);
+    createdTimes.reserve(total);
+    modifiedTimes.reserve(total);
+
+    for (const QString &path : filePaths) {
+        pathArena.append(path);
+        pathEnds.push_back(pathArena.size());
+
+        const qsizetype nameStart = path.lastIndexOf('/') + 1;
+        nameStarts.push_back(quint32(nameStart));
+
+        // 与 QFileInfo::suffix 相同：文件名中最后一个点之后的部分
+        const qsizetype dot = path.lastIndexOf('.');
+        const QString extension = dot >= nameStart ? path.mid(dot + 1) : QString();
+        auto it = extensionIdsByName.constFind(extension);
+        if (it == extensionIdsByName.constEnd()) {
+            it = extensionIdsByName.insert(extension, quint32(extensions.size()));
+            extensions << extension;
+        }
+        extensionIds.push_back(it.value());
+
+        sizes.push_back(NotLoaded);
+        createdTimes.push_back(0);
+        modifiedTimes.push_back(0);
+    }
+
+    QVector<int> added;
+    added.reserve(filePaths.size());
+    for (int file = first; file < fileCount(); ++file) {
+        if (accepts(file)) {
+            added.append(file);
+        }
+    }
+    if (added.isEmpty()) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), int(rows.size()), int(rows.size() + added.size()) - 1);
+    rows += added;
     endInsertRows();
-    // qDebug() << "File added to model: " << filePath;
-    // Logger::instance().log("File added to model: " + filePath);
+}
+
+bool CustomModel::accepts(int file) const {
+    return filter.pattern().isEmpty() || filter.match(pathOf(file)).hasMatch();
+}
+
+void CustomModel::setFilterWildcard(const QString &pattern) {
+    beginResetModel();
+    filter = pattern.isEmpty()
+             ? QRegularExpression()
+             : QRegularExpression(QRegularExpression::wildcardToRegularExpression(
+                                          pattern, QRegularExpression::UnanchoredWildcardConversion),
+                                  QRegularExpression::CaseInsensitiveOption);
+    rows.clear();
+    for (int file = 0; file < fileCount(); ++file) {
+        if (accepts(file)) {
+            rows.append(file);
+        }
+    }
+    if (sortColumn >= 0) {
+        std::stable_sort(rows.begin(), rows.end(), [this](int left, int right) {
+            return sortOrder == Qt::AscendingOrder ? lessThan(sortColumn, left, right) : lessThan(sortColumn, right, left);
+        });
+    }
+    endResetModel();
+}
+
+bool CustomModel::lessThan(int column, int left, int right) const {
+    switch (column) {
+        case NameColumn:
+            return nameOf(left).compare(nameOf(right), Qt::CaseInsensitive) < 0;
+        case PathColumn:
+            return pathOf(left).compare(pathOf(right), Qt::CaseInsensitive) < 0;
+        case TypeColumn:
+            return extensions[extensionIds[left]].compare(extensions[extensionIds[right]], Qt::CaseInsensitive) < 0;
+        case CreatedColumn:
+            return createdTimes[left] < createdTimes[right];
+        case ModifiedColumn:
+            return modifiedTimes[left] < modifiedTimes[right];
+        case SizeColumn:
+            return sizes[left] < sizes[right];
+        default:
+            return left < right;
+    }
+}
+
+/*
+ * Summary: 按列排序当前显示的行。按时间或大小排序时，尚未读到属性的行先排在一起并在后台预读，
+ *          属性全部读到后自动再排一次
+ * Parameters:
+ * int column - 列
+ * Qt::SortOrder order - 升序或降序
+ * Return: void
+ */
+void CustomModel::sort(int column, Qt::SortOrder order) {
+    if (column < 0 || column >= ColumnCount) {
+        return;
+    }
+    sortColumn = column;
+    sortOrder = order;
+    if (isMetadataColumn(column)) {
+        for (int file : rows) {
+            requestMetadata(file, MetadataFetcher::Background);
+        }
+    }
+    resortPending = isMetadataColumn(column) && requestedCount > 0;
+
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    const QModelIndexList persistent = persistentIndexList();
+    QVector<int> persistentFiles;
+    persistentFiles.reserve(persistent.size());
+    for (const QModelIndex &index : persistent) {
+        persistentFiles.append(rows[index.row()]);
+    }
+
+    std::stable_sort(rows.begin(), rows.end(), [this, column, order](int left, int right) {
+        return order == Qt::AscendingOrder ? lessThan(column, left, right) : lessThan(column, right, left);
+    });
+
+    // 选中行等持久索引跟随文件移动
+    if (!persistent.isEmpty()) {
+        std::vector<int> rowOfFile(size_t(fileCount()), -1);
+        for (int row = 0; row < rows.size(); ++row) {
+            rowOfFile[size_t(rows[row])] = row;
+        }
+        QModelIndexList moved;
+        moved.reserve(persistent.size());
+        for (int i = 0; i < persistent.size(); ++i) {
+            moved.append(index(rowOfFile[size_t(persistentFiles[i])], persistent[i].column()));
+        }
+        changePersistentIndexList(persistent, moved);
+    }
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
 }
 
 void CustomModel::clear() {
     beginResetModel();
-    fileList.clear();
+    ++generation;
+    fetcher->cancelAll();
+    fetcher->clearCache();  // 新的搜索重新读取属性，避免显示文件修改前的大小与时间
+    requestedCount = 0;
+    resortPending = false;
+    pathArena.clear();
+    pathEnds.clear();
+    nameStarts.clear();
+    extensionIds.clear();
+    sizes.clear();
+    createdTimes.clear();
+    modifiedTimes.clear();
+    extensions = QStringList{QString()};
+    extensionIdsByName.clear();
+    extensionIdsByName.insert(QString(), 0);
+    rows.clear();
     endResetModel();
-    // qDebug() << "Model cleared.";
-    // Logger::instance().log("Model cleared.");
 }
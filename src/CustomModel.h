@@ -1,22 +1,83 @@
+/*
+ * CustomModel.h
+ * Author: Montee
+ * CreateDate: 2024-11-1
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 搜索结果表格模型。结果按列存放：路径连续存放在一块字符数组中，扩展名存编号，大小与时间存整数；
+ *          显示用的字符串只在 data() 中为可见行生成。文件属性在某行第一次显示或按该列排序时交给 MetadataFetcher
+ *          在后台读取，读到之前显示占位符，界面线程不访问文件系统。
+ *          结果按批追加，每批一次 beginInsertRows；排序与过滤在模型内完成，不再经过 QSortFilterProxyModel
+ */
+
 #ifndef CUSTOMMODEL_H
 #define CUSTOMMODEL_H
 
-#include <QAbstractListModel>
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QRegularExpression>
 #include <QStringList>
+#include <QVector>
+#include <vector>
+
+#include "MetadataFetcher.h"
 
-class CustomModel : public QAbstractListModel {
+class CustomModel : public QAbstractTableModel {
 Q_OBJECT
 
 public:
-    CustomModel(QObject *parent = nullptr);
+    enum Column { IndexColumn, NameColumn, PathColumn, TypeColumn, CreatedColumn, ModifiedColumn, SizeColumn, ColumnCount };
+
+    explicit CustomModel(QObject *parent = nullptr);
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
     void addFile(const QString &filePath);
+    void addFiles(const QStringList &filePaths);   // 一批结果，只通知视图一次
+    void setFilterWildcard(const QString &pattern); // 按路径过滤（含文件名与扩展名），不区分大小写，空串表示不过滤
     void clear();
+    int fileCount() const;                          // 全部结果数，不受过滤影响
+    QString filePath(int row) const;                // 当前排序与过滤下第 row 行的路径
+
+private slots:
+    void onMetadataFetched(const QVector<FileMetadata> &batch);
 
 private:
-    QStringList fileList;
+    static constexpr qint64 NotLoaded = -1;         // 尚未读取文件属性
+    static constexpr qint64 Requested = -2;         // 已交给 MetadataFetcher，尚未返回
+
+    QStringView pathOf(int file) const;
+    QStringView nameOf(int file) const;
+    void requestMetadata(int file, MetadataFetcher::Priority priority) const;
+    static bool isMetadataColumn(int column);
+    bool accepts(int file) const;
+    bool lessThan(int column, int left, int right) const;
+
+    // 按到达顺序存放的列，下标为文件编号
+    QString pathArena;                              // 全部路径首尾相接
+    std::vector<qsizetype> pathEnds;                // 第 i 个路径在 pathArena 中的结束位置
+    std::vector<quint32> nameStarts;                // 文件名相对路径开头的偏移
+    std::vector<quint32> extensionIds;              // 指向 extensions
+    mutable std::vector<qint64> sizes;              // 字节数，NotLoaded 或 Requested 表示尚未读到，文件不存在时为 0
+    mutable std::vector<qint64> createdTimes;       // 毫秒时间戳，无效时为 0
+    mutable std::vector<qint64> modifiedTimes;
+
+    QStringList extensions;
+    QHash<QString, quint32> extensionIdsByName;
+
+    QVector<int> rows;                              // 当前显示的文件编号，按排序与过滤排列
+    int sortColumn;
+    Qt::SortOrder sortOrder;
+    QRegularExpression filter;
+
+    MetadataFetcher *fetcher;
+    quint32 generation;                             // 每次 clear() 加一，丢弃上一次搜索迟到的结果
+    mutable int requestedCount;                     // 已请求尚未返回的文件数
+    bool resortPending;                             // 按属性列排序时，属性全部读到后再排一次
 };
 
 #endif // CUSTOMMODEL_H
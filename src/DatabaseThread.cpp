@@ -4,7 +4,18 @@
 
 #include "DatabaseThread.h"
 #include "FileIndexDatabase.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include <QDebug>
+#include <QElapsedTimer>
+
+namespace {
+MetricGauge &queueDepth() {
+    static MetricGauge &gauge = Metrics::gauge("filetag_db_queue_depth", "数据库线程待处理的任务数");
+    return gauge;
+}
+}
 
 DatabaseThread::DatabaseThread(AbstractDatabase *db, QObject *parent)
         : QThread(parent), db(db), isRunning(true) {
@@ -23,19 +34,40 @@ DatabaseThread::~DatabaseThread() {
 
 void DatabaseThread::addInsertFileTask(const QString &filePath) {
     QMutexLocker locker(&mutex);
-    taskQueue.enqueue({ Task::InsertFile, filePath });
+    taskQueue.enqueue({ Task::InsertFile, filePath, {} });
+    queueDepth().set(taskQueue.size());
     condition.wakeOne();
 }
 
 void DatabaseThread::addSearchFilesTask(const QString &keyword) {
     QMutexLocker locker(&mutex);
-    taskQueue.enqueue({ Task::SearchFiles, keyword });
+    taskQueue.enqueue({ Task::SearchFiles, keyword, {} });
+    queueDepth().set(taskQueue.size());
+    condition.wakeOne();
+}
+
+void DatabaseThread::addExportSnapshotTask(const QString &snapshotPath) {
+    QMutexLocker locker(&mutex);
+    taskQueue.enqueue({ Task::ExportSnapshot, snapshotPath, {} });
+    queueDepth().set(taskQueue.size());
+    condition.wakeOne();
+}
+
+void DatabaseThread::addRemoveMissingTask(const QString &root, const QSet<QString> &seen) {
+    QMutexLocker locker(&mutex);
+    taskQueue.enqueue({ Task::RemoveMissing, root, seen });
+    queueDepth().set(taskQueue.size());
     condition.wakeOne();
 }
 
 void DatabaseThread::run() {
+    MetricHistogram &insertLatency = Metrics::histogram("filetag_db_insert_latency_us", "插入文件信息的耗时（微秒）");
+    MetricHistogram &searchLatency = Metrics::histogram("filetag_db_search_latency_us", "数据库搜索的耗时（微秒）");
+    MetricHistogram &exportLatency = Metrics::histogram("filetag_db_export_latency_us", "导出索引快照的耗时（微秒）");
+
     while (true) {
         Task task;
+        qint64 remaining;
         {
             QMutexLocker locker(&mutex);
             while (taskQueue.isEmpty() && isRunning) {
@@ -45,15 +77,41 @@ void DatabaseThread::run() {
                 break;
             }
             task = taskQueue.dequeue();
+            remaining = taskQueue.size();
+            queueDepth().set(remaining);
         }
 
+        QElapsedTimer timer;
+        timer.start();
         switch (task.type) {
-            case Task::InsertFile:
-                processInsertFile(task.data.toString());
+            case Task::InsertFile: {
+                const QString filePath = task.data.toString();
+                TraceSpan span("db_insert", remaining);
+                processInsertFile(filePath);
+                insertLatency.record(timer.nsecsElapsed() / 1000);
+                FlightRecorder::record(FlightRecorder::Event::DatabaseInsert, remaining, timer.nsecsElapsed() / 1000,
+                                       filePath);
                 break;
-            case Task::SearchFiles:
+            }
+            case Task::SearchFiles: {
+                TraceSpan span("db_search", remaining);
                 processSearchFiles(task.data.toString());
+                searchLatency.record(timer.nsecsElapsed() / 1000);
+                FlightRecorder::record(FlightRecorder::Event::DatabaseSearch, remaining, timer.nsecsElapsed() / 1000);
                 break;
+            }
+            case Task::ExportSnapshot: {
+                TraceSpan span("db_export_snapshot", remaining);
+                processExportSnapshot(task.data.toString());
+                exportLatency.record(timer.nsecsElapsed() / 1000);
+                FlightRecorder::record(FlightRecorder::Event::DatabaseExport, remaining, timer.nsecsElapsed() / 1000);
+                break;
+            }
+            case Task::RemoveMissing: {
+                TraceSpan span("db_remove_missing", remaining);
+                processRemoveMissing(task.data.toString(), task.seen);
+                break;
+            }
         }
     }
 }
@@ -61,10 +119,9 @@ void DatabaseThread::run() {
 void DatabaseThread::processInsertFile(const QString &filePath) {
     // 调用数据库的插入文件信息方法
     if (auto fileDb = dynamic_cast<FileIndexDatabase*>(db)) {
+        // 失败原因已由 insertFileInfo 按调用点限流记录
         if (fileDb->insertFileInfo(filePath)) {
             emit fileInserted(filePath);
-        } else {
-            qDebug() << "插入文件信息失败：" << filePath;
         }
     }
 }
@@ -76,3 +133,17 @@ void DatabaseThread::processSearchFiles(const QString &keyword) {
         emit searchFinished(results);
     }
 }
+
+void DatabaseThread::processRemoveMissing(const QString &root, const QSet<QString> &seen) {
+    // 排在本轮遍历的插入任务之后执行，seen 中的路径都已写入
+    if (auto fileDb = dynamic_cast<FileIndexDatabase*>(db)) {
+        fileDb->removeMissingFiles(root, seen);
+    }
+}
+
+void DatabaseThread::processExportSnapshot(const QString &snapshotPath) {
+    // 排在之前入队的插入任务之后执行，快照包含本轮的全部结果
+    if (auto fileDb = dynamic_cast<FileIndexDatabase*>(db)) {
+        emit snapshotExported(snapshotPath, fileDb->exportSnapshot(snapshotPath));
+    }
+}
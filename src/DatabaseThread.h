@@ -10,6 +10,7 @@
 #include <QWaitCondition>
 #include <QQueue>
 #include <QVariant>
+#include <QSet>
 
 #include "AbstractDatabase.h"
 
@@ -21,18 +22,22 @@ public:
 
     void addInsertFileTask(const QString &filePath);
     void addSearchFilesTask(const QString &keyword);
+    void addExportSnapshotTask(const QString &snapshotPath);
+    void addRemoveMissingTask(const QString &root, const QSet<QString> &seen);  // 排在本轮插入之后清理 root 下已不存在的文件
 
 signals:
     void fileInserted(const QString &filePath);
     void searchFinished(const QVector<QString> &results);
+    void snapshotExported(const QString &snapshotPath, bool success);
 
 protected:
     void run() override;
 
 private:
     struct Task {
-        enum TaskType { InsertFile, SearchFiles } type;
+        enum TaskType { InsertFile, SearchFiles, ExportSnapshot, RemoveMissing } type;
         QVariant data;
+        QSet<QString> seen;  // RemoveMissing：本次遍历见到的路径
     };
 
     AbstractDatabase *db;
@@ -43,6 +48,8 @@ private:
 
     void processInsertFile(const QString &filePath);
     void processSearchFiles(const QString &keyword);
+    void processExportSnapshot(const QString &snapshotPath);
+    void processRemoveMissing(const QString &root, const QSet<QString> &seen);
 };
 
 #endif // DATABASETHREAD_H
@@ -0,0 +1,60 @@
+#include "FileIdentity.h"
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <filesystem>
+#else
+#include <sys/stat.h>
+#endif
+
+// 读取文件标识
+FileIdentity FileIdentity::of(const std::string& filepath) {
+    FileIdentity identity;
+#ifdef _WIN32
+    // FILE_FLAG_BACKUP_SEMANTICS 使目录也能打开
+    HANDLE handle = CreateFileW(std::filesystem::u8path(filepath).c_str(), 0,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return identity;
+    }
+    BY_HANDLE_FILE_INFORMATION info;
+    if (GetFileInformationByHandle(handle, &info)) {
+        identity.device = info.dwVolumeSerialNumber;
+        identity.inode = (uint64_t(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    }
+    CloseHandle(handle);
+#else
+    struct stat info;
+    if (::stat(filepath.c_str(), &info) == 0) {
+        identity.device = uint64_t(info.st_dev);
+        identity.inode = uint64_t(info.st_ino);
+    }
+#endif
+    return identity;
+}
+
+std::string FileIdentity::toString() const {
+    return std::to_string(device) + ":" + std::to_string(inode);
+}
+
+FileIdentity FileIdentity::fromString(const std::string& text) {
+    FileIdentity identity;
+    const size_t colon = text.find(':');
+    if (colon == std::string::npos) {
+        return identity;
+    }
+    char* end = nullptr;
+    const uint64_t device = std::strtoull(text.c_str(), &end, 10);
+    if (end != text.c_str() + colon) {
+        return identity;
+    }
+    const uint64_t inode = std::strtoull(text.c_str() + colon + 1, &end, 10);
+    if (*end != '\0') {
+        return identity;
+    }
+    identity.device = device;
+    identity.inode = inode;
+    return identity;
+}
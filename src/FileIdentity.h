@@ -0,0 +1,30 @@
+/*
+ * FileIdentity.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 文件标识 (设备号, inode)。文件重命名或在同一文件系统内移动后标识不变，
+ *          用于在路径失效后找回文件；Windows 下为卷序列号与文件索引号
+ */
+
+#ifndef FILE_IDENTITY_H
+#define FILE_IDENTITY_H
+
+#include <cstdint>
+#include <string>
+
+struct FileIdentity {
+    uint64_t device = 0;
+    uint64_t inode = 0;
+
+    bool isValid() const { return device != 0 || inode != 0; }
+    bool operator==(const FileIdentity& other) const { return device == other.device && inode == other.inode; }
+    bool operator!=(const FileIdentity& other) const { return !(*this == other); }
+
+    static FileIdentity of(const std::string& filepath);        // 读取文件标识，文件不存在时返回无效标识
+    std::string toString() const;                              // 格式为 device:inode
+    static FileIdentity fromString(const std::string& text);   // 解析失败时返回无效标识
+};
+
+#endif // FILE_IDENTITY_H
@@ -12,11 +12,94 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QDebug>
+#include <QRandomGenerator>
+#include <QVariant>
 
 #include "FileIndexDatabase.h"
+#include "FileIndexSnapshot.h"
 #include "Logger.h"
 
-FileIndexDatabase::FileIndexDatabase(const QString &dbName) : AbstractDatabase(dbName) {}
+namespace {
+const char *TimestampFormat = "yyyy-MM-dd HH:mm:ss";
+const int LookupBatchSize = 500;  // 低于 SQLite 默认的绑定参数上限
+
+// 转义 LIKE 的通配符，配合 ESCAPE '\' 使 % 与 _ 按字面匹配，与快照和 FileFilter::matches 一致
+QString escapeLike(const QString &text) {
+    QString escaped = text;
+    escaped.replace('\\', "\\\\").replace('%', "\\%").replace('_', "\\_");
+    return escaped;
+}
+
+QString containsPattern(const QString &text) {
+    return '%' + escapeLike(text) + '%';
+}
+
+// 将条件转换为 WHERE 子句，参数按顺序追加到 values
+QString whereClause(const FileFilter &filter, QVariantList &values) {
+    QStringList conditions;
+    if (!filter.nameContains.isEmpty()) {
+        conditions << "name LIKE ? ESCAPE '\\'";
+        values << containsPattern(filter.nameContains);
+    }
+    if (!filter.pathContains.isEmpty()) {
+        conditions << "path LIKE ? ESCAPE '\\'";
+        values << containsPattern(filter.pathContains);
+    }
+    if (!filter.extension.isEmpty()) {
+        conditions << "extension = ? COLLATE NOCASE";
+        values << filter.extension;
+    }
+    if (filter.modifiedFrom.isValid()) {
+        conditions << "last_modified >= ?";
+        values << filter.modifiedFrom.toString(TimestampFormat);
+    }
+    if (filter.modifiedTo.isValid()) {
+        conditions << "last_modified < ?";
+        values << filter.modifiedTo.toString(TimestampFormat);
+    }
+    return conditions.isEmpty() ? QString() : " WHERE " + conditions.join(" AND ");
+}
+
+FileRecord recordFrom(const QSqlQuery &query) {
+    return { query.value(0).toString(), query.value(1).toString(), query.value(2).toString(), query.value(3).toString() };
+}
+} // namespace
+
+bool FileFilter::isEmpty() const {
+    return nameContains.isEmpty() && pathContains.isEmpty() && extension.isEmpty()
+           && !modifiedFrom.isValid() && !modifiedTo.isValid();
+}
+
+// SQLite 的 LIKE 只对 ASCII 字母不区分大小写，这里按相同方式比较
+bool FileFilter::matches(const FileRecord &record) const {
+    auto containsAscii = [](const QString &text, const QString &part) {
+        if (part.isEmpty()) {
+            return true;
+        }
+        for (qsizetype start = 0; start + part.size() <= text.size(); ++start) {
+            qsizetype i = 0;
+            while (i < part.size()) {
+                QChar a = text[start + i], b = part[i];
+                if (a.unicode() < 128) a = a.toLower();
+                if (b.unicode() < 128) b = b.toLower();
+                if (a != b) break;
+                ++i;
+            }
+            if (i == part.size()) {
+                return true;
+            }
+        }
+        return false;
+    };
+    return containsAscii(record.name, nameContains)
+           && containsAscii(record.path, pathContains)
+           && (extension.isEmpty() || record.extension.compare(extension, Qt::CaseInsensitive) == 0)
+           && (!modifiedFrom.isValid() || record.lastModified >= modifiedFrom.toString(TimestampFormat))
+           && (!modifiedTo.isValid() || record.lastModified < modifiedTo.toString(TimestampFormat));
+}
+
+FileIndexDatabase::FileIndexDatabase(const QString &dbName, const QString &connectionName)
+    : AbstractDatabase(dbName), connectionName(connectionName), currentGeneration(0), generationBumped(false) {}
 
 FileIndexDatabase::~FileIndexDatabase() {
     closeDatabase();
@@ -25,10 +108,10 @@ FileIndexDatabase::~FileIndexDatabase() {
 // 打开数据库连接并创建表
 bool FileIndexDatabase::openDatabase() {
     // 检查是否已经有同名的连接
-    if (QSqlDatabase::contains("file_db_connection")) {
-        db = QSqlDatabase::database("file_db_connection");
+    if (QSqlDatabase::contains(connectionName)) {
+        db = QSqlDatabase::database(connectionName);
     } else {
-        db = QSqlDatabase::addDatabase("QSQLITE", "file_db_connection");
+        db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
         db.setDatabaseName(databaseName);
     }
 
@@ -50,7 +133,8 @@ void FileIndexDatabase::closeDatabase() {
         LOG_INFO("数据库连接已关闭。");
         qDebug() << "数据库连接已关闭。";
     }
-    QSqlDatabase::removeDatabase("file_db_connection");
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(connectionName);
 }
 
 
@@ -69,10 +153,13 @@ bool FileIndexDatabase::createTables() {
             name TEXT,
             extension TEXT,
             birth_time TEXT,
-            last_modified TEXT
+            last_modified TEXT,
+            device INTEGER,
+            inode INTEGER
         )
     )";
-    if (!query.exec(sqlCreateFiles)) {
+    if (!query.exec(sqlCreateFiles) || !addIdentityColumns()
+        || !query.exec("CREATE INDEX IF NOT EXISTS idx_files_identity ON files (device, inode)")) {
         QString errorMessage = QString("创建 files 表失败: %1").arg(query.lastError().text());
         qDebug() << errorMessage;
         LOG_ERROR(errorMessage);
@@ -93,34 +180,159 @@ bool FileIndexDatabase::createTables() {
         return false;
     }
 
+    // meta 表记录索引代数，快照以此判断是否过期
+    QString sqlCreateMeta = R"(
+        CREATE TABLE IF NOT EXISTS meta (
+            key TEXT PRIMARY KEY,
+            value INTEGER
+        )
+    )";
+    if (!query.exec(sqlCreateMeta) || !query.exec("INSERT OR IGNORE INTO meta (key, value) VALUES ('generation', 0)")) {
+        QString errorMessage = QString("创建 meta 表失败: %1").arg(query.lastError().text());
+        qDebug() << errorMessage;
+        LOG_ERROR(errorMessage);
+        return false;
+    }
+
     //LOG_INFO("数据库表创建成功。");
     //qDebug() << "数据库表创建成功。";
+    return loadGeneration();
+}
+
+/*
+ * Summary: 旧版数据库的 files 表没有 device、inode 列，这里补上；旧记录的两列为空，重新索引后填入
+ * Parameters: 无
+ * Return: bool - 是否成功
+ */
+bool FileIndexDatabase::addIdentityColumns() {
+    QSqlQuery query(db);
+    if (!query.exec("PRAGMA table_info(files)")) {
+        return false;
+    }
+    bool hasIdentity = false;
+    while (query.next()) {
+        hasIdentity = hasIdentity || query.value(1).toString() == "inode";
+    }
+    if (hasIdentity) {
+        return true;
+    }
+    return query.exec("ALTER TABLE files ADD COLUMN device INTEGER")
+           && query.exec("ALTER TABLE files ADD COLUMN inode INTEGER");
+}
+
+/*
+ * Summary: 从 meta 表读取索引代数
+ * Parameters: 无
+ * Return: bool - 是否成功
+ */
+bool FileIndexDatabase::loadGeneration() {
+    QSqlQuery query(db);
+    if (!query.exec("SELECT value FROM meta WHERE key = 'generation'") || !query.next()) {
+        QString errorMessage = QString("读取索引代数失败: %1").arg(query.lastError().text());
+        qDebug() << errorMessage;
+        LOG_ERROR(errorMessage);
+        return false;
+    }
+    currentGeneration = query.value(0).toULongLong();
+    generationBumped = false;
+    return true;
+}
+
+/*
+ * Summary: 标记索引已修改。自上次打开或导出快照以来的第一次修改会把代数加一，
+ *          之后的修改不再访问 meta 表
+ * Parameters: 无
+ * Return: void
+ */
+void FileIndexDatabase::markIndexChanged() {
+    if (generationBumped.exchange(true)) {
+        return;
+    }
+
+    QSqlQuery query(db);
+    if (!query.exec("UPDATE meta SET value = value + 1 WHERE key = 'generation'")) {
+        QString errorMessage = QString("更新索引代数失败: %1").arg(query.lastError().text());
+        qDebug() << errorMessage;
+        LOG_ERROR(errorMessage);
+        return;
+    }
+    ++currentGeneration;
+}
+
+// 获取当前索引代数
+quint64 FileIndexDatabase::generation() const {
+    return currentGeneration.load();
+}
+
+/*
+ * Summary: 将 files 表导出为只读二进制快照
+ * Parameters:
+ * const QString &snapshotPath - 快照文件路径
+ * Return: bool - 是否成功
+ */
+bool FileIndexDatabase::exportSnapshot(const QString &snapshotPath) {
+    if (!db.isOpen()) {
+        LOG_ERROR("数据库未打开，无法导出快照。");
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT path FROM files ORDER BY path")) {
+        QString errorMessage = QString("读取快照数据失败: %1").arg(query.lastError().text());
+        qDebug() << errorMessage;
+        LOG_ERROR(errorMessage);
+        return false;
+    }
+
+    QVector<QString> paths;
+    while (query.next()) {
+        paths.append(query.value(0).toString());
+    }
+
+    // 导出后的下一次修改需要重新递增代数
+    const quint64 exportedGeneration = currentGeneration.load();
+    if (!FileIndexSnapshot::write(snapshotPath, exportedGeneration, paths)) {
+        return false;
+    }
+    generationBumped = false;
     return true;
 }
 
 
 bool FileIndexDatabase::insertFileInfo(const QString &filePath) {
     if (!db.isOpen()) {
-        LOG_ERROR("数据库未打开，无法插入文件信息。");
+        LOG_ERROR_LIMITED("数据库未打开，无法插入文件信息。");
         return false;
     }
 
+    markIndexChanged();
+
     QFileInfo fileInfo(filePath);
     QSqlQuery query(db);
+    // 不用 INSERT OR REPLACE：替换会先删除旧行，文件 ID 随之改变，file_keywords 中的关联随之失效
     query.prepare(R"(
-        INSERT OR REPLACE INTO files (path, name, extension, birth_time, last_modified)
-        VALUES (?, ?, ?, ?, ?)
+        INSERT INTO files (path, name, extension, birth_time, last_modified, device, inode)
+        VALUES (?, ?, ?, ?, ?, ?, ?)
+        ON CONFLICT(path) DO UPDATE SET
+            name = excluded.name,
+            extension = excluded.extension,
+            birth_time = excluded.birth_time,
+            last_modified = excluded.last_modified,
+            device = excluded.device,
+            inode = excluded.inode
     )");
     query.addBindValue(fileInfo.absoluteFilePath());
     query.addBindValue(fileInfo.fileName());
     query.addBindValue(fileInfo.suffix());
     query.addBindValue(fileInfo.birthTime().toString("yyyy-MM-dd HH:mm:ss"));
     query.addBindValue(fileInfo.lastModified().toString("yyyy-MM-dd HH:mm:ss"));
+    const FileIdentity identity = FileIdentity::of(filePath.toStdString());
+    query.addBindValue(identity.isValid() ? QVariant(qint64(identity.device)) : QVariant());
+    query.addBindValue(identity.isValid() ? QVariant(qint64(identity.inode)) : QVariant());
 
     if (!query.exec()) {
-        QString errorMessage = QString("插入文件信息失败: %1").arg(query.lastError().text());
-        qDebug() << errorMessage;
-        LOG_ERROR(errorMessage);
+        LOG_ERROR_LIMITED(QString("插入文件信息失败: %1（%2）").arg(query.lastError().text(), filePath));
         return false;
     }
 
@@ -129,6 +341,72 @@ bool FileIndexDatabase::insertFileInfo(const QString &filePath) {
     return true;
 }
 
+/*
+ * Summary: 重新索引 root 后删除其下已不存在的文件（标记-清除：seen 为本次遍历见到的全部路径），
+ *          关联的关键词一并删除
+ * Parameters:
+ * const QString &root - 遍历的根目录，绝对路径
+ * const QSet<QString> &seen - 本次遍历见到的路径
+ * Return: qint64 - 删除的记录数，失败时返回 -1
+ */
+qint64 FileIndexDatabase::removeMissingFiles(const QString &root, const QSet<QString> &seen) {
+    if (!db.isOpen()) {
+        LOG_ERROR("数据库未打开，无法清理索引。");
+        return -1;
+    }
+
+    const QString prefix = root.endsWith('/') ? root : root + '/';
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT id, path FROM files WHERE path LIKE ? ESCAPE '\\'");
+    query.addBindValue(escapeLike(prefix) + '%');
+    if (!query.exec()) {
+        LOG_ERROR(QString("读取待清理的索引记录失败: %1").arg(query.lastError().text()));
+        return -1;
+    }
+
+    // LIKE 对 ASCII 字母不区分大小写，前缀再按原样比较一次
+    QVector<qint64> missing;
+    while (query.next()) {
+        const QString path = query.value(1).toString();
+        if (path.startsWith(prefix) && !seen.contains(path)) {
+            missing.append(query.value(0).toLongLong());
+        }
+    }
+    query.finish();
+    if (missing.isEmpty()) {
+        return 0;
+    }
+
+    markIndexChanged();
+    if (!db.transaction()) {
+        LOG_ERROR(QString("清理索引时无法开始事务: %1").arg(db.lastError().text()));
+        return -1;
+    }
+    QSqlQuery removeFile(db);
+    QSqlQuery removeKeywords(db);
+    removeFile.prepare("DELETE FROM files WHERE id = ?");
+    removeKeywords.prepare("DELETE FROM file_keywords WHERE file_id = ?");
+    for (const qint64 id : missing) {
+        removeKeywords.addBindValue(id);
+        removeFile.addBindValue(id);
+        if (!removeKeywords.exec() || !removeFile.exec()) {
+            LOG_ERROR(QString("删除索引记录失败: %1%2")
+                              .arg(removeKeywords.lastError().text(), removeFile.lastError().text()));
+            db.rollback();
+            return -1;
+        }
+    }
+    if (!db.commit()) {
+        LOG_ERROR(QString("提交索引清理失败: %1").arg(db.lastError().text()));
+        db.rollback();
+        return -1;
+    }
+
+    LOG_INFO(QString("已从索引中删除 %1 个不存在的文件：%2").arg(missing.size()).arg(root));
+    return missing.size();
+}
+
 /*
  * Summary: 插入关键词
  * Parameters:
@@ -138,10 +416,12 @@ bool FileIndexDatabase::insertFileInfo(const QString &filePath) {
  */
 void FileIndexDatabase::insertFileKeywords(int fileId, const QVector<QString> &keywords) {
     if (!db.isOpen()) {
-        LOG_ERROR("数据库未打开，无法插入关键词。");
+        LOG_ERROR_LIMITED("数据库未打开，无法插入关键词。");
         return;
     }
 
+    markIndexChanged();
+
     QSqlQuery query(db);
     for (const QString &keyword : keywords) {
         query.prepare("INSERT INTO file_keywords (file_id, keyword) VALUES (?, ?)");
@@ -149,12 +429,10 @@ void FileIndexDatabase::insertFileKeywords(int fileId, const QVector<QString> &k
         query.addBindValue(keyword);
 
         if (!query.exec()) {
-            QString errorMessage = QString("插入关键词失败，文件 ID: %1, 关键词: %2, 错误信息: %3")
-                    .arg(fileId)
-                    .arg(keyword)
-                    .arg(query.lastError().text());
-            qDebug() << errorMessage;
-            LOG_ERROR(errorMessage);
+            LOG_ERROR_LIMITED(QString("插入关键词失败，文件 ID: %1, 关键词: %2, 错误信息: %3")
+                                      .arg(fileId)
+                                      .arg(keyword)
+                                      .arg(query.lastError().text()));
         } else {
             //LOG_INFO("关键词插入成功，文件 ID: " + QString::number(fileId) + ", 关键词: " + keyword);
             //qDebug() << "关键词插入成功，文件 ID: " << fileId << ", 关键词: " << keyword;
@@ -178,18 +456,18 @@ QVector<QString> FileIndexDatabase::searchFiles(const QString &keyword) {
     QSqlQuery query(db);
     QString sql = R"(
         SELECT path FROM files
-        WHERE path LIKE '%' || ? || '%'
-        OR name LIKE '%' || ? || '%'
+        WHERE path LIKE ? ESCAPE '\'
+        OR name LIKE ? ESCAPE '\'
         OR EXISTS (
             SELECT 1 FROM file_keywords
             WHERE file_keywords.file_id = files.id
-            AND file_keywords.keyword LIKE ?
+            AND file_keywords.keyword LIKE ? ESCAPE '\'
         )
     )";
     query.prepare(sql);
-    query.addBindValue(keyword);
-    query.addBindValue(keyword);
-    query.addBindValue(keyword);
+    query.addBindValue(containsPattern(keyword));
+    query.addBindValue(containsPattern(keyword));
+    query.addBindValue(escapeLike(keyword));
 
     if (query.exec()) {
         while (query.next()) {
@@ -226,3 +504,169 @@ int FileIndexDatabase::getFileId(const QString &filePath) {
     LOG_INFO(errorMessage);
     return -1;
 }
+
+/*
+ * Summary: 统计索引中的文件数
+ * Parameters: 无
+ * Return: qint64 - 文件数，失败时返回 -1
+ */
+qint64 FileIndexDatabase::fileCount() {
+    if (!db.isOpen()) {
+        LOG_ERROR("数据库未打开，无法统计文件数。");
+        return -1;
+    }
+
+    QSqlQuery query(db);
+    if (!query.exec("SELECT COUNT(*) FROM files") || !query.next()) {
+        LOG_ERROR(QString("统计文件数失败: %1").arg(query.lastError().text()));
+        return -1;
+    }
+    return query.value(0).toLongLong();
+}
+
+/*
+ * Summary: 随机抽样估计满足条件的文件数。在 [min(id), max(id)] 中均匀抽取 ID 逐个按主键读取，
+ *          命中且满足条件的比例乘以 ID 区间长度即为估计值（已删除的 ID 视为不满足，因此无需 COUNT）
+ * Parameters:
+ * const FileFilter &filter - 文件属性条件
+ * int sampleSize - 抽样数
+ * Return: qint64 - 估计的文件数，失败时返回 -1
+ */
+qint64 FileIndexDatabase::estimateMatches(const FileFilter &filter, int sampleSize) {
+    if (!db.isOpen()) {
+        LOG_ERROR("数据库未打开，无法估计查询结果数。");
+        return -1;
+    }
+
+    QSqlQuery query(db);
+    if (!query.exec("SELECT MIN(id), MAX(id) FROM files") || !query.next() || query.value(0).isNull()) {
+        return 0;
+    }
+    const qint64 minId = query.value(0).toLongLong();
+    const qint64 range = query.value(1).toLongLong() - minId + 1;
+
+    // ID 区间不大于抽样数时直接精确统计
+    if (range <= sampleSize) {
+        qint64 count = 0;
+        queryFiles(filter, [&count](const FileRecord &) { ++count; return true; });
+        return count;
+    }
+
+    query.prepare("SELECT path, name, extension, last_modified FROM files WHERE id = ?");
+    qint64 matched = 0;
+    for (int i = 0; i < sampleSize; ++i) {
+        query.bindValue(0, minId + qint64(QRandomGenerator::global()->bounded(quint64(range))));
+        if (query.exec() && query.next() && filter.matches(recordFrom(query))) {
+            ++matched;
+        }
+    }
+    return range * matched / sampleSize;
+}
+
+/*
+ * Summary: 流式输出满足条件的文件，不在内存中汇总结果
+ * Parameters:
+ * const FileFilter &filter - 文件属性条件
+ * const std::function<bool(const FileRecord &)> &onRecord - 每条记录的回调，返回 false 时停止
+ * Return: bool - 查询是否成功
+ */
+bool FileIndexDatabase::queryFiles(const FileFilter &filter, const std::function<bool(const FileRecord &)> &onRecord) {
+    if (!db.isOpen()) {
+        LOG_ERROR("数据库未打开，无法查询文件。");
+        return false;
+    }
+
+    QVariantList values;
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT path, name, extension, last_modified FROM files" + whereClause(filter, values));
+    for (const QVariant &value : values) {
+        query.addBindValue(value);
+    }
+    if (!query.exec()) {
+        QString errorMessage = QString("执行文件查询失败: %1").arg(query.lastError().text());
+        qDebug() << errorMessage;
+        LOG_ERROR(errorMessage);
+        return false;
+    }
+
+    while (query.next()) {
+        if (!onRecord(recordFrom(query))) {
+            break;
+        }
+    }
+    return true;
+}
+
+/*
+ * Summary: 按路径批量读取记录，每批一次 IN 查询走 path 唯一索引
+ * Parameters:
+ * const QVector<QString> &paths - 文件路径
+ * const std::function<void(const FileRecord &)> &onRecord - 每条记录的回调
+ * Return: bool - 查询是否成功
+ */
+bool FileIndexDatabase::lookupFiles(const QVector<QString> &paths, const std::function<void(const FileRecord &)> &onRecord) {
+    if (!db.isOpen()) {
+        LOG_ERROR("数据库未打开，无法查询文件。");
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    for (qsizetype start = 0; start < paths.size(); start += LookupBatchSize) {
+        const qsizetype count = qMin<qsizetype>(LookupBatchSize, paths.size() - start);
+        QStringList placeholders;
+        for (qsizetype i = 0; i < count; ++i) {
+            placeholders << "?";
+        }
+        query.prepare("SELECT path, name, extension, last_modified FROM files WHERE path IN (" + placeholders.join(',') + ")");
+        for (qsizetype i = 0; i < count; ++i) {
+            query.addBindValue(paths[start + i]);
+        }
+        if (!query.exec()) {
+            QString errorMessage = QString("批量查询文件失败: %1").arg(query.lastError().text());
+            qDebug() << errorMessage;
+            LOG_ERROR(errorMessage);
+            return false;
+        }
+        while (query.next()) {
+            onRecord(recordFrom(query));
+        }
+    }
+    return true;
+}
+
+/*
+ * Summary: 按 (设备号, inode) 批量查找文件的当前路径，用于文件移动后找回标签
+ * Parameters:
+ * const QVector<FileIdentity> &identities - 文件标识
+ * Return: QVector<QString> - 与 identities 一一对应的路径，索引中没有的为空串
+ */
+QVector<QString> FileIndexDatabase::resolveIdentities(const QVector<FileIdentity> &identities) {
+    QVector<QString> paths(identities.size());
+    if (!db.isOpen()) {
+        LOG_ERROR("数据库未打开，无法查询文件标识。");
+        return paths;
+    }
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT path FROM files WHERE device = ? AND inode = ? LIMIT 1");
+    for (qsizetype i = 0; i < identities.size(); ++i) {
+        if (!identities[i].isValid()) {
+            continue;
+        }
+        query.bindValue(0, qint64(identities[i].device));
+        query.bindValue(1, qint64(identities[i].inode));
+        if (!query.exec()) {
+            QString errorMessage = QString("按标识查询文件失败: %1").arg(query.lastError().text());
+            qDebug() << errorMessage;
+            LOG_ERROR(errorMessage);
+            return paths;
+        }
+        if (query.next()) {
+            paths[i] = query.value(0).toString();
+        }
+    }
+    return paths;
+}
@@ -8,25 +8,67 @@
 #include <QString>
 #include <QSqlDatabase>
 #include <QVector>
+#include <QSet>
+#include <QDateTime>
+#include <atomic>
+#include <functional>
 
 #include "AbstractDatabase.h"
+#include "FileIdentity.h"
+
+// 文件索引中的一条记录
+struct FileRecord {
+    QString path;
+    QString name;
+    QString extension;
+    QString lastModified;  // yyyy-MM-dd HH:mm:ss，可按字符串比较
+};
+
+// 文件属性条件，各条件之间为 AND，空条件不限制
+struct FileFilter {
+    QString nameContains;   // 文件名包含，不区分大小写
+    QString pathContains;   // 路径包含，不区分大小写
+    QString extension;      // 扩展名，不区分大小写
+    QDateTime modifiedFrom; // 修改时间下限（含），无效表示不限制
+    QDateTime modifiedTo;   // 修改时间上限（不含），无效表示不限制
+
+    bool isEmpty() const;
+    bool matches(const FileRecord &record) const;  // 与 SQL 条件语义相同，用于抽样估计和索引外的文件
+};
 
 class FileIndexDatabase : public AbstractDatabase {
 public:
-    explicit FileIndexDatabase(const QString &dbName);
+    explicit FileIndexDatabase(const QString &dbName, const QString &connectionName = "file_db_connection");
     ~FileIndexDatabase() override;
 
     bool openDatabase() override;      // 打开数据库
     void closeDatabase() override;     // 关闭数据库
     bool createTables() override;      // 创建表，返回是否成功
 
-    bool insertFileInfo(const QString &filePath);                 // 插入文件信息，返回是否成功
+    bool insertFileInfo(const QString &filePath);                 // 插入或更新文件信息，已有记录保留原 ID，返回是否成功
+    qint64 removeMissingFiles(const QString &root, const QSet<QString> &seen);  // 删除 root 下本次遍历未见到的记录，返回删除数，失败时返回 -1
     void insertFileKeywords(int fileId, const QVector<QString> &keywords); // 插入关键词
     QVector<QString> searchFiles(const QString &keyword);         // 搜索文件
     int getFileId(const QString &filePath);                       // 获取文件ID
+    qint64 fileCount();                                           // 索引中的文件数，失败时返回 -1
+
+    qint64 estimateMatches(const FileFilter &filter, int sampleSize = 512);  // 随机抽样估计满足条件的文件数
+    bool queryFiles(const FileFilter &filter, const std::function<bool(const FileRecord &)> &onRecord);  // 流式输出满足条件的文件，回调返回 false 时停止
+    bool lookupFiles(const QVector<QString> &paths, const std::function<void(const FileRecord &)> &onRecord);  // 批量读取指定路径的记录，不在索引中的路径被跳过
+    QVector<QString> resolveIdentities(const QVector<FileIdentity> &identities);  // 按 (设备号, inode) 批量查找当前路径，找不到的为空串
+
+    quint64 generation() const;                                   // 当前索引代数，索引变化后递增
+    bool exportSnapshot(const QString &snapshotPath);             // 导出只读二进制快照
 
 private:
+    bool loadGeneration();                                        // 从 meta 表读取索引代数
+    bool addIdentityColumns();                                    // 旧数据库的 files 表补上 device、inode 列
+    void markIndexChanged();                                      // 自上次导出后首次修改时递增代数
+
     QSqlDatabase db; // 数据库连接对象
+    QString connectionName; // 连接名
+    std::atomic<quint64> currentGeneration; // 索引代数
+    std::atomic<bool> generationBumped;     // 本代数是否已因修改而递增
 };
 
 #endif // FILEDATABASE_H
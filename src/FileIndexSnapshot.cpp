@@ -0,0 +1,311 @@
+/*
+ * FileIndexSnapshot.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 文件索引只读二进制快照实现
+ */
+
+#include <QSaveFile>
+#include <QHash>
+#include <QByteArray>
+#include <cstring>
+#include <vector>
+
+#include "FileIndexSnapshot.h"
+#include "Logger.h"
+
+namespace {
+
+const char SnapshotMagic[8] = { 'F', 'T', 'S', 'N', 'A', 'P', '0', '1' };
+
+inline char asciiLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+/*
+ * Summary: ASCII 大小写不敏感的子串查找，与 SQLite LIKE 的大小写规则保持一致
+ * Parameters:
+ * const char *haystack - 被查找的字节串
+ * quint32 length - 字节串长度
+ * const QByteArray &lowerNeedle - 已转为小写的查找串
+ * Return: bool - 是否包含
+ */
+bool containsIgnoreAsciiCase(const char *haystack, quint32 length, const QByteArray &lowerNeedle) {
+    const int needleLength = lowerNeedle.size();
+    if (needleLength == 0) {
+        return true;
+    }
+    if (length < quint32(needleLength)) {
+        return false;
+    }
+    const char *needle = lowerNeedle.constData();
+    const quint32 last = length - quint32(needleLength);
+    for (quint32 i = 0; i <= last; ++i) {
+        if (asciiLower(haystack[i]) != needle[0]) {
+            continue;
+        }
+        int j = 1;
+        while (j < needleLength && asciiLower(haystack[i + j]) == needle[j]) {
+            ++j;
+        }
+        if (j == needleLength) {
+            return true;
+        }
+    }
+    return false;
+}
+
+quint64 alignTo8(quint64 value) {
+    return (value + 7) & ~quint64(7);
+}
+
+// [offset, offset + length) 是否落在 [0, limit) 内，不会因加法溢出而误判
+bool fitsIn(quint64 offset, quint64 length, quint64 limit) {
+    return offset <= limit && length <= limit - offset;
+}
+
+} // namespace
+
+FileIndexSnapshot::FileIndexSnapshot()
+    : base(nullptr), header(nullptr), dirs(nullptr), files(nullptr), arena(nullptr) {}
+
+FileIndexSnapshot::~FileIndexSnapshot() {
+    close();
+}
+
+/*
+ * Summary: 映射快照文件并校验头部、各段边界以及每个目录项与文件项的偏移，
+ *          通过校验后查询时不再逐项检查
+ * Parameters:
+ * const QString &snapshotPath - 快照文件路径
+ * Return: bool - 是否成功
+ */
+bool FileIndexSnapshot::open(const QString &snapshotPath) {
+    close();
+
+    file.setFileName(snapshotPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        LOG_INFO("索引快照不存在或无法打开：" + snapshotPath);
+        return false;
+    }
+
+    const qint64 size = file.size();
+    if (size < qint64(sizeof(Header))) {
+        LOG_WARNING("索引快照文件过小，忽略：" + snapshotPath);
+        close();
+        return false;
+    }
+
+    base = file.map(0, size);
+    if (!base) {
+        LOG_WARNING("索引快照映射失败：" + file.errorString());
+        close();
+        return false;
+    }
+
+    const Header *candidate = reinterpret_cast<const Header *>(base);
+    const quint64 fileSize = quint64(size);
+    bool ok = std::memcmp(candidate->magic, SnapshotMagic, sizeof(SnapshotMagic)) == 0
+              && candidate->version == FormatVersion
+              && candidate->headerSize == sizeof(Header)
+              && candidate->dirTableOffset % 8 == 0
+              && candidate->fileTableOffset % 8 == 0
+              && fitsIn(candidate->dirTableOffset, quint64(candidate->dirCount) * sizeof(DirEntry), fileSize)
+              && fitsIn(candidate->fileTableOffset, quint64(candidate->fileCount) * sizeof(FileEntry), fileSize)
+              && fitsIn(candidate->arenaOffset, candidate->arenaSize, fileSize);
+    if (!ok) {
+        LOG_WARNING("索引快照格式或版本不匹配，忽略：" + snapshotPath);
+        close();
+        return false;
+    }
+
+    const DirEntry *dirTable = reinterpret_cast<const DirEntry *>(base + candidate->dirTableOffset);
+    const FileEntry *fileTable = reinterpret_cast<const FileEntry *>(base + candidate->fileTableOffset);
+    for (quint32 i = 0; i < candidate->dirCount && ok; ++i) {
+        ok = fitsIn(dirTable[i].pathOffset, dirTable[i].pathLength, candidate->arenaSize);
+    }
+    for (quint32 i = 0; i < candidate->fileCount && ok; ++i) {
+        ok = fileTable[i].dirIndex < candidate->dirCount
+             && fitsIn(fileTable[i].nameOffset, fileTable[i].nameLength, candidate->arenaSize);
+    }
+    if (!ok) {
+        LOG_WARNING("索引快照条目越界，文件已损坏，忽略：" + snapshotPath);
+        close();
+        return false;
+    }
+
+    header = candidate;
+    dirs = dirTable;
+    files = fileTable;
+    arena = reinterpret_cast<const char *>(base + header->arenaOffset);
+
+    LOG_INFO(QString("索引快照已映射：%1 个文件，%2 个目录，代数 %3")
+                     .arg(header->fileCount)
+                     .arg(header->dirCount)
+                     .arg(header->generation));
+    return true;
+}
+
+void FileIndexSnapshot::close() {
+    if (base) {
+        file.unmap(const_cast<uchar *>(base));
+    }
+    if (file.isOpen()) {
+        file.close();
+    }
+    base = nullptr;
+    header = nullptr;
+    dirs = nullptr;
+    files = nullptr;
+    arena = nullptr;
+}
+
+bool FileIndexSnapshot::isValid() const {
+    return header != nullptr;
+}
+
+quint64 FileIndexSnapshot::generation() const {
+    return header ? header->generation : 0;
+}
+
+quint32 FileIndexSnapshot::fileCount() const {
+    return header ? header->fileCount : 0;
+}
+
+/*
+ * Summary: 拼接目录与文件名得到完整路径
+ * Parameters:
+ * quint32 fileIndex - 文件表下标
+ * Return: QString - 文件完整路径
+ */
+QString FileIndexSnapshot::filePath(quint32 fileIndex) const {
+    const FileEntry &entry = files[fileIndex];
+    const DirEntry &dir = dirs[entry.dirIndex];
+    QByteArray bytes;
+    bytes.reserve(int(dir.pathLength + entry.nameLength));
+    bytes.append(arena + dir.pathOffset, int(dir.pathLength));
+    bytes.append(arena + entry.nameOffset, int(entry.nameLength));
+    return QString::fromUtf8(bytes);
+}
+
+/*
+ * Summary: 在快照中搜索路径或文件名包含关键字的文件
+ * Parameters:
+ * const QString &keyword - 搜索关键字
+ * Return: QVector<QString> - 匹配的文件路径列表
+ */
+QVector<QString> FileIndexSnapshot::searchFiles(const QString &keyword) const {
+    QVector<QString> resultPaths;
+    if (!isValid() || keyword.isEmpty()) {
+        return resultPaths;
+    }
+
+    QByteArray needle = keyword.toUtf8();
+    for (char &c : needle) {
+        c = asciiLower(c);
+    }
+
+    // 目录串只匹配一次，文件只需检查自身文件名
+    std::vector<char> dirMatched(header->dirCount, 0);
+    for (quint32 i = 0; i < header->dirCount; ++i) {
+        const DirEntry &dir = dirs[i];
+        dirMatched[i] = containsIgnoreAsciiCase(arena + dir.pathOffset, dir.pathLength, needle);
+    }
+
+    // 关键字跨越目录与文件名边界时需要检查完整路径
+    const bool spansSeparator = needle.contains('/');
+    QByteArray joined;
+
+    for (quint32 i = 0; i < header->fileCount; ++i) {
+        const FileEntry &entry = files[i];
+        bool matched = dirMatched[entry.dirIndex]
+                       || containsIgnoreAsciiCase(arena + entry.nameOffset, entry.nameLength, needle);
+        if (!matched && spansSeparator) {
+            const DirEntry &dir = dirs[entry.dirIndex];
+            joined.clear();
+            joined.append(arena + dir.pathOffset, int(dir.pathLength));
+            joined.append(arena + entry.nameOffset, int(entry.nameLength));
+            matched = containsIgnoreAsciiCase(joined.constData(), quint32(joined.size()), needle);
+        }
+
+        if (matched) {
+            resultPaths.append(filePath(i));
+        }
+    }
+
+    LOG_INFO(QString("快照搜索完成，找到 %1 个匹配文件。").arg(resultPaths.size()));
+    return resultPaths;
+}
+
+/*
+ * Summary: 生成快照文件
+ * Parameters:
+ * const QString &snapshotPath - 快照文件路径
+ * quint64 generation - 当前索引代数
+ * const QVector<QString> &filePaths - 按路径排序的文件列表
+ * Return: bool - 是否成功
+ */
+bool FileIndexSnapshot::write(const QString &snapshotPath, quint64 generation, const QVector<QString> &filePaths) {
+    QByteArray arenaBytes;
+    QVector<DirEntry> dirTable;
+    QVector<FileEntry> fileTable;
+    QHash<QString, quint32> dirIndex;
+    fileTable.reserve(filePaths.size());
+
+    for (const QString &path : filePaths) {
+        const int slash = path.lastIndexOf('/');
+        const QString dir = path.left(slash + 1);
+        const QByteArray name = path.mid(slash + 1).toUtf8();
+
+        quint32 dirId;
+        auto it = dirIndex.constFind(dir);
+        if (it == dirIndex.constEnd()) {
+            const QByteArray dirBytes = dir.toUtf8();
+            dirId = quint32(dirTable.size());
+            dirTable.append({ quint64(arenaBytes.size()), quint32(dirBytes.size()), 0 });
+            arenaBytes.append(dirBytes);
+            dirIndex.insert(dir, dirId);
+        } else {
+            dirId = it.value();
+        }
+
+        fileTable.append({ quint64(arenaBytes.size()), quint32(name.size()), dirId });
+        arenaBytes.append(name);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, SnapshotMagic, sizeof(SnapshotMagic));
+    header.version = FormatVersion;
+    header.headerSize = sizeof(Header);
+    header.generation = generation;
+    header.dirCount = quint32(dirTable.size());
+    header.fileCount = quint32(fileTable.size());
+    header.dirTableOffset = sizeof(Header);
+    header.fileTableOffset = header.dirTableOffset + quint64(dirTable.size()) * sizeof(DirEntry);
+    const quint64 tablesEnd = header.fileTableOffset + quint64(fileTable.size()) * sizeof(FileEntry);
+    header.arenaOffset = alignTo8(tablesEnd);
+    header.arenaSize = quint64(arenaBytes.size());
+
+    QSaveFile out(snapshotPath);
+    if (!out.open(QIODevice::WriteOnly)) {
+        LOG_ERROR("无法写入索引快照：" + out.errorString());
+        return false;
+    }
+
+    const qint64 padding = qint64(header.arenaOffset - tablesEnd);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    out.write(reinterpret_cast<const char *>(dirTable.constData()), qint64(dirTable.size()) * qint64(sizeof(DirEntry)));
+    out.write(reinterpret_cast<const char *>(fileTable.constData()), qint64(fileTable.size()) * qint64(sizeof(FileEntry)));
+    out.write(QByteArray(int(padding), '\0'));
+    out.write(arenaBytes);
+
+    if (!out.commit()) {
+        LOG_ERROR("提交索引快照失败：" + out.errorString());
+        return false;
+    }
+
+    LOG_INFO(QString("索引快照已导出：%1 个文件，代数 %2").arg(fileTable.size()).arg(generation));
+    return true;
+}
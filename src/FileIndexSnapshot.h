@@ -0,0 +1,85 @@
+/*
+ * FileIndexSnapshot.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 文件索引只读二进制快照，启动时 mmap 后直接查询，无需解析
+ */
+
+#ifndef FILEINDEXSNAPSHOT_H
+#define FILEINDEXSNAPSHOT_H
+
+#include <QString>
+#include <QVector>
+#include <QFile>
+
+/*
+ * 快照文件布局（小端，所有偏移均相对文件起始位置）：
+ *   Header
+ *   DirEntry[dirCount]       目录表，目录路径带结尾的 '/'
+ *   FileEntry[fileCount]     文件表，按完整路径排序
+ *   arena                    UTF-8 字符串池，从 8 字节对齐处开始
+ * 快照携带导出时的索引代数（generation），与数据库不一致即视为失效。
+ */
+class FileIndexSnapshot {
+public:
+    static constexpr quint32 FormatVersion = 2;   // 2：去掉了没有使用的文件名排序表
+
+    FileIndexSnapshot();
+    ~FileIndexSnapshot();
+
+    FileIndexSnapshot(const FileIndexSnapshot&) = delete;
+    FileIndexSnapshot& operator=(const FileIndexSnapshot&) = delete;
+
+    bool open(const QString &snapshotPath);   // 映射快照文件并校验
+    void close();                             // 解除映射
+    bool isValid() const;
+
+    quint64 generation() const;               // 导出时的索引代数
+    quint32 fileCount() const;
+
+    // 路径（含文件名）包含关键字，只对 ASCII 字母不区分大小写，% 与 _ 按字面匹配；
+    // 与 FileIndexDatabase::searchFiles 的路径条件一致，但不查 file_keywords 表
+    QVector<QString> searchFiles(const QString &keyword) const;
+
+    // 由文件路径列表生成快照，先写入临时文件再原子替换
+    static bool write(const QString &snapshotPath, quint64 generation, const QVector<QString> &filePaths);
+
+private:
+    struct Header {
+        char magic[8];
+        quint32 version;
+        quint32 headerSize;
+        quint64 generation;
+        quint32 dirCount;
+        quint32 fileCount;
+        quint64 dirTableOffset;
+        quint64 fileTableOffset;
+        quint64 arenaOffset;
+        quint64 arenaSize;
+    };
+
+    struct DirEntry {
+        quint64 pathOffset;
+        quint32 pathLength;
+        quint32 reserved;
+    };
+
+    struct FileEntry {
+        quint64 nameOffset;
+        quint32 nameLength;
+        quint32 dirIndex;
+    };
+
+    QString filePath(quint32 fileIndex) const;
+
+    QFile file;
+    const uchar *base;
+    const Header *header;
+    const DirEntry *dirs;
+    const FileEntry *files;
+    const char *arena;
+};
+
+#endif // FILEINDEXSNAPSHOT_H
@@ -0,0 +1,347 @@
+/*
+ * FileQueryEngine.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 标签与文件索引联合查询实现
+ */
+
+#include <QDate>
+#include <QFileInfo>
+#include <QSet>
+#include <QElapsedTimer>
+#include <stdexcept>
+#include <algorithm>
+
+#include "FileQueryEngine.h"
+#include "FileTagSystem.h"
+#include "TagQuery.h"
+#include "Logger.h"
+
+namespace {
+
+const int TagBatchSize = 2000;  // 先标签计划中每批按路径查索引的文件数
+
+// 按空白切分，双引号内的空白不切分，引号保留给标签表达式
+QStringList tokenize(const QString &text) {
+    QStringList tokens;
+    QString current;
+    bool quoted = false;
+    for (QChar c : text) {
+        if (c == '"') {
+            quoted = !quoted;
+        }
+        if (c.isSpace() && !quoted) {
+            if (!current.isEmpty()) {
+                tokens << current;
+                current.clear();
+            }
+        } else {
+            current += c;
+        }
+    }
+    if (quoted) {
+        throw std::invalid_argument("查询中的引号不成对");
+    }
+    if (!current.isEmpty()) {
+        tokens << current;
+    }
+    return tokens;
+}
+
+QString unquote(QString value) {
+    if (value.size() >= 2 && value.startsWith('"') && value.endsWith('"')) {
+        value = value.mid(1, value.size() - 2);
+    }
+    if (value.isEmpty()) {
+        throw std::invalid_argument("查询条件缺少取值");
+    }
+    return value;
+}
+
+QDateTime startOfDay(const QString &value) {
+    const QDate date = QDate::fromString(value, Qt::ISODate);
+    if (!date.isValid()) {
+        throw std::invalid_argument(QString("无法识别的日期：%1，应为 yyyy-MM-dd").arg(value).toStdString());
+    }
+    return date.startOfDay();
+}
+
+const char *const ModifiedOperators[] = { ">=", "<=", ">", "<", ":" };
+
+// modified 之后紧跟运算符才是修改时间条件，modified、modified_docs 之类仍是标签
+bool isModifiedCondition(const QString &lowerToken) {
+    if (!lowerToken.startsWith("modified")) {
+        return false;
+    }
+    const QString rest = lowerToken.mid(int(qstrlen("modified")));
+    return std::any_of(std::begin(ModifiedOperators), std::end(ModifiedOperators),
+                       [&rest](const char *op) { return rest.startsWith(op); });
+}
+
+// 解析 modified 条件，运算符之后为日期或 today/week/month/year
+void parseModified(const QString &token, FileFilter &filter) {
+    const QString rest = token.mid(int(qstrlen("modified")));
+    for (const char *op : ModifiedOperators) {
+        if (!rest.startsWith(op)) {
+            continue;
+        }
+        const QString value = unquote(rest.mid(int(qstrlen(op)))).toLower();
+        const QString opText = op;
+        if (opText == ">=") {
+            filter.modifiedFrom = startOfDay(value);
+        } else if (opText == ">") {
+            filter.modifiedFrom = startOfDay(value).addDays(1);
+        } else if (opText == "<") {
+            filter.modifiedTo = startOfDay(value);
+        } else if (opText == "<=") {
+            filter.modifiedTo = startOfDay(value).addDays(1);
+        } else {
+            const QDate today = QDate::currentDate();
+            QDate from;
+            if (value == "today") {
+                from = today;
+            } else if (value == "week") {
+                from = today.addDays(1 - today.dayOfWeek());
+            } else if (value == "month") {
+                from = QDate(today.year(), today.month(), 1);
+            } else if (value == "year") {
+                from = QDate(today.year(), 1, 1);
+            }
+            if (from.isValid()) {
+                filter.modifiedFrom = from.startOfDay();
+                filter.modifiedTo = QDateTime();
+            } else {
+                filter.modifiedFrom = startOfDay(value);
+                filter.modifiedTo = filter.modifiedFrom.addDays(1);
+            }
+        }
+        return;
+    }
+    throw std::invalid_argument(QString("无法识别的修改时间条件：%1").arg(token).toStdString());
+}
+
+const char *planName(FileQueryEngine::Plan plan) {
+    switch (plan) {
+        case FileQueryEngine::Plan::TagOnly: return "仅标签";
+        case FileQueryEngine::Plan::IndexOnly: return "仅索引";
+        case FileQueryEngine::Plan::TagFirst: return "先标签";
+        case FileQueryEngine::Plan::IndexFirst: return "先索引";
+    }
+    return "";
+}
+
+} // namespace
+
+FileQueryEngine::FileQueryEngine(const FileTagSystem &tagSystem, const QString &indexPath)
+    : tagSystem(tagSystem), database(indexPath, "file_query_connection"), indexOpened(false) {}
+
+FileQueryEngine::~FileQueryEngine() = default;
+
+// 首次需要索引时才打开连接
+bool FileQueryEngine::openIndex() {
+    if (!indexOpened) {
+        indexOpened = database.openDatabase();
+    }
+    return indexOpened;
+}
+
+/*
+ * Summary: 解析查询文本，文件属性条件与标签表达式分开
+ * Parameters:
+ * const QString &text - 查询文本
+ * Return: Query - 解析结果
+ */
+FileQueryEngine::Query FileQueryEngine::parse(const QString &text) {
+    Query query;
+    QStringList tagTokens;
+    for (const QString &token : tokenize(text)) {
+        const QString lower = token.toLower();
+        if (lower.startsWith("name:")) {
+            query.filter.nameContains = unquote(token.mid(5));
+        } else if (lower.startsWith("path:")) {
+            query.filter.pathContains = unquote(token.mid(5));
+        } else if (lower.startsWith("ext:")) {
+            QString extension = unquote(token.mid(4));
+            query.filter.extension = extension.startsWith('.') ? extension.mid(1) : extension;
+        } else if (isModifiedCondition(lower)) {
+            parseModified(lower, query.filter);
+        } else {
+            tagTokens << token;
+        }
+    }
+
+    query.tagExpression = tagTokens.join(' ').toStdString();
+    if (query.tagExpression.empty() && query.filter.isEmpty()) {
+        throw std::invalid_argument("查询为空");
+    }
+    if (!query.tagExpression.empty()) {
+        TagQuery::parse(query.tagExpression);  // 提前检查标签表达式语法
+    }
+    return query;
+}
+
+/*
+ * Summary: 选择执行计划。标签侧结果数由位图精确得到，索引侧按主键随机抽样估计，
+ *          从结果较少的一侧出发，另一侧只做逐条检查
+ * Parameters:
+ * const Query &query - 查询
+ * Return: Explain - 计划与两侧的结果数估计
+ */
+FileQueryEngine::Explain FileQueryEngine::explain(const Query &query) {
+    Explain result{ Plan::TagOnly, -1, -1 };
+    const bool hasTags = !query.tagExpression.empty();
+    if (hasTags) {
+        result.tagCardinality = qint64(tagSystem.countFiles(query.tagExpression));
+    }
+    if (query.filter.isEmpty()) {
+        return result;
+    }
+
+    if (openIndex()) {
+        result.indexEstimate = database.estimateMatches(query.filter);
+    }
+    if (!hasTags) {
+        result.plan = Plan::IndexOnly;
+    } else if (result.indexEstimate < 0 || result.tagCardinality <= result.indexEstimate) {
+        result.plan = Plan::TagFirst;
+    } else {
+        result.plan = Plan::IndexFirst;
+    }
+    return result;
+}
+
+/*
+ * Summary: 执行查询，结果逐条交给回调
+ * Parameters:
+ * const Query &query - 查询
+ * const ResultCallback &onResult - 结果回调，返回 false 时停止
+ * Return: qint64 - 输出的结果数
+ */
+qint64 FileQueryEngine::run(const Query &query, const ResultCallback &onResult) {
+    QElapsedTimer timer;
+    timer.start();
+
+    const Explain plan = explain(query);
+    qint64 emitted = 0;
+    switch (plan.plan) {
+        case Plan::TagOnly:
+            tagSystem.queryFiles(query.tagExpression, TagBatchSize, [&](const std::vector<std::string> &files) {
+                for (const auto &file : files) {
+                    ++emitted;
+                    if (!onResult(QString::fromStdString(file))) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+            break;
+        case Plan::TagFirst:
+            emitted = runTagFirst(query, onResult);
+            break;
+        case Plan::IndexOnly:
+        case Plan::IndexFirst:
+            emitted = runIndexFirst(query, onResult);
+            break;
+    }
+
+    LOG_INFO(QString("联合查询计划：%1，标签结果 %2，索引估计 %3，输出 %4 个文件，耗时 %5 毫秒。")
+                     .arg(planName(plan.plan))
+                     .arg(plan.tagCardinality)
+                     .arg(plan.indexEstimate)
+                     .arg(emitted)
+                     .arg(timer.elapsed()));
+    return emitted;
+}
+
+// 先标签：标签结果从位图中分批展开，每批按路径查索引，不在索引中的文件直接读取文件系统属性
+qint64 FileQueryEngine::runTagFirst(const Query &query, const ResultCallback &onResult) {
+    qint64 emitted = 0;
+    bool stopped = false;
+    auto offer = [&](const FileRecord &record) {
+        if (!stopped && query.filter.matches(record)) {
+            ++emitted;
+            stopped = !onResult(record.path);
+        }
+    };
+
+    tagSystem.queryFiles(query.tagExpression, TagBatchSize, [&](const std::vector<std::string> &files) {
+        QVector<QString> batch;
+        batch.reserve(qsizetype(files.size()));
+        for (const auto &file : files) {
+            batch.append(QString::fromStdString(file));
+        }
+
+        QSet<QString> indexed;
+        if (indexOpened) {
+            database.lookupFiles(batch, [&](const FileRecord &record) {
+                indexed.insert(record.path);
+                offer(record);
+            });
+        }
+        for (const QString &path : batch) {
+            if (stopped) {
+                break;
+            }
+            if (indexed.contains(path)) {
+                continue;
+            }
+            QFileInfo info(path);
+            if (info.exists()) {
+                offer({ path, info.fileName(), info.suffix(), info.lastModified().toString("yyyy-MM-dd HH:mm:ss") });
+            }
+        }
+        return !stopped;
+    });
+    return emitted;
+}
+
+// 先索引：流式扫描满足属性条件的文件，逐条按路径查文件ID并检查标签位图，标签结果不展开为路径；
+// 标签由 filetagd 持有时每 TagBatchSize 个文件交给它判断一次
+qint64 FileQueryEngine::runIndexFirst(const Query &query, const ResultCallback &onResult) {
+    if (!query.tagExpression.empty() && tagSystem.isRemote()) {
+        return runIndexFirstRemote(query, onResult);
+    }
+
+    std::function<bool(const std::string &)> tagged;
+    if (!query.tagExpression.empty()) {
+        tagged = tagSystem.tagMatcher(query.tagExpression);
+    }
+
+    qint64 emitted = 0;
+    database.queryFiles(query.filter, [&](const FileRecord &record) {
+        if (tagged && !tagged(record.path.toStdString())) {
+            return true;
+        }
+        ++emitted;
+        return onResult(record.path);
+    });
+    return emitted;
+}
+
+// 先索引且标签由 filetagd 持有：攒满一批路径后一次判断，回调返回 false 后不再扫描
+qint64 FileQueryEngine::runIndexFirstRemote(const Query &query, const ResultCallback &onResult) {
+    qint64 emitted = 0;
+    bool stopped = false;
+    std::vector<std::string> batch;
+    const auto flush = [&] {
+        for (const std::string &path : tagSystem.filterTagged(query.tagExpression, batch)) {
+            ++emitted;
+            if (!onResult(QString::fromStdString(path))) {
+                stopped = true;
+                break;
+            }
+        }
+        batch.clear();
+        return !stopped;
+    };
+    database.queryFiles(query.filter, [&](const FileRecord &record) {
+        batch.push_back(record.path.toStdString());
+        return batch.size() < size_t(TagBatchSize) || flush();
+    });
+    if (!stopped && !batch.empty()) {
+        flush();
+    }
+    return emitted;
+}
@@ -0,0 +1,66 @@
+/*
+ * FileQueryEngine.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 标签与文件索引的联合查询。例如 invoice name:2024 modified:month，
+ *          按两侧的结果数估计选择从较小的一侧出发，结果逐条流式输出
+ */
+
+#ifndef FILEQUERYENGINE_H
+#define FILEQUERYENGINE_H
+
+#include <QString>
+#include <functional>
+#include <string>
+
+#include "FileIndexDatabase.h"
+
+class FileTagSystem;
+
+class FileQueryEngine {
+public:
+    // 查询：标签表达式（TagQuery 语法）与文件属性条件，二者均可为空
+    struct Query {
+        std::string tagExpression;
+        FileFilter filter;
+    };
+
+    enum class Plan {
+        TagOnly,     // 只有标签条件
+        IndexOnly,   // 只有文件属性条件
+        TagFirst,    // 先取标签结果，再按路径批量查索引过滤
+        IndexFirst   // 先流式扫描索引，再逐条检查标签位图
+    };
+
+    struct Explain {
+        Plan plan;
+        qint64 tagCardinality;  // 标签表达式的精确结果数，-1 表示无标签条件
+        qint64 indexEstimate;   // 文件属性条件的抽样估计数，-1 表示无属性条件
+    };
+
+    using ResultCallback = std::function<bool(const QString &filePath)>;  // 返回 false 时停止查询
+
+    explicit FileQueryEngine(const FileTagSystem &tagSystem, const QString &indexPath = "file_index.db");
+    ~FileQueryEngine();
+
+    // 解析查询。name:、path:、ext:、modified>=日期、modified<日期、modified:today/week/month
+    // 为文件属性条件，其余部分为标签表达式；语法错误时抛出 std::invalid_argument
+    static Query parse(const QString &text);
+
+    Explain explain(const Query &query);                          // 选择执行计划
+    qint64 run(const Query &query, const ResultCallback &onResult);  // 执行查询，返回输出的结果数
+
+private:
+    qint64 runTagFirst(const Query &query, const ResultCallback &onResult);
+    qint64 runIndexFirst(const Query &query, const ResultCallback &onResult);
+    qint64 runIndexFirstRemote(const Query &query, const ResultCallback &onResult);
+    bool openIndex();
+
+    const FileTagSystem &tagSystem;
+    FileIndexDatabase database;  // 独立连接，不与搜索线程共用
+    bool indexOpened;
+};
+
+#endif // FILEQUERYENGINE_H
@@ -3,21 +3,29 @@
  * Author: Montee
  * CreateDate: 2024-11-1
  * Updater: Montee
- * UpdateDate: 2024-11-1
+ * UpdateDate: 2026-10-19
  * Summary: 文件搜索窗口类的实现文件
  */
 
 #include <QVBoxLayout>
 #include <QMessageBox>
 #include <QDir>
-#include <QFileInfo>
-#include <QStandardItem>
+#include <QHeaderView>
 #include <QCheckBox>
+#include <QThread>
 
 #include "Logger.h"
+#include "Trace.h"
+#include "IndexClient.h"
 #include "FileSearch.h"
 #include "ui_FileSearch.h"
 
+namespace {
+const int DaemonConnectTimeoutMs = 50;  // filetagd 未运行时连接立即失败，这只是上限
+const int DaemonReplyTimeoutMs = 2000;  // filetagd 只查索引，回复慢时不再等待，改为本地搜索
+const int FlushIntervalMs = 50;         // 搜索中结果加入表格的间隔
+}
+
 /*
  * Summary: 构造函数，初始化UI和成员变量
  * Parameters:
@@ -27,7 +35,8 @@
 FileSearch::FileSearch(QWidget *parent) :
         QWidget(parent),
         ui(new Ui::FileSearch),
-        searchCore(new FileSearchCore(this))
+        searchCore(nullptr),
+        searchId(0)
 {
     ui->setupUi(this);
 
@@ -40,20 +49,13 @@ FileSearch::FileSearch(QWidget *parent) :
     systemFilesCheckBox = ui->systemFilesCheckBox;
     systemFilesCheckBox->setChecked(false); // 默认不搜索系统文件
 
-    // 设置表格视图模型
-    tableModel = new QStandardItemModel(this);
-    tableModel->setHorizontalHeaderLabels({"序号", "文件名", "文件路径", "文件类型", "创建时间", "修改时间"});
-
-    // 设置代理模型
-    proxyModel = new QSortFilterProxyModel(this);
-    proxyModel->setSourceModel(tableModel);
-    proxyModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
-    proxyModel->setFilterKeyColumn(-1);
-    proxyModel->setSortRole(Qt::UserRole);
-
-    // 将代理模型设置到表格视图
-    resultTableView->setModel(proxyModel);
+    // 设置表格视图模型，排序与过滤都在模型内完成
+    resultModel = new CustomModel(this);
+    resultTableView->setModel(resultModel);
     resultTableView->horizontalHeader()->setStretchLastSection(true);
+    // 固定行高，视图不必逐行计算高度
+    resultTableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    resultTableView->verticalHeader()->setDefaultSectionSize(resultTableView->fontMetrics().height() + 6);
     resultTableView->setSortingEnabled(true);
     resultTableView->sortByColumn(0, Qt::AscendingOrder);
 
@@ -67,6 +69,10 @@ FileSearch::FileSearch(QWidget *parent) :
     connect(finishButton, &QPushButton::clicked, this, &FileSearch::onFinishButtonClicked);
     connect(filterLineEdit, &QLineEdit::textChanged, this, &FileSearch::onSearchFilterChanged);
 
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(FlushIntervalMs);
+    connect(&flushTimer, &QTimer::timeout, this, &FileSearch::flushPendingFiles);
+
     LOG_INFO("表格视图模型设置完成。");
 
     if (!layout()) {
@@ -76,13 +82,7 @@ FileSearch::FileSearch(QWidget *parent) :
         setLayout(layout);
     }
 
-    // 连接 FileSearchCore 的信号到槽函数
-    connect(searchCore, &FileSearchCore::fileFound, this, &FileSearch::onFileFound);
-    connect(searchCore, &FileSearchCore::searchFinished, this, &FileSearch::onSearchFinished);
-    connect(searchCore, &FileSearchCore::progressUpdated, this, &FileSearch::updateProgress);
-
-    // 初始化文件数据库
-    // searchCore->initFileDatabase();
+    // FileSearchCore 在第一次需要本地搜索时才创建，filetagd 运行时不打开索引数据库
 }
 
 /*
@@ -91,6 +91,10 @@ FileSearch::FileSearch(QWidget *parent) :
  * Return: 无
  */
 FileSearch::~FileSearch() {
+    // 查询 filetagd 的线程会把结果投递给本对象，析构前等它结束（最长为回复超时）
+    for (QThread *worker : findChildren<QThread *>(QString(), Qt::FindDirectChildrenOnly)) {
+        worker->wait();
+    }
     delete ui;
 }
 
@@ -119,9 +123,104 @@ void FileSearch::onSearchButtonClicked() {
         }
     }
 
-    tableModel->removeRows(0, tableModel->rowCount());
+    flushTimer.stop();
+    pendingFiles.clear();
+    resultModel->clear();
+
+    searchDaemon(searchKeyword, searchPath, includeSystemFiles);
+}
+
+/*
+ * Summary: 在工作线程中向 filetagd 查询索引，界面线程不等待连接与回复；结果按搜索路径过滤后成批投递到表格。
+ *          结束后由 onDaemonFinished 决定是否退回到本地搜索
+ * Parameters:
+ * const QString &keyword - 搜索关键字
+ * const QString &searchPath - 搜索路径，filetagd 返回整个索引中的结果，这里只保留该路径下的
+ * bool includeSystemFiles - 是否包含系统目录，随请求交给 filetagd
+ * Return: void
+ */
+void FileSearch::searchDaemon(const QString &keyword, const QString &searchPath, bool includeSystemFiles) {
+    const quint64 id = ++searchId;
+    QString prefix = QDir(searchPath).absolutePath();
+    if (!prefix.endsWith('/')) {
+        prefix += '/';
+    }
 
-    searchCore->startSearch(searchKeyword, searchPath, includeSystemFiles);
+    QThread *worker = QThread::create([this, id, keyword, searchPath, prefix, includeSystemFiles] {
+        IndexClient client;
+        bool answered = false;
+        if (client.connectToServer(DaemonConnectTimeoutMs)) {
+            client.setTimeout(DaemonReplyTimeoutMs);
+            qint64 kept = 0;
+            const QStringList request{keyword, QString(), includeSystemFiles ? "1" : "0"};
+            const bool ok = client.request(IndexProtocol::Type::Search, request, [&](const QStringList &paths) {
+                QStringList batch;
+                for (const QString &path : paths) {
+                    if (path.startsWith(prefix)) {
+                        batch.append(path);
+                    }
+                }
+                if (batch.isEmpty()) {
+                    return;
+                }
+                kept += batch.size();
+                QMetaObject::invokeMethod(this, [this, id, batch] {
+                    if (id == searchId) {
+                        TraceSpan span("ui_append_rows", batch.size());
+                        resultModel->addFiles(batch);
+                    }
+                }, Qt::QueuedConnection);
+            });
+            if (!ok) {
+                LOG_WARNING("filetagd 查询失败，改为本地搜索：" + client.errorString());
+            }
+            answered = ok && kept > 0;
+        }
+        QMetaObject::invokeMethod(this, [this, id, answered, keyword, searchPath, includeSystemFiles] {
+            onDaemonFinished(id, answered, keyword, searchPath, includeSystemFiles);
+        }, Qt::QueuedConnection);
+    });
+    worker->setParent(this);
+    connect(worker, &QThread::finished, worker, &QObject::deleteLater);
+    worker->start();
+}
+
+/*
+ * Summary: filetagd 查询结束。它未运行、查询失败或没有结果时与本地搜索一样退回到遍历目录
+ * Parameters:
+ * quint64 id - 发起查询时的搜索编号，已有更新的搜索时忽略
+ * bool answered - filetagd 是否给出了结果
+ * const QString &keyword - 搜索关键字
+ * const QString &searchPath - 搜索路径
+ * bool includeSystemFiles - 是否包含系统目录
+ * Return: void
+ */
+void FileSearch::onDaemonFinished(quint64 id, bool answered, const QString &keyword, const QString &searchPath,
+                                  bool includeSystemFiles) {
+    if (id != searchId) {
+        return;
+    }
+    if (answered) {
+        onSearchFinished();
+        return;
+    }
+    resultModel->clear();
+    localCore()->startSearch(keyword, searchPath, includeSystemFiles);
+}
+
+/*
+ * Summary: 本地搜索使用的 FileSearchCore，第一次调用时创建并连接信号
+ * Parameters: 无
+ * Return: FileSearchCore* - 搜索核心
+ */
+FileSearchCore *FileSearch::localCore() {
+    if (!searchCore) {
+        searchCore = new FileSearchCore(this);
+        connect(searchCore, &FileSearchCore::fileFound, this, &FileSearch::onFileFound);
+        connect(searchCore, &FileSearchCore::searchFinished, this, &FileSearch::onSearchFinished);
+        connect(searchCore, &FileSearchCore::progressUpdated, this, &FileSearch::updateProgress);
+    }
+    return searchCore;
 }
 
 /*
@@ -130,7 +229,10 @@ void FileSearch::onSearchButtonClicked() {
  * Return: void
  */
 void FileSearch::onFinishButtonClicked() {
-    searchCore->stopSearch();
+    ++searchId;  // 丢弃 filetagd 尚未送达的结果
+    if (searchCore) {
+        searchCore->stopSearch();
+    }
 }
 
 /*
@@ -140,44 +242,34 @@ void FileSearch::onFinishButtonClicked() {
  * Return: void
  */
 void FileSearch::onSearchFilterChanged(const QString &text) {
-    proxyModel->setFilterWildcard(text);
+    resultModel->setFilterWildcard(text);
 }
 
 /*
- * Summary: 处理文件找到的信号，更新UI
+ * Summary: 处理文件找到的信号。结果先暂存，由 flushTimer 定时成批加入表格
  * Parameters:
  * const QString &filePath - 文件路径
  * Return: void
  */
 void FileSearch::onFileFound(const QString &filePath) {
-    QFileInfo fileInfo(filePath);
-    QList<QStandardItem *> items;
-
-    QStandardItem *item0 = new QStandardItem(QString::number(tableModel->rowCount() + 1));
-    item0->setData(tableModel->rowCount() + 1, Qt::UserRole);
-    items.append(item0);
-
-    QStandardItem *item1 = new QStandardItem(fileInfo.fileName());
-    item1->setData(fileInfo.fileName(), Qt::UserRole);
-    items.append(item1);
-
-    QStandardItem *item2 = new QStandardItem(fileInfo.absoluteFilePath());
-    item2->setData(fileInfo.absoluteFilePath(), Qt::UserRole);
-    items.append(item2);
-
-    QStandardItem *item3 = new QStandardItem(fileInfo.suffix());
-    item3->setData(fileInfo.suffix(), Qt::UserRole);
-    items.append(item3);
-
-    QStandardItem *item4 = new QStandardItem(fileInfo.birthTime().toString("yyyy-MM-dd HH:mm:ss"));
-    item4->setData(fileInfo.birthTime(), Qt::UserRole);
-    items.append(item4);
-
-    QStandardItem *item5 = new QStandardItem(fileInfo.lastModified().toString("yyyy-MM-dd HH:mm:ss"));
-    item5->setData(fileInfo.lastModified(), Qt::UserRole);
-    items.append(item5);
+    pendingFiles.append(filePath);
+    if (!flushTimer.isActive()) {
+        flushTimer.start();
+    }
+}
 
-    tableModel->appendRow(items);
+/*
+ * Summary: 将暂存的结果一次加入表格，视图只收到一次插入通知
+ * Parameters: 无
+ * Return: void
+ */
+void FileSearch::flushPendingFiles() {
+    if (pendingFiles.isEmpty()) {
+        return;
+    }
+    TraceSpan span("ui_append_rows", pendingFiles.size());
+    resultModel->addFiles(pendingFiles);
+    pendingFiles.clear();
 }
 
 /*
@@ -186,6 +278,8 @@ void FileSearch::onFileFound(const QString &filePath) {
  * Return: void
  */
 void FileSearch::onSearchFinished() {
+    flushTimer.stop();
+    flushPendingFiles();
     QMessageBox::information(this, "搜索完成", "文件搜索已完成。");
 }
 
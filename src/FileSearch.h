@@ -3,7 +3,7 @@
  * Author: Montee
  * CreateDate: 2024-11-1
  * Updater: Montee
- * UpdateDate: 2024-11-1
+ * UpdateDate: 2026-10-19
  * Summary: 文件搜索窗口类的实现文件
  */
 
@@ -14,12 +14,13 @@
 #include <QLineEdit>
 #include <QTableView>
 #include <QPushButton>
-#include <QStandardItemModel>
 #include <QProgressBar>
 #include <QLabel>
-#include <QSortFilterProxyModel>
+#include <QStringList>
+#include <QTimer>
 #include <QCheckBox> // 添加 QCheckBox 头文件
 
+#include "CustomModel.h"
 #include "FileSearchCore.h"
 
 namespace Ui {
@@ -48,16 +49,23 @@ private:
     QLineEdit *pathLineEdit;
     QLineEdit *filterLineEdit;
     QTableView *resultTableView;
-    QStandardItemModel *tableModel;
-    QSortFilterProxyModel *proxyModel;
+    CustomModel *resultModel;
     QPushButton *finishButton;
     QProgressBar *progressBar;
     QLabel *progressLabel;
     QCheckBox *systemFilesCheckBox; // 新增复选框指针
 
 
-    FileSearchCore *searchCore;
+    FileSearchCore *searchCore;  // 只在需要本地搜索时创建
+    quint64 searchId;            // 每次搜索递增，filetagd 迟到的回复按此丢弃
+    QStringList pendingFiles;    // 尚未加入表格的结果
+    QTimer flushTimer;           // 攒够一段时间的结果后一次加入表格
 
+    void searchDaemon(const QString &keyword, const QString &searchPath, bool includeSystemFiles);
+    void onDaemonFinished(quint64 id, bool answered, const QString &keyword, const QString &searchPath,
+                          bool includeSystemFiles);
+    FileSearchCore *localCore();
+    void flushPendingFiles();
     void updateProgressLabel(int value, int total);
 };
 
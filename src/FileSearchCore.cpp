@@ -13,17 +13,36 @@
 #include <QMetaObject>
 
 #include "Logger.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include "FileSearchCore.h"
  // 初始化静态成员变量
 QVector<QString> FileSearchCore::filesBatch;
 
+namespace {
+const QString DatabaseFileName = "file_index.db";
+const QString SnapshotFileName = "file_index.snapshot";
+
+QString indexFile(const QString& directory, const QString& fileName) {
+    return directory.isEmpty() ? fileName : QDir(directory).filePath(fileName);
+}
+
+// 正常结束与中断的搜索都计入耗时
+MetricHistogram &searchDuration() {
+    static MetricHistogram &histogram = Metrics::histogram("filetag_search_duration_ms", "一次搜索的耗时（毫秒）");
+    return histogram;
+}
+}
+
 /*
  * Summary: 构造函数，初始化成员变量和数据库连接
  * Parameters:
  * QObject *parent - 父对象指针，默认值为 nullptr
+ * const QString& indexDirectory - 索引数据库与快照所在目录，为空时使用当前目录
  * Return: 无
  */
-FileSearchCore::FileSearchCore(QObject* parent)
+FileSearchCore::FileSearchCore(QObject* parent, const QString& indexDirectory)
     : QObject(parent),
     threadPool(new QThreadPool(this)),
     updateCounter(0),
@@ -32,15 +51,21 @@ FileSearchCore::FileSearchCore(QObject* parent)
     isSearching(false),
     firstSearch(true),
     isStopping(false),
-    db(new FileIndexDatabase("file_index.db")),
+    indexLoadTime(0),
+    snapshotPath(snapshotFile(indexDirectory)),
+    db(new FileIndexDatabase(databaseFile(indexDirectory))),
+    snapshot(new FileIndexSnapshot()),
     dbThread(new DatabaseThread(db, this)),
-    taskQueue(new QQueue<QString>()),
+    taskQueue(new QQueue<SearchTask>()),
     queueMutex(new QMutex()),
     queueCondition(new QWaitCondition()),
     includeSystemFiles(false)
 {
     threadPool->setMaxThreadCount(QThread::idealThreadCount());
 
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+
     // 初始化数据库并创建表
     if (db->openDatabase()) {
         if (!db->createTables()) {
@@ -51,7 +76,18 @@ FileSearchCore::FileSearchCore(QObject* parent)
         LOG_ERROR("数据库打开失败。");
     }
 
+    // 快照代数与数据库一致时才使用，否则等下一次遍历结束后重新导出
+    if (snapshot->open(snapshotPath) && snapshot->generation() != db->generation()) {
+        LOG_INFO(QString("索引快照已过期（快照代数 %1，数据库代数 %2）。")
+                         .arg(snapshot->generation())
+                         .arg(db->generation()));
+        snapshot->close();
+    }
+    indexLoadTime = loadTimer.elapsed();
+    LOG_INFO(QString("索引加载耗时: %1 毫秒（%2）").arg(indexLoadTime).arg(snapshot->isValid() ? "快照" : "数据库"));
+
     connect(dbThread, &DatabaseThread::fileInserted, this, &FileSearchCore::onFileInserted);
+    connect(dbThread, &DatabaseThread::snapshotExported, this, &FileSearchCore::onSnapshotExported);
 }
 
 /*
@@ -62,6 +98,8 @@ FileSearchCore::FileSearchCore(QObject* parent)
 FileSearchCore::~FileSearchCore() {
     stopAllTasks();
     threadPool->waitForDone();
+    delete dbThread;  // 等待数据库线程处理完剩余任务，之后才能关闭数据库
+    delete snapshot;
     db->closeDatabase();
     delete db;
     delete taskQueue;
@@ -69,6 +107,26 @@ FileSearchCore::~FileSearchCore() {
     delete queueCondition;
 }
 
+// 索引数据库文件路径
+QString FileSearchCore::databaseFile(const QString& indexDirectory) {
+    return indexFile(indexDirectory, DatabaseFileName);
+}
+
+// 索引快照文件路径
+QString FileSearchCore::snapshotFile(const QString& indexDirectory) {
+    return indexFile(indexDirectory, SnapshotFileName);
+}
+
+/*
+ * Summary: 设置遍历线程数，对之后开始的搜索生效
+ * Parameters:
+ * int count - 线程数，小于 1 时按 1 处理
+ * Return: void
+ */
+void FileSearchCore::setThreadCount(int count) {
+    threadPool->setMaxThreadCount(qMax(1, count));
+}
+
 /*
  * Summary: 开始文件搜索
  * Parameters:
@@ -90,6 +148,7 @@ void FileSearchCore::startSearch(const QString& keyword, const QString& path, bo
         return;
     }
 
+    sweepRoot.clear();
     QString searchPath = path;
     if (searchPath.isEmpty()) {
         searchPath = QDir::rootPath();
@@ -102,15 +161,19 @@ void FileSearchCore::startSearch(const QString& keyword, const QString& path, bo
         }
     }
 
+    TraceSpan startSpan("start_search");
     timer.start();
     LOG_INFO("搜索计时开始。");
+    FlightRecorder::record(FlightRecorder::Event::SearchStart, 0, 0, keyword);
+    static MetricCounter &searches = Metrics::counter("filetag_searches_total", "开始的搜索次数");
+    searches.add();
     activeTaskCount = 0;
     updateCounter = 0;
     totalDirectories = 0;
     isSearching = true;
 
-    // 使用数据库进行搜索
-    QVector<QString> results = db->searchFiles(keyword);
+    // 优先使用索引快照，其次使用数据库进行搜索
+    QVector<QString> results = queryIndex(keyword);
 
     if (!results.isEmpty()) {
         for (const QString& filePath : results) {
@@ -123,54 +186,135 @@ void FileSearchCore::startSearch(const QString& keyword, const QString& path, bo
     }
     else {
         LOG_INFO("数据库中没有结果，开始文件系统遍历搜索。");
-        uniquePaths.clear();
-        uniqueFiles.clear();
+        startTraversal(keyword, searchPath, includeSystemFiles);
+    }
+}
 
-        enqueueDirectories(searchPath, 2, includeSystemFiles);
+/*
+ * Summary: 遍历目录，将其中全部文件写入索引，不先查询已有索引；
+ *          与遍历搜索相同，每个文件发出 fileFound，完成后发出 searchFinished，之后由数据库线程重新导出快照
+ * Parameters:
+ * const QString &path - 要索引的目录
+ * bool includeSystemFiles - 是否包含系统目录
+ * Return: void
+ */
+void FileSearchCore::indexDirectory(const QString& path, bool includeSystemFiles) {
+    uniqueFiles.clear();
+    uniquePaths.clear();
 
-        totalDirectories = taskQueue->size();
-        emit progressUpdated(0, totalDirectories);
+    if (!QDir(path).exists()) {
+        LOG_INFO("指定的路径不存在。");
+        return;
+    }
 
-        for (int i = 0; i < threadPool->maxThreadCount(); ++i) {
-            FileSearchThread* task = new FileSearchThread(keyword, taskQueue, queueMutex, queueCondition);
-            connect(task, &FileSearchThread::fileFound, this, &FileSearchCore::onFileFound);
-            connect(task, &FileSearchThread::searchFinished, this, &FileSearchCore::onSearchFinished);
-            connect(task, &FileSearchThread::taskStarted, this, &FileSearchCore::onTaskStarted);
-            threadPool->start(task);
-        }
+    // 遍历得到的路径需与数据库中的绝对路径一致，才能据此找出已删除的文件
+    const QString root = QDir(path).absolutePath();
+    sweepRoot = root;
+
+    TraceSpan startSpan("start_index");
+    timer.start();
+    LOG_INFO("索引计时开始：" + path);
+    FlightRecorder::record(FlightRecorder::Event::SearchStart, 0, 0, path);
+    activeTaskCount = 0;
+    updateCounter = 0;
+    totalDirectories = 0;
+    isSearching = true;
+
+    startTraversal(QString(), root, includeSystemFiles);
+}
+
+/*
+ * Summary: 将 searchPath 及其下两层目录入队并启动遍历线程，每个条目只被遍历一次
+ * Parameters:
+ * const QString &keyword - 文件名关键字，为空时匹配全部文件
+ * const QString &searchPath - 遍历的根目录
+ * bool includeSystemFiles - 是否包含系统目录
+ * Return: void
+ */
+void FileSearchCore::startTraversal(const QString& keyword, const QString& searchPath, bool includeSystemFiles) {
+    uniquePaths.clear();
+
+    enqueueDirectories(searchPath, 2, includeSystemFiles);
+
+    totalDirectories = taskQueue->size();
+    FlightRecorder::record(FlightRecorder::Event::QueueDepth, totalDirectories);
+    static MetricGauge &queueDepth = Metrics::gauge("filetag_search_queue_depth", "待搜索的目录任务数");
+    queueDepth.set(totalDirectories);
+    emit progressUpdated(0, totalDirectories);
+
+    for (int i = 0; i < threadPool->maxThreadCount(); ++i) {
+        FileSearchThread* task = new FileSearchThread(keyword, taskQueue, queueMutex, queueCondition);
+        connect(task, &FileSearchThread::fileFound, this, &FileSearchCore::onFileFound);
+        connect(task, &FileSearchThread::searchFinished, this, &FileSearchCore::onSearchFinished);
+        connect(task, &FileSearchThread::taskStarted, this, &FileSearchCore::onTaskStarted);
+        threadPool->start(task);
+    }
+}
+
+/*
+ * Summary: 查询文件索引。快照有效时直接在映射内存上匹配，否则查询数据库；
+ *          启动后的首次查询会记录加载与查询耗时，用于比较两条路径的冷启动时间
+ * Parameters:
+ * const QString &keyword - 搜索关键字
+ * Return: QVector<QString> - 匹配的文件路径列表
+ */
+QVector<QString> FileSearchCore::queryIndex(const QString& keyword) {
+    TraceSpan span("index_query");
+    QElapsedTimer queryTimer;
+    queryTimer.start();
+
+    const bool useSnapshot = snapshot->isValid() && snapshot->generation() == db->generation();
+    QVector<QString> results = useSnapshot ? snapshot->searchFiles(keyword) : db->searchFiles(keyword);
+    FlightRecorder::record(FlightRecorder::Event::IndexQuery, results.size(), queryTimer.nsecsElapsed() / 1000);
+    span.setCount(results.size());
+    static MetricHistogram &queryLatency = Metrics::histogram("filetag_index_query_latency_us", "索引查询耗时（微秒）");
+    queryLatency.record(queryTimer.nsecsElapsed() / 1000);
+
+    if (firstSearch) {
+        firstSearch = false;
+        const qint64 queryTime = queryTimer.elapsed();
+        LOG_INFO(QString("启动后首次查询（%1）: 加载 %2 毫秒 + 查询 %3 毫秒 = %4 毫秒")
+                         .arg(useSnapshot ? "快照" : "数据库")
+                         .arg(indexLoadTime)
+                         .arg(queryTime)
+                         .arg(indexLoadTime + queryTime));
     }
+    return results;
 }
 
 /*
- * Summary: 将目录加入任务队列
+ * Summary: 将目录加入任务队列。depth 大于 0 的目录只列出自身的文件和子目录名，
+ *          子目录另行入队；到第 depth 层才递归遍历，避免同一子树被遍历两次
  * Parameters:
  * const QString &path - 目录路径
- * int depth - 深度
+ * int depth - 还需展开的层数
+ * bool includeSystemFiles - 是否包含系统目录
  * Return: void
  */
 void FileSearchCore::enqueueDirectories(const QString& path, int depth, bool includeSystemFiles) {
+    taskQueue->enqueue({ path, depth == 0 });
+    totalDirectories++;
+    if (depth == 0) {
+        return;
+    }
+
     QDirIterator dirIt(path, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::NoIteratorFlags);
     while (dirIt.hasNext()) {
         dirIt.next();
         QString subDirPath = dirIt.filePath();
 
         //检查复选框状态
-        LOG_INFO("Include system files: " + QString::number(includeSystemFiles));
+        LOG_DEBUG_LIMITED("Include system files: " + QString::number(includeSystemFiles));
 
         // 检查是否包含系统文件目录
         if (!includeSystemFiles && isSystemDirectory(subDirPath)) {
-            LOG_INFO("Skipping system directory: " + subDirPath);
+            LOG_DEBUG_LIMITED("Skipping system directory: " + subDirPath);
             continue;  // 跳过系统目录
         }
 
         if (!uniquePaths.contains(subDirPath)) {
             uniquePaths.insert(subDirPath);
-            taskQueue->enqueue(subDirPath);
-            totalDirectories++;
-
-            if (depth > 1) {
-                enqueueDirectories(subDirPath, depth - 1, includeSystemFiles);
-            }
+            enqueueDirectories(subDirPath, depth - 1, includeSystemFiles);
         }
     }
 }
@@ -215,8 +359,24 @@ void FileSearchCore::onSearchFinished() {
     if (activeTaskCount == 0 && taskQueue->isEmpty()) {
         finishSearch();
         qint64 elapsedTime = timer.elapsed();
+        FlightRecorder::record(FlightRecorder::Event::SearchStop, elapsedTime, 0);
+        searchDuration().record(elapsedTime);
         onSearchTime(elapsedTime);
         isSearching = false;
+
+        // 重新索引完整结束后清理根目录下本次未见到的记录；中途停止时 sweepRoot 已清空，不做清理
+        const bool sweeping = !sweepRoot.isEmpty();
+        if (sweeping) {
+            QMutexLocker filesLocker(&uniqueFilesMutex);
+            dbThread->addRemoveMissingTask(sweepRoot, uniqueFiles);
+            sweepRoot.clear();
+        }
+
+        // 遍历写入了新文件或删除了记录，旧快照已过期；在数据库线程上排在插入与清理任务之后重新导出
+        if (!uniqueFiles.isEmpty() || sweeping) {
+            snapshot->close();
+            dbThread->addExportSnapshotTask(snapshotPath);
+        }
         emit searchFinished();
     }
 }
@@ -238,6 +398,7 @@ void FileSearchCore::finishSearch() {
 void FileSearchCore::stopAllTasks() {
     QMutexLocker locker(queueMutex);
     isStopping = true;
+    sweepRoot.clear();  // 遍历不完整，不能据此删除记录
     while (!taskQueue->isEmpty()) {
         taskQueue->dequeue();
     }
@@ -257,6 +418,8 @@ void FileSearchCore::stopSearch() {
 
     stopAllTasks();
     qint64 elapsedTime = timer.elapsed();
+    FlightRecorder::record(FlightRecorder::Event::SearchStop, elapsedTime, 1);
+    searchDuration().record(elapsedTime);
     LOG_INFO(QString("搜索线程被中断，已耗时: %1 毫秒").arg(elapsedTime));
     timer.invalidate();
 
@@ -298,6 +461,20 @@ void FileSearchCore::onFileInserted(const QString& filePath) {
     // 可以在这里处理文件插入后的操作
 }
 
+/*
+ * Summary: 快照导出完成后重新映射
+ * Parameters:
+ * const QString &snapshotPath - 快照文件路径
+ * bool success - 是否导出成功
+ * Return: void
+ */
+void FileSearchCore::onSnapshotExported(const QString& snapshotPath, bool success) {
+    if (!success || isSearching) {
+        return;
+    }
+    snapshot->open(snapshotPath);
+}
+
 /*
  * Summary: 初始化文件数据库
  * Parameters: 无
@@ -339,7 +516,7 @@ void FileSearchCore::initFileDatabase() {
 bool FileSearchCore::isSystemDirectory(const QString& path) {
     // 根据需要判断系统目录
     // 例如，在 Windows 上，检查是否在 C:\Windows 或其他系统路径
-    LOG_INFO("Checking if directory is system: " + path);
+    LOG_DEBUG_LIMITED("Checking if directory is system: " + path);
     return path.startsWith(QDir::rootPath() + "Windows") ||
         path.startsWith(QDir::rootPath() + "Program Files") ||
         path.startsWith(QDir::rootPath() + "Program Files (x86)");
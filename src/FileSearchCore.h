@@ -20,19 +20,28 @@
 
 #include "FileSearchThread.h"
 #include "FileIndexDatabase.h"
+#include "FileIndexSnapshot.h"
 #include "DatabaseThread.h"
 
 class FileSearchCore : public QObject {
     Q_OBJECT
 
 public:
-    explicit FileSearchCore(QObject* parent = nullptr);
+    // indexDirectory 为索引数据库与快照所在目录，为空时使用当前目录
+    explicit FileSearchCore(QObject* parent = nullptr, const QString& indexDirectory = QString());
     ~FileSearchCore();
 
     void startSearch(const QString& keyword, const QString& path, bool includeSystemFiles);
+    void indexDirectory(const QString& path, bool includeSystemFiles);  // 遍历目录并将全部文件写入索引
+    QVector<QString> queryIndex(const QString& keyword);                 // 只查询索引（快照或数据库），不遍历
+    void setThreadCount(int count);  // 遍历线程数，默认为 CPU 核数
     void stopSearch();
     void initFileDatabase();
     bool isSystemDirectory(const QString& path);
+
+    // indexDirectory 下的索引数据库与快照文件路径
+    static QString databaseFile(const QString& indexDirectory);
+    static QString snapshotFile(const QString& indexDirectory);
 signals:
     void fileFound(const QString& filePath);
     void searchFinished();
@@ -43,9 +52,11 @@ private slots:
     void onSearchFinished();
     void onTaskStarted();
     void onFileFound(const QString& filePath);
+    void onSnapshotExported(const QString& snapshotPath, bool success);
 
 private:
-    void enqueueDirectories(const QString& path, int depth, bool includeSystemFiles);
+    void enqueueDirectories(const QString& path, int depth, bool includeSystemFiles);  // depth 层以内只列出自身条目，第 depth 层递归遍历
+    void startTraversal(const QString& keyword, const QString& searchPath, bool includeSystemFiles);
     void finishSearch();
     void stopAllTasks();
     void onSearchTime(qint64 elapsedTime);
@@ -62,14 +73,18 @@ private:
 
     QThreadPool* threadPool;
     QElapsedTimer timer;
+    qint64 indexLoadTime;  // 打开数据库与映射快照的耗时
+    QString snapshotPath;
+    QString sweepRoot;  // 正在重新索引的根目录，完整遍历结束后删除其下已不存在的文件
     QSet<QString> uniquePaths;
     QSet<QString> uniqueFiles;
-    QQueue<QString>* taskQueue;
+    QQueue<SearchTask>* taskQueue;
     QMutex* queueMutex;
     QWaitCondition* queueCondition;
     QMutex uniqueFilesMutex;
 
     FileIndexDatabase* db;
+    FileIndexSnapshot* snapshot;
     DatabaseThread* dbThread;
 };
 
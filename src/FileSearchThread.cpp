@@ -2,11 +2,15 @@
 
 #include "FileSearchThread.h"
 #include "Logger.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include <QDirIterator>
+#include <QElapsedTimer>
 #include <QEventLoop>
 #include <QMutexLocker>
 
-FileSearchThread::FileSearchThread(const QString &keyword, QQueue<QString> *taskQueue, QMutex *queueMutex, QWaitCondition *queueCondition, QObject *parent)
+FileSearchThread::FileSearchThread(const QString &keyword, QQueue<SearchTask> *taskQueue, QMutex *queueMutex, QWaitCondition *queueCondition, QObject *parent)
         : QObject(parent), searchKeyword(keyword), taskQueue(taskQueue), queueMutex(queueMutex), queueCondition(queueCondition), stopped(false) {
     LOG_INFO("线程创建");
 }
@@ -16,41 +20,57 @@ FileSearchThread::~FileSearchThread() {
 }
 
 void FileSearchThread::run() {
+    static MetricCounter &directories = Metrics::counter("filetag_search_directories_total", "遍历的目录数");
+    static MetricCounter &files = Metrics::counter("filetag_search_files_total", "遍历的文件数");
+    static MetricCounter &matches = Metrics::counter("filetag_search_matches_total", "文件名匹配关键字的条目数");
+    static MetricGauge &queueDepth = Metrics::gauge("filetag_search_queue_depth", "待搜索的目录任务数");
+
     while (true) {
-        QString searchPath;
+        SearchTask task;
         {
             QMutexLocker locker(queueMutex);
-            if (taskQueue->isEmpty()) {
-                if (stopped) {
-                    break;
-                }
-                queueCondition->wait(queueMutex);
-                continue;
+            // 目录在线程启动前已全部入队，遍历时不再追加；队列为空（包括被 stopAllTasks 清空）即可退出，
+            // 线程池中的线程随之回收，下一次搜索的线程才能使用新的关键字
+            if (taskQueue->isEmpty() || stopped) {
+                break;
             }
-            searchPath = taskQueue->dequeue();
+            task = taskQueue->dequeue();
+            queueDepth.set(taskQueue->size());
+            FlightRecorder::record(FlightRecorder::Event::DirectoryEnter, taskQueue->size(), 0, task.path);
 
             emit taskStarted();
         }
 
+        const QString &searchPath = task.path;
         if (searchPath.isEmpty()) {
             continue;
         }
 
-        LOG_INFO("线程开始：" + searchPath);
-        QDirIterator it(searchPath, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        LOG_INFO_LIMITED("线程开始：" + searchPath);
+        TraceSpan walkSpan("walk_directory");
+        QElapsedTimer timer;
+        timer.start();
+        qint64 entries = 0;
+        QDirIterator it(searchPath, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot,
+                        task.recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
         QEventLoop loop;
         while (it.hasNext() && !stopped) {
             QString filePath = it.next();
+            ++entries;
             QString fileName = it.fileName();
+            (it.fileInfo().isDir() ? directories : files).add();
 
             if (fileName.contains(searchKeyword, Qt::CaseInsensitive)) {
+                matches.add();
                 emit fileFound(filePath);
             }
 
             loop.processEvents(QEventLoop::AllEvents, 50);
         }
+        walkSpan.setCount(entries);
+        FlightRecorder::record(FlightRecorder::Event::DirectoryLeave, entries, timer.nsecsElapsed() / 1000, searchPath);
         emit searchFinished();
-        LOG_INFO("线程结束：" + searchPath);
+        LOG_INFO_LIMITED("线程结束：" + searchPath);
     }
 }
 
@@ -9,10 +9,16 @@
 #include <QMutex>
 #include <QWaitCondition>
 
+// 遍历任务：recursive 为 false 时只列出目录自身的条目，其子目录另有任务
+struct SearchTask {
+    QString path;
+    bool recursive;
+};
+
 class FileSearchThread : public QObject, public QRunnable {
 Q_OBJECT
 public:
-    explicit FileSearchThread(const QString &keyword, QQueue<QString> *taskQueue, QMutex *queueMutex, QWaitCondition *queueCondition, QObject *parent = nullptr);
+    explicit FileSearchThread(const QString &keyword, QQueue<SearchTask> *taskQueue, QMutex *queueMutex, QWaitCondition *queueCondition, QObject *parent = nullptr);
     ~FileSearchThread();
     void run() override; // 继承 QRunnable 的 run 方法
     void stop();
@@ -24,7 +30,7 @@ signals:
 
 private:
     QString searchKeyword;
-    QQueue<QString> *taskQueue;
+    QQueue<SearchTask> *taskQueue;
     QMutex *queueMutex;
     QWaitCondition *queueCondition;
     bool stopped;
@@ -0,0 +1,511 @@
+/*
+ * FileTagCli.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetag-cli：不创建界面的命令行工具，与主程序共用 FileSearchCore、FileIndexDatabase 与 TagManager，
+ *          用于定时任务中的批量索引、搜索与打标签。默认输出每行一条（统计为“键<TAB>值”），--json 时输出 JSON；
+ *          出错返回 1，用法错误返回 2。filetagd 在运行时子命令转发给它：index 只排队不等待完成，search 只查索引
+ *          不遍历目录。指定 --local、search 的目录，或 --index-dir、--tags、--threads 之一，以及 index 指定 --system 时不转发，
+ *          因为 filetagd 使用自己的设置，无法照这些选项执行。
+ *          用法：filetag-cli index <目录>
+ *                filetag-cli search <关键字> [目录，默认为当前目录] [--tag 表达式]
+ *                filetag-cli tag add|remove <标签> <文件>...
+ *                filetag-cli tag list [文件]
+ *                filetag-cli tag query <表达式>
+ *                filetag-cli stats
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QTextStream>
+#include <QTimer>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+#include "FileIndexDatabase.h"
+#include "FileIndexSnapshot.h"
+#include "FileSearchCore.h"
+#include "IndexClient.h"
+#include "Logger.h"
+#include "TagManager.h"
+
+namespace {
+
+const char *const StatsConnectionName = "cli_stats_connection";
+const int DaemonConnectTimeoutMs = 100;
+const char *const IndexUsage = "用法：filetag-cli index <目录>";
+const char *const SearchUsage = "用法：filetag-cli search <关键字> [目录，默认为当前目录] [--tag 表达式]";
+const char *const TagUsage = "用法：filetag-cli tag add|remove <标签> <文件>... | tag list [文件] | tag query <表达式>";
+
+struct Context {
+    QString indexDirectory;
+    QString tagsFile;
+    bool json = false;
+    bool includeSystemFiles = false;
+    int threads = 0;
+};
+
+class Output {
+public:
+    explicit Output(bool json) : json(json), out(stdout) {}
+
+    // 文本模式下立即输出一行，JSON 模式下记入数组，最后一起输出
+    void item(const QString &value) {
+        if (json) {
+            items.append(value);
+        } else {
+            out << value << '\n';
+        }
+    }
+
+    void field(const QString &key, const QJsonValue &value) {
+        if (json) {
+            fields[key] = value;
+        } else {
+            out << key << '\t' << value.toVariant().toString() << '\n';
+        }
+    }
+
+    void finish(const QString &itemsKey = QString()) {
+        if (json) {
+            if (!itemsKey.isEmpty()) {
+                fields[itemsKey] = items;
+            }
+            out << QJsonDocument(fields).toJson(QJsonDocument::Compact) << '\n';
+        }
+        out.flush();
+    }
+
+private:
+    bool json;
+    QTextStream out;
+    QJsonObject fields;
+    QJsonArray items;
+};
+
+QTextStream &errors() {
+    static QTextStream stream(stderr);
+    return stream;
+}
+
+int usageError(const QString &message) {
+    errors() << message << "\n";
+    return 2;
+}
+
+std::vector<std::string> toStdPaths(const QStringList &paths) {
+    std::vector<std::string> result;
+    result.reserve(paths.size());
+    for (const QString &path : paths) {
+        result.push_back(QFileInfo(path).absoluteFilePath().toStdString());
+    }
+    return result;
+}
+
+/*
+ * Summary: 在事件循环中运行一次索引或搜索，直到 searchFinished；
+ *          索引与搜索都可能在开始函数内同步结束，所以在事件循环开始后再调用
+ * Parameters:
+ * FileSearchCore &core - 搜索核心
+ * const std::function<void()> &start - 开始索引或搜索
+ * Return: void
+ */
+void runUntilFinished(FileSearchCore &core, const std::function<void()> &start) {
+    QEventLoop loop;
+    QObject::connect(&core, &FileSearchCore::searchFinished, &loop, &QEventLoop::quit);
+    QTimer::singleShot(0, &core, start);
+    loop.exec();
+}
+
+/*
+ * Summary: index 子命令：遍历目录，将全部文件写入索引；返回前等待数据库线程写完并导出快照
+ * Parameters:
+ * const Context &context - 公共选项
+ * const QStringList &arguments - 子命令参数
+ * Return: int - 退出码
+ */
+int runIndex(const Context &context, const QStringList &arguments) {
+    if (arguments.size() != 1) {
+        return usageError(IndexUsage);
+    }
+    const QString root = QFileInfo(arguments[0]).absoluteFilePath();
+    if (!QFileInfo(root).isDir()) {
+        errors() << "目录不存在: " << root << "\n";
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 entries = 0;  // 遍历到的文件与目录，都会写入索引
+    qint64 walkMs = 0;
+    {
+        FileSearchCore core(nullptr, context.indexDirectory);
+        if (context.threads > 0) {
+            core.setThreadCount(context.threads);
+        }
+        QObject::connect(&core, &FileSearchCore::fileFound, [&entries](const QString &) { ++entries; });
+        runUntilFinished(core, [&] { core.indexDirectory(root, context.includeSystemFiles); });
+        walkMs = timer.elapsed();
+    }  // 析构时等待数据库线程处理完剩余的插入与快照导出
+
+    Output output(context.json);
+    output.field("root", root);
+    output.field("entries", entries);
+    output.field("walkMs", walkMs);
+    output.field("totalMs", timer.elapsed());
+    output.finish();
+    return 0;
+}
+
+/*
+ * Summary: search 子命令：与界面相同，先查索引，没有结果时遍历目录；可按标签表达式过滤结果。
+ *          索引中的结果不限于该目录
+ * Parameters:
+ * const Context &context - 公共选项
+ * const QStringList &arguments - 子命令参数
+ * const QString &tagExpression - 标签表达式，为空时不过滤
+ * Return: int - 退出码
+ */
+int runSearch(const Context &context, const QStringList &arguments, const QString &tagExpression) {
+    if (arguments.isEmpty() || arguments.size() > 2 || arguments[0].isEmpty()) {
+        return usageError(SearchUsage);
+    }
+    const QString keyword = arguments[0];
+    // 索引中没有结果时遍历的目录；不指定时用当前目录，避免从根目录开始遍历整个文件系统
+    const QString root = QFileInfo(arguments.value(1, ".")).absoluteFilePath();
+    if (!QFileInfo(root).isDir()) {
+        errors() << "目录不存在: " << root << "\n";
+        return 1;
+    }
+
+    std::unique_ptr<TagManager> tags;
+    std::function<bool(const std::string &)> matches;
+    if (!tagExpression.isEmpty()) {
+        tags = std::make_unique<TagManager>(context.tagsFile.toStdString());
+        tags->loadTags();
+        matches = tags->matcher(tagExpression.toStdString());
+    }
+
+    Output output(context.json);
+    qint64 count = 0;
+    FileSearchCore core(nullptr, context.indexDirectory);
+    if (context.threads > 0) {
+        core.setThreadCount(context.threads);
+    }
+    QObject::connect(&core, &FileSearchCore::fileFound, [&](const QString &path) {
+        if (!matches || matches(path.toStdString())) {
+            output.item(path);
+            ++count;
+        }
+    });
+    runUntilFinished(core, [&] { core.startSearch(keyword, root, context.includeSystemFiles); });
+
+    // 文本模式只输出路径，便于交给 xargs 等处理
+    if (context.json) {
+        output.field("keyword", keyword);
+        output.field("count", count);
+    }
+    output.finish("files");
+    return 0;
+}
+
+/*
+ * Summary: tag 子命令：add、remove、list、query；修改在返回前写盘
+ * Parameters:
+ * const Context &context - 公共选项
+ * const QStringList &arguments - 子命令参数
+ * Return: int - 退出码
+ */
+int runTag(const Context &context, const QStringList &arguments) {
+    const QString action = arguments.value(0);
+    const bool modifying = action == "add" || action == "remove";
+    if ((modifying && arguments.size() < 3) || (action == "list" && arguments.size() > 2)
+        || (action == "query" && arguments.size() != 2) || (!modifying && action != "list" && action != "query")) {
+        return usageError(TagUsage);
+    }
+
+    TagManager tags(context.tagsFile.toStdString());
+    tags.loadTags();
+    Output output(context.json);
+
+    if (modifying) {
+        const std::string tag = arguments[1].toStdString();
+        const std::vector<std::string> paths = toStdPaths(arguments.mid(2));
+        // 没有取消标志，批量修改总会生效
+        const size_t changed = (action == "add" ? tags.addTagToFiles(paths, tag) : tags.removeTagFromFiles(paths, tag)).value_or(0);
+        if (!tags.sync()) {
+            errors() << "标签修改未能写盘\n";
+            return 1;
+        }
+        output.field("tag", arguments[1]);
+        output.field("changed", qint64(changed));
+        output.finish();
+        return 0;
+    }
+
+    std::vector<std::string> values;
+    if (action == "query") {
+        values = tags.queryFiles(arguments[1].toStdString());
+    } else if (arguments.size() == 2) {
+        values = tags.listTagsForFile(toStdPaths({arguments[1]}).front());
+        tags.sync();  // 文件移动过时 listTagsForFile 会找回标签并记下修改
+    } else {
+        values = tags.listAllTags();
+    }
+    for (const std::string &value : values) {
+        output.item(QString::fromStdString(value));
+    }
+    output.finish(action == "query" ? "files" : "tags");
+    return 0;
+}
+
+/*
+ * Summary: stats 子命令：索引文件数、代数、数据库与快照大小，以及标签数与带标签的文件数
+ * Parameters:
+ * const Context &context - 公共选项
+ * Return: int - 退出码
+ */
+int runStats(const Context &context) {
+    Output output(context.json);
+    const QString databasePath = FileSearchCore::databaseFile(context.indexDirectory);
+    const QString snapshotPath = FileSearchCore::snapshotFile(context.indexDirectory);
+
+    if (QFileInfo::exists(databasePath)) {
+        FileIndexDatabase database(databasePath, StatsConnectionName);
+        if (!database.openDatabase()) {
+            errors() << "无法打开索引数据库: " << databasePath << "\n";
+            return 1;
+        }
+        FileIndexSnapshot snapshot;
+        const bool snapshotCurrent = snapshot.open(snapshotPath) && snapshot.generation() == database.generation();
+        output.field("index.files", database.fileCount());
+        output.field("index.generation", QString::number(database.generation()));
+        output.field("index.databaseBytes", QFileInfo(databasePath).size());
+        output.field("index.snapshotBytes", QFileInfo(snapshotPath).size());
+        output.field("index.snapshotCurrent", snapshotCurrent);
+    } else {
+        output.field("index.files", 0);
+    }
+
+    TagManager tags(context.tagsFile.toStdString());
+    tags.loadTags();
+    const std::shared_ptr<const TagIndex> snapshot = tags.snapshot();
+    output.field("tags.tags", qint64(snapshot->allTags().size()));
+    output.field("tags.files", qint64(snapshot->fileCount()));
+    output.field("tags.memoryBytes", qint64(snapshot->memoryUsage()));
+    output.finish();
+    return 0;
+}
+
+/*
+ * Summary: 判断命令行是否指定了 filetagd 无法照办的选项，此时必须在本进程中执行
+ * Parameters:
+ * const QCommandLineParser &parser - 已解析的命令行
+ * const QString &command - 子命令
+ * const QStringList &arguments - 子命令参数
+ * Return: bool - 是否需要在本进程中执行
+ */
+bool needsLocal(const QCommandLineParser &parser, const QString &command, const QStringList &arguments) {
+    if (parser.isSet("local")) {
+        return true;
+    }
+    for (const char *option : {"index-dir", "tags", "threads"}) {
+        if (parser.isSet(option)) {
+            return true;
+        }
+    }
+    // search 的 --system 随请求转发；filetagd 的索引任务不包含系统目录
+    if (parser.isSet("system") && command != "search") {
+        return true;
+    }
+    // filetagd 的 search 只查索引，不按目录过滤
+    return command == "search" && arguments.size() == 2;
+}
+
+int remoteError(const IndexClient &client) {
+    errors() << "filetagd: " << client.errorString() << "\n";
+    return 1;
+}
+
+/*
+ * Summary: 把子命令转发给 filetagd
+ * Parameters:
+ * IndexClient &client - 已连接的客户端
+ * const Context &context - 公共选项
+ * const QString &command - 子命令
+ * const QStringList &arguments - 子命令参数
+ * const QString &tagExpression - search 的标签表达式
+ * Return: int - 退出码
+ */
+int runRemote(IndexClient &client, const Context &context, const QString &command, const QStringList &arguments,
+              const QString &tagExpression) {
+    using IndexProtocol::Type;
+    Output output(context.json);
+    const auto collect = [&output](const QStringList &values) {
+        for (const QString &value : values) {
+            output.item(value);
+        }
+    };
+    qint64 value = 0;
+
+    if (command == "index") {
+        if (arguments.size() != 1) {
+            return usageError(IndexUsage);
+        }
+        const QString root = QFileInfo(arguments[0]).absoluteFilePath();
+        if (!client.request(Type::Index, {root}, {}, &value)) {
+            return remoteError(client);
+        }
+        output.field("root", root);
+        output.field("queuedJobs", value);
+        output.finish();
+        return 0;
+    }
+
+    if (command == "search") {
+        if (arguments.isEmpty() || arguments.size() > 2 || arguments[0].isEmpty()) {
+            return usageError(SearchUsage);
+        }
+        const QStringList request{arguments[0], tagExpression, context.includeSystemFiles ? "1" : "0"};
+        if (!client.request(Type::Search, request, collect, &value)) {
+            return remoteError(client);
+        }
+        if (context.json) {
+            output.field("keyword", arguments[0]);
+            output.field("count", value);
+        }
+        output.finish("files");
+        return 0;
+    }
+
+    if (command == "tag") {
+        const QString action = arguments.value(0);
+        if ((action == "add" || action == "remove") && arguments.size() >= 3) {
+            QStringList request{arguments[1]};
+            for (const std::string &path : toStdPaths(arguments.mid(2))) {
+                request << QString::fromStdString(path);
+            }
+            if (!client.request(action == "add" ? Type::TagAdd : Type::TagRemove, request, {}, &value)) {
+                return remoteError(client);
+            }
+            output.field("tag", arguments[1]);
+            output.field("changed", value);
+            output.finish();
+            return 0;
+        }
+        if (action == "query" && arguments.size() == 2) {
+            if (!client.request(Type::TagQuery, {arguments[1]}, collect)) {
+                return remoteError(client);
+            }
+            output.finish("files");
+            return 0;
+        }
+        if (action == "list" && arguments.size() <= 2) {
+            const QStringList request = arguments.size() == 2 ? QStringList{QFileInfo(arguments[1]).absoluteFilePath()}
+                                                              : QStringList();
+            if (!client.request(Type::TagList, request, collect)) {
+                return remoteError(client);
+            }
+            output.finish("tags");
+            return 0;
+        }
+        return usageError(TagUsage);
+    }
+
+    // stats：名称与值交替排列，数值在 JSON 中输出为数字
+    QStringList values;
+    if (!client.request(Type::Stats, {}, [&values](const QStringList &batch) { values << batch; })) {
+        return remoteError(client);
+    }
+    for (qsizetype i = 0; i + 1 < values.size(); i += 2) {
+        bool isNumber = false;
+        const qint64 number = values[i + 1].toLongLong(&isNumber);
+        output.field(values[i], isNumber ? QJsonValue(number) : QJsonValue(values[i + 1]));
+    }
+    output.finish();
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    // 只用 QCoreApplication：不加载平台插件、样式表与窗口，可在没有显示器的环境中运行
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("filetag-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("FileTag 命令行工具：index、search、tag、stats");
+    parser.addHelpOption();
+    parser.addPositionalArgument("command", "index <目录> | search <关键字> [目录] | tag ... | stats");
+    parser.addOptions({
+            {"index-dir", "索引数据库与快照所在目录，默认为当前目录", "dir"},
+            {"tags", "标签文件，数据库与日志与其同名", "file", "tags.csv"},
+            {"tag", "search 时只输出满足标签表达式的文件，例如 \"work AND NOT archived\"", "expression"},
+            {"threads", "遍历线程数，默认为 CPU 核数", "n", "0"},
+            {"system", "包含系统目录"},
+            {"json", "以 JSON 输出"},
+            {"verbose", "输出调试信息到标准错误"},
+            {"server", "filetagd 的本地套接字名称", "name", IndexProtocol::DefaultServerName},
+            {"local", "不使用 filetagd，直接打开索引与标签数据"}
+    });
+    parser.process(app);
+
+    // 数据库模块每次查询都会 qDebug，标准错误只保留警告，日志文件照常按 settings.ini 写入
+    if (!parser.isSet("verbose")) {
+        QLoggingCategory::setFilterRules("default.debug=false");
+    }
+    Logger::instance().loadSettings(QDir::currentPath() + "/settings.ini");
+
+    Context context;
+    context.indexDirectory = parser.value("index-dir");
+    context.tagsFile = parser.value("tags");
+    context.json = parser.isSet("json");
+    context.includeSystemFiles = parser.isSet("system");
+    context.threads = parser.value("threads").toInt();
+
+    const QStringList positional = parser.positionalArguments();
+    const QString command = positional.value(0);
+    const QStringList arguments = positional.mid(1);
+
+    const bool known = command == "index" || command == "search" || command == "tag" || command == "stats";
+    if (known && !needsLocal(parser, command, arguments)) {
+        IndexClient client(parser.value("server"));
+        if (client.connectToServer(DaemonConnectTimeoutMs)) {
+            return runRemote(client, context, command, arguments, parser.value("tag"));
+        }
+    }
+
+    try {
+        if (command == "index") {
+            return runIndex(context, arguments);
+        }
+        if (command == "search") {
+            return runSearch(context, arguments, parser.value("tag"));
+        }
+        if (command == "tag") {
+            return runTag(context, arguments);
+        }
+        if (command == "stats") {
+            return runStats(context);
+        }
+    } catch (const std::exception &e) {
+        // 标签表达式语法错误与标签数据加载失败
+        errors() << e.what() << "\n";
+        return 1;
+    }
+
+    errors() << parser.helpText();
+    return 2;
+}
@@ -0,0 +1,65 @@
+/*
+ * FileTagDaemon.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetagd：常驻的索引服务。启动后索引并监视指定目录，索引数据库、快照与标签数据一直保持打开，
+ *          主程序与 filetag-cli 检测到它在运行时通过本地套接字查询，不再各自打开索引。
+ *          用法：filetagd [--watch 目录]... [--index-dir 目录] [--tags tags.csv] [--server filetagd] [--debounce 5]
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QSettings>
+#include <QTextStream>
+#include <stdexcept>
+
+#include "FlightRecorder.h"
+#include "IndexServer.h"
+#include "Logger.h"
+#include "Metrics.h"
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("filetagd");
+    QTextStream errors(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("FileTag 索引服务");
+    parser.addHelpOption();
+    parser.addOptions({
+            {"watch", "启动时索引并监视的目录，可重复指定", "dir"},
+            {"index-dir", "索引数据库与快照所在目录，默认为当前目录", "dir"},
+            {"tags", "标签文件，数据库与日志与其同名", "file", "tags.csv"},
+            {"server", "本地套接字名称", "name", IndexProtocol::DefaultServerName},
+            {"debounce", "目录变化后等待多少秒再重新索引", "seconds", "5"}
+    });
+    parser.process(app);
+
+    const QString settingsFile = QDir::currentPath() + "/settings.ini";
+    Logger::instance().loadSettings(settingsFile);
+    FlightRecorder::installSignalHandlers("logs");
+
+    // 与主程序相同的指标导出，文件名区分进程
+    const int metricsInterval = QSettings(settingsFile, QSettings::IniFormat).value("Metrics/exportIntervalSec", 15).toInt();
+    MetricsExporter metricsExporter("logs/filetagd.prom", metricsInterval);
+
+    // 标签数据加载失败时 TagManager 抛出异常
+    try {
+        IndexServer server(parser.value("index-dir"), parser.value("tags"));
+        server.setDebounceSeconds(parser.value("debounce").toInt());
+        if (!server.listen(parser.value("server"))) {
+            errors << "无法监听 " << parser.value("server") << ": " << server.errorString() << "\n";
+            return 1;
+        }
+        for (const QString &root : parser.values("watch")) {
+            server.watch(root);
+        }
+        return app.exec();
+    } catch (const std::exception &e) {
+        errors << e.what() << "\n";
+        return 1;
+    }
+}
@@ -1,21 +1,68 @@
 #include "FileTagSystem.h"
+#include "FileIndexDatabase.h"
+#include "IndexClient.h"
 #include <iostream>
 #include <filesystem>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+
+const int DaemonConnectTimeoutMs = 50;     // filetagd 未运行时连接立即失败，这只是上限
+const int DaemonStartingTimeoutMs = 2000;  // 标签数据已被占用时 filetagd 可能正在启动，再等它一会儿
+const int DaemonRetryIntervalMs = 100;     // 等待 filetagd 开始监听时的重试间隔
+const int DaemonReplyTimeoutMs = 30000;    // 大批修改要在 filetagd 中写盘后才回复，等待比搜索长
+const size_t RemoteBatchFiles = 20000;     // 每个请求携带的文件数上限，避免超过协议的消息长度上限
+
+QStringList toQStrings(std::vector<std::string>::const_iterator begin, std::vector<std::string>::const_iterator end) {
+    QStringList values;
+    values.reserve(qsizetype(end - begin));
+    for (auto it = begin; it != end; ++it) {
+        values.append(QString::fromStdString(*it));
+    }
+    return values;
+}
+
+void appendStdStrings(std::vector<std::string>& values, const QStringList& strings) {
+    for (const QString& value : strings) {
+        values.push_back(value.toStdString());
+    }
+}
+
+} // namespace
 
 // 构造函数，初始化 FileTagSystem 对象
-FileTagSystem::FileTagSystem(const std::string& tagsFile, const std::string& usersFile)
-        : tagManager(tagsFile), userManager(usersFile) {
+FileTagSystem::FileTagSystem(const std::string& tagsFile, const std::string& usersFile, const std::string& serverName)
+        : tagManager(tagsFile), userManager(usersFile), serverName(QString::fromStdString(serverName)) {
     // 初始化用户管理器，添加一些默认用户
     userManager.addUser("admin", "admin123", UserRole::ADMIN);
     userManager.addUser("user", "user123", UserRole::USER);
 
     try {
-        tagManager.loadTags(); // 尝试加载标签数据
+        // filetagd 正在运行时标签数据由它持有，本进程只转发请求
+        if (!connectDaemon(0)) {
+            try {
+                tagManager.loadTags(); // 尝试加载标签数据
+            } catch (const std::runtime_error&) {
+                // 标签数据被占用：filetagd 可能刚启动还没开始监听，等到它就绪后改用它
+                if (!connectDaemon(DaemonStartingTimeoutMs)) {
+                    throw;
+                }
+            }
+        }
         userManager.loadUsers(); // 添加这行确保加载用户数据
     } catch (const std::exception& e) {
-        // 如果加载失败，输出错误信息并退出程序
+        // 加载失败（包括标签数据正被其他进程使用）时交给调用方提示用户
         std::cerr << e.what() << std::endl;
-        exit(1);
+        throw;
     }
 }
 
@@ -106,15 +153,15 @@ void FileTagSystem::handleAdminChoice(int choice) {
         }
         case 8:
             std::cout << "退出程序。" << std::endl;
+            tagManager.sync();
             exit(0);
         default:
             std::cerr << "无效的选择。" << std::endl;
             break;
     }
 
-    // 保存标签数据
+    // 标签修改已追加到日志，由后台线程写盘，这里只保存用户数据
     try {
-        tagManager.saveTags();
         userManager.saveUsers();
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
@@ -154,16 +201,16 @@ void FileTagSystem::handleChoice(int choice) {
             break;
         case 7:
             std::cout << "退出程序。" << std::endl;
+            tagManager.sync();
             exit(0);
         default:
             std::cerr << "无效的选择。" << std::endl;
             break;
     }
 
-    // 保存标签数据
+    // 标签修改已追加到日志，由后台线程写盘，这里只保存用户数据
     try {
         userManager.saveUsers();
-        tagManager.saveTags();
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
@@ -207,41 +254,396 @@ std::string FileTagSystem::getValidPath() const {
     }
 }
 
+// 连接 filetagd，只用来确认它正在运行，之后每次请求使用各自的连接。
+// filetagd 尚未开始监听时连接立即失败，因此在 waitMs 内每隔一段时间重试
+bool FileTagSystem::connectDaemon(int waitMs) {
+    if (serverName.isEmpty()) {
+        return false;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(waitMs);
+    while (true) {
+        IndexClient client(serverName);
+        if (client.connectToServer(DaemonConnectTimeoutMs)) {
+            remote = true;
+            return true;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(DaemonRetryIntervalMs));
+    }
+}
+
+// 把请求交给 filetagd。QLocalSocket 只能在创建它的线程中使用，而标签操作来自界面线程与后台任务，
+// 因此每次请求新建连接；本地套接字连接很快，相比标签操作本身可以忽略
+std::optional<qint64> FileTagSystem::remoteRequest(IndexProtocol::Type type, const QStringList& arguments,
+                                                   const std::function<void(const QStringList&)>& onResults) const {
+    IndexClient client(serverName);
+    if (!client.connectToServer(DaemonConnectTimeoutMs)) {
+        std::cerr << "filetagd 已退出，改为在本地操作标签" << std::endl;
+        switchToLocal();
+        return std::nullopt;
+    }
+    client.setTimeout(DaemonReplyTimeoutMs);
+    qint64 value = 0;
+    if (!client.request(type, arguments, onResults, &value)) {
+        throw std::runtime_error("filetagd: " + client.errorString().toStdString());
+    }
+    return value;
+}
+
+// 分批交给 filetagd，每批在 filetagd 中一次修改、一次写盘。已发出的批次无法撤销，
+// 因此取消标志只由调用方在发出第一批之前检查
+std::optional<size_t> FileTagSystem::remoteBatch(IndexProtocol::Type type, const std::vector<std::string>& filepaths,
+                                                 const std::string& tag, const TagBatchOptions& options) {
+    size_t changed = 0;
+    for (size_t begin = 0; begin < filepaths.size(); begin += RemoteBatchFiles) {
+        const size_t end = std::min(filepaths.size(), begin + RemoteBatchFiles);
+        QStringList arguments{QString::fromStdString(tag)};
+        arguments.append(toQStrings(filepaths.begin() + begin, filepaths.begin() + end));
+        const std::optional<qint64> value = remoteRequest(type, arguments);
+        if (!value) {
+            return std::nullopt;
+        }
+        changed += size_t(*value);
+        if (options.progress) {
+            options.progress(end, filepaths.size());
+        }
+    }
+    return changed;
+}
+
+// 改为本地加载。本地加载只是换一种方式提供同一份数据，对调用方而言对象状态不变，因此允许在 const 函数中进行
+void FileTagSystem::switchToLocal() const {
+    std::lock_guard<std::mutex> lock(modeMutex);
+    if (!remote) {
+        return;
+    }
+    const_cast<TagManager&>(tagManager).loadTags();
+    remote = false;
+}
+
+// 标签操作是否交给 filetagd
+bool FileTagSystem::isRemote() const {
+    return remote;
+}
+
 // 添加标签的函数
 void FileTagSystem::addTags(const std::string& filepath, const std::string& tag) {
     if (std::filesystem::is_directory(filepath)) {
-        for (const auto& entry : std::filesystem::directory_iterator(filepath)) {
-            if (entry.is_regular_file()) {
-                tagManager.addTag(entry.path().string(), tag);
+        addTagsToDirectory(filepath, tag);
+    } else if (!remote || !remoteRequest(IndexProtocol::Type::TagAdd, {QString::fromStdString(tag), QString::fromStdString(filepath)})) {
+        tagManager.addTag(filepath, tag);
+    }
+}
+
+// 为一组文件批量添加标签
+std::optional<size_t> FileTagSystem::addTags(const std::vector<std::string>& filepaths, const std::string& tag, const TagBatchOptions& options) {
+    if (remote) {
+        if (options.cancelled && options.cancelled->load()) {
+            return std::nullopt;
+        }
+        if (auto changed = remoteBatch(IndexProtocol::Type::TagAdd, filepaths, tag, options)) {
+            return changed;
+        }
+    }
+    return tagManager.addTagToFiles(filepaths, tag, options.cancelled, options.progress);
+}
+
+// 为目录中的文件批量添加标签：先并行枚举，再一次性修改并写盘
+std::optional<size_t> FileTagSystem::addTagsToDirectory(const std::string& directory, const std::string& tag, const TagBatchOptions& options) {
+    std::vector<std::string> files = collectFiles(directory, options);
+    return addTags(files, tag, options);
+}
+
+// 从一组文件中批量删除标签
+std::optional<size_t> FileTagSystem::removeTags(const std::vector<std::string>& filepaths, const std::string& tag, const TagBatchOptions& options) {
+    if (remote) {
+        if (options.cancelled && options.cancelled->load()) {
+            return std::nullopt;
+        }
+        if (auto changed = remoteBatch(IndexProtocol::Type::TagRemove, filepaths, tag, options)) {
+            return changed;
+        }
+    }
+    return tagManager.removeTagFromFiles(filepaths, tag, options.cancelled, options.progress);
+}
+
+// 并行枚举目录：所有待遍历的目录放在共享队列中，工作线程每次取一个目录只列出一层，
+// 子目录放回队列，因此大部分文件集中在一个子目录下时也能分给多个线程；调用线程负责汇报进度
+std::vector<std::string> FileTagSystem::collectFiles(const std::string& directory, const TagBatchOptions& options) {
+    namespace fs = std::filesystem;
+    const auto isCancelled = [&options] {
+        return options.cancelled && options.cancelled->load(std::memory_order_relaxed);
+    };
+    const auto accepts = [&options](const fs::path& path) {
+        return !options.filter || options.filter(path);
+    };
+
+    // 列出一个目录中的文件与子目录（不跟随符号链接）
+    const auto listDirectory = [&](const fs::path& dir, std::vector<std::string>& files, std::vector<fs::path>& subdirectories,
+                                   std::atomic<size_t>* found) {
+        std::error_code ec;
+        for (fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+             !ec && it != end; it.increment(ec)) {
+            if (isCancelled()) {
+                return;
+            }
+            std::error_code entryError;
+            if (it->is_regular_file(entryError)) {
+                if (accepts(it->path())) {
+                    files.push_back(it->path().string());
+                    if (found) {
+                        found->fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            } else if (options.recursive && it->is_directory(entryError) && !it->is_symlink(entryError)) {
+                subdirectories.push_back(it->path());
             }
         }
-    } else {
-        tagManager.addTag(filepath, tag);
+    };
+
+    std::vector<std::string> files;
+    std::vector<fs::path> pendingDirectories;
+    listDirectory(directory, files, pendingDirectories, nullptr);
+    if (pendingDirectories.empty()) {
+        return files;
+    }
+
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    size_t busyWorkers = 0;  // 正在列目录的线程数，队列为空且没有线程在忙时遍历结束
+    std::atomic<size_t> found{files.size()};
+    auto worker = [&]() {
+        std::vector<std::string> local;
+        std::vector<fs::path> children;
+        while (true) {
+            fs::path dir;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueChanged.wait(lock, [&] { return !pendingDirectories.empty() || busyWorkers == 0 || isCancelled(); });
+                if (pendingDirectories.empty() || isCancelled()) {
+                    queueChanged.notify_all();
+                    return local;
+                }
+                dir = std::move(pendingDirectories.back());
+                pendingDirectories.pop_back();
+                ++busyWorkers;
+            }
+            children.clear();
+            listDirectory(dir, local, children, &found);
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                pendingDirectories.insert(pendingDirectories.end(), std::make_move_iterator(children.begin()),
+                                          std::make_move_iterator(children.end()));
+                --busyWorkers;
+            }
+            queueChanged.notify_all();
+        }
+    };
+
+    const size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::future<std::vector<std::string>>> results;
+    for (size_t i = 0; i < threadCount; ++i) {
+        results.push_back(std::async(std::launch::async, worker));
+    }
+
+    for (auto& result : results) {
+        while (result.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready) {
+            if (options.progress) {
+                options.progress(found.load(std::memory_order_relaxed), 0);
+            }
+        }
+        std::vector<std::string> local = result.get();
+        files.insert(files.end(), std::make_move_iterator(local.begin()), std::make_move_iterator(local.end()));
+    }
+    if (options.progress) {
+        options.progress(files.size(), 0);
     }
+    return files;
 }
 
-// 根据标签搜索文件的函数
+// 根据标签搜索文件的函数；交给 filetagd 时标签名用引号括起，作为只含一个标签的表达式查询
 std::vector<std::string> FileTagSystem::searchFilesByTag(const std::string& tag) const {
+    if (remote) {
+        if (tag.find('"') != std::string::npos) {
+            throw std::invalid_argument("filetagd 正在运行，无法按包含双引号的标签搜索");
+        }
+        return queryFiles("\"" + tag + "\"");
+    }
     return tagManager.searchFilesByTag(tag);
 }
 
+// 按布尔表达式搜索文件的函数
+std::vector<std::string> FileTagSystem::queryFiles(const std::string& expression) const {
+    if (remote) {
+        std::vector<std::string> files;
+        if (remoteRequest(IndexProtocol::Type::TagQuery, {QString::fromStdString(expression)},
+                          [&files](const QStringList& paths) { appendStdStrings(files, paths); })) {
+            return files;
+        }
+    }
+    return tagManager.queryFiles(expression);
+}
+
+// 按布尔表达式分批输出文件的函数；filetagd 的回复按 batchSize 重新分批，停止后丢弃剩余的回复
+size_t FileTagSystem::queryFiles(const std::string& expression, size_t batchSize, const TagManager::BatchCallback& onBatch) const {
+    if (remote) {
+        const size_t limit = std::max<size_t>(1, batchSize);
+        size_t emitted = 0;
+        bool stopped = false;
+        std::vector<std::string> batch;
+        const auto flush = [&] {
+            if (!stopped && !batch.empty()) {
+                emitted += batch.size();
+                stopped = !onBatch(batch);
+                batch.clear();
+            }
+        };
+        const auto onResults = [&](const QStringList& paths) {
+            for (qsizetype i = 0; i < paths.size() && !stopped; ++i) {
+                batch.push_back(paths[i].toStdString());
+                if (batch.size() == limit) {
+                    flush();
+                }
+            }
+        };
+        if (remoteRequest(IndexProtocol::Type::TagQuery, {QString::fromStdString(expression)}, onResults)) {
+            flush();
+            return emitted;
+        }
+    }
+    return tagManager.queryFiles(expression, batchSize, onBatch);
+}
+
+// 按布尔表达式统计文件数的函数
+size_t FileTagSystem::countFiles(const std::string& expression) const {
+    if (remote) {
+        if (auto count = remoteRequest(IndexProtocol::Type::TagCount, {QString::fromStdString(expression)})) {
+            return size_t(*count);
+        }
+    }
+    return tagManager.countFiles(expression);
+}
+
+// 返回判断单个文件是否满足表达式的函数；交给 filetagd 时取回当时满足条件的全部文件，与本地一样不受之后的修改影响
+std::function<bool(const std::string&)> FileTagSystem::tagMatcher(const std::string& expression) const {
+    if (remote) {
+        auto files = std::make_shared<std::unordered_set<std::string>>();
+        if (remoteRequest(IndexProtocol::Type::TagQuery, {QString::fromStdString(expression)}, [&files](const QStringList& paths) {
+                for (const QString& path : paths) {
+                    files->insert(path.toStdString());
+                }
+            })) {
+            return [files](const std::string& filepath) { return files->count(filepath) > 0; };
+        }
+    }
+    return tagManager.matcher(expression);
+}
+
+// 返回一组文件中满足表达式的文件
+std::vector<std::string> FileTagSystem::filterTagged(const std::string& expression, const std::vector<std::string>& filepaths) const {
+    std::vector<std::string> matched;
+    if (remote) {
+        QStringList arguments{QString::fromStdString(expression)};
+        arguments.append(toQStrings(filepaths.begin(), filepaths.end()));
+        if (remoteRequest(IndexProtocol::Type::TagMatch, arguments,
+                          [&matched](const QStringList& paths) { appendStdStrings(matched, paths); })) {
+            return matched;
+        }
+    }
+    const auto matches = tagManager.matcher(expression);
+    std::copy_if(filepaths.begin(), filepaths.end(), std::back_inserter(matched), matches);
+    return matched;
+}
+
 // 删除标签的函数
 void FileTagSystem::removeTag(const std::string& filepath, const std::string& tag) {
-    tagManager.removeTag(filepath, tag);
+    if (!remote || !remoteRequest(IndexProtocol::Type::TagRemove, {QString::fromStdString(tag), QString::fromStdString(filepath)})) {
+        tagManager.removeTag(filepath, tag);
+    }
 }
 
 // 更新标签的函数
 void FileTagSystem::updateTag(const std::string& filepath, const std::string& oldTag, const std::string& newTag) {
-    tagManager.updateTag(filepath, oldTag, newTag);
+    if (!remote || !remoteRequest(IndexProtocol::Type::TagUpdate, {QString::fromStdString(filepath), QString::fromStdString(oldTag),
+                                                                   QString::fromStdString(newTag)})) {
+        tagManager.updateTag(filepath, oldTag, newTag);
+    }
+}
+
+// 全局重命名标签的函数
+size_t FileTagSystem::renameTag(const std::string& oldTag, const std::string& newTag) {
+    if (remote) {
+        if (auto count = remoteRequest(IndexProtocol::Type::TagRename, {QString::fromStdString(oldTag), QString::fromStdString(newTag)})) {
+            return size_t(*count);
+        }
+    }
+    return tagManager.renameTag(oldTag, newTag);
+}
+
+// 将标签 source 合并到 target 的函数
+size_t FileTagSystem::mergeTag(const std::string& source, const std::string& target) {
+    if (remote) {
+        if (auto count = remoteRequest(IndexProtocol::Type::TagMerge, {QString::fromStdString(source), QString::fromStdString(target)})) {
+            return size_t(*count);
+        }
+    }
+    return tagManager.mergeTag(source, target);
+}
+
+// 从所有文件删除标签的函数
+size_t FileTagSystem::deleteTag(const std::string& tag) {
+    if (remote) {
+        if (auto count = remoteRequest(IndexProtocol::Type::TagDelete, {QString::fromStdString(tag)})) {
+            return size_t(*count);
+        }
+    }
+    return tagManager.deleteTag(tag);
+}
+
+// 目录已被移动或重命名，标签随之迁移的函数
+size_t FileTagSystem::moveDirectory(const std::string& oldDirectory, const std::string& newDirectory) {
+    if (remote) {
+        throw std::runtime_error("filetagd 正在运行，无法在本进程中迁移目录的标签");
+    }
+    return tagManager.moveDirectory(oldDirectory, newDirectory);
+}
+
+// 整理标签路径的函数，文件索引使用独立连接；交给 filetagd 时由它按自己的索引找回，indexPath 不使用
+size_t FileTagSystem::reconcileTags(const std::string& indexPath) {
+    if (remote) {
+        if (auto relocated = remoteRequest(IndexProtocol::Type::TagReconcile, {})) {
+            return size_t(*relocated);
+        }
+    }
+    FileIndexDatabase database(QString::fromStdString(indexPath), "tag_reconcile_connection");
+    const bool opened = database.openDatabase();
+    return tagManager.reconcile([&](const std::vector<FileIdentity>& identities) {
+        std::vector<std::string> paths(identities.size());
+        if (opened) {
+            const QVector<QString> resolved = database.resolveIdentities(QVector<FileIdentity>(identities.begin(), identities.end()));
+            for (size_t i = 0; i < paths.size(); ++i) {
+                paths[i] = resolved[qsizetype(i)].toStdString();
+            }
+        }
+        return paths;
+    });
 }
 
 // 列出所有标签的函数
 std::vector<std::string> FileTagSystem::listAllTags() const {
+    if (remote) {
+        std::vector<std::string> tags;
+        if (remoteRequest(IndexProtocol::Type::TagList, {}, [&tags](const QStringList& names) { appendStdStrings(tags, names); })) {
+            return tags;
+        }
+    }
     return tagManager.listAllTags();
 }
 
 // 列出某个文件的所有标签的函数
-void FileTagSystem::listTagsForFile() const {
+void FileTagSystem::listTagsForFile() {
     std::string path = getValidPath();
     if (path.empty()) return;
 
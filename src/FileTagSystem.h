@@ -1,27 +1,72 @@
 #ifndef FILE_TAG_SYSTEM_H
 #define FILE_TAG_SYSTEM_H
 
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include <QStringList>
+
+#include "IndexProtocol.h"
 #include "TagManager.h"
 #include "UserManager.h"
 
+// 批量打标签的选项
+struct TagBatchOptions {
+    bool recursive = false;  // 是否包含子目录
+    std::function<bool(const std::filesystem::path&)> filter;  // 文件过滤，为空时接受所有普通文件；会在多个线程中调用
+    TagManager::ProgressCallback progress;  // 进度回调，在调用线程中执行；枚举阶段 total 为 0，done 为已找到的文件数
+    const std::atomic<bool>* cancelled = nullptr;  // 取消标志，置位后本批修改全部撤销
+};
+
 class FileTagSystem {
 public:
-    // 构造函数，接受标签文件路径作为参数
-    explicit FileTagSystem(const std::string& tagsFile, const std::string& usersFile);
+    // 构造函数，接受标签文件路径作为参数；serverName 不为空且 filetagd 正在运行时，标签操作都交给 filetagd，
+    // 本进程不加载标签数据，filetagd 退出后在下一次操作时改为本地加载
+    explicit FileTagSystem(const std::string& tagsFile, const std::string& usersFile, const std::string& serverName = std::string());
     // 主运行函数，控制程序的主循环
     void run();
 
-    // 添加标签的函数
+    // 添加标签的函数，路径为目录时为其中的文件添加
     void addTags(const std::string& filepath, const std::string& tag);
+    // 为一组文件（例如搜索结果）批量添加标签，返回新增标签的文件数，取消时返回 std::nullopt
+    std::optional<size_t> addTags(const std::vector<std::string>& filepaths, const std::string& tag, const TagBatchOptions& options = {});
+    // 为目录中的文件批量添加标签，可递归并按条件过滤，返回新增标签的文件数，取消时返回 std::nullopt
+    std::optional<size_t> addTagsToDirectory(const std::string& directory, const std::string& tag, const TagBatchOptions& options = {});
+    // 从一组文件中批量删除标签，返回删除标签的文件数，取消时返回 std::nullopt
+    std::optional<size_t> removeTags(const std::vector<std::string>& filepaths, const std::string& tag, const TagBatchOptions& options = {});
     // 根据标签搜索文件的函数
     std::vector<std::string> searchFilesByTag(const std::string& tag) const;
+    // 按布尔表达式搜索文件的函数，例如 work AND 2024 AND NOT archived
+    std::vector<std::string> queryFiles(const std::string& expression) const;
+    // 按布尔表达式分批输出文件的函数，回调返回 false 时停止，返回输出的文件数
+    size_t queryFiles(const std::string& expression, size_t batchSize, const TagManager::BatchCallback& onBatch) const;
+    // 按布尔表达式统计文件数的函数
+    size_t countFiles(const std::string& expression) const;
+    // 返回判断单个文件是否满足表达式的函数；标签由 filetagd 持有时会取回全部满足条件的文件
+    std::function<bool(const std::string&)> tagMatcher(const std::string& expression) const;
+    // 返回一组文件中满足表达式的文件，顺序不变；标签由 filetagd 持有时整批只往返一次
+    std::vector<std::string> filterTagged(const std::string& expression, const std::vector<std::string>& filepaths) const;
+    // 标签操作是否交给 filetagd
+    bool isRemote() const;
     // 删除标签的函数
     void removeTag(const std::string& filepath, const std::string& tag);
     // 更新标签的函数
     void updateTag(const std::string& filepath, const std::string& oldTag, const std::string& newTag);
+    // 全局重命名标签的函数，新标签已在用时合并
+    size_t renameTag(const std::string& oldTag, const std::string& newTag);
+    // 将标签 source 合并到 target 的函数
+    size_t mergeTag(const std::string& source, const std::string& target);
+    // 从所有文件删除标签的函数
+    size_t deleteTag(const std::string& tag);
+    // 目录已被移动或重命名，标签随之迁移的函数；filetagd 持有标签数据时不可用
+    size_t moveDirectory(const std::string& oldDirectory, const std::string& newDirectory);
+    // 整理标签路径的函数：已不存在的文件按 (设备号, inode) 在文件索引中找回新路径，返回找回的文件数
+    size_t reconcileTags(const std::string& indexPath = "file_index.db");
     // 列出所有标签的函数
     std::vector<std::string> listAllTags() const;
 
@@ -32,15 +77,31 @@ private:
     void handleChoice(int choice);
 
     // 列出某个文件的所有标签的函数
-    void listTagsForFile() const;
+    void listTagsForFile();
+    // 并行枚举目录中符合条件的文件
+    static std::vector<std::string> collectFiles(const std::string& directory, const TagBatchOptions& options);
+
+    // 连接 filetagd，成功时之后的标签操作都交给它；waitMs 内重试，为 0 时只尝试一次
+    bool connectDaemon(int waitMs);
+    // 把请求交给 filetagd，返回 Done 的 value；连接不上时改为本地加载并返回 std::nullopt，请求失败时抛出 std::runtime_error
+    std::optional<qint64> remoteRequest(IndexProtocol::Type type, const QStringList& arguments,
+                                        const std::function<void(const QStringList&)>& onResults = {}) const;
+    // 分批把一组文件交给 filetagd 添加或删除标签，返回涉及的文件数；连接不上时返回 std::nullopt
+    std::optional<size_t> remoteBatch(IndexProtocol::Type type, const std::vector<std::string>& filepaths,
+                                      const std::string& tag, const TagBatchOptions& options);
+    // filetagd 已退出，改为本地加载标签数据；数据仍被占用时抛出 std::runtime_error
+    void switchToLocal() const;
 
     // 新增的用户登录和管理函数
     bool login();
     void displayAdminMenu() const;
     void handleAdminChoice(int choice);
 
-    TagManager tagManager;
+    TagManager tagManager;    // filetagd 持有标签数据时不加载
     UserManager userManager;  // 用户管理对象
+    QString serverName;       // filetagd 的套接字名，为空时只在本地操作
+    mutable std::atomic<bool> remote{false};  // 标签操作是否交给 filetagd，只会从 true 变为 false
+    mutable std::mutex modeMutex;             // 保护改为本地加载的过程
     std::string currentUser;  // 当前用户名
     UserRole currentUserRole; // 当前用户角色
 
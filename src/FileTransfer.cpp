@@ -1,5 +1,9 @@
 #include "FileTransfer.h"
 #include "ui_FileTransfer.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+#include <QElapsedTimer>
 
 FileTransfer::FileTransfer(QWidget *parent) :
     QMainWindow(parent),
@@ -100,8 +104,15 @@ void FileTransfer::onSendFileButtonClicked()
         return;
     }
 
+    static MetricCounter &transfers = Metrics::counter("filetag_transfers_total", "完成的文件发送次数");
+    static MetricCounter &failures = Metrics::counter("filetag_transfer_failures_total", "失败的文件发送次数");
+    static MetricHistogram &duration = Metrics::histogram("filetag_transfer_duration_ms", "一次文件发送的耗时（毫秒）");
+
+    QElapsedTimer transferTimer;
+    transferTimer.start();
     QFile file(filePath);
     if (file.open(QIODevice::ReadOnly)) {
+        TraceSpan sendSpan("transfer_send", file.size());
         QString fileName = file.fileName();
         QDataStream out(tcpSocket);
         out << fileName;
@@ -130,14 +141,18 @@ void FileTransfer::onSendFileButtonClicked()
         progressTimer->stop();
         delete progressTimer;
 
+        duration.record(transferTimer.elapsed());
         if (bytesSent == totalBytes) {
             // 传输成功，发出文件传输完成信号
+            transfers.add();
             emit fileTransferFinished(true);
         } else {
             // 传输失败，发出文件传输完成信号
+            failures.add();
             emit fileTransferFinished(false);
         }
     } else {
+        failures.add();
         QMessageBox::warning(this, "警告", "无法打开文件！", QMessageBox::Ok);
         // 发出文件传输完成信号，传输失败
         emit fileTransferFinished(false);
@@ -155,6 +170,9 @@ void FileTransfer::onTcpSocketConnected()
 void FileTransfer::onTcpSocketBytesWritten(qint64 bytes)
 {
     // 更新已发送的字节数
+    TraceSpan span("transfer_chunk", bytes);
+    static MetricCounter &sentBytes = Metrics::counter("filetag_transfer_bytes_total", "已发送的字节数");
+    sentBytes.add(bytes);
     bytesSent += bytes;
 
     // 发出文件传输进度信号
@@ -0,0 +1,346 @@
+/*
+ * FlightRecorder.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 运行记录器实现。每个线程独占一个 PerThreadRing 环，线程退出后环保留到被新线程复用；
+ *          导出只使用异步信号安全的操作（原子读、open/write），可以直接在信号处理函数中执行
+ */
+
+#include "FlightRecorder.h"
+#include "PerThreadRing.h"
+
+#include <QByteArray>
+#include <QThread>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const quint64 EventsPerThread = 2048;  // 2 的幂
+const int TextUnits = 26;              // 每个事件保留的 UTF-16 单元数
+
+struct Entry {
+    qint64 ticks;
+    qint64 a;
+    qint64 b;
+    quint16 type;
+    quint16 length;
+    char16_t text[TextUnits];
+};
+
+// 环的 first 为当前线程的第一个事件，复用前的事件不再导出
+using EntryRings = PerThreadRing<Entry, EventsPerThread>;
+
+std::atomic<int> dumpSequence{0};
+char dumpPrefix[512] = "flight_";       // 安装信号处理时生成，如 logs/flight_1234_
+
+qint64 steadyTicks() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 线程取得环时记下线程名与线程 ID，之前线程留下的事件不再导出
+void claimRing(EntryRings::Ring &ring) {
+    const QByteArray name = QThread::currentThread() ? QThread::currentThread()->objectName().toUtf8() : QByteArray();
+    std::strncpy(ring.threadName, name.constData(), sizeof(ring.threadName) - 1);
+    ring.threadId.store(quint64(reinterpret_cast<quintptr>(QThread::currentThreadId())), std::memory_order_relaxed);
+    ring.first.store(ring.head.load(std::memory_order_relaxed), std::memory_order_release);
+}
+
+inline Entry &nextEntry(quint64 &head) {
+    return EntryRings::claim(head, claimRing);
+}
+
+inline void publish(quint64 head) {
+    EntryRings::publish(head);
+}
+
+// 信号处理函数中可用的输出：固定缓冲区，满了直接 write
+class SafeWriter {
+public:
+    explicit SafeWriter(int fd) : fd(fd) {}
+    ~SafeWriter() { flush(); }
+
+    void text(const char *value) {
+        while (*value) {
+            put(*value++);
+        }
+    }
+
+    void number(qint64 value) {
+        char digits[24];
+        int count = 0;
+        quint64 magnitude = value < 0 ? quint64(0) - quint64(value) : quint64(value);
+        do {
+            digits[count++] = char('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude);
+        if (value < 0) {
+            put('-');
+        }
+        while (count) {
+            put(digits[--count]);
+        }
+    }
+
+    void hex(quint64 value) {
+        char digits[16];
+        int count = 0;
+        do {
+            digits[count++] = "0123456789abcdef"[value & 0xF];
+            value >>= 4;
+        } while (value);
+        while (count) {
+            put(digits[--count]);
+        }
+    }
+
+    // 相对导出时刻的毫秒数，保留三位小数
+    void milliseconds(qint64 nanoseconds) {
+        const qint64 micros = nanoseconds / 1000;
+        const quint64 magnitude = micros < 0 ? quint64(0) - quint64(micros) : quint64(micros);
+        if (micros < 0) {
+            put('-');
+        }
+        number(qint64(magnitude / 1000));
+        put('.');
+        put(char('0' + magnitude / 100 % 10));
+        put(char('0' + magnitude / 10 % 10));
+        put(char('0' + magnitude % 10));
+    }
+
+    void utf16(const char16_t *data, int length) {
+        for (int i = 0; i < length; ++i) {
+            char32_t code = data[i];
+            if (code >= 0xD800 && code < 0xDC00 && i + 1 < length && data[i + 1] >= 0xDC00 && data[i + 1] < 0xE000) {
+                code = 0x10000 + ((code - 0xD800) << 10) + (data[++i] - 0xDC00);
+            }
+            if (code < 0x80) {
+                put(char(code));
+            } else if (code < 0x800) {
+                put(char(0xC0 | (code >> 6)));
+                put(char(0x80 | (code & 0x3F)));
+            } else if (code < 0x10000) {
+                put(char(0xE0 | (code >> 12)));
+                put(char(0x80 | ((code >> 6) & 0x3F)));
+                put(char(0x80 | (code & 0x3F)));
+            } else {
+                put(char(0xF0 | (code >> 18)));
+                put(char(0x80 | ((code >> 12) & 0x3F)));
+                put(char(0x80 | ((code >> 6) & 0x3F)));
+                put(char(0x80 | (code & 0x3F)));
+            }
+        }
+    }
+
+    void flush() {
+        const char *data = buffer;
+        while (used > 0) {
+#ifdef Q_OS_WIN
+            const int written = _write(fd, data, unsigned(used));
+#else
+            const ssize_t written = ::write(fd, data, size_t(used));
+#endif
+            if (written <= 0) {
+                break;
+            }
+            data += written;
+            used -= int(written);
+        }
+        used = 0;
+    }
+
+private:
+    void put(char c) {
+        if (used == int(sizeof(buffer))) {
+            flush();
+        }
+        buffer[used++] = c;
+    }
+
+    int fd;
+    int used = 0;
+    char buffer[4096];
+};
+
+// 按 dumpPrefix + 序号生成路径，写入全部线程的事件；返回是否成功
+bool dumpTo(char *path, size_t capacity) {
+    // 路径：前缀 + 序号 + .txt
+    const size_t prefixLength = std::strlen(dumpPrefix);
+    if (prefixLength + 16 >= capacity) {
+        return false;
+    }
+    std::memcpy(path, dumpPrefix, prefixLength);
+    char *cursor = path + prefixLength;
+    int sequence = dumpSequence.fetch_add(1) + 1;
+    char digits[12];
+    int count = 0;
+    do {
+        digits[count++] = char('0' + sequence % 10);
+        sequence /= 10;
+    } while (sequence);
+    while (count) {
+        *cursor++ = digits[--count];
+    }
+    std::memcpy(cursor, ".txt", 5);
+
+#ifdef Q_OS_WIN
+    const int fd = _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (fd < 0) {
+        return false;
+    }
+
+    const qint64 now = steadyTicks();
+    {
+        SafeWriter out(fd);
+        out.text("FileTag 运行记录，时间为相对导出时刻的毫秒数\n");
+        for (EntryRings::Ring *ring = EntryRings::rings(); ring; ring = ring->next) {
+            const EntryRings::Range range = EntryRings::readable(*ring);
+
+            out.text("\n线程 ");
+            out.hex(ring->threadId.load(std::memory_order_relaxed));
+            if (ring->threadName[0]) {
+                out.text(" (");
+                out.text(ring->threadName);
+                out.text(")");
+            }
+            out.text(ring->inUse.load(std::memory_order_relaxed) ? "" : " 已退出");
+            out.text("，事件 ");
+            out.number(qint64(range.end - range.begin));
+            out.text("\n");
+
+            EntryRings::read(*ring, range, [&out, now](const Entry &entry) {
+                out.text("  ");
+                out.milliseconds(entry.ticks - now);
+                out.text("  ");
+                out.text(FlightRecorder::eventName(FlightRecorder::Event(entry.type)));
+                out.text(" a=");
+                out.number(entry.a);
+                out.text(" b=");
+                out.number(entry.b);
+                if (entry.length > 0) {
+                    out.text("  ");
+                    out.utf16(entry.text, qMin<int>(entry.length, TextUnits));
+                }
+                out.text("\n");
+            });
+        }
+    }
+#ifdef Q_OS_WIN
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+    return true;
+}
+
+void onCrashSignal(int signal) {
+    char path[600];
+    dumpTo(path, sizeof(path));
+    std::signal(signal, SIG_DFL);  // 恢复默认处理后重新触发，保留原有的崩溃行为
+    std::raise(signal);
+}
+
+#ifndef Q_OS_WIN
+void onDumpSignal(int) {
+    char path[600];
+    dumpTo(path, sizeof(path));
+}
+#endif
+
+} // namespace
+
+void FlightRecorder::record(Event event, qint64 a, qint64 b) {
+    quint64 head;
+    Entry &entry = nextEntry(head);
+    entry.ticks = steadyTicks();
+    entry.a = a;
+    entry.b = b;
+    entry.type = quint16(event);
+    entry.length = 0;
+    publish(head);
+}
+
+void FlightRecorder::record(Event event, qint64 a, qint64 b, const QString &text) {
+    quint64 head;
+    Entry &entry = nextEntry(head);
+    entry.ticks = steadyTicks();
+    entry.a = a;
+    entry.b = b;
+    entry.type = quint16(event);
+    // 路径的末尾最有辨识度
+    const qsizetype length = qMin<qsizetype>(text.size(), TextUnits);
+    std::memcpy(entry.text, text.constData() + (text.size() - length), size_t(length) * sizeof(char16_t));
+    entry.length = quint16(length);
+    publish(head);
+}
+
+/*
+ * Summary: 生成导出路径前缀并注册信号处理。SIGUSR1 导出后程序继续运行；
+ *          SIGSEGV、SIGABRT 等崩溃信号导出后按默认方式终止
+ * Parameters:
+ * const QString &directory - 导出目录
+ * Return: void
+ */
+void FlightRecorder::installSignalHandlers(const QString &directory) {
+#ifdef Q_OS_WIN
+    const qint64 pid = _getpid();
+#else
+    const qint64 pid = ::getpid();
+#endif
+    const QByteArray prefix = QString("%1/flight_%2_").arg(directory).arg(pid).toLocal8Bit();
+    std::strncpy(dumpPrefix, prefix.constData(), sizeof(dumpPrefix) - 1);
+
+    for (int signal : { SIGSEGV, SIGABRT, SIGFPE, SIGILL }) {
+        std::signal(signal, onCrashSignal);
+    }
+#ifndef Q_OS_WIN
+    std::signal(SIGBUS, onCrashSignal);
+
+    struct sigaction action {};
+    action.sa_handler = onDumpSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, nullptr);
+#endif
+}
+
+QString FlightRecorder::dump() {
+    char path[600];
+    if (!dumpTo(path, sizeof(path))) {
+        return QString();
+    }
+    return QString::fromLocal8Bit(path);
+}
+
+const char *FlightRecorder::eventName(Event event) {
+    switch (event) {
+        case Event::SearchStart: return "SearchStart";
+        case Event::SearchStop: return "SearchStop";
+        case Event::IndexQuery: return "IndexQuery";
+        case Event::QueueDepth: return "QueueDepth";
+        case Event::DirectoryEnter: return "DirectoryEnter";
+        case Event::DirectoryLeave: return "DirectoryLeave";
+        case Event::DatabaseInsert: return "DatabaseInsert";
+        case Event::DatabaseSearch: return "DatabaseSearch";
+        case Event::DatabaseExport: return "DatabaseExport";
+        default: return "Unknown";
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * FlightRecorder.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 运行记录器。每个线程在内存中保留最近的结构化事件（搜索开始/结束、进入目录、数据库任务、队列长度），
+ *          记录时不加锁、不分配内存、不写盘；收到 SIGUSR1、程序崩溃或在界面中导出时才写入 logs/flight_*.txt
+ */
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <QString>
+
+class FlightRecorder {
+public:
+    enum class Event : quint16 {
+        SearchStart = 1,    // text 为关键字
+        SearchStop,         // a 耗时毫秒，b 为 1 表示被中断
+        IndexQuery,         // a 结果数，b 耗时微秒
+        QueueDepth,         // a 目录任务队列长度
+        DirectoryEnter,     // a 出队后的目录队列长度，text 为目录
+        DirectoryLeave,     // a 遍历的条目数，b 耗时微秒
+        DatabaseInsert,     // a 数据库任务队列剩余长度，b 耗时微秒，text 为文件
+        DatabaseSearch,     // a 数据库任务队列剩余长度，b 耗时微秒
+        DatabaseExport      // a 数据库任务队列剩余长度，b 耗时微秒
+    };
+
+    static void record(Event event, qint64 a = 0, qint64 b = 0);
+    static void record(Event event, qint64 a, qint64 b, const QString &text);  // 只保留 text 的末尾部分
+
+    // 注册 SIGUSR1 与崩溃信号，运行记录写入 directory；Windows 下没有 SIGUSR1，只处理崩溃
+    static void installSignalHandlers(const QString &directory);
+    static QString dump();  // 立即导出，返回文件路径，失败时返回空字符串
+
+    static const char *eventName(Event event);
+};
+
+#endif // FLIGHT_RECORDER_H
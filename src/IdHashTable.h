@@ -0,0 +1,100 @@
+/*
+ * IdHashTable.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 只存放 uint32 ID 的开放寻址哈希表，键保存在调用方的记录中，由调用方按 ID 计算哈希与比较。
+ *          线性探测，删除时后移填补空洞，每个元素约占 5~10 字节
+ */
+
+#ifndef ID_HASH_TABLE_H
+#define ID_HASH_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class IdHashTable {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    // matches(id) 判断 ID 对应的键是否为要找的键，找不到时返回 npos
+    template <typename Matches>
+    uint32_t find(size_t hash, Matches matches) const {
+        if (slots.empty()) {
+            return npos;
+        }
+        const size_t mask = slots.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            const uint32_t id = slots[slot];
+            if (id == npos || matches(id)) {
+                return id;
+            }
+        }
+    }
+
+    // 插入 ID，负载超过 3/4 时扩容；hashOf(id) 计算已有 ID 的哈希
+    template <typename HashOf>
+    void insert(uint32_t id, size_t hash, HashOf hashOf) {
+        if ((count + 1) * 4 > slots.size() * 3) {
+            std::vector<uint32_t> old;
+            old.swap(slots);
+            slots.assign(old.empty() ? 16 : old.size() * 2, npos);
+            for (uint32_t existing : old) {
+                if (existing != npos) {
+                    place(existing, hashOf(existing));
+                }
+            }
+        }
+        place(id, hash);
+        ++count;
+    }
+
+    // 删除 ID，hash 为该 ID 插入时的哈希；之后的元素理想位置不在空洞之后时前移
+    template <typename HashOf>
+    void erase(uint32_t id, size_t hash, HashOf hashOf) {
+        if (slots.empty()) {
+            return;
+        }
+        const size_t mask = slots.size() - 1;
+        size_t hole = hash & mask;
+        while (slots[hole] != id) {
+            if (slots[hole] == npos) {
+                return;
+            }
+            hole = (hole + 1) & mask;
+        }
+        for (size_t next = (hole + 1) & mask; slots[next] != npos; next = (next + 1) & mask) {
+            const size_t home = hashOf(slots[next]) & mask;
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+        }
+        slots[hole] = npos;
+        --count;
+    }
+
+    void clear() {
+        slots.clear();
+        count = 0;
+    }
+
+    size_t memoryUsage() const { return slots.capacity() * sizeof(uint32_t); }
+
+private:
+    void place(uint32_t id, size_t hash) {
+        const size_t mask = slots.size() - 1;
+        size_t slot = hash & mask;
+        while (slots[slot] != npos) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id;
+    }
+
+    std::vector<uint32_t> slots;
+    size_t count = 0;
+};
+
+#endif // ID_HASH_TABLE_H
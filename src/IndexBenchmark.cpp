@@ -0,0 +1,495 @@
+/*
+ * IndexBenchmark.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetag-index-bench：在固定种子生成的合成行上测量 FileIndexDatabase 的规模表现：
+ *          insertFileInfo 逐条与分批事务写入的吞吐、与读并发时的写入吞吐、searchFiles 选择性与非选择性关键字的延迟分位数、
+ *          getFileId 点查延迟以及数据库文件大小；同一批路径打上标签后比较 TagIndex 与旧版路径到标签列表映射的内存占用。
+ *          结果以 JSON 输出，索引或表结构改动前后各跑一次即可对比。
+ *          用法：filetag-index-bench [--rows 1000000,10000000] [--seed 1] [--tag-rows 1000000] [--dir 数据库目录] [--output result.json]
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FileIndexDatabase.h"
+#include "Logger.h"
+#include "TagIndex.h"
+
+namespace {
+
+const char *const ConnectionName = "index_bench_writer";
+const char *const ReaderConnectionName = "index_bench_reader";
+const char *const PathRoot = "/filetag-index-bench";
+const char *const Needle = "needle";              // 约万分之一的文件名含有，作为选择性关键字
+const char *const BroadKeyword = ".cpp";          // 约十六分之一的文件，作为非选择性关键字
+const char AsciiChars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-";
+const char *const Extensions[] = {"txt", "md", "cpp", "h", "py", "js", "json", "png", "jpg", "pdf",
+                                  "docx", "xlsx", "zip", "log", "csv", ""};
+const quint64 FilesPerDirectory = 40;
+const quint64 DirectoriesPerParent = 50;
+const quint64 TagVocabulary = 200;                // 标签内存测量中的标签种类数
+
+quint64 mix(quint64 value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// 名称只取决于种子、所在层与编号；15% 为中日韩字符
+QString syntheticName(quint64 seed, quint64 level, quint64 id) {
+    quint64 state = mix(seed ^ mix((level << 56) ^ id));
+    const int length = 4 + int(state % 13);
+    const bool cjk = (state >> 8) % 100 < 15;
+    QString name;
+    name.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        state = mix(state + 0x9E3779B97F4A7C15ULL);
+        name += cjk ? QChar(char16_t(0x4E00 + state % (0x9FFF - 0x4E00)))
+                    : QChar(AsciiChars[state % (sizeof(AsciiChars) - 1)]);
+    }
+    return name;
+}
+
+/*
+ * Summary: 第 index 行的路径。每 40 个文件一个目录、每 50 个目录一个上级目录，纯函数，不占内存也不落盘；
+ *          路径指向不存在的文件，insertFileInfo 中的 stat 很快失败，测到的主要是数据库本身的开销
+ * Parameters:
+ * quint64 seed - 随机种子
+ * quint64 index - 行号
+ * Return: QString - 绝对路径
+ */
+QString syntheticPath(quint64 seed, quint64 index) {
+    const quint64 directory = index / FilesPerDirectory;
+    const quint64 parent = directory / DirectoriesPerParent;
+    const quint64 grandparent = parent / DirectoriesPerParent;
+    const quint64 hash = mix(seed ^ mix(index + 1));
+    const int extensionCount = int(sizeof(Extensions) / sizeof(Extensions[0]));
+    const QString extension = Extensions[hash % extensionCount];
+
+    QString name = syntheticName(seed, 4, index);
+    if ((hash >> 16) % 10000 == 0) {
+        name.insert(name.size() / 2, Needle);
+    }
+    return QString("%1/%2/%3/%4/%5_%6")
+                   .arg(PathRoot, syntheticName(seed, 1, grandparent), syntheticName(seed, 2, parent),
+                        syntheticName(seed, 3, directory), name)
+                   .arg(index)
+           + (extension.isEmpty() ? QString() : "." + extension);
+}
+
+struct Latency {
+    qint64 count = 0;
+    double p50 = 0, p90 = 0, p99 = 0, max = 0;   // 微秒
+};
+
+Latency latencyOf(QVector<qint64> nanoseconds) {
+    Latency result;
+    result.count = nanoseconds.size();
+    if (nanoseconds.isEmpty()) {
+        return result;
+    }
+    std::sort(nanoseconds.begin(), nanoseconds.end());
+    auto at = [&](double quantile) {
+        return nanoseconds[qMin(nanoseconds.size() - 1, qsizetype(quantile * nanoseconds.size()))] / 1000.0;
+    };
+    result.p50 = at(0.50);
+    result.p90 = at(0.90);
+    result.p99 = at(0.99);
+    result.max = nanoseconds.last() / 1000.0;
+    return result;
+}
+
+QJsonObject toJson(const Latency &latency) {
+    return QJsonObject{{"count", latency.count}, {"p50Us", latency.p50}, {"p90Us", latency.p90},
+                       {"p99Us", latency.p99}, {"maxUs", latency.max}};
+}
+
+QJsonObject throughput(qint64 rows, qint64 nanoseconds) {
+    return QJsonObject{{"rows", rows}, {"elapsedMs", nanoseconds / 1e6},
+                       {"rowsPerSec", nanoseconds > 0 ? rows * 1e9 / nanoseconds : 0.0}};
+}
+
+/*
+ * Summary: 依次调用 insertFileInfo 写入 [from, to) 行，每 batchSize 行放在一个事务中提交
+ * Parameters:
+ * FileIndexDatabase &database - 已打开的写连接
+ * quint64 seed - 随机种子
+ * qint64 from - 起始行号
+ * qint64 to - 结束行号（不含）
+ * int batchSize - 每个事务的行数，1 表示不开事务、逐条自动提交
+ * Return: bool - 是否全部成功
+ */
+bool insertRows(FileIndexDatabase &database, quint64 seed, qint64 from, qint64 to, int batchSize) {
+    QSqlDatabase connection = QSqlDatabase::database(ConnectionName, false);
+    bool ok = true;
+    for (qint64 begin = from; begin < to; begin += batchSize) {
+        const qint64 end = qMin(to, begin + batchSize);
+        const bool batched = batchSize > 1 && connection.transaction();
+        for (qint64 index = begin; index < end; ++index) {
+            ok = database.insertFileInfo(syntheticPath(seed, quint64(index))) && ok;
+        }
+        if (batched && !connection.commit()) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// 数据库文件及日志文件的总大小
+qint64 databaseSize(const QString &path) {
+    qint64 size = 0;
+    for (const QString &suffix : {"", "-journal", "-wal", "-shm"}) {
+        size += QFileInfo(path + suffix).size();
+    }
+    return size;
+}
+
+QString pragma(const QString &name) {
+    QSqlQuery query(QSqlDatabase::database(ConnectionName, false));
+    return query.exec("PRAGMA " + name) && query.next() ? query.value(0).toString() : QString();
+}
+
+/*
+ * Summary: 对每个关键字重复执行 searchFiles，记录延迟与匹配数
+ * Parameters:
+ * FileIndexDatabase &database - 已打开的连接
+ * const QStringList &keywords - 关键字
+ * int queries - 每个关键字的查询次数
+ * Return: QJsonArray - 每个关键字一项
+ */
+QJsonArray measureSearch(FileIndexDatabase &database, const QStringList &keywords, int queries) {
+    QJsonArray result;
+    for (const QString &keyword : keywords) {
+        QVector<qint64> samples;
+        qint64 matches = 0;
+        QElapsedTimer timer;
+        for (int i = 0; i < queries; ++i) {
+            timer.start();
+            matches = database.searchFiles(keyword).size();
+            samples << timer.nsecsElapsed();
+        }
+        QJsonObject entry = toJson(latencyOf(samples));
+        entry["keyword"] = keyword;
+        entry["matches"] = matches;
+        result.append(entry);
+    }
+    return result;
+}
+
+/*
+ * Summary: 按固定种子随机抽取已有行做 getFileId 点查
+ * Parameters:
+ * FileIndexDatabase &database - 已打开的连接
+ * quint64 seed - 随机种子
+ * qint64 rows - 已有行数
+ * int lookups - 点查次数
+ * Return: QJsonObject - 延迟分位数与未找到的次数
+ */
+QJsonObject measureLookups(FileIndexDatabase &database, quint64 seed, qint64 rows, int lookups) {
+    QVector<qint64> samples;
+    samples.reserve(lookups);
+    qint64 missing = 0;
+    QElapsedTimer timer;
+    for (int i = 0; i < lookups; ++i) {
+        const QString path = syntheticPath(seed, mix(seed ^ mix(quint64(i) + 0x5EED)) % quint64(rows));
+        timer.start();
+        missing += database.getFileId(path) < 0;
+        samples << timer.nsecsElapsed();
+    }
+    QJsonObject result = toJson(latencyOf(samples));
+    result["missing"] = missing;
+    return result;
+}
+
+/*
+ * Summary: 读线程用独立连接循环执行选择性搜索与点查，同时本线程分批写入新行；
+ *          SQLite 同一时刻只允许一个写者，读事务会推迟提交，两边的延迟都计入结果
+ * Parameters:
+ * FileIndexDatabase &database - 写连接
+ * const QString &path - 数据库文件
+ * quint64 seed - 随机种子
+ * qint64 rows - 已有行数，新行从这里开始编号
+ * qint64 extraRows - 写入的新行数
+ * int batchSize - 每个事务的行数
+ * Return: QJsonObject - 写入吞吐与读延迟
+ */
+QJsonObject measureConcurrent(FileIndexDatabase &database, const QString &path, quint64 seed, qint64 rows,
+                              qint64 extraRows, int batchSize) {
+    std::atomic<bool> stop{false};
+    QVector<qint64> searchSamples;
+    QVector<qint64> lookupSamples;
+    QThread *reader = QThread::create([&] {
+        FileIndexDatabase readerDatabase(path, ReaderConnectionName);
+        if (!readerDatabase.openDatabase()) {
+            return;
+        }
+        QElapsedTimer timer;
+        for (quint64 i = 0; !stop.load(); ++i) {
+            timer.start();
+            readerDatabase.searchFiles(Needle);
+            searchSamples << timer.nsecsElapsed();
+            for (int j = 0; j < 100 && !stop.load(); ++j) {
+                const QString lookupPath = syntheticPath(seed, mix(seed ^ mix(i * 100 + j)) % quint64(rows));
+                timer.start();
+                readerDatabase.getFileId(lookupPath);
+                lookupSamples << timer.nsecsElapsed();
+            }
+        }
+    });
+    reader->start();
+
+    QElapsedTimer timer;
+    timer.start();
+    const bool ok = insertRows(database, seed, rows, rows + extraRows, batchSize);
+    const qint64 elapsed = timer.nsecsElapsed();
+    stop = true;
+    reader->wait();
+    delete reader;
+
+    QJsonObject result{{"insert", throughput(extraRows, elapsed)},
+                       {"search", toJson(latencyOf(searchSamples))},
+                       {"lookup", toJson(latencyOf(lookupSamples))}};
+    result["insertOk"] = ok;
+    return result;
+}
+
+// std::string 在堆上占用的字节数，短字符串优化范围内为 0
+size_t stringHeapBytes(const std::string &value) {
+    return value.capacity() > std::string().capacity() ? value.capacity() + 1 : 0;
+}
+
+/*
+ * Summary: 旧版标签数据（路径 -> 标签列表的 unordered_map）的内存估算：桶数组、每个节点
+ *          （next 指针、键值对、缓存的哈希值）以及字符串与 vector 在堆上的部分，不含分配器的额外开销
+ * Parameters:
+ * const std::unordered_map<std::string, std::vector<std::string>> &tags - 旧版标签数据
+ * Return: size_t - 估算字节数
+ */
+size_t legacyTagBytes(const std::unordered_map<std::string, std::vector<std::string>> &tags) {
+    using Node = std::pair<const std::string, std::vector<std::string>>;
+    size_t bytes = sizeof(tags) + tags.bucket_count() * sizeof(void *);
+    for (const auto &[path, list] : tags) {
+        bytes += sizeof(void *) + sizeof(Node) + sizeof(size_t) + stringHeapBytes(path)
+                 + list.capacity() * sizeof(std::string);
+        for (const std::string &tag : list) {
+            bytes += stringHeapBytes(tag);
+        }
+    }
+    return bytes;
+}
+
+/*
+ * Summary: 前 rows 个合成路径各打 1 到 3 个标签，分别写入 TagIndex 与旧版映射，比较内存占用
+ * Parameters:
+ * quint64 seed - 随机种子
+ * qint64 rows - 文件数
+ * Return: QJsonObject - 两种结构的字节数与每个文件的平均字节数
+ */
+QJsonObject measureTagMemory(quint64 seed, qint64 rows) {
+    TagIndex index;
+    std::unordered_map<std::string, std::vector<std::string>> legacy;
+    qint64 tagged = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (qint64 i = 0; i < rows; ++i) {
+        const std::string path = syntheticPath(seed, quint64(i)).toStdString();
+        const quint64 hash = mix(seed ^ mix(quint64(i) + 0x7A6));
+        const int count = 1 + int(hash % 3);
+        for (int j = 0; j < count; ++j) {
+            const std::string tag = "tag_" + std::to_string(mix(hash + quint64(j)) % TagVocabulary);
+            if (index.add(path, tag)) {
+                legacy[path].push_back(tag);
+                ++tagged;
+            }
+        }
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    const size_t indexBytes = index.memoryUsage();
+    const size_t legacyBytes = legacyTagBytes(legacy);
+    return QJsonObject{{"files", rows},
+                       {"tags", tagged},
+                       {"buildMs", elapsed / 1e6},
+                       {"tagIndexBytes", qint64(indexBytes)},
+                       {"tagIndexBytesPerFile", rows > 0 ? double(indexBytes) / rows : 0.0},
+                       {"legacyMapBytes", qint64(legacyBytes)},
+                       {"legacyMapBytesPerFile", rows > 0 ? double(legacyBytes) / rows : 0.0}};
+}
+
+struct Options {
+    quint64 seed = 1;
+    int singleRows = 10000;
+    int batchSize = 10000;
+    int lookups = 10000;
+    int queries = 10;
+    qint64 concurrentRows = 100000;
+    qint64 tagRows = 1000000;
+};
+
+/*
+ * Summary: 在 directory 下新建数据库，写入 rows 行后依次测量各项
+ * Parameters:
+ * const QString &directory - 数据库目录
+ * qint64 rows - 行数
+ * const Options &options - 参数
+ * QTextStream &errors - 进度输出
+ * Return: QJsonObject - 本规模的结果，失败时含 error
+ */
+QJsonObject runScale(const QString &directory, qint64 rows, const Options &options, QTextStream &errors) {
+    const QString path = QDir(directory).filePath(QString("index_bench_%1.db").arg(rows));
+    for (const QString &suffix : {"", "-journal", "-wal", "-shm"}) {
+        QFile::remove(path + suffix);
+    }
+
+    QJsonObject result{{"rows", rows}, {"database", path}};
+    FileIndexDatabase database(path, ConnectionName);
+    if (!database.openDatabase()) {
+        result["error"] = "无法打开数据库";
+        return result;
+    }
+    result["journalMode"] = pragma("journal_mode");
+    result["synchronous"] = pragma("synchronous");
+
+    // 逐条写入只跑开头一小段，自动提交每行一次同步，全量跑在 1000 万行时要数小时
+    const qint64 singleRows = qMin<qint64>(options.singleRows, rows);
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = insertRows(database, options.seed, 0, singleRows, 1);
+    result["insertSingle"] = throughput(singleRows, timer.nsecsElapsed());
+    errors << QString("%1 行：逐条写入 %2 行完成\n").arg(rows).arg(singleRows);
+
+    timer.start();
+    ok = insertRows(database, options.seed, singleRows, rows, options.batchSize) && ok;
+    QJsonObject batched = throughput(rows - singleRows, timer.nsecsElapsed());
+    batched["batchSize"] = options.batchSize;
+    result["insertBatched"] = batched;
+    result["insertOk"] = ok;
+    result["databaseBytes"] = databaseSize(path);
+    result["bytesPerRow"] = rows > 0 ? double(databaseSize(path)) / rows : 0.0;
+    errors << QString("%1 行：分批写入完成，数据库 %2 MB\n").arg(rows).arg(databaseSize(path) / 1048576.0, 0, 'f', 1);
+
+    result["lookup"] = measureLookups(database, options.seed, rows, options.lookups);
+    result["search"] = measureSearch(database, {Needle, BroadKeyword}, options.queries);
+    errors << QString("%1 行：点查与搜索完成\n").arg(rows);
+
+    if (options.concurrentRows > 0) {
+        result["concurrent"] = measureConcurrent(database, path, options.seed, rows, options.concurrentRows,
+                                                 options.batchSize);
+        errors << QString("%1 行：并发读写完成\n").arg(rows);
+    }
+    database.closeDatabase();
+
+    // 两种结构都要整份放在内存中，行数很多时只取开头一段
+    const qint64 tagRows = qMin(options.tagRows, rows);
+    if (tagRows > 0) {
+        result["tagMemory"] = measureTagMemory(options.seed, tagRows);
+        errors << QString("%1 行：标签内存测量完成（%2 个文件）\n").arg(rows).arg(tagRows);
+    }
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QTextStream errors(stderr);
+
+    const Options defaults;
+    QCommandLineParser parser;
+    parser.setApplicationDescription("FileIndexDatabase 规模基准测试");
+    parser.addHelpOption();
+    parser.addOptions({
+            {"rows", "逗号分隔的行数列表", "list", "1000000,10000000"},
+            {"seed", "合成数据的随机种子", "n", QString::number(defaults.seed)},
+            {"single", "逐条自动提交写入的行数", "n", QString::number(defaults.singleRows)},
+            {"batch", "分批写入时每个事务的行数", "n", QString::number(defaults.batchSize)},
+            {"lookups", "getFileId 点查次数", "n", QString::number(defaults.lookups)},
+            {"queries", "每个关键字的 searchFiles 次数", "n", QString::number(defaults.queries)},
+            {"concurrent", "与读并发时写入的行数，0 表示跳过", "n", QString::number(defaults.concurrentRows)},
+            {"tag-rows", "标签内存测量的文件数上限，0 表示跳过", "n", QString::number(defaults.tagRows)},
+            {"dir", "数据库所在目录，默认使用临时目录并在结束后删除", "dir"},
+            {"output", "JSON 输出文件，默认输出到标准输出", "file"}
+    });
+    parser.process(app);
+
+    // searchFiles 每次调用都会写日志和 qDebug，只保留警告与错误，避免影响计时
+    Logger::instance().setLogLevel(LogLevel::WARNING);
+    QLoggingCategory::setFilterRules("default.debug=false");
+
+    Options options;
+    options.seed = parser.value("seed").toULongLong();
+    options.singleRows = qMax(0, parser.value("single").toInt());
+    options.batchSize = qMax(1, parser.value("batch").toInt());
+    options.lookups = qMax(1, parser.value("lookups").toInt());
+    options.queries = qMax(1, parser.value("queries").toInt());
+    options.concurrentRows = qMax<qint64>(0, parser.value("concurrent").toLongLong());
+    options.tagRows = qMax<qint64>(0, parser.value("tag-rows").toLongLong());
+
+    QTemporaryDir temporaryDirectory;
+    const QString directory = parser.isSet("dir") ? parser.value("dir") : temporaryDirectory.path();
+    if (!QDir().mkpath(directory)) {
+        errors << "无法创建目录 " << directory << "\n";
+        return 1;
+    }
+
+    QJsonArray scales;
+    bool ok = true;
+    for (const QString &value : parser.value("rows").split(',', Qt::SkipEmptyParts)) {
+        const qint64 rows = value.toLongLong();
+        if (rows <= 0) {
+            continue;
+        }
+        const QJsonObject scale = runScale(directory, rows, options, errors);
+        ok = ok && !scale.contains("error") && scale["insertOk"].toBool();
+        scales.append(scale);
+    }
+
+    const QJsonObject report{
+            {"benchmark", "index"},
+            {"timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+            {"host", QJsonObject{{"cpus", QThread::idealThreadCount()},
+                                 {"os", QSysInfo::prettyProductName()},
+                                 {"arch", QSysInfo::currentCpuArchitecture()}}},
+            {"seed", QString::number(options.seed)},
+            {"keywords", QJsonObject{{"selective", Needle}, {"broad", BroadKeyword}}},
+            {"scales", scales}
+    };
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    if (parser.isSet("output")) {
+        QFile output(parser.value("output"));
+        if (!output.open(QIODevice::WriteOnly)) {
+            errors << "无法写入 " << output.fileName() << ": " << output.errorString() << "\n";
+            return 1;
+        }
+        output.write(json);
+    } else {
+        QFile output;
+        output.open(stdout, QIODevice::WriteOnly);
+        output.write(json);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+/*
+ * IndexClient.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetagd 同步客户端实现
+ */
+
+#include "IndexClient.h"
+
+IndexClient::IndexClient(const QString &serverName)
+        : serverName(serverName), nextId(1), timeoutMs(30000) {}
+
+bool IndexClient::connectToServer(int timeoutMs) {
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(timeoutMs)) {
+        error = socket.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool IndexClient::isConnected() const {
+    return socket.state() == QLocalSocket::ConnectedState;
+}
+
+QString IndexClient::errorString() const {
+    return error;
+}
+
+void IndexClient::setTimeout(int milliseconds) {
+    timeoutMs = milliseconds;
+}
+
+/*
+ * Summary: 发送请求，读取回复直到本请求的 Done 或 Error
+ * Parameters:
+ * IndexProtocol::Type type - 请求类型
+ * const QStringList &arguments - 请求参数
+ * const std::function<void(const QStringList &)> &onResults - 每批结果的回调，可为空
+ * qint64 *value - 保存 Done 中的数值，可为空
+ * Return: bool - 请求是否成功完成
+ */
+bool IndexClient::request(IndexProtocol::Type type, const QStringList &arguments,
+                          const std::function<void(const QStringList &)> &onResults, qint64 *value) {
+    if (!isConnected()) {
+        error = "未连接到 filetagd";
+        return false;
+    }
+
+    IndexProtocol::Message message;
+    message.type = type;
+    message.id = nextId++;
+    message.strings = arguments;
+    socket.write(IndexProtocol::encode(message));
+    socket.flush();
+
+    IndexProtocol::Message reply;
+    while (true) {
+        while (reader.next(reply)) {
+            if (reply.id != message.id) {
+                continue;  // 之前超时放弃的请求的迟到回复
+            }
+            switch (reply.type) {
+                case IndexProtocol::Type::Results:
+                    if (onResults) {
+                        onResults(reply.strings);
+                    }
+                    break;
+                case IndexProtocol::Type::Done:
+                    if (value) {
+                        *value = reply.value;
+                    }
+                    return true;
+                case IndexProtocol::Type::Error:
+                    error = reply.strings.value(0);
+                    return false;
+                default:
+                    break;
+            }
+        }
+        if (reader.hasError()) {
+            error = "filetagd 回复格式错误";
+            socket.abort();
+            return false;
+        }
+        if (!socket.waitForReadyRead(timeoutMs)) {
+            error = isConnected() ? "等待 filetagd 回复超时" : socket.errorString();
+            return false;
+        }
+        reader.append(socket.readAll());
+    }
+}
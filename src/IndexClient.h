@@ -0,0 +1,43 @@
+/*
+ * IndexClient.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetagd 的同步客户端。请求在调用线程中阻塞等待回复，不需要事件循环，
+ *          命令行工具与界面都可直接使用；连接不上时由调用方退回到本地的 FileSearchCore 与 TagManager
+ */
+
+#ifndef INDEX_CLIENT_H
+#define INDEX_CLIENT_H
+
+#include <QLocalSocket>
+#include <functional>
+
+#include "IndexProtocol.h"
+
+class IndexClient {
+public:
+    explicit IndexClient(const QString &serverName = IndexProtocol::DefaultServerName);
+
+    bool connectToServer(int timeoutMs = 200);  // filetagd 未运行时很快返回 false
+    bool isConnected() const;
+
+    // 发送请求并等待结束，每收到一批结果调用一次 onResults；
+    // 返回 false 表示连接断开、超时或 filetagd 回复了 Error，原因见 errorString
+    bool request(IndexProtocol::Type type, const QStringList &arguments,
+                 const std::function<void(const QStringList &)> &onResults = {}, qint64 *value = nullptr);
+    QString errorString() const;
+
+    void setTimeout(int milliseconds);  // 两批回复之间的最长等待时间
+
+private:
+    QString serverName;
+    QLocalSocket socket;
+    IndexProtocol::MessageReader reader;
+    quint32 nextId;
+    int timeoutMs;
+    QString error;
+};
+
+#endif // INDEX_CLIENT_H
@@ -0,0 +1,120 @@
+/*
+ * IndexProtocol.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetagd 本地套接字协议的编码与解码
+ */
+
+#include "IndexProtocol.h"
+
+#include <QtEndian>
+
+namespace IndexProtocol {
+
+namespace {
+
+// 无符号变长整数，每字节 7 位，低位在前
+void appendVarint(QByteArray &out, quint64 value) {
+    while (value >= 0x80) {
+        out.append(char(value | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool readVarint(const char *&cursor, const char *end, quint64 &value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && cursor < end; shift += 7) {
+        const quint8 byte = quint8(*cursor++);
+        value |= quint64(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 数值先做 zigzag 变换，小的负数也只占一两个字节
+quint64 zigzag(qint64 value) {
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+qint64 unzigzag(quint64 value) {
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+bool decodeBody(const char *cursor, const char *end, Message &message) {
+    if (cursor >= end) {
+        return false;
+    }
+    message.type = Type(quint8(*cursor++));
+    quint64 id, value, count;
+    if (!readVarint(cursor, end, id) || !readVarint(cursor, end, value) || !readVarint(cursor, end, count)
+        || count > quint64(end - cursor)) {
+        return false;
+    }
+    message.id = quint32(id);
+    message.value = unzigzag(value);
+    message.strings.clear();
+    message.strings.reserve(qsizetype(count));
+    for (quint64 i = 0; i < count; ++i) {
+        quint64 length;
+        if (!readVarint(cursor, end, length) || length > quint64(end - cursor)) {
+            return false;
+        }
+        message.strings.append(QString::fromUtf8(cursor, qsizetype(length)));
+        cursor += length;
+    }
+    return cursor == end;
+}
+
+} // namespace
+
+QByteArray encode(const Message &message) {
+    QByteArray out(4, '\0');
+    out.append(char(message.type));
+    appendVarint(out, message.id);
+    appendVarint(out, zigzag(message.value));
+    appendVarint(out, quint64(message.strings.size()));
+    for (const QString &text : message.strings) {
+        const QByteArray utf8 = text.toUtf8();
+        appendVarint(out, quint64(utf8.size()));
+        out.append(utf8);
+    }
+    qToLittleEndian(quint32(out.size() - 4), out.data());
+    return out;
+}
+
+void MessageReader::append(const QByteArray &data) {
+    // 已取出的部分超过一半时再整理，避免每条消息都移动缓冲区
+    if (offset > buffer.size() / 2) {
+        buffer.remove(0, offset);
+        offset = 0;
+    }
+    buffer.append(data);
+}
+
+bool MessageReader::next(Message &message) {
+    if (error || buffer.size() - offset < 4) {
+        return false;
+    }
+    const quint32 length = qFromLittleEndian<quint32>(buffer.constData() + offset);
+    if (length > quint32(MaxMessageBytes)) {
+        error = true;
+        return false;
+    }
+    if (buffer.size() - offset - 4 < qsizetype(length)) {
+        return false;
+    }
+    const char *body = buffer.constData() + offset + 4;
+    if (!decodeBody(body, body + length, message)) {
+        error = true;
+        return false;
+    }
+    offset += 4 + int(length);
+    return true;
+}
+
+} // namespace IndexProtocol
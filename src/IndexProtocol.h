@@ -0,0 +1,72 @@
+/*
+ * IndexProtocol.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetagd 与客户端之间的本地套接字协议。每条消息为 4 字节小端长度加消息体，
+ *          消息体依次为类型、请求编号、数值与字符串列表，编号、数值与长度都用变长整数，字符串为 UTF-8。
+ *          一个请求的回复是零或多条 Results，最后是一条 Done 或 Error；同一连接上的请求按顺序回复。
+ *          TagAdd、TagRemove 一次携带一批文件，整批在 filetagd 中一次修改、一次写盘
+ */
+
+#ifndef INDEX_PROTOCOL_H
+#define INDEX_PROTOCOL_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+namespace IndexProtocol {
+
+const char *const DefaultServerName = "filetagd";
+const int MaxMessageBytes = 64 * 1024 * 1024;
+const int ResultBatch = 512;   // 每条 Results 消息最多携带的条目数
+
+enum class Type : quint8 {
+    // 请求
+    Search = 1,      // strings：关键字、标签表达式（可为空）、是否包含系统目录（"1" 为包含，省略为不包含）；只查索引，不遍历文件系统
+    Index = 2,       // strings：目录；加入索引队列并开始监视，立即回复 Done，value 为排队的目录数
+    TagAdd = 3,      // strings：标签、文件...；Done 的 value 为修改的文件数
+    TagRemove = 4,   // 同 TagAdd
+    TagQuery = 5,    // strings：标签表达式；回复满足条件的文件
+    TagList = 6,     // strings：文件（可省略）；回复该文件的标签，省略时回复全部标签
+    Stats = 7,       // 回复名称与值交替排列的 Results
+    TagUpdate = 8,   // strings：文件、旧标签、新标签
+    TagRename = 9,   // strings：旧标签、新标签；新标签已在用时合并，Done 的 value 为涉及的文件数
+    TagMerge = 10,   // strings：源标签、目标标签；Done 的 value 为涉及的文件数
+    TagDelete = 11,  // strings：标签；从所有文件删除，Done 的 value 为涉及的文件数
+    TagCount = 12,   // strings：标签表达式；Done 的 value 为满足条件的文件数，不回复路径
+    TagMatch = 13,   // strings：标签表达式、文件...；回复其中满足条件的文件，整批只求值一次、不展开全部结果
+    TagReconcile = 14,  // 整理标签路径，已不存在的文件按标识在 filetagd 的索引中找回；Done 的 value 为找回的文件数
+    // 回复
+    Results = 64,    // strings：一批结果
+    Done = 65,       // value：结果数或修改数
+    Error = 66       // strings：错误说明
+};
+
+struct Message {
+    Type type = Type::Done;
+    quint32 id = 0;          // 请求编号，由客户端分配，回复中原样带回
+    qint64 value = 0;
+    QStringList strings;
+};
+
+QByteArray encode(const Message &message);  // 含长度前缀
+
+// 从字节流中切出完整的消息，数据可以分多次到达
+class MessageReader {
+public:
+    void append(const QByteArray &data);
+    bool next(Message &message);      // 取出下一条完整消息，数据不足时返回 false
+    bool hasError() const { return error; }  // 长度超限或消息体无法解析，连接应当关闭
+
+private:
+    QByteArray buffer;
+    int offset = 0;
+    bool error = false;
+};
+
+} // namespace IndexProtocol
+
+#endif // INDEX_PROTOCOL_H
@@ -0,0 +1,449 @@
+/*
+ * IndexServer.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetagd 服务端实现。全部请求在主线程中处理：搜索直接查询已映射的快照或已打开的数据库，
+ *          标签操作使用常驻的 TagManager；索引任务一次只运行一个，与查询并行进行
+ */
+
+#include "IndexServer.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QLocalSocket>
+#include <stdexcept>
+
+#include "FileIndexDatabase.h"
+#include "Logger.h"
+#include "Metrics.h"
+
+namespace {
+const int DefaultDebounceMs = 5000;
+const int WatchDepth = 2;                 // 与遍历任务入队的层数相同
+const int MaxWatchedDirectories = 8192;   // inotify 监视数有上限，超过后只监视已加入的目录
+const char *const ReconcileConnectionName = "daemon_reconcile_connection";
+
+MetricGauge &clientCount() {
+    static MetricGauge &gauge = Metrics::gauge("filetag_daemon_clients", "filetagd 当前连接的客户端数");
+    return gauge;
+}
+
+MetricHistogram &requestLatency() {
+    static MetricHistogram &histogram = Metrics::histogram("filetag_daemon_request_latency_us", "filetagd 处理一个请求的耗时（微秒）");
+    return histogram;
+}
+
+std::vector<std::string> toStdPaths(const QStringList &paths) {
+    std::vector<std::string> result;
+    result.reserve(paths.size());
+    for (const QString &path : paths) {
+        result.push_back(path.toStdString());
+    }
+    return result;
+}
+
+QStringList fromStdStrings(const std::vector<std::string> &values) {
+    QStringList result;
+    result.reserve(qsizetype(values.size()));
+    for (const std::string &value : values) {
+        result.append(QString::fromStdString(value));
+    }
+    return result;
+}
+} // namespace
+
+IndexServer::IndexServer(const QString &indexDirectory, const QString &tagsFile, QObject *parent)
+        : QObject(parent),
+          indexDirectory(indexDirectory),
+          core(nullptr, indexDirectory),
+          tags(tagsFile.toStdString()) {
+    tags.loadTags();
+    uptime.start();
+
+    debounce.setSingleShot(true);
+    debounce.setInterval(DefaultDebounceMs);
+
+    connect(&server, &QLocalServer::newConnection, this, &IndexServer::onNewConnection);
+    connect(&watcher, &QFileSystemWatcher::directoryChanged, this, &IndexServer::onDirectoryChanged);
+    connect(&core, &FileSearchCore::searchFinished, this, &IndexServer::onIndexFinished);
+    connect(&debounce, &QTimer::timeout, this, &IndexServer::onDebounceTimeout);
+}
+
+// 关闭所有连接后 core 析构，等待数据库线程写完剩余的索引任务
+IndexServer::~IndexServer() {
+    server.close();
+    for (QLocalSocket *socket : readers.keys()) {
+        socket->abort();
+    }
+    tags.sync();
+}
+
+bool IndexServer::listen(const QString &serverName) {
+    // 上次异常退出时遗留的套接字文件会导致监听失败
+    QLocalServer::removeServer(serverName);
+    server.setSocketOptions(QLocalServer::UserAccessOption);
+    if (!server.listen(serverName)) {
+        LOG_ERROR(QString("filetagd 无法监听 %1: %2").arg(serverName, server.errorString()));
+        return false;
+    }
+    LOG_INFO("filetagd 开始监听：" + server.fullServerName());
+    return true;
+}
+
+QString IndexServer::errorString() const {
+    return server.errorString();
+}
+
+void IndexServer::setDebounceSeconds(int seconds) {
+    debounce.setInterval(qMax(0, seconds) * 1000);
+}
+
+/*
+ * Summary: 开始监视目录并加入索引队列，已监视的目录只重新索引
+ * Parameters:
+ * const QString &root - 目录
+ * Return: void
+ */
+void IndexServer::watch(const QString &root) {
+    const QString path = QFileInfo(root).absoluteFilePath();
+    if (!roots.contains(path)) {
+        roots.append(path);
+        watchTree(path);
+    }
+    enqueueIndex(path);
+}
+
+/*
+ * Summary: 监视目录及其下 WatchDepth 层的子目录。QFileSystemWatcher 只报告直接子项的变化，
+ *          更深层目录中的变化要等下一次重新索引才会写入
+ * Parameters:
+ * const QString &root - 目录
+ * Return: void
+ */
+void IndexServer::watchTree(const QString &root) {
+    QStringList directories{root};
+    for (int level = 0, begin = 0; level < WatchDepth; ++level) {
+        const int end = int(directories.size());
+        for (int i = begin; i < end; ++i) {
+            QDirIterator it(directories[i], QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+            while (it.hasNext()) {
+                directories.append(it.next());
+            }
+        }
+        begin = end;
+    }
+
+    const QStringList watchedList = watcher.directories();
+    const QSet<QString> watched(watchedList.begin(), watchedList.end());
+    QStringList added;
+    for (const QString &directory : directories) {
+        if (watched.size() + added.size() >= MaxWatchedDirectories) {
+            LOG_WARNING_LIMITED(QString("监视的目录数已达上限 %1，其余目录只在重新索引时更新").arg(MaxWatchedDirectories));
+            break;
+        }
+        if (!watched.contains(directory)) {
+            added.append(directory);
+        }
+    }
+    if (!added.isEmpty()) {
+        watcher.addPaths(added);
+    }
+}
+
+void IndexServer::enqueueIndex(const QString &root) {
+    if (!pendingRoots.contains(root)) {
+        pendingRoots.append(root);
+    }
+    runNextIndexJob();
+}
+
+// 一次只运行一个索引任务：FileSearchCore 的遍历状态不能同时用于两个目录
+void IndexServer::runNextIndexJob() {
+    while (indexingRoot.isEmpty() && !pendingRoots.isEmpty()) {
+        const QString root = pendingRoots.takeFirst();
+        if (!QFileInfo(root).isDir()) {
+            LOG_WARNING("索引目录不存在，跳过：" + root);
+            continue;
+        }
+        indexingRoot = root;
+        LOG_INFO("filetagd 开始索引：" + root);
+        core.indexDirectory(root, false);
+    }
+}
+
+// 索引结束后补上新建的子目录的监视；下一个任务排到事件循环中开始，避免在 searchFinished 中重入
+void IndexServer::onIndexFinished() {
+    if (indexingRoot.isEmpty()) {
+        return;
+    }
+    LOG_INFO("filetagd 索引完成：" + indexingRoot);
+    watchTree(indexingRoot);
+    indexingRoot.clear();
+    QTimer::singleShot(0, this, &IndexServer::runNextIndexJob);
+}
+
+void IndexServer::onDirectoryChanged(const QString &path) {
+    for (const QString &root : roots) {
+        if (path == root || path.startsWith(root + '/')) {
+            changedRoots.insert(root);
+        }
+    }
+    debounce.start();
+}
+
+void IndexServer::onDebounceTimeout() {
+    for (const QString &root : changedRoots) {
+        enqueueIndex(root);
+    }
+    changedRoots.clear();
+}
+
+void IndexServer::onNewConnection() {
+    while (QLocalSocket *socket = server.nextPendingConnection()) {
+        readers.insert(socket, IndexProtocol::MessageReader());
+        connect(socket, &QLocalSocket::readyRead, this, &IndexServer::onReadyRead);
+        connect(socket, &QLocalSocket::disconnected, this, &IndexServer::onDisconnected);
+    }
+    clientCount().set(readers.size());
+}
+
+void IndexServer::onDisconnected() {
+    auto *socket = qobject_cast<QLocalSocket *>(sender());
+    readers.remove(socket);
+    clientCount().set(readers.size());
+    socket->deleteLater();
+}
+
+void IndexServer::onReadyRead() {
+    auto *socket = qobject_cast<QLocalSocket *>(sender());
+    auto it = readers.find(socket);
+    if (it == readers.end()) {
+        return;
+    }
+    it->append(socket->readAll());
+
+    IndexProtocol::Message request;
+    while (it->next(request)) {
+        handle(socket, request);
+    }
+    if (it->hasError()) {
+        LOG_WARNING("filetagd 收到无法解析的消息，断开连接。");
+        socket->abort();
+    }
+}
+
+/*
+ * Summary: 处理一个请求并回复。标签表达式语法错误等异常以 Error 回复
+ * Parameters:
+ * QLocalSocket *socket - 客户端连接
+ * const IndexProtocol::Message &request - 请求
+ * Return: void
+ */
+void IndexServer::handle(QLocalSocket *socket, const IndexProtocol::Message &request) {
+    using IndexProtocol::Type;
+    static MetricCounter &requests = Metrics::counter("filetag_daemon_requests_total", "filetagd 处理的请求数");
+    requests.add();
+    QElapsedTimer timer;
+    timer.start();
+
+    const QStringList &arguments = request.strings;
+    try {
+        switch (request.type) {
+            case Type::Search: {
+                if (arguments.value(0).isEmpty()) {
+                    sendError(socket, request.id, "搜索关键字为空");
+                    break;
+                }
+                QStringList results = QStringList(core.queryIndex(arguments[0]));
+                // 与本地搜索相同，默认不返回系统目录中的文件
+                if (arguments.value(2) != "1") {
+                    results.removeIf([this](const QString &path) { return core.isSystemDirectory(path); });
+                }
+                if (!arguments.value(1).isEmpty()) {
+                    const auto matches = tags.matcher(arguments[1].toStdString());
+                    results.removeIf([&matches](const QString &path) { return !matches(path.toStdString()); });
+                }
+                sendResults(socket, request.id, results);
+                break;
+            }
+            case Type::Index:
+                if (arguments.size() != 1 || !QFileInfo(arguments[0]).isDir()) {
+                    sendError(socket, request.id, "目录不存在: " + arguments.value(0));
+                    break;
+                }
+                watch(arguments[0]);
+                sendDone(socket, request.id, pendingRoots.size() + (indexingRoot.isEmpty() ? 0 : 1));
+                break;
+            case Type::TagAdd:
+            case Type::TagRemove: {
+                if (arguments.size() < 2) {
+                    sendError(socket, request.id, "缺少标签或文件");
+                    break;
+                }
+                const std::string tag = arguments[0].toStdString();
+                const std::vector<std::string> paths = toStdPaths(arguments.mid(1));
+                const size_t changed = (request.type == Type::TagAdd ? tags.addTagToFiles(paths, tag)
+                                                                     : tags.removeTagFromFiles(paths, tag)).value_or(0);
+                if (!tags.sync()) {
+                    sendError(socket, request.id, "标签修改未能写盘");
+                    break;
+                }
+                sendDone(socket, request.id, qint64(changed));
+                break;
+            }
+            case Type::TagQuery:
+                sendResults(socket, request.id, fromStdStrings(tags.queryFiles(arguments.value(0).toStdString())));
+                break;
+            case Type::TagList:
+                sendResults(socket, request.id, fromStdStrings(arguments.isEmpty()
+                                                                       ? tags.listAllTags()
+                                                                       : tags.listTagsForFile(arguments[0].toStdString())));
+                break;
+            case Type::TagUpdate:
+                if (arguments.size() != 3) {
+                    sendError(socket, request.id, "缺少文件或标签");
+                    break;
+                }
+                tags.updateTag(arguments[0].toStdString(), arguments[1].toStdString(), arguments[2].toStdString());
+                if (!tags.sync()) {
+                    sendError(socket, request.id, "标签修改未能写盘");
+                    break;
+                }
+                sendDone(socket, request.id, 0);
+                break;
+            case Type::TagRename:
+            case Type::TagMerge: {
+                if (arguments.size() != 2) {
+                    sendError(socket, request.id, "缺少标签");
+                    break;
+                }
+                const std::string from = arguments[0].toStdString();
+                const std::string to = arguments[1].toStdString();
+                const size_t changed = request.type == Type::TagRename ? tags.renameTag(from, to) : tags.mergeTag(from, to);
+                if (!tags.sync()) {
+                    sendError(socket, request.id, "标签修改未能写盘");
+                    break;
+                }
+                sendDone(socket, request.id, qint64(changed));
+                break;
+            }
+            case Type::TagDelete: {
+                if (arguments.size() != 1) {
+                    sendError(socket, request.id, "缺少标签");
+                    break;
+                }
+                const size_t changed = tags.deleteTag(arguments[0].toStdString());
+                if (!tags.sync()) {
+                    sendError(socket, request.id, "标签修改未能写盘");
+                    break;
+                }
+                sendDone(socket, request.id, qint64(changed));
+                break;
+            }
+            case Type::TagCount:
+                sendDone(socket, request.id, qint64(tags.countFiles(arguments.value(0).toStdString())));
+                break;
+            case Type::TagMatch: {
+                const auto matches = tags.matcher(arguments.value(0).toStdString());
+                QStringList matched;
+                for (qsizetype i = 1; i < arguments.size(); ++i) {
+                    if (matches(arguments[i].toStdString())) {
+                        matched.append(arguments[i]);
+                    }
+                }
+                sendResults(socket, request.id, matched);
+                break;
+            }
+            case Type::TagReconcile: {
+                const size_t relocated = reconcileTags();
+                if (!tags.sync()) {
+                    sendError(socket, request.id, "标签修改未能写盘");
+                    break;
+                }
+                sendDone(socket, request.id, qint64(relocated));
+                break;
+            }
+            case Type::Stats:
+                sendResults(socket, request.id, statistics());
+                break;
+            default:
+                sendError(socket, request.id, QString("未知的请求类型 %1").arg(int(request.type)));
+                break;
+        }
+    } catch (const std::exception &e) {
+        sendError(socket, request.id, QString::fromStdString(e.what()));
+    }
+    requestLatency().record(timer.nsecsElapsed() / 1000);
+}
+
+// 结果按 ResultBatch 分批发送，客户端可以边收边处理
+void IndexServer::sendResults(QLocalSocket *socket, quint32 id, const QStringList &values) {
+    IndexProtocol::Message message;
+    message.type = IndexProtocol::Type::Results;
+    message.id = id;
+    for (qsizetype begin = 0; begin < values.size(); begin += IndexProtocol::ResultBatch) {
+        message.strings = values.mid(begin, IndexProtocol::ResultBatch);
+        socket->write(IndexProtocol::encode(message));
+    }
+    sendDone(socket, id, values.size());
+}
+
+void IndexServer::sendDone(QLocalSocket *socket, quint32 id, qint64 value) {
+    IndexProtocol::Message message;
+    message.type = IndexProtocol::Type::Done;
+    message.id = id;
+    message.value = value;
+    socket->write(IndexProtocol::encode(message));
+}
+
+void IndexServer::sendError(QLocalSocket *socket, quint32 id, const QString &text) {
+    IndexProtocol::Message message;
+    message.type = IndexProtocol::Type::Error;
+    message.id = id;
+    message.strings << text;
+    socket->write(IndexProtocol::encode(message));
+}
+
+// 整理标签路径：与主程序相同，按 (设备号, inode) 在索引数据库中找回移动过的文件，数据库使用独立连接
+size_t IndexServer::reconcileTags() {
+    FileIndexDatabase database(FileSearchCore::databaseFile(indexDirectory), ReconcileConnectionName);
+    const bool opened = database.openDatabase();
+    return tags.reconcile([&](const std::vector<FileIdentity> &identities) {
+        std::vector<std::string> paths(identities.size());
+        if (opened) {
+            const QVector<QString> resolved = database.resolveIdentities(QVector<FileIdentity>(identities.begin(), identities.end()));
+            for (size_t i = 0; i < paths.size(); ++i) {
+                paths[i] = resolved[qsizetype(i)].toStdString();
+            }
+        }
+        return paths;
+    });
+}
+
+/*
+ * Summary: 统计信息，名称与值交替排列：服务状态、标签数据，以及全部计数器与仪表的当前值
+ * Parameters: 无
+ * Return: QStringList - 名称、值、名称、值……
+ */
+QStringList IndexServer::statistics() {
+    const std::shared_ptr<const TagIndex> snapshot = tags.snapshot();
+    QStringList values{
+            "daemon.uptimeSec", QString::number(uptime.elapsed() / 1000),
+            "daemon.clients", QString::number(readers.size()),
+            "daemon.indexing", indexingRoot,
+            "daemon.pendingIndexJobs", QString::number(pendingRoots.size()),
+            "daemon.watchedRoots", roots.join(';'),
+            "daemon.watchedDirectories", QString::number(watcher.directories().size()),
+            "tags.tags", QString::number(snapshot->allTags().size()),
+            "tags.files", QString::number(snapshot->fileCount()),
+            "tags.memoryBytes", QString::number(snapshot->memoryUsage())
+    };
+    for (const Metrics::Sample &sample : Metrics::samples()) {
+        const qint64 value = sample.type == Metrics::Type::Histogram ? qint64(sample.histogram.count) : sample.value;
+        values << sample.name << QString::number(value);
+    }
+    return values;
+}
@@ -0,0 +1,75 @@
+/*
+ * IndexServer.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetagd 的服务端。常驻进程只持有一个 FileSearchCore 与一个 TagManager，索引数据库与快照保持打开，
+ *          监视已索引的目录并在变化后重新索引；通过 QLocalServer 回答搜索、标签与统计请求，结果分批发送
+ */
+
+#ifndef INDEX_SERVER_H
+#define INDEX_SERVER_H
+
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QLocalServer>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+#include "FileSearchCore.h"
+#include "IndexProtocol.h"
+#include "TagManager.h"
+
+class QLocalSocket;
+
+class IndexServer : public QObject {
+Q_OBJECT
+public:
+    // indexDirectory 与 tagsFile 的含义与主程序相同
+    IndexServer(const QString &indexDirectory, const QString &tagsFile, QObject *parent = nullptr);
+    ~IndexServer() override;
+
+    bool listen(const QString &serverName);  // 同名的旧套接字文件会先删除
+    QString errorString() const;
+    void watch(const QString &root);         // 加入索引队列，并在目录变化后重新索引
+    void setDebounceSeconds(int seconds);    // 最后一次变化之后等待多久再重新索引
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void onDirectoryChanged(const QString &path);
+    void onIndexFinished();
+    void onDebounceTimeout();
+    void runNextIndexJob();
+
+private:
+    void handle(QLocalSocket *socket, const IndexProtocol::Message &request);
+    void sendResults(QLocalSocket *socket, quint32 id, const QStringList &values);
+    void sendDone(QLocalSocket *socket, quint32 id, qint64 value);
+    void sendError(QLocalSocket *socket, quint32 id, const QString &message);
+    void enqueueIndex(const QString &root);
+    void watchTree(const QString &root);
+    QStringList statistics();
+    size_t reconcileTags();         // 整理标签路径，已不存在的文件按标识在索引数据库中找回
+
+    QString indexDirectory;         // 索引数据库与快照所在目录
+
+    FileSearchCore core;
+    TagManager tags;
+    QLocalServer server;
+    QFileSystemWatcher watcher;
+    QHash<QLocalSocket *, IndexProtocol::MessageReader> readers;
+    QStringList roots;              // 监视的目录
+    QStringList pendingRoots;       // 等待索引的目录，按加入顺序
+    QSet<QString> changedRoots;     // 防抖期间发生变化的目录
+    QString indexingRoot;           // 正在索引的目录，为空表示空闲
+    QTimer debounce;
+    QElapsedTimer uptime;
+};
+
+#endif // INDEX_SERVER_H
@@ -0,0 +1,219 @@
+/*
+ * LogArchiver.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 日志归档线程实现。本线程不使用 LOG_* 宏：日志线程退出后它仍可能在运行，错误只输出到 qWarning。
+ *          多个进程（主程序、filetagd、filetag-cli）共用日志目录，只压缩和删除本进程或已退出进程的日志
+ */
+
+#include "LogArchiver.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QCoreApplication>
+#include <QRegularExpression>
+#include <zlib.h>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#endif
+
+namespace {
+
+const qint64 ChunkBytes = 256 * 1024;
+
+// 属于日志轮转的文件：<进程名>_<进程号>_<时间>.log、.bin 及其 .gz，以及旧版的 application_<时间>.log 等
+QFileInfoList logFiles(const QString &directory) {
+    QDir dir(directory);
+    return dir.entryInfoList(QStringList() << "*_*.log" << "*_*.bin" << "*_*.log.gz" << "*_*.bin.gz",
+                             QDir::Files, QDir::Time | QDir::Reversed);  // 最旧的在前
+}
+
+// 从文件名取出写入它的进程号；旧版文件名不带进程号，返回 0
+qint64 ownerPid(const QString &fileName) {
+    static const QRegularExpression pattern(R"(_(\d+)_\d{8}_\d{6}_\d{3}\.(log|bin)(\.gz)?$)");
+    const QRegularExpressionMatch match = pattern.match(fileName);
+    return match.hasMatch() ? match.captured(1).toLongLong() : 0;
+}
+
+bool processAlive(qint64 pid) {
+#ifdef Q_OS_WIN
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, DWORD(pid));
+    if (!process) {
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    }
+    DWORD exitCode = 0;
+    const bool alive = GetExitCodeProcess(process, &exitCode) && exitCode == STILL_ACTIVE;
+    CloseHandle(process);
+    return alive;
+#else
+    return ::kill(pid_t(pid), 0) == 0 || errno == EPERM;
+#endif
+}
+
+// 本进程的日志、已退出进程留下的日志和旧版无主日志可以压缩或删除；其他运行中进程的日志不能动
+bool mayTouch(const QFileInfo &info) {
+    const qint64 pid = ownerPid(info.fileName());
+    return pid == 0 || pid == QCoreApplication::applicationPid() || !processAlive(pid);
+}
+
+} // namespace
+
+LogArchiver::LogArchiver(const QString &directory, QObject *parent)
+    : QThread(parent),
+      directory(directory),
+      scanRequested(false),
+      compressionEnabled(true),
+      retentionBytes(512LL * 1024 * 1024),
+      running(true) {}
+
+LogArchiver::~LogArchiver() {
+    {
+        QMutexLocker locker(&mutex);
+        running = false;
+        condition.wakeAll();
+    }
+    wait();  // 线程退出前处理完已投递的文件
+}
+
+void LogArchiver::archive(const QString &closedPath, const QString &activePath) {
+    QMutexLocker locker(&mutex);
+    queue << closedPath;
+    this->activePath = activePath;
+    condition.wakeOne();
+}
+
+void LogArchiver::archiveLeftovers(const QString &activePath) {
+    QMutexLocker locker(&mutex);
+    this->activePath = activePath;
+    scanRequested = true;
+    condition.wakeOne();
+}
+
+void LogArchiver::setCompression(bool enabled) {
+    QMutexLocker locker(&mutex);
+    compressionEnabled = enabled;
+}
+
+void LogArchiver::setRetentionBytes(qint64 bytes) {
+    QMutexLocker locker(&mutex);
+    retentionBytes = bytes;
+    condition.wakeOne();  // 上限变小时立即清理
+}
+
+void LogArchiver::run() {
+    while (true) {
+        QStringList paths;
+        bool scan;
+        QString active;
+        bool compressFiles;
+        {
+            QMutexLocker locker(&mutex);
+            if (queue.isEmpty() && !scanRequested && running) {
+                condition.wait(&mutex);
+            }
+            if (queue.isEmpty() && !scanRequested && !running) {
+                break;
+            }
+            paths.swap(queue);
+            scan = scanRequested;
+            scanRequested = false;
+            active = QFileInfo(activePath).absoluteFilePath();
+            compressFiles = compressionEnabled;
+        }
+
+        if (scan) {
+            for (const QFileInfo &info : logFiles(directory)) {
+                if (info.suffix() != "gz" && info.absoluteFilePath() != active && !paths.contains(info.filePath())
+                    && mayTouch(info)) {
+                    paths << info.filePath();
+                }
+            }
+        }
+
+        if (compressFiles) {
+            for (const QString &path : paths) {
+                compress(path);
+            }
+        }
+        enforceRetention();
+    }
+}
+
+/*
+ * Summary: 以 gzip 格式压缩日志文件，完成后删除原文件；失败时保留原文件并删除不完整的压缩文件
+ * Parameters:
+ * const QString &path - 已关闭的日志文件
+ * Return: bool - 是否成功
+ */
+bool LogArchiver::compress(const QString &path) {
+    QFile input(path);
+    if (!input.open(QIODevice::ReadOnly)) {
+        qWarning() << "无法读取待压缩的日志:" << path << input.errorString();
+        return false;
+    }
+
+    const QString target = path + ".gz";
+    gzFile output = gzopen(QFile::encodeName(target).constData(), "wb6");
+    if (!output) {
+        qWarning() << "无法创建压缩日志:" << target;
+        return false;
+    }
+
+    bool ok = true;
+    while (ok && !input.atEnd()) {
+        const QByteArray chunk = input.read(ChunkBytes);
+        ok = !chunk.isEmpty() && gzwrite(output, chunk.constData(), unsigned(chunk.size())) == int(chunk.size());
+    }
+    ok = gzclose(output) == Z_OK && ok;
+    input.close();
+
+    if (!ok) {
+        qWarning() << "压缩日志失败，保留原文件:" << path;
+        QFile::remove(target);
+        return false;
+    }
+    QFile::remove(path);
+    return true;
+}
+
+// 日志总大小超过上限时从最旧的文件开始删除，正在写入的文件与其他运行中进程的日志除外
+void LogArchiver::enforceRetention() {
+    qint64 limit;
+    QString active;
+    {
+        QMutexLocker locker(&mutex);
+        limit = retentionBytes;
+        active = QFileInfo(activePath).absoluteFilePath();
+    }
+    if (limit <= 0) {
+        return;
+    }
+
+    const QFileInfoList files = logFiles(directory);
+    qint64 total = 0;
+    for (const QFileInfo &info : files) {
+        total += info.size();
+    }
+    for (const QFileInfo &info : files) {
+        if (total <= limit) {
+            break;
+        }
+        if (info.absoluteFilePath() == active || !mayTouch(info)) {
+            continue;
+        }
+        if (QFile::remove(info.filePath())) {
+            total -= info.size();
+        } else {
+            qWarning() << "无法删除旧日志:" << info.filePath();
+        }
+    }
+}
@@ -0,0 +1,51 @@
+/*
+ * LogArchiver.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 日志归档线程。把轮转下来的日志文件压缩为 .gz，并按总大小上限删除最旧的日志；
+ *          压缩与删除都在本线程中进行，日志线程只投递文件路径
+ */
+
+#ifndef LOG_ARCHIVER_H
+#define LOG_ARCHIVER_H
+
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+
+class LogArchiver : public QThread {
+Q_OBJECT
+public:
+    explicit LogArchiver(const QString &directory, QObject *parent = nullptr);
+    ~LogArchiver();
+
+    // 压缩已关闭的日志文件，随后执行保留策略；activePath 为日志线程新打开的文件
+    void archive(const QString &closedPath, const QString &activePath);
+    void archiveLeftovers(const QString &activePath);  // 压缩目录中除 activePath 外尚未压缩、且属于本进程或已退出进程的日志，用于启动时
+    void setCompression(bool enabled);
+    void setRetentionBytes(qint64 bytes);             // 日志目录中全部日志的总大小上限，0 表示不限制
+
+protected:
+    void run() override;
+
+private:
+    bool compress(const QString &path);  // 压缩为 path.gz 并删除原文件
+    void enforceRetention();
+
+    QString directory;
+
+    QMutex mutex;
+    QWaitCondition condition;
+    QStringList queue;          // 待压缩的文件
+    QString activePath;         // 正在写入的日志，保留策略不删除它
+    bool scanRequested;
+    bool compressionEnabled;
+    qint64 retentionBytes;
+    bool running;
+};
+
+#endif // LOG_ARCHIVER_H
@@ -0,0 +1,87 @@
+/*
+ * LogDecoder.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetag-logdecode：把 logs/*.bin 二进制日志（包括轮转后压缩的 .bin.gz）还原为文本格式输出到标准输出。
+ *          用法：filetag-logdecode logs/filetagd_1234_20261019_120000_000.bin [...]
+ */
+
+#include <QFile>
+#include <QTextStream>
+
+#include <zlib.h>
+
+#include "LogFormat.h"
+
+namespace {
+
+// 读取整个文件，.gz 文件先解压
+bool readLog(const QString &path, QByteArray &content, QString &error) {
+    if (!path.endsWith(".gz")) {
+        QFile input(path);
+        if (!input.open(QIODevice::ReadOnly)) {
+            error = input.errorString();
+            return false;
+        }
+        content = input.readAll();
+        return true;
+    }
+
+    gzFile input = gzopen(QFile::encodeName(path).constData(), "rb");
+    if (!input) {
+        error = "无法打开压缩文件";
+        return false;
+    }
+    char chunk[256 * 1024];
+    int read;
+    while ((read = gzread(input, chunk, sizeof(chunk))) > 0) {
+        content.append(chunk, read);
+    }
+    const bool ok = read == 0;
+    gzclose(input);
+    if (!ok) {
+        error = "解压失败";
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QTextStream errors(stderr);
+    if (argc < 2) {
+        errors << "用法: " << argv[0] << " <日志文件.bin> [...]\n";
+        return 2;
+    }
+
+    QFile output;
+    if (!output.open(stdout, QIODevice::WriteOnly)) {
+        errors << "无法写入标准输出\n";
+        return 1;
+    }
+
+    int status = 0;
+    for (int i = 1; i < argc; ++i) {
+        const QString path = QString::fromLocal8Bit(argv[i]);
+        QByteArray content;
+        QString error;
+        if (!readLog(path, content, error)) {
+            errors << "无法读取 " << path << ": " << error << "\n";
+            status = 1;
+            continue;
+        }
+
+        QByteArray text;
+        const bool valid = LogFormat::decodeBinary(content, text, error);
+        output.write(text);
+        if (!error.isEmpty()) {
+            errors << path << ": " << error << "\n";
+        }
+        if (!valid) {
+            status = 1;
+        }
+    }
+    return status;
+}
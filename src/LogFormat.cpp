@@ -0,0 +1,267 @@
+/*
+ * LogFormat.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 日志文本格式与二进制格式的编码、解码
+ */
+
+#include "LogFormat.h"
+
+#include <QDateTime>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+const char BinaryMagic[8] = { 'F', 'T', 'L', 'O', 'G', 'B', '0', '1' };
+const quint16 TruncatedFlag = 0x8000;  // 消息长度字段的最高位表示消息被截断
+
+enum EntryType : quint8 {
+    EpochEntry = 1,    // i64 墙上时间毫秒, i64 时钟计数
+    SiteEntry = 2,     // u32 调用点, u8 级别, i32 行号, u16+文件名, u16+函数名
+    MessageEntry = 3,  // u32 调用点, i64 时钟计数, u64 线程 ID, u16 长度（含截断标志）, 消息字节
+    DropEntry = 4      // i64 时钟计数, u64 丢弃条数
+};
+
+template <typename T>
+void appendValue(QByteArray &out, T value) {
+    const T little = qToLittleEndian(value);
+    out.append(reinterpret_cast<const char *>(&little), sizeof(little));
+}
+
+void appendShortString(QByteArray &out, const char *text) {
+    const quint16 length = quint16(qMin<size_t>(std::strlen(text), 0xFFFF));
+    appendValue(out, length);
+    out.append(text, length);
+}
+
+// 按顺序读取条目字段，越界时返回 false
+class Reader {
+public:
+    Reader(const char *begin, const char *end) : cursor(begin), end(end) {}
+
+    bool atEnd() const { return cursor == end; }
+
+    bool readByte(quint8 &value) {
+        if (cursor == end) {
+            return false;
+        }
+        value = quint8(*cursor++);
+        return true;
+    }
+
+    template <typename T>
+    bool read(T &value) {
+        if (end - cursor < qsizetype(sizeof(T))) {
+            return false;
+        }
+        value = qFromLittleEndian<T>(cursor);
+        cursor += sizeof(T);
+        return true;
+    }
+
+    bool readBytes(qsizetype length, const char *&data) {
+        if (end - cursor < length) {
+            return false;
+        }
+        data = cursor;
+        cursor += length;
+        return true;
+    }
+
+    bool readShortString(QByteArray &value) {
+        quint16 length = 0;
+        const char *data = nullptr;
+        if (!read(length) || !readBytes(length, data)) {
+            return false;
+        }
+        value = QByteArray(data, length);
+        return true;
+    }
+
+private:
+    const char *cursor;
+    const char *end;
+};
+
+struct DecodedSite {
+    LogLevel level = LogLevel::INFO;
+    int line = 0;
+    QByteArray file;
+    QByteArray function;
+};
+
+} // namespace
+
+namespace LogFormat {
+
+const char *levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO: return "INFO";
+        case LogLevel::WARNING: return "WARNING";
+        case LogLevel::ERROR: return "ERROR";
+        default: return "UNKNOWN";
+    }
+}
+
+void TextWriter::appendTime(QByteArray &out, qint64 wallMs) {
+    const qint64 second = wallMs / 1000;
+    if (second != cachedSecond) {
+        cachedSecond = second;
+        cachedTime = QDateTime::fromMSecsSinceEpoch(wallMs).toString("yyyy-MM-dd HH:mm:ss").toUtf8();
+    }
+    out.append(cachedTime);
+}
+
+void TextWriter::appendLine(QByteArray &out, qint64 wallMs, quint64 threadId, LogLevel level, const char *text,
+                            int length, bool truncated, const char *file, int line, const char *function) {
+    appendTime(out, wallMs);
+    out.append(" - [");
+    out.append(levelName(level));
+    out.append("] [线程ID: ");
+    out.append(QByteArray::number(threadId, 16));
+    out.append("] ");
+    out.append(text, length);
+    if (truncated) {
+        out.append("...");
+    }
+    out.append(" [");
+    out.append(file);
+    out.append(':');
+    out.append(QByteArray::number(line));
+    out.append(" - ");
+    out.append(function);
+    out.append("]\n");
+}
+
+void TextWriter::appendDrops(QByteArray &out, qint64 wallMs, quint64 count) {
+    appendTime(out, wallMs);
+    out.append(" - [WARNING] 日志队列已满，丢弃 ");
+    out.append(QByteArray::number(count));
+    out.append(" 条日志\n");
+}
+
+void appendBinaryHeader(QByteArray &out) {
+    out.append(BinaryMagic, sizeof(BinaryMagic));
+}
+
+void appendEpoch(QByteArray &out, qint64 wallMs, qint64 ticks) {
+    out.append(char(EpochEntry));
+    appendValue(out, wallMs);
+    appendValue(out, ticks);
+}
+
+void appendSite(QByteArray &out, quint32 site, LogLevel level, int line, const char *file, const char *function) {
+    out.append(char(SiteEntry));
+    appendValue(out, site);
+    out.append(char(level));
+    appendValue(out, qint32(line));
+    appendShortString(out, file);
+    appendShortString(out, function);
+}
+
+void appendMessage(QByteArray &out, quint32 site, qint64 ticks, quint64 threadId, const char *text, int length,
+                   bool truncated) {
+    out.append(char(MessageEntry));
+    appendValue(out, site);
+    appendValue(out, ticks);
+    appendValue(out, threadId);
+    appendValue(out, quint16(length | (truncated ? TruncatedFlag : 0)));
+    out.append(text, length);
+}
+
+void appendDrops(QByteArray &out, qint64 ticks, quint64 count) {
+    out.append(char(DropEntry));
+    appendValue(out, ticks);
+    appendValue(out, count);
+}
+
+/*
+ * Summary: 把二进制日志还原为文本格式，输出与文本模式写出的内容相同
+ * Parameters:
+ * const QByteArray &content - 二进制日志文件内容
+ * QByteArray &text - 追加文本的缓冲区
+ * QString &error - 文件头无效或尾部条目不完整时的说明
+ * Return: bool - 文件头有效时返回 true
+ */
+bool decodeBinary(const QByteArray &content, QByteArray &text, QString &error) {
+    if (content.size() < qsizetype(sizeof(BinaryMagic))
+        || std::memcmp(content.constData(), BinaryMagic, sizeof(BinaryMagic)) != 0) {
+        error = "文件头无效，不是二进制日志";
+        return false;
+    }
+
+    Reader reader(content.constData() + sizeof(BinaryMagic), content.constData() + content.size());
+    TextWriter writer;
+    std::vector<DecodedSite> sites;
+    qint64 epochWallMs = 0;
+    qint64 epochTicks = 0;
+    auto wallTime = [&](qint64 ticks) { return epochWallMs + (ticks - epochTicks) / 1000000; };
+
+    while (!reader.atEnd()) {
+        quint8 type = 0;
+        reader.readByte(type);
+        bool complete = false;
+        switch (type) {
+            case EpochEntry:
+                complete = reader.read(epochWallMs) && reader.read(epochTicks);
+                break;
+            case SiteEntry: {
+                quint32 id = 0;
+                quint8 level = 0;
+                qint32 line = 0;
+                DecodedSite site;
+                complete = reader.read(id) && reader.readByte(level) && reader.read(line)
+                           && reader.readShortString(site.file) && reader.readShortString(site.function);
+                if (complete) {
+                    site.level = LogLevel(level);
+                    site.line = line;
+                    if (sites.size() <= id) {
+                        sites.resize(size_t(id) + 1);
+                    }
+                    sites[id] = std::move(site);
+                }
+                break;
+            }
+            case MessageEntry: {
+                quint32 id = 0;
+                qint64 ticks = 0;
+                quint64 threadId = 0;
+                quint16 length = 0;
+                const char *data = nullptr;
+                complete = reader.read(id) && reader.read(ticks) && reader.read(threadId) && reader.read(length)
+                           && reader.readBytes(length & ~TruncatedFlag, data);
+                if (complete) {
+                    static const DecodedSite unknown{ LogLevel::INFO, 0, "?", "?" };
+                    const DecodedSite &site = id < sites.size() ? sites[id] : unknown;
+                    writer.appendLine(text, wallTime(ticks), threadId, site.level, data, length & ~TruncatedFlag,
+                                      (length & TruncatedFlag) != 0, site.file.constData(), site.line,
+                                      site.function.constData());
+                }
+                break;
+            }
+            case DropEntry: {
+                qint64 ticks = 0;
+                quint64 count = 0;
+                complete = reader.read(ticks) && reader.read(count);
+                if (complete) {
+                    writer.appendDrops(text, wallTime(ticks), count);
+                }
+                break;
+            }
+            default:
+                error = QString("未知的条目类型 %1，之后的内容已忽略").arg(int(type));
+                return true;
+        }
+        if (!complete) {
+            error = "尾部条目不完整，已忽略";
+            return true;
+        }
+    }
+    return true;
+}
+
+} // namespace LogFormat
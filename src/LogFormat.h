@@ -0,0 +1,58 @@
+/*
+ * LogFormat.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 日志文件格式。文本格式为每行一条；二进制格式只记录调用点编号、时钟计数、线程 ID 和消息字节，
+ *          调用点的源文件、行号、函数名每个文件只写一次，由 filetag-logdecode 还原为文本格式
+ */
+
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <QByteArray>
+#include <QString>
+#include <vector>
+
+enum class LogLevel {
+    DEBUG,
+    INFO,
+    WARNING,
+    ERROR,
+    OFF     // 只用于级别设置，关闭该模块的全部日志
+};
+
+namespace LogFormat {
+
+const char *levelName(LogLevel level);
+
+// 文本格式：时间 - [级别] [线程ID: x] 消息 [文件:行号 - 函数]
+class TextWriter {
+public:
+    void appendLine(QByteArray &out, qint64 wallMs, quint64 threadId, LogLevel level, const char *text, int length,
+                    bool truncated, const char *file, int line, const char *function);
+    void appendDrops(QByteArray &out, qint64 wallMs, quint64 count);  // 队列已满丢弃日志的提示行
+
+private:
+    void appendTime(QByteArray &out, qint64 wallMs);
+
+    qint64 cachedSecond = -1;  // 时间字符串每秒只生成一次
+    QByteArray cachedTime;
+};
+
+// 二进制格式：文件头 8 字节魔数，之后是若干条目，首字节为条目类型，整数均为小端序。
+// 每次打开文件先写 Epoch 条目，把时钟计数（steady_clock 纳秒）对应到墙上时间
+void appendBinaryHeader(QByteArray &out);
+void appendEpoch(QByteArray &out, qint64 wallMs, qint64 ticks);
+void appendSite(QByteArray &out, quint32 site, LogLevel level, int line, const char *file, const char *function);
+void appendMessage(QByteArray &out, quint32 site, qint64 ticks, quint64 threadId, const char *text, int length,
+                   bool truncated);
+void appendDrops(QByteArray &out, qint64 ticks, quint64 count);
+
+// 把二进制日志还原为文本格式追加到 text；文件头无效时返回 false，尾部不完整的条目忽略并在 error 中说明
+bool decodeBinary(const QByteArray &content, QByteArray &text, QString &error);
+
+} // namespace LogFormat
+
+#endif // LOG_FORMAT_H
@@ -0,0 +1,95 @@
+/*
+ * LogRing.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 有界无锁多生产者单消费者环形队列。每个槽位带序号，生产者以 CAS 抢占写入位置后
+ *          直接在槽位内填写记录，消费者按序号判断槽位是否写完；不分配内存，不加锁
+ */
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+template <typename T>
+class LogRing {
+public:
+    // capacity 向上取整为 2 的幂
+    explicit LogRing(size_t capacity) {
+        size_t rounded = 2;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        mask = rounded - 1;
+        cells.reset(new Cell[rounded]);
+        for (size_t i = 0; i < rounded; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    // 生产者：抢到槽位后调用 fill(T&) 就地填写；队列已满时返回 false
+    template <typename Fill>
+    bool tryPush(Fill&& fill) {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& slot = cells[position & mask];
+            const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const ptrdiff_t difference = ptrdiff_t(sequence) - ptrdiff_t(position);
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    fill(slot.value);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 消费者（只能有一个）：取出一条交给 consume(const T&)；队列为空或队首尚未写完时返回 false
+    template <typename Consume>
+    bool tryPop(Consume&& consume) {
+        const size_t position = dequeuePosition.load(std::memory_order_relaxed);
+        Cell& slot = cells[position & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+            return false;
+        }
+        consume(slot.value);
+        slot.sequence.store(position + mask + 1, std::memory_order_release);
+        dequeuePosition.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 当前条数的近似值，任意线程可调用
+    size_t size() const {
+        const size_t tail = dequeuePosition.load(std::memory_order_acquire);
+        const size_t head = enqueuePosition.load(std::memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+
+    size_t capacity() const { return mask + 1; }
+    size_t pushed() const { return enqueuePosition.load(std::memory_order_acquire); }  // 累计入队条数
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;  // 等于写入位置时可写，等于写入位置 + 1 时可读
+        T value;
+    };
+
+    alignas(64) std::atomic<size_t> enqueuePosition{0};  // 生产者之间竞争
+    alignas(64) std::atomic<size_t> dequeuePosition{0};  // 只有消费者修改
+    size_t mask = 0;
+    std::unique_ptr<Cell[]> cells;
+};
+
+#endif // LOG_RING_H
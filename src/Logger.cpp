@@ -1,8 +1,140 @@
 #include "Logger.h"
+#include "Metrics.h"
+#include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
 #include <QDebug>
 #include <QMutexLocker>
+#include <QSettings>
+#include <QTextStream>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+
+namespace {
+
+// 将 QString 按 UTF-8 编码写入定长缓冲区，不分配内存；空间不足时在字符边界截断，返回写入的字节数
+int encodeUtf8(const QString &text, char *out, int capacity, bool &truncated) {
+    const QChar *data = text.constData();
+    const qsizetype size = text.size();
+    int length = 0;
+    truncated = false;
+    for (qsizetype i = 0; i < size; ++i) {
+        char32_t code = data[i].unicode();
+        if (QChar::isHighSurrogate(code) && i + 1 < size && data[i + 1].isLowSurrogate()) {
+            code = QChar::surrogateToUcs4(char16_t(code), data[i + 1].unicode());
+            ++i;
+        }
+        const int bytes = code < 0x80 ? 1 : code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+        if (length + bytes > capacity) {
+            truncated = true;
+            break;
+        }
+        char *p = out + length;
+        switch (bytes) {
+            case 1:
+                p[0] = char(code);
+                break;
+            case 2:
+                p[0] = char(0xC0 | (code >> 6));
+                p[1] = char(0x80 | (code & 0x3F));
+                break;
+            case 3:
+                p[0] = char(0xE0 | (code >> 12));
+                p[1] = char(0x80 | ((code >> 6) & 0x3F));
+                p[2] = char(0x80 | (code & 0x3F));
+                break;
+            default:
+                p[0] = char(0xF0 | (code >> 18));
+                p[1] = char(0x80 | ((code >> 12) & 0x3F));
+                p[2] = char(0x80 | ((code >> 6) & 0x3F));
+                p[3] = char(0x80 | (code & 0x3F));
+                break;
+        }
+        length += bytes;
+    }
+    return length;
+}
+
+// 各模块的运行时级别。条目只增不删，LOG_AT 的调用点缓存条目中 level 的地址
+struct ModuleLevels {
+    struct Entry {
+        std::atomic<int> level;
+        bool overridden = false;  // 在设置中单独指定过，不随默认级别变化
+    };
+
+    QMutex mutex;
+    int defaultLevel = int(LogLevel::INFO);
+    std::map<QString, std::unique_ptr<Entry>> entries;
+
+    // 调用方持有 mutex
+    Entry& entry(const QString &module) {
+        std::unique_ptr<Entry> &slot = entries[module];
+        if (!slot) {
+            slot = std::make_unique<Entry>();
+            slot->level.store(defaultLevel, std::memory_order_relaxed);
+        }
+        return *slot;
+    }
+};
+
+// 不析构：静态对象析构期间仍可能有日志调用点读取其中的级别
+ModuleLevels& moduleLevels() {
+    static ModuleLevels *levels = new ModuleLevels;
+    return *levels;
+}
+
+// 模块名取源文件名去掉目录和扩展名，如 src/FileSearchCore.cpp -> FileSearchCore
+QString moduleName(const char *file) {
+    const char *name = file;
+    for (const char *p = file; *p; ++p) {
+        if (*p == '/' || *p == '\\') {
+            name = p + 1;
+        }
+    }
+    const char *dot = std::strrchr(name, '.');
+    return QString::fromUtf8(name, dot ? dot - name : qsizetype(std::strlen(name)));
+}
+
+// 调用点表。deque 追加时不移动已有元素，调用点按引用长期持有
+struct SiteRegistry {
+    QMutex mutex;
+    std::deque<LogSite> sites;
+    std::deque<LogRateLimit> limits;
+    std::vector<const LogSite *> limitedSites;  // 日志线程按周期遍历
+};
+
+SiteRegistry& siteRegistry() {
+    static SiteRegistry *registry = new SiteRegistry;
+    return *registry;
+}
+
+const std::atomic<int>& moduleLevelOf(const char *file) {
+    const QString module = moduleName(file);
+    ModuleLevels &levels = moduleLevels();
+    QMutexLocker locker(&levels.mutex);
+    return levels.entry(module).level;
+}
+
+qint64 steadyTicks() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 解析级别名称，不区分大小写；无法识别时返回 -1
+int parseLevel(const QString &text) {
+    const QString name = text.trimmed().toUpper();
+    if (name == "DEBUG") return int(LogLevel::DEBUG);
+    if (name == "INFO") return int(LogLevel::INFO);
+    if (name == "WARNING") return int(LogLevel::WARNING);
+    if (name == "ERROR") return int(LogLevel::ERROR);
+    if (name == "OFF") return int(LogLevel::OFF);
+    return -1;
+}
+
+} // namespace
 
 Logger& Logger::instance() {
     static Logger instance;
@@ -10,11 +142,25 @@ Logger& Logger::instance() {
 }
 
 Logger::Logger()
-        : logFile(generateLogFileName()),
-          logStream(&logFile),
+        : ring(RingCapacity),
           running(true),
-          currentLogLevel(LogLevel::INFO),
-          identifier("") {
+          writerSleeping(false),
+          rotateRequested(false),
+          flushRequested(false),
+          binaryRequested(false),
+          flushInterval(200),
+          maxFileBytes(64LL * 1024 * 1024),
+          maxFileAgeMs(24LL * 60 * 60 * 1000),
+          overflowPolicy(LogOverflowPolicy::Block),
+          dropped(0),
+          reportedDrops(0),
+          written(0),
+          binary(false),
+          epochWallMs(QDateTime::currentMSecsSinceEpoch()),
+          epochTicks(steadyTicks()),
+          fileBytes(0),
+          fileOpenedMs(0),
+          archiver("logs") {
     QDir logDir("logs");
     if (!logDir.exists()) {
         qDebug() << "日志目录不存在，尝试创建";
@@ -25,141 +171,443 @@ Logger::Logger()
         }
     }
 
-    if (!logFile.open(QIODevice::Append | QIODevice::Text)) {
-        QTextStream(stderr) << "无法打开日志文件: " << logFile.fileName() << "\n";
-        qDebug() << "无法打开日志文件: " << logFile.fileName();
-    } else {
-        qDebug() << "日志文件打开成功: " << logFile.fileName();
-    }
+    Metrics::gauge("filetag_log_queue_depth", "日志队列中待写入的记录数", [this] { return qint64(ring.size()); });
+    Metrics::counter("filetag_log_records_total", "进入日志队列的记录数", [this] { return qint64(ring.pushed()); });
+    Metrics::counter("filetag_log_dropped_total", "队列满时丢弃的日志数", [this] { return qint64(droppedCount()); });
 
+    // 日志文件在第一次写入时打开，启动时读取的设置可以先决定文件格式
+    archiver.start();
     start();  // 启动线程
 }
 
 Logger::~Logger() {
+    running = false;  // 设置线程运行状态为 false，日志线程写完队列中剩余的日志后退出
     {
         QMutexLocker locker(&mutex);
-        running = false;  // 设置线程运行状态为 false
+        condition.wakeOne();
     }
-    condition.wakeOne();  // 唤醒线程以便它可以退出
     wait();  // 等待线程结束
     logFile.close();
 }
 
 void Logger::setLogLevel(LogLevel level) {
-    QMutexLocker locker(&mutex);
-    currentLogLevel = level;
+    ModuleLevels &levels = moduleLevels();
+    QMutexLocker locker(&levels.mutex);
+    levels.defaultLevel = int(level);
+    for (auto &entry : levels.entries) {
+        if (!entry.second->overridden) {
+            entry.second->level.store(int(level), std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::setModuleLevel(const QString &module, LogLevel level) {
+    ModuleLevels &levels = moduleLevels();
+    QMutexLocker locker(&levels.mutex);
+    ModuleLevels::Entry &entry = levels.entry(module);
+    entry.overridden = true;
+    entry.level.store(int(level), std::memory_order_relaxed);
+}
+
+// 每个 LOG_* 调用点只注册一次，之后由调用点的静态引用持有
+const LogSite& Logger::registerSite(LogLevel level, const char *file, int line, const char *function,
+                                    quint32 burst) {
+    const std::atomic<int> &moduleLevel = moduleLevelOf(file);
+    SiteRegistry &registry = siteRegistry();
+    QMutexLocker locker(&registry.mutex);
+    LogRateLimit *limit = nullptr;
+    if (burst > 0) {
+        registry.limits.emplace_back(burst);
+        limit = &registry.limits.back();
+    }
+    registry.sites.push_back(
+            LogSite{ quint32(registry.sites.size()), level, line, file, function, &moduleLevel, limit });
+    if (limit) {
+        registry.limitedSites.push_back(&registry.sites.back());
+    }
+    return registry.sites.back();
+}
+
+void Logger::setRotation(qint64 maxFileBytes, qint64 maxFileAgeMs) {
+    this->maxFileBytes = maxFileBytes;
+    this->maxFileAgeMs = maxFileAgeMs;
 }
 
-void Logger::log(const QString &message, LogLevel level, const char* file, int line, const char* function) {
+void Logger::setRetention(qint64 totalBytes, bool compress) {
+    archiver.setCompression(compress);
+    archiver.setRetentionBytes(totalBytes);
+}
 
-//    if (level < currentLogLevel) {
-//        return;  // 如果消息级别低于当前日志级别，则忽略该消息
-//    }
+void Logger::setBinaryFormat(bool enabled) {
+    binaryRequested = enabled;
+    wakeWriter();
+}
 
-    QString threadId = getCurrentThreadId();
-    QString sourceInfo = QString("[%1:%2 - %3]").arg(file).arg(line).arg(function);
+/*
+ * Summary: 从设置文件读取日志设置并立即生效。[Log] 段中 level 为默认级别，format 为 text 或 binary，
+ *          maxFileMB、maxFileAgeHours 为轮转条件，retentionMB 为日志目录总大小上限，compress 控制是否压缩，
+ *          其余键为模块名，例如 FileSearchCore=DEBUG；文件中不再出现的模块恢复默认级别
+ * Parameters:
+ * const QString &settingsFile - settings.ini 路径
+ * Return: void
+ */
+void Logger::loadSettings(const QString &settingsFile) {
+    QSettings settings(settingsFile, QSettings::IniFormat);
+    settings.beginGroup("Log");
+    const int defaultLevel = parseLevel(settings.value("level", "INFO").toString());
+    setBinaryFormat(settings.value("format", "text").toString().trimmed().toLower() == "binary");
+    const qint64 megabyte = 1024 * 1024;
+    setRotation(settings.value("maxFileMB", 64).toLongLong() * megabyte,
+                settings.value("maxFileAgeHours", 24).toLongLong() * 60 * 60 * 1000);
+    setRetention(settings.value("retentionMB", 512).toLongLong() * megabyte,
+                 settings.value("compress", true).toBool());
+
+    static const QStringList reservedKeys = { "level", "format", "maxFileMB", "maxFileAgeHours", "retentionMB",
+                                              "compress" };
+    std::map<QString, int> overrides;
+    QStringList invalid;
+    for (const QString &key : settings.childKeys()) {
+        if (reservedKeys.contains(key)) {
+            continue;
+        }
+        const int level = parseLevel(settings.value(key).toString());
+        if (level < 0) {
+            invalid << key;
+        } else {
+            overrides[key] = level;
+        }
+    }
+    settings.endGroup();
 
-    QString currentIdentifier;
     {
-        QMutexLocker locker(&mutex);
-        currentIdentifier = identifier;
+        ModuleLevels &levels = moduleLevels();
+        QMutexLocker locker(&levels.mutex);
+        if (defaultLevel >= 0) {
+            levels.defaultLevel = defaultLevel;
+        }
+        for (auto &entry : levels.entries) {
+            entry.second->overridden = false;
+        }
+        for (const auto &module : overrides) {
+            levels.entry(module.first).overridden = true;
+        }
+        for (auto &entry : levels.entries) {
+            const auto found = overrides.find(entry.first);
+            entry.second->level.store(found != overrides.end() ? found->second : levels.defaultLevel,
+                                      std::memory_order_relaxed);
+        }
     }
 
-    QString identifierPart = currentIdentifier.isEmpty() ? "" : QString("[标识符: %1] ").arg(currentIdentifier);
+    // 在释放级别表的锁之后再记录，LOG_* 首次执行时需要这把锁
+    if (defaultLevel < 0) {
+        LOG_WARNING("无法识别的默认日志级别，保持原设置");
+    }
+    if (!invalid.isEmpty()) {
+        LOG_WARNING("无法识别以下模块的日志级别: " + invalid.join(", "));
+    }
+}
 
-    QString logMessage = QString("[%1] [线程ID: %2] %3%4 %5")
-            .arg(logLevelToString(level, false))  // 文件日志不带颜色
-            .arg(threadId)
-            .arg(identifierPart)  // 标识符部分
-            .arg(message)
-            .arg(sourceInfo);
+void Logger::setFlushInterval(int milliseconds) {
+    flushInterval = qMax(1, milliseconds);
+    wakeWriter();
+}
 
-    {
+void Logger::setOverflowPolicy(LogOverflowPolicy policy) {
+    overflowPolicy = policy;
+}
+
+quint64 Logger::droppedCount() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+/*
+ * Summary: 记录一条日志。级别过滤已在 LOG_* 宏中完成，这里不再检查。
+ *          消息在调用线程中直接编码进环形队列的槽位，不分配内存、不加锁；
+ *          队列过半或遇到 ERROR 时才唤醒日志线程，其余情况由日志线程按刷新间隔批量写入
+ * Parameters:
+ * const LogSite &site - 调用点
+ * const QString &message - 日志内容
+ * Return: void
+ */
+void Logger::log(const LogSite &site, const QString &message) {
+    static thread_local const quintptr threadId = reinterpret_cast<quintptr>(QThread::currentThreadId());
+    const qint64 ticks = steadyTicks();
+    auto fill = [&](Record &record) {
+        record.ticks = ticks;
+        record.threadId = threadId;
+        record.site = &site;
+        record.length = quint16(encodeUtf8(message, record.text, MaxMessageBytes, record.truncated));
+    };
+
+    while (!ring.tryPush(fill)) {
+        if (overflowPolicy.load(std::memory_order_relaxed) == LogOverflowPolicy::Drop) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        wakeWriter();
+        QThread::usleep(50);
+    }
+
+    if (site.level == LogLevel::ERROR || ring.size() >= ring.capacity() / 2) {
+        wakeWriter();
+    }
+}
+
+// 日志线程在等待时才需要加锁唤醒。
+// 生产者“入队后读 writerSleeping”与日志线程“写 writerSleeping 后读队列长度”是先写后读的对称模式，
+// acquire/release 不能保证双方至少有一方看到对方的写入，两侧都用 seq_cst 栅栏隔开
+void Logger::wakeWriter() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writerSleeping.load(std::memory_order_relaxed)) {
         QMutexLocker locker(&mutex);
-        logQueue.enqueue(logMessage);
+        condition.wakeOne();
+    }
+}
+
+/*
+ * Summary: 等待调用前提交的日志全部写入文件
+ * Parameters: 无
+ * Return: void
+ */
+void Logger::flush() {
+    const quint64 target = ring.pushed();
+    QMutexLocker locker(&mutex);
+    flushRequested = true;
+    condition.wakeOne();
+    while (written < target && isRunning()) {
+        flushed.wait(&mutex, 100);
     }
-    condition.wakeOne();  // 唤醒工作线程
+}
 
-    // 控制台输出带颜色的版本
-    QString consoleMessage = QString("[%1] [线程ID: %2] %3%4 %5")
-            .arg(logLevelToString(level, true))  // 控制台输出带颜色
-            .arg(threadId)
-            .arg(identifierPart)  // 标识符部分
-            .arg(message)
-            .arg(sourceInfo);
-    // QTextStream(stdout) << consoleMessage << "\n";  // 输出到标准输出
+void Logger::rotateLogFile() {
+    rotateRequested = true;
+    wakeWriter();
 }
 
+/*
+ * Summary: 日志线程。批量取出日志格式化到同一块缓冲区，缓冲区写满、到达刷新间隔、
+ *          出现 ERROR 或有人等待 flush 时一次写入文件
+ * Parameters: 无
+ * Return: void
+ */
 void Logger::run() {
+    QByteArray buffer;
+    buffer.reserve(WriteBufferBytes + 4096);
+    quint64 pending = 0;    // 缓冲区中的条数
+    bool urgent = false;    // 缓冲区中有 ERROR
+    qint64 lastWrite = QDateTime::currentMSecsSinceEpoch();
+    qint64 lastLimitSweep = lastWrite;
+
     while (true) {
-        QString message;
+        // 切换文件或格式前先把已按旧格式编码的内容写入旧文件
+        const bool wantBinary = binaryRequested.load();
+        if (rotateRequested.exchange(false) || wantBinary != binary
+            || rotationDue(QDateTime::currentMSecsSinceEpoch())) {
+            writeOut(buffer, pending);
+            pending = 0;
+            binary = wantBinary;
+            sitesWritten.clear();
+            if (logFile.isOpen()) {
+                reopenLogFile();
+            }
+        }
+
+        size_t drained = 0;
+        while (buffer.size() < WriteBufferBytes && ring.tryPop([&](const Record &record) {
+            appendRecord(buffer, record);
+            urgent = urgent || record.site->level == LogLevel::ERROR;
+        })) {
+            ++drained;
+        }
+        pending += drained;
 
-        {
+        const quint64 totalDropped = dropped.load(std::memory_order_relaxed);
+        if (totalDropped != reportedDrops) {
+            appendDrops(buffer, totalDropped - reportedDrops);
+            reportedDrops = totalDropped;
+        }
+
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        const bool stopping = !running.load();
+        if (now - lastLimitSweep >= LogRateLimit::PeriodMs || (stopping && ring.size() == 0)) {
+            appendSuppressed(buffer);
+            lastLimitSweep = now;
+        }
+        if (!buffer.isEmpty() && (buffer.size() >= WriteBufferBytes || urgent || flushRequested.load() || stopping
+                                  || now - lastWrite >= flushInterval.load())) {
+            writeOut(buffer, pending);
+            pending = 0;
+            urgent = false;
+            lastWrite = now;
+        } else if (buffer.isEmpty() && flushRequested.load()) {
             QMutexLocker locker(&mutex);
-            if (logQueue.isEmpty() && !running) {
-                break;  // 如果队列为空且不再运行，则退出线程
-            }
-            if (logQueue.isEmpty()) {
-                condition.wait(&mutex);  // 如果队列为空，等待唤醒
-            }
-            if (!logQueue.isEmpty()) {
-                message = logQueue.dequeue();  // 从队列中取出消息
-            }
+            flushRequested = false;
+            flushed.wakeAll();
         }
 
-        if (!message.isEmpty()) {
-            QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
-            if (!logFile.isOpen()) {
-                logFile.setFileName(generateLogFileName());
-                logFile.open(QIODevice::Append | QIODevice::Text);
-                logStream.setDevice(&logFile);
-            }
-            logStream << timestamp << " - " << message << "\n";
-            logStream.flush();
+        if (drained > 0) {
+            continue;
+        }
+        if (stopping && ring.size() == 0) {
+            writeOut(buffer, pending);
+            break;  // 如果队列为空且不再运行，则退出线程
+        }
+
+        // 队列为空，休眠到下一次写盘的时间；生产者在队列过半、出现 ERROR 或有人等待时唤醒
+        QMutexLocker locker(&mutex);
+        writerSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);  // 与 wakeWriter 中的栅栏配对
+        if (ring.size() == 0 && running.load() && !flushRequested.load() && !rotateRequested.load()
+            && binaryRequested.load() == binary) {
+            const qint64 remaining = buffer.isEmpty() ? flushInterval.load() : lastWrite + flushInterval.load() - now;
+            condition.wait(&mutex, ulong(qMax<qint64>(1, remaining)));
         }
+        writerSleeping.store(false, std::memory_order_relaxed);
     }
 }
 
-void Logger::rotateLogFile() {
-    if (logFile.isOpen()) {
-        logFile.close();
+/*
+ * Summary: 把一条日志按当前文件格式追加到缓冲区。文本格式与原先逐条写入时相同；
+ *          二进制格式只在调用点第一次出现在当前文件时写入源位置
+ * Parameters:
+ * QByteArray &buffer - 写缓冲
+ * const Record &record - 日志记录
+ * Return: void
+ */
+void Logger::appendRecord(QByteArray &buffer, const Record &record) {
+    const LogSite &site = *record.site;
+    if (!binary) {
+        textWriter.appendLine(buffer, epochWallMs + (record.ticks - epochTicks) / 1000000, record.threadId,
+                              site.level, record.text, record.length, record.truncated, site.file, site.line,
+                              site.function);
+        return;
     }
 
-    logFile.setFileName(generateLogFileName());
-    if (!logFile.open(QIODevice::Append | QIODevice::Text)) {
-        QTextStream(stderr) << "无法打开新的日志文件: " << logFile.fileName() << "\n";
-        qDebug() << "无法打开新的日志文件: " << logFile.fileName();
-    } else {
-        logStream.setDevice(&logFile);
-        qDebug() << "新的日志文件打开成功: " << logFile.fileName();
+    if (sitesWritten.size() <= site.id) {
+        sitesWritten.resize(size_t(site.id) + 1, false);
     }
+    if (!sitesWritten[site.id]) {
+        LogFormat::appendSite(buffer, site.id, site.level, site.line, site.file, site.function);
+        sitesWritten[site.id] = true;
+    }
+    LogFormat::appendMessage(buffer, site.id, record.ticks, record.threadId, record.text, record.length,
+                             record.truncated);
 }
 
-QString Logger::generateLogFileName() {
-    QString dateTimeString = QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss");
-    return QString("logs/application_%1.log").arg(dateTimeString);
+/*
+ * Summary: 结束限流周期：取走各限流调用点的计数，超出 burst 的部分以该调用点的名义输出一条汇总
+ * Parameters:
+ * QByteArray &buffer - 写缓冲
+ * Return: void
+ */
+void Logger::appendSuppressed(QByteArray &buffer) {
+    SiteRegistry &registry = siteRegistry();
+    QMutexLocker locker(&registry.mutex);
+    for (const LogSite *site : registry.limitedSites) {
+        const quint64 count = site->limit->count.exchange(0, std::memory_order_relaxed);
+        if (count <= site->limit->burst) {
+            continue;
+        }
+        const QByteArray text = QString("上一周期内另有 %1 条相同位置的日志未输出（每 %2 秒最多输出 %3 条）")
+                                        .arg(count - site->limit->burst)
+                                        .arg(LogRateLimit::PeriodMs / 1000)
+                                        .arg(site->limit->burst)
+                                        .toUtf8();
+        Record record;
+        record.ticks = steadyTicks();
+        record.threadId = reinterpret_cast<quintptr>(QThread::currentThreadId());
+        record.site = site;
+        record.length = quint16(qMin<qsizetype>(text.size(), MaxMessageBytes));
+        record.truncated = false;
+        std::memcpy(record.text, text.constData(), record.length);
+        appendRecord(buffer, record);
+    }
 }
 
-QString Logger::logLevelToString(LogLevel level, bool useColor) {
-    if (useColor) {
-        switch (level) {
-            case LogLevel::DEBUG: return "\033[36mDEBUG\033[0m";   // 青色
-            case LogLevel::INFO: return "\033[37mINFO\033[0m";    // 白色
-            case LogLevel::WARNING: return "\033[33mWARNING\033[0m"; // 黄色
-            case LogLevel::ERROR: return "\033[31mERROR\033[0m";  // 红色
-            default: return "\033[37mUNKNOWN\033[0m";             // 默认白色
-        }
+// 当前文件超过大小或时长上限，空文件不轮转
+bool Logger::rotationDue(qint64 now) const {
+    if (!logFile.isOpen() || fileBytes == 0) {
+        return false;
+    }
+    const qint64 maxBytes = maxFileBytes.load();
+    const qint64 maxAge = maxFileAgeMs.load();
+    return (maxBytes > 0 && fileBytes >= maxBytes) || (maxAge > 0 && now - fileOpenedMs >= maxAge);
+}
+
+void Logger::appendDrops(QByteArray &buffer, quint64 count) {
+    if (binary) {
+        LogFormat::appendDrops(buffer, steadyTicks(), count);
     } else {
-        switch (level) {
-            case LogLevel::DEBUG: return "DEBUG";
-            case LogLevel::INFO: return "INFO";
-            case LogLevel::WARNING: return "WARNING";
-            case LogLevel::ERROR: return "ERROR";
-            default: return "UNKNOWN";
+        textWriter.appendDrops(buffer, QDateTime::currentMSecsSinceEpoch(), count);
+    }
+}
+
+// 缓冲区一次写入文件并清空，通知等待 flush 的线程
+void Logger::writeOut(QByteArray &buffer, quint64 records) {
+    if (!buffer.isEmpty()) {
+        if (!logFile.isOpen()) {
+            reopenLogFile();
         }
+        logFile.write(buffer);
+        logFile.flush();
+        fileBytes += buffer.size();
+        buffer.clear();
     }
+
+    QMutexLocker locker(&mutex);
+    written += records;
+    if (flushRequested && ring.size() == 0) {
+        flushRequested = false;
+    }
+    flushed.wakeAll();
 }
 
-QString Logger::getCurrentThreadId() {
-    return QString::number(reinterpret_cast<quintptr>(QThread::currentThreadId()), 16);
+// 按当前格式打开新的日志文件，同时重新对应时钟计数与墙上时间；关闭的文件交给归档线程压缩
+void Logger::reopenLogFile() {
+    QString closedPath;
+    if (logFile.isOpen()) {
+        closedPath = logFile.fileName();
+        logFile.close();
+    }
+
+    epochWallMs = QDateTime::currentMSecsSinceEpoch();
+    epochTicks = steadyTicks();
+    fileOpenedMs = epochWallMs;
+    logFile.setFileName(generateLogFileName(binary));
+    // 二进制文件不能按文本模式打开，否则 Windows 下换行字节会被转换
+    const bool opened = logFile.open(binary ? QIODevice::Append : QIODevice::Append | QIODevice::Text);
+    if (closedPath.isEmpty()) {
+        archiver.archiveLeftovers(logFile.fileName());  // 第一次打开：处理以前运行留下的日志
+    } else if (closedPath != logFile.fileName()) {
+        archiver.archive(closedPath, logFile.fileName());
+    }
+    if (!opened) {
+        QTextStream(stderr) << "无法打开日志文件: " << logFile.fileName() << "\n";
+        qDebug() << "无法打开日志文件: " << logFile.fileName();
+        return;
+    }
+    qDebug() << "日志文件打开成功: " << logFile.fileName();
+    fileBytes = logFile.size();
+
+    if (binary) {
+        QByteArray header;
+        if (logFile.size() == 0) {
+            LogFormat::appendBinaryHeader(header);
+        }
+        LogFormat::appendEpoch(header, epochWallMs, epochTicks);
+        logFile.write(header);
+    }
+}
+
+// 文件名带进程名与进程号，多个进程共用日志目录时归档线程据此只处理自己或已退出进程的日志
+QString Logger::generateLogFileName(bool binary) {
+    QString dateTimeString = QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss_zzz");
+    QString processName = QCoreApplication::applicationName();
+    if (processName.isEmpty()) {
+        processName = "application";
+    }
+    return QString("logs/%1_%2_%3.%4")
+            .arg(processName)
+            .arg(QCoreApplication::applicationPid())
+            .arg(dateTimeString, binary ? "bin" : "log");
 }
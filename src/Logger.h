@@ -2,32 +2,104 @@
 #define LOGGER_H
 
 #include <QString>
+#include <QByteArray>
 #include <QFile>
-#include <QTextStream>
 #include <QMutex>
-#include <QQueue>
 #include <QThread>
 #include <QWaitCondition>
 #include <atomic>
+#include <vector>
+
+#include "LogArchiver.h"
+#include "LogFormat.h"
+#include "LogRing.h"
+
+// 编译期最低日志级别（0 DEBUG、1 INFO、2 WARNING、3 ERROR），低于它的 LOG_* 调用连同参数一起不参与编译。
+// 未指定时调试版保留全部级别，发布版只保留 WARNING 及以上
+#ifndef FILETAG_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define FILETAG_LOG_MIN_LEVEL 2
+#else
+#define FILETAG_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+// 每个调用点在第一次执行时注册一次，得到调用点编号和所在模块（源文件名）的运行时级别；
+// 之后先做一次原子读检查级别，通过后才计算 message，被过滤的日志不构造任何字符串
+#define LOG_AT(logLevel, message) \
+    do { \
+        static const LogSite &logSite = Logger::registerSite(logLevel, __FILE__, __LINE__, __FUNCTION__); \
+        if (int(logLevel) >= logSite.moduleLevel->load(std::memory_order_relaxed)) { \
+            Logger::instance().log(logSite, message); \
+        } \
+    } while (0)
+
+// 限流版本：同一调用点每个周期内只输出前 burst 条，其余只计数、不计算 message，
+// 周期结束时由日志线程在该调用点补一条省略次数的汇总。用于一次扫描中可能触发成千上万次的日志
+#define LOG_LIMITED_AT(logLevel, burst, message) \
+    do { \
+        static const LogSite &logSite = Logger::registerSite(logLevel, __FILE__, __LINE__, __FUNCTION__, burst); \
+        if (int(logLevel) >= logSite.moduleLevel->load(std::memory_order_relaxed) && logSite.limit->admit()) { \
+            Logger::instance().log(logSite, message); \
+        } \
+    } while (0)
 
 // 辅助宏，用于简化调用，包含文件名、行号和函数名
-#define LOG_ERROR(message) \
-    Logger::instance().log(message, LogLevel::ERROR, __FILE__, __LINE__, __FUNCTION__)
+#define LOG_ERROR(message) LOG_AT(LogLevel::ERROR, message)
+#define LOG_ERROR_LIMITED(message) LOG_LIMITED_AT(LogLevel::ERROR, LogRateLimit::DefaultBurst, message)
 
-#define LOG_WARNING(message) \
-    Logger::instance().log(message, LogLevel::WARNING, __FILE__, __LINE__, __FUNCTION__)
+#if FILETAG_LOG_MIN_LEVEL <= 2
+#define LOG_WARNING(message) LOG_AT(LogLevel::WARNING, message)
+#define LOG_WARNING_LIMITED(message) LOG_LIMITED_AT(LogLevel::WARNING, LogRateLimit::DefaultBurst, message)
+#else
+#define LOG_WARNING(message) do {} while (0)
+#define LOG_WARNING_LIMITED(message) do {} while (0)
+#endif
 
-#define LOG_INFO(message) \
-    Logger::instance().log(message, LogLevel::INFO, __FILE__, __LINE__, __FUNCTION__)
+#if FILETAG_LOG_MIN_LEVEL <= 1
+#define LOG_INFO(message) LOG_AT(LogLevel::INFO, message)
+#define LOG_INFO_LIMITED(message) LOG_LIMITED_AT(LogLevel::INFO, LogRateLimit::DefaultBurst, message)
+#else
+#define LOG_INFO(message) do {} while (0)
+#define LOG_INFO_LIMITED(message) do {} while (0)
+#endif
 
-#define LOG_DEBUG(message) \
-    Logger::instance().log(message, LogLevel::DEBUG, __FILE__, __LINE__, __FUNCTION__)
+#if FILETAG_LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(message) LOG_AT(LogLevel::DEBUG, message)
+#define LOG_DEBUG_LIMITED(message) LOG_LIMITED_AT(LogLevel::DEBUG, LogRateLimit::DefaultBurst, message)
+#else
+#define LOG_DEBUG(message) do {} while (0)
+#define LOG_DEBUG_LIMITED(message) do {} while (0)
+#endif
 
-enum class LogLevel {
-    DEBUG,
-    INFO,
-    WARNING,
-    ERROR
+// 限流调用点的计数。周期由日志线程推进：每个周期结束时取走计数并输出汇总，调用线程只做一次原子加
+struct LogRateLimit {
+    static constexpr quint32 DefaultBurst = 10;
+    static constexpr int PeriodMs = 10000;
+
+    explicit LogRateLimit(quint32 burst) : burst(burst) {}
+
+    bool admit() { return count.fetch_add(1, std::memory_order_relaxed) < burst; }
+
+    const quint32 burst;
+    std::atomic<quint64> count{0};  // 本周期内的调用次数
+};
+
+// 一个 LOG_* 调用点，注册后在程序运行期间一直有效
+struct LogSite {
+    quint32 id;
+    LogLevel level;
+    int line;
+    const char *file;       // __FILE__、__FUNCTION__ 均为静态存储，只保存指针
+    const char *function;
+    const std::atomic<int> *moduleLevel;
+    LogRateLimit *limit;    // 只有 LOG_*_LIMITED 调用点有
+};
+
+// 日志队列已满时的处理方式
+enum class LogOverflowPolicy {
+    Block,  // 调用线程等待写线程腾出空间，不丢日志
+    Drop    // 丢弃并计数，调用线程不等待
 };
 
 class Logger : public QThread {
@@ -35,33 +107,82 @@ Q_OBJECT
 
 public:
     static Logger& instance();
-    void log(const QString &message, LogLevel level, const char* file, int line, const char* function);
-    void setLogLevel(LogLevel level);
-    void rotateLogFile();
+    // 调用线程只把消息、调用点和时钟计数写入环形队列的一个槽位，格式化与写文件都在日志线程中进行
+    void log(const LogSite &site, const QString &message);
+    static const LogSite& registerSite(LogLevel level, const char *file, int line, const char *function,
+                                       quint32 burst = 0);  // burst 非 0 时为限流调用点
+    void setLogLevel(LogLevel level);              // 默认级别，作用于没有单独设置的模块
+    void setModuleLevel(const QString &module, LogLevel level);
+    void loadSettings(const QString &settingsFile);  // 从 settings.ini 的 [Log] 段读取级别与格式，可随时重新调用
+    void setBinaryFormat(bool enabled);              // 二进制日志写入 logs/*.bin，下一批写入前切换文件
+    void rotateLogFile();                          // 下一批写入前切换到新的日志文件
+    void setRotation(qint64 maxFileBytes, qint64 maxFileAgeMs);  // 文件超过大小或时长时自动轮转，0 表示不按该条件轮转
+    void setRetention(qint64 totalBytes, bool compress);        // 轮转下来的文件是否压缩，日志目录的总大小上限
+    void setFlushInterval(int milliseconds);       // 日志最多在内存中停留多久，ERROR 级别立即写盘
+    void setOverflowPolicy(LogOverflowPolicy policy);
+    quint64 droppedCount() const;                  // 因队列已满而丢弃的日志条数
+    void flush();                                  // 等待此前提交的日志全部写入文件
 
 protected:
     void run() override;  // 线程运行方法
 
 private:
+    static constexpr int MaxMessageBytes = 480;       // 单条消息的 UTF-8 字节上限，超出部分截断
+    static constexpr size_t RingCapacity = 8192;      // 环形队列槽位数
+    static constexpr int WriteBufferBytes = 256 * 1024;  // 写缓冲达到此大小时立即写盘
+
+    // 环形队列中的一条日志，大小固定，入队时不分配内存
+    struct Record {
+        qint64 ticks;           // steady_clock 纳秒，写入时换算为墙上时间
+        quintptr threadId;
+        const LogSite *site;
+        quint16 length;         // text 中的字节数
+        bool truncated;
+        char text[MaxMessageBytes];
+    };
+
     Logger();
     ~Logger();
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
-    QString getCurrentThreadId();
-    QString generateLogFileName();
-    QString logLevelToString(LogLevel level, bool useColor = false);
+    QString generateLogFileName(bool binary);
+    void wakeWriter();
+    void reopenLogFile();                           // 以下均由日志线程调用
+    void appendRecord(QByteArray &buffer, const Record &record);
+    void appendDrops(QByteArray &buffer, quint64 count);
+    bool rotationDue(qint64 now) const;
+    void appendSuppressed(QByteArray &buffer);     // 输出各限流调用点本周期的省略次数
+    void writeOut(QByteArray &buffer, quint64 records);
 
     QFile logFile;
-    QTextStream logStream;
-    QMutex mutex;
-    QQueue<QString> logQueue;  // 存储待写入的日志消息
-    QWaitCondition condition;  // 等待条件，用于控制线程
-    std::atomic<bool> running; // 控制线程运行状态
-
-    LogLevel currentLogLevel; // 当前日志级别
-    QString identifier;       // 标识符
-    void setIdentifier(const QString &id);
+    QMutex mutex;                 // 只用于日志线程休眠/唤醒和 flush 等待，不在记录日志的路径上
+    QWaitCondition condition;     // 唤醒日志线程
+    QWaitCondition flushed;       // 一批日志写盘后通知 flush() 的调用者
+    LogRing<Record> ring;         // 待写入的日志
+    std::atomic<bool> running;    // 控制线程运行状态
+    std::atomic<bool> writerSleeping;   // 日志线程正在等待，生产者需要时才去唤醒
+    std::atomic<bool> rotateRequested;
+    std::atomic<bool> flushRequested;
+    std::atomic<bool> binaryRequested;  // 期望的日志格式
+    std::atomic<int> flushInterval;     // 毫秒
+    std::atomic<qint64> maxFileBytes;
+    std::atomic<qint64> maxFileAgeMs;
+    std::atomic<LogOverflowPolicy> overflowPolicy;
+    std::atomic<quint64> dropped;       // 丢弃的条数
+    quint64 reportedDrops;              // 已在日志中报告过的丢弃条数，只由日志线程访问
+    quint64 written;                    // 已写入文件的条数，受 mutex 保护
+
+    // 以下只由日志线程访问
+    bool binary;                        // 当前文件的格式
+    qint64 epochWallMs;                 // 打开当前文件时的墙上时间与时钟计数，用于换算时间戳
+    qint64 epochTicks;
+    qint64 fileBytes;                   // 当前文件的大小
+    qint64 fileOpenedMs;                // 当前文件的打开时间
+    std::vector<bool> sitesWritten;     // 二进制格式下已写入当前文件的调用点
+    LogFormat::TextWriter textWriter;
+
+    LogArchiver archiver;               // 压缩轮转下来的文件并清理旧日志，不占用日志线程
 };
 
 #endif // LOGGER_H
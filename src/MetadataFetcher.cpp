@@ -0,0 +1,153 @@
+/*
+ * MetadataFetcher.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 后台读取文件属性的实现
+ */
+
+#include "MetadataFetcher.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QThreadPool>
+
+#include "Metrics.h"
+
+namespace {
+const int MaxWorkers = 2;           // 读属性主要等待磁盘，线程多了只会互相争抢
+const int BatchSize = 64;           // 工作线程每次取出的请求数，也是一次信号送回的结果数
+const int CacheEntries = 16384;
+
+MetricCounter &statCount() {
+    static MetricCounter &counter = Metrics::counter("filetag_metadata_stats_total", "后台读取文件属性的次数");
+    return counter;
+}
+
+MetricCounter &cacheHits() {
+    static MetricCounter &counter = Metrics::counter("filetag_metadata_cache_hits_total", "文件属性命中缓存的次数");
+    return counter;
+}
+}
+
+/*
+ * Summary: 构造函数，创建只供读取属性使用的线程池
+ * Parameters:
+ * QObject *parent - 父对象指针，默认值为 nullptr
+ * Return: 无
+ */
+MetadataFetcher::MetadataFetcher(QObject *parent)
+        : QObject(parent),
+          threadPool(new QThreadPool(this)),
+          cache(CacheEntries),
+          runningWorkers(0) {
+    qRegisterMetaType<FileMetadata>();
+    qRegisterMetaType<QVector<FileMetadata>>();
+    threadPool->setMaxThreadCount(MaxWorkers);
+}
+
+/*
+ * Summary: 析构函数，丢弃排队的请求并等待正在读取的一批结束
+ * Parameters: 无
+ * Return: 无
+ */
+MetadataFetcher::~MetadataFetcher() {
+    cancelAll();
+    threadPool->waitForDone();
+}
+
+/*
+ * Summary: 加入一个读取请求。可见的行插到队首，最后滚动到的行最先读取
+ * Parameters:
+ * quint64 key - 调用方的编号，随结果返回
+ * const QString &path - 文件路径
+ * Priority priority - 优先级
+ * Return: void
+ */
+void MetadataFetcher::request(quint64 key, const QString &path, Priority priority) {
+    QMutexLocker locker(&mutex);
+    if (priority == Visible) {
+        queue.push_front({key, path});
+    } else {
+        queue.push_back({key, path});
+    }
+    startWorkers();
+}
+
+void MetadataFetcher::cancelAll() {
+    QMutexLocker locker(&mutex);
+    queue.clear();
+}
+
+void MetadataFetcher::clearCache() {
+    QMutexLocker locker(&mutex);
+    cache.clear();
+}
+
+int MetadataFetcher::pendingCount() {
+    QMutexLocker locker(&mutex);
+    return int(queue.size());
+}
+
+void MetadataFetcher::startWorkers() {
+    while (runningWorkers < MaxWorkers && size_t(runningWorkers) * BatchSize < queue.size()) {
+        ++runningWorkers;
+        threadPool->start([this]() { work(); });
+    }
+}
+
+/*
+ * Summary: 工作线程主循环。每次从队首取一批，先查缓存，其余在不持锁时读取，整批结果一次送回
+ * Parameters: 无
+ * Return: void
+ */
+void MetadataFetcher::work() {
+    while (true) {
+        QVector<FileMetadata> batch;
+        QVector<int> misses;
+        QStringList paths;
+        {
+            QMutexLocker locker(&mutex);
+            if (queue.empty()) {
+                --runningWorkers;
+                return;
+            }
+            while (!queue.empty() && batch.size() < BatchSize) {
+                Request request = std::move(queue.front());
+                queue.pop_front();
+                FileMetadata metadata;
+                if (const FileMetadata *cached = cache.object(request.path)) {
+                    metadata = *cached;
+                    cacheHits().add();
+                } else {
+                    misses.append(batch.size());
+                    paths.append(std::move(request.path));
+                }
+                metadata.key = request.key;
+                batch.append(metadata);
+            }
+        }
+
+        // QFileInfo 在 Linux 上通过一次 statx 同时取得大小、创建时间与修改时间
+        for (int i = 0; i < misses.size(); ++i) {
+            const QFileInfo info(paths[i]);
+            FileMetadata &metadata = batch[misses[i]];
+            const QDateTime created = info.birthTime();
+            const QDateTime modified = info.lastModified();
+            metadata.size = info.exists() ? info.size() : 0;
+            metadata.created = created.isValid() ? created.toMSecsSinceEpoch() : 0;
+            metadata.modified = modified.isValid() ? modified.toMSecsSinceEpoch() : 0;
+        }
+        statCount().add(misses.size());
+
+        if (!misses.isEmpty()) {
+            QMutexLocker locker(&mutex);
+            for (int i = 0; i < misses.size(); ++i) {
+                cache.insert(paths[i], new FileMetadata(batch[misses[i]]));
+            }
+        }
+        emit fetched(batch);
+    }
+}
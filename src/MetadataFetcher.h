@@ -0,0 +1,69 @@
+/*
+ * MetadataFetcher.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 在后台线程读取文件的大小与时间。请求按优先级排队：当前可见的行插到队首，
+ *          预读（例如按时间排序时的全部行）排在队尾；工作线程每次取一批读取，结果成批通过信号送回，
+ *          最近读取过的路径保存在一个小缓存中，同一次搜索中滚动或重新排序时不再访问文件系统；
+ *          缓存在新的搜索开始时清空，文件被修改后不会一直显示旧的属性
+ */
+
+#ifndef METADATA_FETCHER_H
+#define METADATA_FETCHER_H
+
+#include <QCache>
+#include <QMetaType>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <deque>
+
+class QThreadPool;
+
+struct FileMetadata {
+    quint64 key = 0;        // 请求时传入的编号，原样返回
+    qint64 size = 0;        // 字节数，文件不存在时为 0
+    qint64 created = 0;     // 毫秒时间戳，无效时为 0
+    qint64 modified = 0;
+};
+Q_DECLARE_METATYPE(FileMetadata)
+
+class MetadataFetcher : public QObject {
+Q_OBJECT
+public:
+    enum Priority {
+        Visible,    // 正在显示的行，最先读取
+        Background  // 预读，队列空闲时读取
+    };
+
+    explicit MetadataFetcher(QObject *parent = nullptr);
+    ~MetadataFetcher() override;
+
+    void request(quint64 key, const QString &path, Priority priority = Visible);
+    void cancelAll();       // 丢弃尚未开始读取的请求，已在读取的一批仍会送回
+    void clearCache();      // 丢弃缓存的属性，之后的请求重新读取文件系统
+    int pendingCount();     // 排队中的请求数
+
+signals:
+    void fetched(const QVector<FileMetadata> &batch);
+
+private:
+    struct Request {
+        quint64 key;
+        QString path;
+    };
+
+    void startWorkers();    // 调用时需持有 mutex
+    void work();
+
+    QThreadPool *threadPool;
+    QMutex mutex;
+    std::deque<Request> queue;
+    QCache<QString, FileMetadata> cache;
+    int runningWorkers;
+};
+
+#endif // METADATA_FETCHER_H
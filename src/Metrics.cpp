@@ -0,0 +1,287 @@
+/*
+ * Metrics.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 运行指标实现。本文件不使用 LOG_* 宏：日志模块自身也注册指标，注册时可能正处于 Logger 构造过程中
+ */
+
+#include "Metrics.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtAlgorithms>
+#include <limits>
+#include <map>
+
+namespace {
+
+struct Entry {
+    QString help;
+    Metrics::Type type;
+    std::unique_ptr<MetricCounter> counter;
+    std::unique_ptr<MetricGauge> gauge;
+    std::unique_ptr<MetricHistogram> histogram;
+    std::function<qint64()> read;
+};
+
+struct Registry {
+    QMutex mutex;
+    std::map<QString, Entry> entries;
+};
+
+// 与 Logger 的模块级别表一样不析构，静态对象析构后仍可能有线程持有指标引用
+Registry &registry() {
+    static Registry *instance = new Registry;
+    return *instance;
+}
+
+// 已存在的同名指标直接返回；类型不一致属于编程错误，仍按请求的类型补建对象以免调用方拿到空引用
+Entry &entryFor(const QString &name, const QString &help, Metrics::Type type) {
+    Registry &reg = registry();
+    auto it = reg.entries.find(name);
+    if (it == reg.entries.end()) {
+        Entry entry;
+        entry.help = help;
+        entry.type = type;
+        it = reg.entries.emplace(name, std::move(entry)).first;
+    } else if (it->second.type != type) {
+        qWarning() << "指标类型不一致:" << name;
+    }
+    return it->second;
+}
+
+} // namespace
+
+namespace MetricsDetail {
+size_t nextShard() {
+    static std::atomic<size_t> next{0};
+    return next.fetch_add(1, std::memory_order_relaxed) % Shards;
+}
+} // namespace MetricsDetail
+
+qint64 MetricCounter::value() const {
+    qint64 total = 0;
+    for (const Shard &shard : shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+MetricHistogram::MetricHistogram() : shards(new Shard[MetricsDetail::Shards]) {
+    for (size_t s = 0; s < MetricsDetail::Shards; ++s) {
+        for (std::atomic<quint64> &bucket : shards[s].buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void MetricHistogram::record(qint64 value) {
+    if (value < 0) {
+        value = 0;
+    }
+    Shard &shard = shards[MetricsDetail::currentShard()];
+    shard.buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+/*
+ * Summary: 计算数值所在的桶。小于 16 的值各占一个桶；更大的值按最高位分段，每段取最高位之后的 4 位作为子桶
+ * Parameters:
+ * qint64 value - 非负数值
+ * Return: int - 桶序号
+ */
+int MetricHistogram::bucketOf(qint64 value) {
+    const quint64 v = quint64(value);
+    if (v < quint64(SubBuckets)) {
+        return int(v);
+    }
+    const int exponent = 63 - int(qCountLeadingZeroBits(v));
+    const int sub = int(v >> (exponent - 4)) - SubBuckets;
+    return (exponent - 3) * SubBuckets + sub;
+}
+
+qint64 MetricHistogram::bucketUpperBound(int bucket) {
+    if (bucket < SubBuckets) {
+        return bucket;
+    }
+    const int exponent = bucket / SubBuckets + 3;
+    const quint64 sub = quint64(bucket % SubBuckets);
+    const quint64 upper = ((SubBuckets + sub + 1) << (exponent - 4)) - 1;
+    const quint64 limit = quint64(std::numeric_limits<qint64>::max());
+    return upper > limit ? qint64(limit) : qint64(upper);
+}
+
+MetricHistogram::Snapshot MetricHistogram::snapshot() const {
+    Snapshot result;
+    result.buckets.assign(BucketCount, 0);
+    for (size_t s = 0; s < MetricsDetail::Shards; ++s) {
+        const Shard &shard = shards[s];
+        for (int b = 0; b < BucketCount; ++b) {
+            const quint64 n = shard.buckets[b].load(std::memory_order_relaxed);
+            result.buckets[b] += n;
+            result.count += n;
+        }
+        result.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+qint64 MetricHistogram::Snapshot::percentile(double quantile) const {
+    if (count == 0) {
+        return 0;
+    }
+    quint64 rank = quint64(quantile * double(count) + 0.5);
+    rank = qBound<quint64>(1, rank, count);
+    quint64 seen = 0;
+    for (int b = 0; b < int(buckets.size()); ++b) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            return bucketUpperBound(b);
+        }
+    }
+    return max();
+}
+
+qint64 MetricHistogram::Snapshot::max() const {
+    for (int b = int(buckets.size()) - 1; b >= 0; --b) {
+        if (buckets[b]) {
+            return bucketUpperBound(b);
+        }
+    }
+    return 0;
+}
+
+MetricCounter& Metrics::counter(const QString &name, const QString &help) {
+    QMutexLocker locker(&registry().mutex);
+    Entry &entry = entryFor(name, help, Type::Counter);
+    if (!entry.counter) {
+        entry.counter.reset(new MetricCounter);
+    }
+    return *entry.counter;
+}
+
+MetricGauge& Metrics::gauge(const QString &name, const QString &help) {
+    QMutexLocker locker(&registry().mutex);
+    Entry &entry = entryFor(name, help, Type::Gauge);
+    if (!entry.gauge) {
+        entry.gauge.reset(new MetricGauge);
+    }
+    return *entry.gauge;
+}
+
+MetricHistogram& Metrics::histogram(const QString &name, const QString &help) {
+    QMutexLocker locker(&registry().mutex);
+    Entry &entry = entryFor(name, help, Type::Histogram);
+    if (!entry.histogram) {
+        entry.histogram.reset(new MetricHistogram);
+    }
+    return *entry.histogram;
+}
+
+void Metrics::counter(const QString &name, const QString &help, std::function<qint64()> read) {
+    QMutexLocker locker(&registry().mutex);
+    entryFor(name, help, Type::Counter).read = std::move(read);
+}
+
+void Metrics::gauge(const QString &name, const QString &help, std::function<qint64()> read) {
+    QMutexLocker locker(&registry().mutex);
+    entryFor(name, help, Type::Gauge).read = std::move(read);
+}
+
+std::vector<Metrics::Sample> Metrics::samples() {
+    std::vector<Sample> result;
+    QMutexLocker locker(&registry().mutex);
+    for (const auto &item : registry().entries) {
+        const Entry &entry = item.second;
+        Sample sample{item.first, entry.help, entry.type, 0, {}};
+        if (entry.read) {
+            sample.value = entry.read();
+            result.push_back(std::move(sample));
+            continue;
+        }
+        switch (entry.type) {
+        case Type::Counter:
+            sample.value = entry.counter ? entry.counter->value() : 0;
+            break;
+        case Type::Gauge:
+            sample.value = entry.gauge ? entry.gauge->value() : 0;
+            break;
+        case Type::Histogram:
+            if (entry.histogram) {
+                sample.histogram = entry.histogram->snapshot();
+            }
+            break;
+        }
+        result.push_back(std::move(sample));
+    }
+    return result;
+}
+
+/*
+ * Summary: 生成 Prometheus 文本格式。直方图按 summary 类型输出 p50/p90/p99 分位数、_sum 与 _count，
+ *          分位数取所在桶的上界
+ * Parameters: 无
+ * Return: QByteArray - 文本内容
+ */
+QByteArray Metrics::prometheusText() {
+    static const double Quantiles[] = {0.5, 0.9, 0.99};
+
+    QByteArray text;
+    for (const Sample &sample : samples()) {
+        const QByteArray name = sample.name.toUtf8();
+        text += "# HELP " + name + ' ' + sample.help.toUtf8() + '\n';
+        switch (sample.type) {
+        case Type::Counter:
+            text += "# TYPE " + name + " counter\n";
+            text += name + ' ' + QByteArray::number(sample.value) + '\n';
+            break;
+        case Type::Gauge:
+            text += "# TYPE " + name + " gauge\n";
+            text += name + ' ' + QByteArray::number(sample.value) + '\n';
+            break;
+        case Type::Histogram:
+            text += "# TYPE " + name + " summary\n";
+            for (double quantile : Quantiles) {
+                text += name + "{quantile=\"" + QByteArray::number(quantile) + "\"} "
+                        + QByteArray::number(sample.histogram.percentile(quantile)) + '\n';
+            }
+            text += name + "_sum " + QByteArray::number(sample.histogram.sum) + '\n';
+            text += name + "_count " + QByteArray::number(sample.histogram.count) + '\n';
+            break;
+        }
+    }
+    return text;
+}
+
+bool Metrics::writePrometheus(const QString &path) {
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "无法写入指标文件:" << path << file.errorString();
+        return false;
+    }
+    file.write(prometheusText());
+    if (!file.commit()) {
+        qWarning() << "无法写入指标文件:" << path << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+MetricsExporter::MetricsExporter(const QString &path, int intervalSeconds, QObject *parent)
+    : QObject(parent), path(path) {
+    connect(&timer, &QTimer::timeout, this, &MetricsExporter::exportNow);
+    if (intervalSeconds > 0) {
+        timer.start(intervalSeconds * 1000);
+    }
+}
+
+void MetricsExporter::exportNow() {
+    Metrics::writePrometheus(path);
+}
@@ -0,0 +1,86 @@
+/*
+ * MetricsPanel.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 运行统计面板实现
+ */
+
+#include "MetricsPanel.h"
+#include "Metrics.h"
+
+#include <QFontDatabase>
+#include <QVBoxLayout>
+
+MetricsPanel::MetricsPanel(QWidget *parent)
+        : QDialog(parent) {
+    textView = new QPlainTextEdit(this);
+    textView->setReadOnly(true);
+    textView->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->addWidget(textView);
+    setLayout(mainLayout);
+    setWindowTitle(tr("运行统计"));
+    resize(640, 480);
+
+    connect(&refreshTimer, &QTimer::timeout, this, &MetricsPanel::refresh);
+    refreshTimer.start(1000);
+    refresh();
+}
+
+/*
+ * Summary: 刷新显示。计数器显示累计值与距上次刷新的每秒增量，直方图显示 p50/p90/p99 与最大值；
+ *          另外按遍历的文件与目录数计算匹配率
+ * Parameters: 无
+ * Return: void
+ */
+void MetricsPanel::refresh() {
+    if (!isVisible() && sinceLastRefresh.isValid()) {
+        return;  // 面板关闭后不再合并各分片
+    }
+    const double seconds = sinceLastRefresh.isValid() ? sinceLastRefresh.restart() / 1000.0 : 0.0;
+    if (!sinceLastRefresh.isValid()) {
+        sinceLastRefresh.start();
+    }
+
+    QString text;
+    QHash<QString, qint64> counters;
+    for (const Metrics::Sample &sample : Metrics::samples()) {
+        switch (sample.type) {
+        case Metrics::Type::Counter: {
+            counters.insert(sample.name, sample.value);
+            QString rate = "-";
+            if (seconds > 0 && lastCounters.contains(sample.name)) {
+                rate = QString::number((sample.value - lastCounters.value(sample.name)) / seconds, 'f', 1);
+            }
+            text += QString("%1  %2  %3/秒\n").arg(sample.help, -24).arg(sample.value, 12).arg(rate, 10);
+            break;
+        }
+        case Metrics::Type::Gauge:
+            text += QString("%1  %2\n").arg(sample.help, -24).arg(sample.value, 12);
+            break;
+        case Metrics::Type::Histogram: {
+            const MetricHistogram::Snapshot &h = sample.histogram;
+            text += QString("%1  次数 %2  p50 %3  p90 %4  p99 %5  最大 %6\n")
+                            .arg(sample.help, -24)
+                            .arg(h.count)
+                            .arg(h.percentile(0.5))
+                            .arg(h.percentile(0.9))
+                            .arg(h.percentile(0.99))
+                            .arg(h.max());
+            break;
+        }
+        }
+    }
+
+    const qint64 entries = counters.value("filetag_search_files_total") + counters.value("filetag_search_directories_total");
+    if (entries > 0) {
+        const double matchRate = 100.0 * counters.value("filetag_search_matches_total") / entries;
+        text += QString("\n遍历匹配率  %1%\n").arg(matchRate, 0, 'f', 2);
+    }
+
+    lastCounters = counters;
+    textView->setPlainText(text);
+}
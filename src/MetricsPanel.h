@@ -0,0 +1,35 @@
+/*
+ * MetricsPanel.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 运行统计面板。每秒读取一次指标，显示计数器的累计值与每秒增量、队列长度及耗时分位数
+ */
+
+#ifndef METRICS_PANEL_H
+#define METRICS_PANEL_H
+
+#include <QDialog>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPlainTextEdit>
+#include <QTimer>
+
+class MetricsPanel : public QDialog {
+Q_OBJECT
+
+public:
+    explicit MetricsPanel(QWidget *parent = nullptr);
+
+private slots:
+    void refresh();
+
+private:
+    QPlainTextEdit *textView;
+    QTimer refreshTimer;
+    QElapsedTimer sinceLastRefresh;
+    QHash<QString, qint64> lastCounters;  // 上次刷新时的计数器值，用于计算每秒增量
+};
+
+#endif // METRICS_PANEL_H
@@ -0,0 +1,113 @@
+/*
+ * PerThreadRing.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 每线程独占的记录环，供运行记录器与性能跟踪共用。记录时只写本线程的环，不加锁、不分配内存；
+ *          线程退出后环保留到被新线程复用，导出时只做原子读和复制，可以在信号处理函数中执行
+ */
+
+#ifndef PER_THREAD_RING_H
+#define PER_THREAD_RING_H
+
+#include <QtGlobal>
+#include <atomic>
+
+// 每种实例化对应一组独立的环。N 为每个环的记录数，必须是 2 的幂
+template <typename T, quint64 N>
+class PerThreadRing {
+    static_assert(N > 1 && (N & (N - 1)) == 0, "PerThreadRing 的容量必须是 2 的幂");
+
+public:
+    struct Ring {
+        std::atomic<quint64> head{0};       // 累计写入的记录数，只由所属线程修改
+        std::atomic<quint64> first{0};      // 导出的起点，之前的记录不再导出
+        std::atomic<bool> inUse{true};
+        std::atomic<quint64> threadId{0};   // 当前或最后一个所属线程
+        int index = 0;                      // 按环的创建顺序编号，从 1 开始
+        char threadName[48] = {};           // 只在所属线程取得环时写入
+        Ring *next = nullptr;               // 所有环组成的链表，只在头部插入，从不删除
+        T slots[N];
+    };
+
+    // 可以安全读取的记录下标范围 [begin, end)
+    struct Range {
+        quint64 begin;
+        quint64 end;
+    };
+
+    // 所有环组成的链表
+    static Ring *rings() {
+        return list.load(std::memory_order_acquire);
+    }
+
+    // 本线程下一条记录的槽位。线程第一次记录时取得环，并调用 onAcquire(Ring&) 填写线程信息；
+    // 填好槽位后以同一个 head 调用 publish
+    template <typename Acquire>
+    static T &claim(quint64 &head, Acquire &&onAcquire) {
+        if (!holder.ring) {
+            holder.ring = acquire();
+            onAcquire(*holder.ring);
+        }
+        head = holder.ring->head.load(std::memory_order_relaxed);
+        return holder.ring->slots[head & (N - 1)];
+    }
+
+    static void publish(quint64 head) {
+        holder.ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    // 导出时可读取的范围。下标 head - N 的槽位可能正被所属线程覆盖，从下一个开始读
+    static Range readable(const Ring &ring) {
+        const quint64 head = ring.head.load(std::memory_order_acquire);
+        const quint64 first = ring.first.load(std::memory_order_acquire);
+        const quint64 begin = head > N - 1 ? head - (N - 1) : 0;
+        return { begin > first ? begin : first, head };
+    }
+
+    // 依次复制范围内的记录交给 visit(const T&)；复制期间所属线程写过的槽位内容可能不完整，跳过
+    template <typename Visit>
+    static void read(const Ring &ring, Range range, Visit &&visit) {
+        for (quint64 i = range.begin; i < range.end; ++i) {
+            const T copy = ring.slots[i & (N - 1)];
+            if (ring.head.load(std::memory_order_acquire) - i >= N) {
+                continue;
+            }
+            visit(copy);
+        }
+    }
+
+private:
+    // 线程退出时归还环，内容保留到被复用
+    struct Holder {
+        Ring *ring = nullptr;
+        ~Holder() {
+            if (ring) {
+                ring->inUse.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    // 取得一个空闲的环，没有时新建
+    static Ring *acquire() {
+        for (Ring *ring = rings(); ring; ring = ring->next) {
+            bool expected = false;
+            if (ring->inUse.compare_exchange_strong(expected, true)) {
+                return ring;
+            }
+        }
+        Ring *ring = new Ring;
+        ring->index = count.fetch_add(1) + 1;
+        ring->next = list.load(std::memory_order_relaxed);
+        while (!list.compare_exchange_weak(ring->next, ring, std::memory_order_release)) {
+        }
+        return ring;
+    }
+
+    static inline std::atomic<Ring *> list{nullptr};
+    static inline std::atomic<int> count{0};
+    static inline thread_local Holder holder;
+};
+
+#endif // PER_THREAD_RING_H
@@ -0,0 +1,262 @@
+/*
+ * SearchBenchmark.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetag-search-bench：在 TreeGenerator 生成的目录树上端到端测量 FileSearchCore 的遍历搜索，
+ *          记录首个结果耗时、总耗时、每秒目录数与文件数，并比较不同线程数；结果以 JSON 输出，便于对比多次运行。
+ *          用法：filetag-search-bench [--seed 1] [--depth 4] [--fanout 6] [--files 20] [--threads 1,2,4] [--repeat 3]
+ *                [--keyword .cpp] [--root 已有目录] [--output result.json]
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+
+#include "FileSearchCore.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "TreeGenerator.h"
+
+namespace {
+
+struct RunResult {
+    int threads = 0;
+    double firstResultMs = -1;   // 没有结果时为 -1
+    double totalMs = 0;
+    qint64 directoriesVisited = 0;
+    qint64 filesVisited = 0;
+    qint64 matches = 0;
+};
+
+TreeStats countTree(const QString &root) {
+    TreeStats stats;
+    QDirIterator it(root, QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        ++(it.fileInfo().isDir() ? stats.directories : stats.files);
+    }
+    return stats;
+}
+
+qint64 counterValue(const QString &name) {
+    for (const Metrics::Sample &sample : Metrics::samples()) {
+        if (sample.name == name) {
+            return sample.value;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Summary: 执行一次搜索。每次使用新的空索引目录，保证走文件系统遍历而不是索引查询；
+ *          计时到 searchFinished 为止，不包括之后数据库线程写入匹配结果与导出快照
+ * Parameters:
+ * const QString &root - 搜索根目录
+ * const QString &keyword - 关键字
+ * int threads - 遍历线程数
+ * Return: RunResult - 本次结果
+ */
+RunResult runSearch(const QString &root, const QString &keyword, int threads) {
+    RunResult result;
+    result.threads = threads;
+
+    QTemporaryDir indexDirectory;
+    FileSearchCore core(nullptr, indexDirectory.path());
+    core.setThreadCount(threads);
+
+    QEventLoop loop;
+    QElapsedTimer timer;
+    QObject::connect(&core, &FileSearchCore::fileFound, [&](const QString &) {
+        if (result.firstResultMs < 0) {
+            result.firstResultMs = timer.nsecsElapsed() / 1e6;
+        }
+        ++result.matches;
+    });
+    QObject::connect(&core, &FileSearchCore::searchFinished, &loop, &QEventLoop::quit);
+
+    const qint64 directoriesBefore = counterValue("filetag_search_directories_total");
+    const qint64 filesBefore = counterValue("filetag_search_files_total");
+
+    // 在事件循环中开始，搜索同步结束时 quit 也能生效
+    QTimer::singleShot(0, &core, [&] {
+        timer.start();
+        core.startSearch(keyword, root, true);
+    });
+    loop.exec();
+    result.totalMs = timer.nsecsElapsed() / 1e6;
+
+    result.directoriesVisited = counterValue("filetag_search_directories_total") - directoriesBefore;
+    result.filesVisited = counterValue("filetag_search_files_total") - filesBefore;
+    return result;
+}
+
+QJsonObject toJson(const RunResult &run) {
+    const double seconds = run.totalMs / 1000.0;
+    return QJsonObject{
+            {"threads", run.threads},
+            {"firstResultMs", run.firstResultMs},
+            {"totalMs", run.totalMs},
+            {"directoriesVisited", run.directoriesVisited},
+            {"filesVisited", run.filesVisited},
+            {"directoriesPerSec", seconds > 0 ? run.directoriesVisited / seconds : 0.0},
+            {"filesPerSec", seconds > 0 ? run.filesVisited / seconds : 0.0},
+            {"matches", run.matches}
+    };
+}
+
+// 同一线程数多次运行中总耗时居中的一次
+RunResult medianRun(QVector<RunResult> runs) {
+    std::sort(runs.begin(), runs.end(), [](const RunResult &a, const RunResult &b) { return a.totalMs < b.totalMs; });
+    return runs[runs.size() / 2];
+}
+
+QList<int> defaultThreadCounts() {
+    QList<int> counts;
+    const int ideal = QThread::idealThreadCount();
+    for (int count = 1; count < ideal; count *= 2) {
+        counts << count;
+    }
+    counts << ideal;
+    return counts;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QTextStream errors(stderr);
+
+    const TreeSpec defaults;
+    QCommandLineParser parser;
+    parser.setApplicationDescription("FileSearchCore 遍历搜索基准测试");
+    parser.addHelpOption();
+    parser.addOptions({
+            {"root", "在已有目录上测试，不生成目录树", "dir"},
+            {"seed", "生成目录树的随机种子", "n", QString::number(defaults.seed)},
+            {"depth", "生成的目录层数", "n", QString::number(defaults.depth)},
+            {"fanout", "每个目录的平均子目录数", "n", QString::number(defaults.fanout)},
+            {"files", "每个目录文件数的中位数", "n", QString::number(defaults.filesMedian)},
+            {"threads", "逗号分隔的线程数列表，默认从 1 倍增到 CPU 核数", "list"},
+            {"repeat", "每个线程数的运行次数", "n", "3"},
+            {"keyword", "搜索关键字，默认匹配约十六分之一的文件", "text", ".cpp"},
+            {"output", "JSON 输出文件，默认输出到标准输出", "file"}
+    });
+    parser.process(app);
+
+    // 日志写盘会影响计时，只保留警告与错误
+    Logger::instance().setLogLevel(LogLevel::WARNING);
+
+    TreeSpec spec;
+    spec.seed = parser.value("seed").toULongLong();
+    spec.depth = parser.value("depth").toInt();
+    spec.fanout = parser.value("fanout").toDouble();
+    spec.filesMedian = parser.value("files").toDouble();
+
+    QTemporaryDir treeDirectory;
+    QString root = parser.value("root");
+    TreeStats tree;
+    QElapsedTimer generateTimer;
+    generateTimer.start();
+    if (root.isEmpty()) {
+        root = treeDirectory.path();
+        TreeGenerator generator(spec);
+        if (!generator.generate(root)) {
+            errors << "生成目录树失败: " << generator.errorString() << "\n";
+            return 1;
+        }
+        tree = generator.stats();
+    } else {
+        tree = countTree(root);
+    }
+    errors << QString("目录树 %1：%2 个目录，%3 个文件，准备耗时 %4 毫秒\n")
+                      .arg(root).arg(tree.directories).arg(tree.files).arg(generateTimer.elapsed());
+    if (tree.directories == 0) {
+        errors << "根目录下没有子目录，FileSearchCore 不会遍历\n";
+        return 1;
+    }
+
+    QList<int> threadCounts;
+    for (const QString &value : parser.value("threads").split(',', Qt::SkipEmptyParts)) {
+        threadCounts << qMax(1, value.toInt());
+    }
+    if (threadCounts.isEmpty()) {
+        threadCounts = defaultThreadCounts();
+    }
+    const int repeat = qMax(1, parser.value("repeat").toInt());
+    const QString keyword = parser.value("keyword");
+
+    QJsonArray runs;
+    QJsonArray summary;
+    double baselineMs = 0;
+    for (int threads : threadCounts) {
+        QVector<RunResult> results;
+        for (int i = 0; i < repeat; ++i) {
+            const RunResult run = runSearch(root, keyword, threads);
+            errors << QString("线程 %1，第 %2 次：首个结果 %3 毫秒，总计 %4 毫秒，匹配 %5\n")
+                              .arg(threads).arg(i + 1).arg(run.firstResultMs, 0, 'f', 2)
+                              .arg(run.totalMs, 0, 'f', 2).arg(run.matches);
+            results << run;
+            runs.append(toJson(run));
+        }
+
+        const RunResult median = medianRun(results);
+        if (baselineMs == 0) {
+            baselineMs = median.totalMs;
+        }
+        QJsonObject entry = toJson(median);
+        entry["speedup"] = median.totalMs > 0 ? baselineMs / median.totalMs : 0.0;
+        summary.append(entry);
+    }
+
+    const QJsonObject report{
+            {"benchmark", "search"},
+            {"timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+            {"host", QJsonObject{{"cpus", QThread::idealThreadCount()},
+                                 {"os", QSysInfo::prettyProductName()},
+                                 {"arch", QSysInfo::currentCpuArchitecture()}}},
+            {"tree", QJsonObject{{"root", root},
+                                 {"generated", parser.value("root").isEmpty()},
+                                 {"seed", QString::number(spec.seed)},
+                                 {"depth", spec.depth},
+                                 {"fanout", spec.fanout},
+                                 {"filesMedian", spec.filesMedian},
+                                 {"directories", tree.directories},
+                                 {"files", tree.files},
+                                 {"symlinks", tree.symlinks}}},
+            {"keyword", keyword},
+            {"repeat", repeat},
+            {"runs", runs},
+            {"summary", summary}     // 每个线程数取总耗时居中的一次，speedup 相对第一个线程数
+    };
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    if (parser.isSet("output")) {
+        QFile output(parser.value("output"));
+        if (!output.open(QIODevice::WriteOnly)) {
+            errors << "无法写入 " << output.fileName() << ": " << output.errorString() << "\n";
+            return 1;
+        }
+        output.write(json);
+    } else {
+        QFile output;
+        output.open(stdout, QIODevice::WriteOnly);
+        output.write(json);
+    }
+    return 0;
+}
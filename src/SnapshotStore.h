@@ -0,0 +1,88 @@
+/*
+ * SnapshotStore.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 单写多读的快照容器。读者原子地取得当前版本的 shared_ptr，之后只读不加锁；
+ *          写者在另一份副本上修改后原子替换当前版本。副本不再被读者持有时复用，
+ *          只需补做上一次的修改记录，否则整份复制一次
+ */
+
+#ifndef SNAPSHOT_STORE_H
+#define SNAPSHOT_STORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+template <typename T, typename Change>
+class SnapshotStore {
+public:
+    using Apply = void (*)(T&, const Change&);  // 把一条修改记录作用到副本上，结果必须与首次修改一致
+
+    explicit SnapshotStore(Apply apply) : apply(apply), current(std::make_shared<const T>()) {}
+
+    // 当前版本，持有期间内容不变
+    std::shared_ptr<const T> snapshot() const {
+        return std::atomic_load(&current);
+    }
+
+    // 替换为新加载的数据，丢弃副本
+    void reset(std::shared_ptr<T> value) {
+        std::lock_guard<std::mutex> lock(writer);
+        std::atomic_store(&current, std::shared_ptr<const T>(std::move(value)));
+        spare.reset();
+        backlog.clear();
+    }
+
+    // 写者之间互斥。mutate(T&, std::vector<Change>&) 修改副本并记下全部修改，返回值原样返回；
+    // 没有修改记录时不发布新版本
+    template <typename Mutate>
+    auto update(Mutate&& mutate) {
+        std::lock_guard<std::mutex> lock(writer);
+        std::shared_ptr<T> target = takeSpare();
+        std::vector<Change> changes;
+        auto result = mutate(*target, changes);
+        if (changes.empty()) {
+            spare = std::move(target);
+            return result;
+        }
+        std::shared_ptr<const T> previous = std::atomic_exchange(&current, std::shared_ptr<const T>(target));
+        // 旧版本只剩 current 之外的读者引用，等下次写入时再判断能否复用
+        spare = std::const_pointer_cast<T>(std::move(previous));
+        backlog = std::move(changes);
+        return result;
+    }
+
+    size_t copies() const { return copyCount.load(std::memory_order_relaxed); }  // 因读者占用而整份复制的次数
+
+private:
+    // 取得可写副本：没有读者引用时补做上次的修改，否则立即复制当前版本。
+    // 持有写锁时不等待读者，等待会让所有写者一起阻塞
+    std::shared_ptr<T> takeSpare() {
+        if (spare && spare.use_count() == 1) {
+            for (const Change& change : backlog) {
+                apply(*spare, change);
+            }
+            backlog.clear();
+            return std::move(spare);
+        }
+        spare.reset();
+        backlog.clear();
+        copyCount.fetch_add(1, std::memory_order_relaxed);
+        return std::make_shared<T>(*std::atomic_load(&current));
+    }
+
+    Apply apply;
+    std::mutex writer;                    // 写者互斥，读者不使用
+    std::shared_ptr<const T> current;     // 当前版本，只通过 atomic_load/atomic_store 访问
+    std::shared_ptr<T> spare;             // 上一个版本，读者释放后复用为下一次写入的副本
+    std::vector<Change> backlog;          // spare 尚未补做的修改
+    std::atomic<size_t> copyCount{0};
+};
+
+#endif // SNAPSHOT_STORE_H
@@ -0,0 +1,123 @@
+#include "StringPool.h"
+
+#include <stdexcept>
+
+// FNV-1a 哈希
+uint64_t StringPool::hash(std::string_view value) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : value) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// 查找字符串，线性探测直到遇到空槽
+uint32_t StringPool::find(std::string_view value) const {
+    if (slots.empty()) {
+        return npos;
+    }
+    const size_t mask = slots.size() - 1;
+    for (size_t slot = size_t(hash(value)) & mask;; slot = (slot + 1) & mask) {
+        const uint32_t id = slots[slot];
+        if (id == npos) {
+            return npos;
+        }
+        if (view(id) == value) {
+            return id;
+        }
+    }
+}
+
+// 驻留字符串，负载超过 3/4 时扩容
+uint32_t StringPool::intern(std::string_view value) {
+    const uint32_t existing = find(value);
+    if (existing != npos) {
+        return existing;
+    }
+    if (entries.size() >= npos) {
+        throw std::length_error("字符串池的 ID 已用尽");
+    }
+    const Entry entry = append(value);
+    if ((entries.size() + 1) * 4 > slots.size() * 3) {
+        grow();
+    }
+
+    const uint32_t id = uint32_t(entries.size());
+    entries.push_back(entry);
+
+    const size_t mask = slots.size() - 1;
+    size_t slot = size_t(hash(value)) & mask;
+    while (slots[slot] != npos) {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = id;
+    return id;
+}
+
+// 修改字符串：从寻址表中删除旧位置（后移删除，保持探测链连续），追加新内容后重新放置。
+// 旧内容留在 arena 中不回收，重命名很少发生
+void StringPool::rename(uint32_t id, std::string_view value) {
+    const Entry entry = append(value);
+    const size_t mask = slots.size() - 1;
+    size_t hole = size_t(hash(view(id))) & mask;
+    while (slots[hole] != id) {
+        hole = (hole + 1) & mask;
+    }
+    for (size_t next = (hole + 1) & mask; slots[next] != npos; next = (next + 1) & mask) {
+        const size_t home = size_t(hash(view(slots[next]))) & mask;
+        // next 的理想位置不在 (hole, next] 区间内时，可以前移填补空洞
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            slots[hole] = slots[next];
+            hole = next;
+        }
+    }
+    slots[hole] = npos;
+
+    entries[id] = entry;
+    size_t slot = size_t(hash(value)) & mask;
+    while (slots[slot] != npos) {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = id;
+}
+
+// 位置与长度以 uint32 记录，先检查再追加，超出上限时池保持不变
+StringPool::Entry StringPool::append(std::string_view value) {
+    if (value.size() > MaxArenaBytes - arena.size()) {
+        throw std::length_error("字符串池的字符数据超过 4 GiB");
+    }
+    const Entry entry{uint32_t(arena.size()), uint32_t(value.size())};
+    arena.append(value.data(), value.size());
+    return entry;
+}
+
+std::string_view StringPool::view(uint32_t id) const {
+    const Entry& entry = entries[id];
+    return std::string_view(arena.data() + entry.offset, entry.length);
+}
+
+void StringPool::clear() {
+    arena.clear();
+    entries.clear();
+    slots.clear();
+}
+
+// 扩容并重新放置所有 ID
+void StringPool::grow() {
+    const size_t capacity = slots.empty() ? 16 : slots.size() * 2;
+    slots.assign(capacity, npos);
+    const size_t mask = capacity - 1;
+    for (uint32_t id = 0; id < entries.size(); ++id) {
+        size_t slot = size_t(hash(view(id))) & mask;
+        while (slots[slot] != npos) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id;
+    }
+}
+
+size_t StringPool::memoryUsage() const {
+    return sizeof(StringPool) + arena.capacity() + entries.capacity() * sizeof(Entry)
+           + slots.capacity() * sizeof(uint32_t);
+}
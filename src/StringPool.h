@@ -0,0 +1,50 @@
+/*
+ * StringPool.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 字符串驻留池。相同的字符串只存一份，以连续的 uint32 ID 引用；
+ *          字符数据放在同一块连续内存中，查找用开放寻址哈希表，每个字符串只额外占用十余字节；
+ *          位置以 uint32 记录，字符数据总量不超过 4 GiB，超出时 intern/rename 抛出 std::length_error
+ */
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class StringPool {
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    static constexpr size_t MaxArenaBytes = UINT32_MAX;  // 字符数据总量上限
+
+    uint32_t intern(std::string_view value);     // 返回字符串的 ID，不存在时分配新 ID
+    uint32_t find(std::string_view value) const; // 返回字符串的 ID，不存在时返回 npos
+    std::string_view view(uint32_t id) const;    // ID 对应的字符串，在下一次 intern 之前有效
+    void rename(uint32_t id, std::string_view value);  // 修改 ID 对应的字符串，value 不能已在池中
+    size_t size() const { return entries.size(); }
+    void clear();
+    size_t memoryUsage() const;                  // 估算占用字节数
+
+private:
+    struct Entry {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    static uint64_t hash(std::string_view value);
+    void grow();
+    Entry append(std::string_view value);  // 追加字符数据，超出上限时抛出 std::length_error，不修改池
+
+    std::string arena;             // 所有字符串首尾相接存放
+    std::vector<Entry> entries;    // ID -> 在 arena 中的位置
+    std::vector<uint32_t> slots;   // 开放寻址表，存放 ID，空槽为 npos；容量为 2 的幂
+};
+
+#endif // STRING_POOL_H
@@ -0,0 +1,355 @@
+#include "TagBitmap.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+inline uint16_t highBits(uint32_t value) {
+    return uint16_t(value >> 16);
+}
+
+inline uint16_t lowBits(uint32_t value) {
+    return uint16_t(value & 0xFFFF);
+}
+
+} // namespace
+
+// 查找某个高位桶
+TagBitmap::Container* TagBitmap::find(uint16_t key) {
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    return (it != containers.end() && it->key == key) ? &*it : nullptr;
+}
+
+const TagBitmap::Container* TagBitmap::find(uint16_t key) const {
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    return (it != containers.end() && it->key == key) ? &*it : nullptr;
+}
+
+// 数组桶转为位图桶
+void TagBitmap::toBitmap(Container& container) {
+    if (container.isBitmap()) {
+        return;
+    }
+    container.bits.assign(BitmapWords, 0);
+    for (uint16_t low : container.array) {
+        container.bits[low >> 6] |= uint64_t(1) << (low & 63);
+    }
+    container.array.clear();
+    container.array.shrink_to_fit();
+}
+
+// 位图桶元素不足时退回数组桶
+void TagBitmap::normalize(Container& container) {
+    if (!container.isBitmap() || container.cardinality > ArrayLimit) {
+        return;
+    }
+    std::vector<uint16_t> array;
+    array.reserve(container.cardinality);
+    for (size_t word = 0; word < container.bits.size(); ++word) {
+        uint64_t bits = container.bits[word];
+        while (bits) {
+            array.push_back(uint16_t(word * 64 + countTrailingZeros(bits)));
+            bits &= bits - 1;
+        }
+    }
+    container.array = std::move(array);
+    container.bits.clear();
+    container.bits.shrink_to_fit();
+}
+
+// 添加元素
+bool TagBitmap::add(uint32_t value) {
+    const uint16_t key = highBits(value);
+    const uint16_t low = lowBits(value);
+
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    if (it == containers.end() || it->key != key) {
+        Container container;
+        container.key = key;
+        container.cardinality = 1;
+        container.array.push_back(low);
+        containers.insert(it, std::move(container));
+        return true;
+    }
+
+    Container& container = *it;
+    if (container.isBitmap()) {
+        uint64_t& word = container.bits[low >> 6];
+        const uint64_t mask = uint64_t(1) << (low & 63);
+        if (word & mask) {
+            return false;
+        }
+        word |= mask;
+        ++container.cardinality;
+        return true;
+    }
+
+    auto pos = std::lower_bound(container.array.begin(), container.array.end(), low);
+    if (pos != container.array.end() && *pos == low) {
+        return false;
+    }
+    container.array.insert(pos, low);
+    ++container.cardinality;
+    if (container.cardinality > ArrayLimit) {
+        toBitmap(container);
+    }
+    return true;
+}
+
+// 删除元素
+bool TagBitmap::remove(uint32_t value) {
+    const uint16_t key = highBits(value);
+    const uint16_t low = lowBits(value);
+
+    auto it = std::lower_bound(containers.begin(), containers.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    if (it == containers.end() || it->key != key) {
+        return false;
+    }
+
+    Container& container = *it;
+    if (container.isBitmap()) {
+        uint64_t& word = container.bits[low >> 6];
+        const uint64_t mask = uint64_t(1) << (low & 63);
+        if (!(word & mask)) {
+            return false;
+        }
+        word &= ~mask;
+        --container.cardinality;
+        normalize(container);
+    } else {
+        auto pos = std::lower_bound(container.array.begin(), container.array.end(), low);
+        if (pos == container.array.end() || *pos != low) {
+            return false;
+        }
+        container.array.erase(pos);
+        --container.cardinality;
+    }
+
+    if (container.cardinality == 0) {
+        containers.erase(it);
+    }
+    return true;
+}
+
+// 是否包含元素
+bool TagBitmap::contains(uint32_t value) const {
+    const Container* container = find(highBits(value));
+    if (!container) {
+        return false;
+    }
+    const uint16_t low = lowBits(value);
+    if (container->isBitmap()) {
+        return (container->bits[low >> 6] >> (low & 63)) & 1;
+    }
+    return std::binary_search(container->array.begin(), container->array.end(), low);
+}
+
+// 元素个数，只累加每个桶的计数，不展开元素
+uint64_t TagBitmap::cardinality() const {
+    uint64_t total = 0;
+    for (const auto& container : containers) {
+        total += container.cardinality;
+    }
+    return total;
+}
+
+bool TagBitmap::empty() const {
+    return containers.empty();
+}
+
+void TagBitmap::clear() {
+    containers.clear();
+}
+
+// 两个桶求交集
+TagBitmap::Container TagBitmap::intersect(const Container& a, const Container& b) {
+    Container result;
+    result.key = a.key;
+
+    if (a.isBitmap() && b.isBitmap()) {
+        result.bits.resize(BitmapWords);
+        uint32_t count = 0;
+        for (size_t i = 0; i < BitmapWords; ++i) {
+            result.bits[i] = a.bits[i] & b.bits[i];
+            count += uint32_t(popCount(result.bits[i]));
+        }
+        result.cardinality = count;
+        normalize(result);
+        return result;
+    }
+
+    if (a.isBitmap() || b.isBitmap()) {
+        const Container& array = a.isBitmap() ? b : a;
+        const Container& bitmap = a.isBitmap() ? a : b;
+        for (uint16_t low : array.array) {
+            if ((bitmap.bits[low >> 6] >> (low & 63)) & 1) {
+                result.array.push_back(low);
+            }
+        }
+    } else {
+        std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                              std::back_inserter(result.array));
+    }
+    result.cardinality = uint32_t(result.array.size());
+    return result;
+}
+
+// 两个桶求并集
+TagBitmap::Container TagBitmap::unite(const Container& a, const Container& b) {
+    Container result;
+    result.key = a.key;
+
+    if (!a.isBitmap() && !b.isBitmap() && a.cardinality + b.cardinality <= ArrayLimit) {
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                       std::back_inserter(result.array));
+        result.cardinality = uint32_t(result.array.size());
+        return result;
+    }
+
+    result = a;
+    toBitmap(result);
+    if (b.isBitmap()) {
+        for (size_t i = 0; i < BitmapWords; ++i) {
+            result.bits[i] |= b.bits[i];
+        }
+    } else {
+        for (uint16_t low : b.array) {
+            result.bits[low >> 6] |= uint64_t(1) << (low & 63);
+        }
+    }
+    uint32_t count = 0;
+    for (uint64_t word : result.bits) {
+        count += uint32_t(popCount(word));
+    }
+    result.cardinality = count;
+    normalize(result);
+    return result;
+}
+
+// 两个桶求差集 a - b
+TagBitmap::Container TagBitmap::subtract(const Container& a, const Container& b) {
+    Container result;
+    result.key = a.key;
+
+    if (a.isBitmap()) {
+        result = a;
+        if (b.isBitmap()) {
+            for (size_t i = 0; i < BitmapWords; ++i) {
+                result.bits[i] &= ~b.bits[i];
+            }
+        } else {
+            for (uint16_t low : b.array) {
+                result.bits[low >> 6] &= ~(uint64_t(1) << (low & 63));
+            }
+        }
+        uint32_t count = 0;
+        for (uint64_t word : result.bits) {
+            count += uint32_t(popCount(word));
+        }
+        result.cardinality = count;
+        normalize(result);
+        return result;
+    }
+
+    if (b.isBitmap()) {
+        for (uint16_t low : a.array) {
+            if (!((b.bits[low >> 6] >> (low & 63)) & 1)) {
+                result.array.push_back(low);
+            }
+        }
+    } else {
+        std::set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                            std::back_inserter(result.array));
+    }
+    result.cardinality = uint32_t(result.array.size());
+    return result;
+}
+
+// 交集，只有两侧都存在的桶才需要计算
+TagBitmap& TagBitmap::operator&=(const TagBitmap& other) {
+    std::vector<Container> result;
+    auto left = containers.begin();
+    auto right = other.containers.begin();
+    while (left != containers.end() && right != other.containers.end()) {
+        if (left->key < right->key) {
+            ++left;
+        } else if (right->key < left->key) {
+            ++right;
+        } else {
+            Container merged = intersect(*left, *right);
+            if (merged.cardinality > 0) {
+                result.push_back(std::move(merged));
+            }
+            ++left;
+            ++right;
+        }
+    }
+    containers = std::move(result);
+    return *this;
+}
+
+// 并集
+TagBitmap& TagBitmap::operator|=(const TagBitmap& other) {
+    std::vector<Container> result;
+    result.reserve(containers.size() + other.containers.size());
+    auto left = containers.begin();
+    auto right = other.containers.begin();
+    while (left != containers.end() || right != other.containers.end()) {
+        if (right == other.containers.end() || (left != containers.end() && left->key < right->key)) {
+            result.push_back(std::move(*left));
+            ++left;
+        } else if (left == containers.end() || right->key < left->key) {
+            result.push_back(*right);
+            ++right;
+        } else {
+            result.push_back(unite(*left, *right));
+            ++left;
+            ++right;
+        }
+    }
+    containers = std::move(result);
+    return *this;
+}
+
+// 差集
+TagBitmap& TagBitmap::operator-=(const TagBitmap& other) {
+    std::vector<Container> result;
+    result.reserve(containers.size());
+    auto right = other.containers.begin();
+    for (auto& container : containers) {
+        while (right != other.containers.end() && right->key < container.key) {
+            ++right;
+        }
+        if (right != other.containers.end() && right->key == container.key) {
+            Container remaining = subtract(container, *right);
+            if (remaining.cardinality > 0) {
+                result.push_back(std::move(remaining));
+            }
+        } else {
+            result.push_back(std::move(container));
+        }
+    }
+    containers = std::move(result);
+    return *this;
+}
+
+// 按升序展开为 ID 列表
+std::vector<uint32_t> TagBitmap::toVector() const {
+    std::vector<uint32_t> values;
+    values.reserve(size_t(cardinality()));
+    forEach([&values](uint32_t value) { values.push_back(value); });
+    return values;
+}
+
+// 估算占用字节数
+size_t TagBitmap::memoryUsage() const {
+    size_t bytes = sizeof(TagBitmap) + containers.capacity() * sizeof(Container);
+    for (const auto& container : containers) {
+        bytes += container.array.capacity() * sizeof(uint16_t) + container.bits.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
@@ -0,0 +1,104 @@
+/*
+ * TagBitmap.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 压缩位图（Roaring 风格），用于标签倒排表
+ */
+
+#ifndef TAG_BITMAP_H
+#define TAG_BITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// 以 ID 高 16 位分桶，桶内元素不超过 4096 个时用有序 uint16 数组，超过时用 65536 位的位图
+class TagBitmap {
+public:
+    bool add(uint32_t value);            // 添加元素，返回是否新增
+    bool remove(uint32_t value);         // 删除元素，返回是否存在
+    bool contains(uint32_t value) const; // 是否包含元素
+    uint64_t cardinality() const;        // 元素个数
+    bool empty() const;
+    void clear();
+
+    TagBitmap& operator&=(const TagBitmap& other);  // 交集
+    TagBitmap& operator|=(const TagBitmap& other);  // 并集
+    TagBitmap& operator-=(const TagBitmap& other);  // 差集
+
+    std::vector<uint32_t> toVector() const;  // 按升序展开
+    size_t memoryUsage() const;              // 估算占用字节数
+
+    template <typename Func>
+    void forEach(Func func) const {
+        for (const auto& container : containers) {
+            const uint32_t high = uint32_t(container.key) << 16;
+            if (container.isBitmap()) {
+                for (size_t word = 0; word < container.bits.size(); ++word) {
+                    uint64_t bits = container.bits[word];
+                    while (bits) {
+                        const int bit = countTrailingZeros(bits);
+                        func(high | uint32_t(word * 64 + bit));
+                        bits &= bits - 1;
+                    }
+                }
+            } else {
+                for (uint16_t low : container.array) {
+                    func(high | low);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr size_t ArrayLimit = 4096;
+    static constexpr size_t BitmapWords = 1024;
+
+    struct Container {
+        uint16_t key = 0;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> array;  // 稀疏时使用
+        std::vector<uint64_t> bits;   // 稠密时使用
+
+        bool isBitmap() const { return !bits.empty(); }
+    };
+
+    static int countTrailingZeros(uint64_t value);
+    static int popCount(uint64_t value);
+    static void toBitmap(Container& container);
+    static void normalize(Container& container);  // 位图元素不足时退回数组
+    static Container intersect(const Container& a, const Container& b);
+    static Container unite(const Container& a, const Container& b);
+    static Container subtract(const Container& a, const Container& b);
+
+    Container* find(uint16_t key);
+    const Container* find(uint16_t key) const;
+
+    std::vector<Container> containers;  // 按 key 升序
+};
+
+inline int TagBitmap::countTrailingZeros(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return int(index);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+inline int TagBitmap::popCount(uint64_t value) {
+#ifdef _MSC_VER
+    return int(__popcnt64(value));
+#else
+    return __builtin_popcountll(value);
+#endif
+}
+
+#endif // TAG_BITMAP_H
@@ -0,0 +1,603 @@
+/*
+ * TagDatabase.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 标签数据库实现
+ */
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QDebug>
+
+#include "TagDatabase.h"
+#include "Logger.h"
+
+namespace {
+const int SchemaVersion = 3;  // 2: 增加 file_identity 表；3: 增加 meta 表
+}
+
+TagDatabase::TagDatabase(const QString &dbName, const QString &connectionName)
+    : AbstractDatabase(dbName), connectionName(connectionName), inTransaction(false) {}
+
+TagDatabase::~TagDatabase() {
+    closeDatabase();
+}
+
+// 打开数据库连接并创建表
+bool TagDatabase::openDatabase() {
+    if (QSqlDatabase::contains(connectionName)) {
+        db = QSqlDatabase::database(connectionName);
+    } else {
+        db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(databaseName);
+    }
+
+    if (!db.open()) {
+        QString errorMessage = QString("无法打开标签数据库: %1").arg(db.lastError().text());
+        qDebug() << errorMessage;
+        LOG_ERROR(errorMessage);
+        return false;
+    }
+
+    // WAL 模式下每次小事务只追加日志页，不必重写整个数据库文件
+    QSqlQuery query(db);
+    query.exec("PRAGMA journal_mode=WAL");
+    query.exec("PRAGMA synchronous=NORMAL");
+
+    LOG_INFO("标签数据库连接成功：" + databaseName);
+    return createTables();
+}
+
+void TagDatabase::closeDatabase() {
+    if (db.isOpen()) {
+        db.close();
+        LOG_INFO("标签数据库连接已关闭。");
+    }
+    db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(connectionName);
+    tagIds.clear();
+}
+
+bool TagDatabase::createTables() {
+    if (!db.isOpen()) {
+        LOG_ERROR("标签数据库未打开，无法创建表。");
+        return false;
+    }
+
+    QSqlQuery query(db);
+
+    QString sqlCreateTags = R"(
+        CREATE TABLE IF NOT EXISTS tags (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            name TEXT NOT NULL UNIQUE
+        )
+    )";
+    if (!query.exec(sqlCreateTags)) {
+        QString errorMessage = QString("创建 tags 表失败: %1").arg(query.lastError().text());
+        qDebug() << errorMessage;
+        LOG_ERROR(errorMessage);
+        return false;
+    }
+
+    // 主键 (file_path, tag_id) 即文件侧索引，另建 tag_id 索引供按标签查找
+    QString sqlCreateFileTags = R"(
+        CREATE TABLE IF NOT EXISTS file_tags (
+            file_path TEXT NOT NULL,
+            tag_id INTEGER NOT NULL,
+            PRIMARY KEY (file_path, tag_id),
+            FOREIGN KEY (tag_id) REFERENCES tags(id)
+        ) WITHOUT ROWID
+    )";
+    if (!query.exec(sqlCreateFileTags)) {
+        QString errorMessage = QString("创建 file_tags 表失败: %1").arg(query.lastError().text());
+        qDebug() << errorMessage;
+        LOG_ERROR(errorMessage);
+        return false;
+    }
+
+    if (!query.exec("CREATE INDEX IF NOT EXISTS idx_file_tags_tag ON file_tags (tag_id)")) {
+        QString errorMessage = QString("创建 file_tags 索引失败: %1").arg(query.lastError().text());
+        qDebug() << errorMessage;
+        LOG_ERROR(errorMessage);
+        return false;
+    }
+
+    // 版本 1 的数据库没有该表，这里直接补建，旧文件的标识在整理标签路径时补记
+    QString sqlCreateIdentity = R"(
+        CREATE TABLE IF NOT EXISTS file_identity (
+            file_path TEXT PRIMARY KEY,
+            device INTEGER NOT NULL,
+            inode INTEGER NOT NULL
+        ) WITHOUT ROWID
+    )";
+    if (!query.exec(sqlCreateIdentity)
+        || !query.exec("CREATE INDEX IF NOT EXISTS idx_file_identity ON file_identity (device, inode)")) {
+        QString errorMessage = QString("创建 file_identity 表失败: %1").arg(query.lastError().text());
+        qDebug() << errorMessage;
+        LOG_ERROR(errorMessage);
+        return false;
+    }
+
+    // meta 表记录已合并的日志序号，检查点提交后、删除封存日志前崩溃时据此跳过已合并的日志
+    QString sqlCreateMeta = R"(
+        CREATE TABLE IF NOT EXISTS meta (
+            key TEXT PRIMARY KEY,
+            value INTEGER
+        )
+    )";
+    if (!query.exec(sqlCreateMeta)
+        || !query.exec("INSERT OR IGNORE INTO meta (key, value) VALUES ('journal_sequence', 0)")) {
+        QString errorMessage = QString("创建 meta 表失败: %1").arg(query.lastError().text());
+        qDebug() << errorMessage;
+        LOG_ERROR(errorMessage);
+        return false;
+    }
+
+    query.exec(QString("PRAGMA user_version = %1").arg(SchemaVersion));
+    return true;
+}
+
+bool TagDatabase::beginTransaction() {
+    if (!db.transaction()) {
+        LOG_ERROR("开启标签事务失败: " + db.lastError().text());
+        return false;
+    }
+    inTransaction = true;
+    return true;
+}
+
+bool TagDatabase::commitTransaction() {
+    inTransaction = false;
+    if (!db.commit()) {
+        LOG_ERROR("提交标签事务失败: " + db.lastError().text());
+        db.rollback();
+        tagIds.clear();
+        return false;
+    }
+    return true;
+}
+
+void TagDatabase::rollbackTransaction() {
+    inTransaction = false;
+    db.rollback();
+    // 回滚可能撤销了新建的标签，缓存的ID不再可靠
+    tagIds.clear();
+}
+
+/*
+ * Summary: 执行一次修改。调用方已开启事务时直接执行，否则包在一个小事务中
+ * Parameters:
+ * const std::function<bool()> &body - 修改操作
+ * Return: bool - 是否成功
+ */
+bool TagDatabase::runInTransaction(const std::function<bool()> &body) {
+    if (inTransaction) {
+        return body();
+    }
+    if (!beginTransaction()) {
+        return false;
+    }
+    if (!body()) {
+        rollbackTransaction();
+        return false;
+    }
+    return commitTransaction();
+}
+
+/*
+ * Summary: 查询标签ID，不存在时按需创建
+ * Parameters:
+ * const QString &tag - 标签名
+ * bool create - 不存在时是否创建
+ * Return: int - 标签ID，失败或不存在时返回 -1
+ */
+int TagDatabase::tagId(const QString &tag, bool create) {
+    auto cached = tagIds.constFind(tag);
+    if (cached != tagIds.constEnd()) {
+        return cached.value();
+    }
+
+    QSqlQuery query(db);
+    if (create) {
+        query.prepare("INSERT OR IGNORE INTO tags (name) VALUES (?)");
+        query.addBindValue(tag);
+        if (!query.exec()) {
+            LOG_ERROR(QString("创建标签失败: %1, 错误信息: %2").arg(tag, query.lastError().text()));
+            return -1;
+        }
+    }
+
+    query.prepare("SELECT id FROM tags WHERE name = ?");
+    query.addBindValue(tag);
+    if (query.exec() && query.next()) {
+        const int id = query.value(0).toInt();
+        tagIds.insert(tag, id);
+        return id;
+    }
+    return -1;
+}
+
+bool TagDatabase::addFileTag(const QString &filePath, const QString &tag) {
+    if (!db.isOpen()) {
+        LOG_ERROR("标签数据库未打开，无法添加标签。");
+        return false;
+    }
+
+    return runInTransaction([&]() {
+        const int id = tagId(tag, true);
+        if (id < 0) {
+            return false;
+        }
+        QSqlQuery query(db);
+        query.prepare("INSERT OR IGNORE INTO file_tags (file_path, tag_id) VALUES (?, ?)");
+        query.addBindValue(filePath);
+        query.addBindValue(id);
+        if (!query.exec()) {
+            LOG_ERROR(QString("添加标签失败，文件: %1, 标签: %2, 错误信息: %3")
+                              .arg(filePath, tag, query.lastError().text()));
+            return false;
+        }
+        return true;
+    });
+}
+
+bool TagDatabase::removeFileTag(const QString &filePath, const QString &tag) {
+    if (!db.isOpen()) {
+        LOG_ERROR("标签数据库未打开，无法删除标签。");
+        return false;
+    }
+
+    const int id = tagId(tag, false);
+    if (id < 0) {
+        return true;  // 标签不存在，无需删除
+    }
+
+    return runInTransaction([&]() {
+        QSqlQuery query(db);
+        query.prepare("DELETE FROM file_tags WHERE file_path = ? AND tag_id = ?");
+        query.addBindValue(filePath);
+        query.addBindValue(id);
+        if (!query.exec()) {
+            LOG_ERROR(QString("删除标签失败，文件: %1, 标签: %2, 错误信息: %3")
+                              .arg(filePath, tag, query.lastError().text()));
+            return false;
+        }
+        return true;
+    });
+}
+
+bool TagDatabase::updateFileTag(const QString &filePath, const QString &oldTag, const QString &newTag) {
+    if (!db.isOpen()) {
+        LOG_ERROR("标签数据库未打开，无法更新标签。");
+        return false;
+    }
+
+    return runInTransaction([&]() {
+        const int oldId = tagId(oldTag, false);
+        const int newId = tagId(newTag, true);
+        if (newId < 0) {
+            return false;
+        }
+
+        QSqlQuery query(db);
+        query.prepare("INSERT OR IGNORE INTO file_tags (file_path, tag_id) VALUES (?, ?)");
+        query.addBindValue(filePath);
+        query.addBindValue(newId);
+        if (!query.exec()) {
+            LOG_ERROR(QString("更新标签失败，文件: %1, 错误信息: %2").arg(filePath, query.lastError().text()));
+            return false;
+        }
+
+        if (oldId >= 0 && oldId != newId) {
+            query.prepare("DELETE FROM file_tags WHERE file_path = ? AND tag_id = ?");
+            query.addBindValue(filePath);
+            query.addBindValue(oldId);
+            if (!query.exec()) {
+                LOG_ERROR(QString("更新标签失败，文件: %1, 错误信息: %2").arg(filePath, query.lastError().text()));
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+/*
+ * Summary: 全局重命名标签。新标签不存在时只改 tags 表中的一行；已存在时把旧标签的文件并入新标签
+ * Parameters:
+ * const QString &oldTag - 旧标签
+ * const QString &newTag - 新标签
+ * Return: bool - 是否成功
+ */
+bool TagDatabase::renameTag(const QString &oldTag, const QString &newTag) {
+    if (!db.isOpen()) {
+        LOG_ERROR("标签数据库未打开，无法重命名标签。");
+        return false;
+    }
+
+    const int oldId = tagId(oldTag, false);
+    if (oldId < 0 || oldTag == newTag) {
+        return true;
+    }
+
+    return runInTransaction([&]() {
+        QSqlQuery query(db);
+        const int newId = tagId(newTag, false);
+        if (newId < 0) {
+            query.prepare("UPDATE tags SET name = ? WHERE id = ?");
+            query.addBindValue(newTag);
+            query.addBindValue(oldId);
+            if (!query.exec()) {
+                LOG_ERROR(QString("重命名标签失败: %1 -> %2, 错误信息: %3").arg(oldTag, newTag, query.lastError().text()));
+                return false;
+            }
+            tagIds.remove(oldTag);
+            tagIds.insert(newTag, oldId);
+            return true;
+        }
+
+        query.prepare("INSERT OR IGNORE INTO file_tags (file_path, tag_id) SELECT file_path, ? FROM file_tags WHERE tag_id = ?");
+        query.addBindValue(newId);
+        query.addBindValue(oldId);
+        if (!query.exec()) {
+            LOG_ERROR(QString("合并标签失败: %1 -> %2, 错误信息: %3").arg(oldTag, newTag, query.lastError().text()));
+            return false;
+        }
+        return deleteTagRows(oldTag, oldId);
+    });
+}
+
+bool TagDatabase::deleteTag(const QString &tag) {
+    if (!db.isOpen()) {
+        LOG_ERROR("标签数据库未打开，无法删除标签。");
+        return false;
+    }
+
+    const int id = tagId(tag, false);
+    if (id < 0) {
+        return true;  // 标签不存在，无需删除
+    }
+
+    return runInTransaction([&]() {
+        return deleteTagRows(tag, id);
+    });
+}
+
+// 删除标签的全部文件记录及标签本身
+bool TagDatabase::deleteTagRows(const QString &tag, int id) {
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM file_tags WHERE tag_id = ?");
+    query.addBindValue(id);
+    if (!query.exec()) {
+        LOG_ERROR(QString("删除标签失败: %1, 错误信息: %2").arg(tag, query.lastError().text()));
+        return false;
+    }
+    query.prepare("DELETE FROM tags WHERE id = ?");
+    query.addBindValue(id);
+    if (!query.exec()) {
+        LOG_ERROR(QString("删除标签失败: %1, 错误信息: %2").arg(tag, query.lastError().text()));
+        return false;
+    }
+    tagIds.remove(tag);
+    return true;
+}
+
+/*
+ * Summary: 记录文件的 (设备号, inode)
+ * Parameters:
+ * const QString &filePath - 文件路径
+ * const FileIdentity &identity - 文件标识
+ * Return: bool - 是否成功
+ */
+bool TagDatabase::setFileIdentity(const QString &filePath, const FileIdentity &identity) {
+    if (!db.isOpen()) {
+        LOG_ERROR("标签数据库未打开，无法记录文件标识。");
+        return false;
+    }
+
+    return runInTransaction([&]() {
+        QSqlQuery query(db);
+        // inode 被复用时以新记录为准，与内存索引一致
+        query.prepare("DELETE FROM file_identity WHERE device = ? AND inode = ? AND file_path <> ?");
+        query.addBindValue(qint64(identity.device));  // SQLite 整数为有符号 64 位，按位保存
+        query.addBindValue(qint64(identity.inode));
+        query.addBindValue(filePath);
+        if (!query.exec()) {
+            LOG_ERROR(QString("记录文件标识失败，文件: %1, 错误信息: %2").arg(filePath, query.lastError().text()));
+            return false;
+        }
+        query.prepare("INSERT OR REPLACE INTO file_identity (file_path, device, inode) VALUES (?, ?, ?)");
+        query.addBindValue(filePath);
+        query.addBindValue(qint64(identity.device));
+        query.addBindValue(qint64(identity.inode));
+        if (!query.exec()) {
+            LOG_ERROR(QString("记录文件标识失败，文件: %1, 错误信息: %2").arg(filePath, query.lastError().text()));
+            return false;
+        }
+        return true;
+    });
+}
+
+/*
+ * Summary: 文件移动。目标路径原有的标签与标识被覆盖，再把旧路径的记录改到新路径
+ * Parameters:
+ * const QString &oldPath - 旧路径
+ * const QString &newPath - 新路径
+ * Return: bool - 是否成功
+ */
+bool TagDatabase::moveFile(const QString &oldPath, const QString &newPath) {
+    if (!db.isOpen()) {
+        LOG_ERROR("标签数据库未打开，无法移动文件记录。");
+        return false;
+    }
+
+    return runInTransaction([&]() {
+        QSqlQuery query(db);
+        for (const char *table : { "file_tags", "file_identity" }) {
+            query.prepare(QString("DELETE FROM %1 WHERE file_path = ?").arg(table));
+            query.addBindValue(newPath);
+            bool ok = query.exec();
+            if (ok) {
+                query.prepare(QString("UPDATE %1 SET file_path = ? WHERE file_path = ?").arg(table));
+                query.addBindValue(newPath);
+                query.addBindValue(oldPath);
+                ok = query.exec();
+            }
+            if (!ok) {
+                LOG_ERROR(QString("移动文件记录失败: %1 -> %2, 错误信息: %3").arg(oldPath, newPath, query.lastError().text()));
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+/*
+ * Summary: 目录移动。按主键范围找出前缀下的记录，替换前缀；新路径上已有的文件记录被覆盖
+ * Parameters:
+ * const QString &oldPrefix - 旧目录，含末尾分隔符
+ * const QString &newPrefix - 新目录，含末尾分隔符
+ * Return: bool - 是否成功
+ */
+bool TagDatabase::moveDirectory(const QString &oldPrefix, const QString &newPrefix) {
+    if (!db.isOpen()) {
+        LOG_ERROR("标签数据库未打开，无法移动目录记录。");
+        return false;
+    }
+    if (oldPrefix.isEmpty() || oldPrefix == newPrefix) {
+        return true;
+    }
+
+    // 前缀以分隔符结尾，把分隔符加一得到范围上界，范围查询可走主键索引
+    auto upperBound = [](QString prefix) {
+        prefix[prefix.size() - 1] = QChar(prefix.back().unicode() + 1);
+        return prefix;
+    };
+    const QString oldUpper = upperBound(oldPrefix);
+    const QString newUpper = upperBound(newPrefix);
+
+    return runInTransaction([&]() {
+        QSqlQuery query(db);
+        // 先删除会被覆盖的目标文件的全部记录，与内存索引中覆盖目标文件的语义一致
+        for (const char *table : { "file_tags", "file_identity" }) {
+            query.prepare(QString("DELETE FROM %1 WHERE file_path >= ? AND file_path < ? "
+                                  "AND ? || substr(file_path, length(?) + 1) IN ("
+                                  "SELECT file_path FROM file_tags WHERE file_path >= ? AND file_path < ? "
+                                  "UNION SELECT file_path FROM file_identity WHERE file_path >= ? AND file_path < ?)").arg(table));
+            for (const QString &value : { newPrefix, newUpper, oldPrefix, newPrefix, oldPrefix, oldUpper, oldPrefix, oldUpper }) {
+                query.addBindValue(value);
+            }
+            if (!query.exec()) {
+                LOG_ERROR(QString("移动目录记录失败: %1 -> %2, 错误信息: %3").arg(oldPrefix, newPrefix, query.lastError().text()));
+                return false;
+            }
+        }
+        for (const char *table : { "file_tags", "file_identity" }) {
+            query.prepare(QString("UPDATE %1 SET file_path = ? || substr(file_path, length(?) + 1) "
+                                  "WHERE file_path >= ? AND file_path < ?").arg(table));
+            for (const QString &value : { newPrefix, oldPrefix, oldPrefix, oldUpper }) {
+                query.addBindValue(value);
+            }
+            if (!query.exec()) {
+                LOG_ERROR(QString("移动目录记录失败: %1 -> %2, 错误信息: %3").arg(oldPrefix, newPrefix, query.lastError().text()));
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+/*
+ * Summary: 从 meta 表读取已合并进数据库的最后一个标签日志序号
+ * Parameters:
+ * quint64 &sequence - 读取到的序号
+ * Return: bool - 是否成功
+ */
+bool TagDatabase::loadJournalSequence(quint64 &sequence) {
+    QSqlQuery query(db);
+    if (!query.exec("SELECT value FROM meta WHERE key = 'journal_sequence'") || !query.next()) {
+        LOG_ERROR(QString("读取标签日志序号失败: %1").arg(query.lastError().text()));
+        return false;
+    }
+    sequence = query.value(0).toULongLong();
+    return true;
+}
+
+/*
+ * Summary: 记录已合并的日志序号。与封存日志的内容在同一事务中提交，二者要么都生效要么都不生效
+ * Parameters:
+ * quint64 sequence - 日志序号
+ * Return: bool - 是否成功
+ */
+bool TagDatabase::setJournalSequence(quint64 sequence) {
+    return runInTransaction([&]() {
+        QSqlQuery query(db);
+        query.prepare("UPDATE meta SET value = ? WHERE key = 'journal_sequence'");
+        query.addBindValue(qint64(sequence));
+        if (!query.exec()) {
+            LOG_ERROR(QString("记录标签日志序号失败: %1").arg(query.lastError().text()));
+            return false;
+        }
+        return true;
+    });
+}
+
+bool TagDatabase::isEmpty() {
+    QSqlQuery query(db);
+    if (query.exec("SELECT 1 FROM file_tags LIMIT 1")) {
+        return !query.next();
+    }
+    return true;
+}
+
+/*
+ * Summary: 读取全部标签记录，用于启动时构建内存中的标签表
+ * Parameters: 无
+ * Return: QVector<QPair<QString, QString>> - (文件路径, 标签) 列表
+ */
+QVector<QPair<QString, QString>> TagDatabase::loadFileTags() {
+    QVector<QPair<QString, QString>> rows;
+    if (!db.isOpen()) {
+        LOG_ERROR("标签数据库未打开，无法读取标签。");
+        return rows;
+    }
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT f.file_path, t.name FROM file_tags f JOIN tags t ON t.id = f.tag_id")) {
+        QString errorMessage = QString("读取标签失败: %1").arg(query.lastError().text());
+        qDebug() << errorMessage;
+        LOG_ERROR(errorMessage);
+        return rows;
+    }
+
+    while (query.next()) {
+        rows.append({ query.value(0).toString(), query.value(1).toString() });
+    }
+    return rows;
+}
+
+// 读取全部文件标识
+QVector<QPair<QString, FileIdentity>> TagDatabase::loadFileIdentities() {
+    QVector<QPair<QString, FileIdentity>> rows;
+    if (!db.isOpen()) {
+        LOG_ERROR("标签数据库未打开，无法读取文件标识。");
+        return rows;
+    }
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT file_path, device, inode FROM file_identity")) {
+        LOG_ERROR(QString("读取文件标识失败: %1").arg(query.lastError().text()));
+        return rows;
+    }
+    while (query.next()) {
+        FileIdentity identity;
+        identity.device = quint64(query.value(1).toLongLong());
+        identity.inode = quint64(query.value(2).toLongLong());
+        rows.append({ query.value(0).toString(), identity });
+    }
+    return rows;
+}
@@ -0,0 +1,63 @@
+/*
+ * TagDatabase.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 标签数据库，tags/file_tags 两张表，标签与文件两侧均有索引；file_identity 表记录文件的 (设备号, inode)，
+ *          meta 表记录已合并进数据库的最后一个标签日志序号
+ */
+
+#ifndef TAGDATABASE_H
+#define TAGDATABASE_H
+
+#include <QString>
+#include <QSqlDatabase>
+#include <QVector>
+#include <QPair>
+#include <QHash>
+#include <functional>
+
+#include "AbstractDatabase.h"
+#include "FileIdentity.h"
+
+class TagDatabase : public AbstractDatabase {
+public:
+    explicit TagDatabase(const QString &dbName, const QString &connectionName = "tag_db_connection");
+    ~TagDatabase() override;
+
+    bool openDatabase() override;      // 打开数据库
+    void closeDatabase() override;     // 关闭数据库
+    bool createTables() override;      // 创建表，返回是否成功
+
+    bool beginTransaction();           // 开始事务，之后的修改合并提交
+    bool commitTransaction();          // 提交事务
+    void rollbackTransaction();        // 回滚事务
+
+    bool addFileTag(const QString &filePath, const QString &tag);                              // 为文件添加标签
+    bool removeFileTag(const QString &filePath, const QString &tag);                           // 删除文件的标签
+    bool updateFileTag(const QString &filePath, const QString &oldTag, const QString &newTag); // 替换文件的标签
+    bool renameTag(const QString &oldTag, const QString &newTag);   // 全局重命名标签，新标签已存在时合并
+    bool deleteTag(const QString &tag);                             // 从所有文件删除标签
+    bool setFileIdentity(const QString &filePath, const FileIdentity &identity);  // 记录文件标识
+    bool moveFile(const QString &oldPath, const QString &newPath);                // 文件移动，目标路径原有记录被覆盖
+    bool moveDirectory(const QString &oldPrefix, const QString &newPrefix);       // 目录移动，前缀均含末尾分隔符
+    bool loadJournalSequence(quint64 &sequence);  // 读取已合并的最后一个日志序号
+    bool setJournalSequence(quint64 sequence);    // 记录已合并的日志序号，须与日志内容在同一事务中写入
+
+    bool isEmpty();                                    // 是否没有任何标签记录
+    QVector<QPair<QString, QString>> loadFileTags();   // 读取全部 (文件, 标签) 记录
+    QVector<QPair<QString, FileIdentity>> loadFileIdentities();  // 读取全部 (文件, 标识) 记录
+
+private:
+    int tagId(const QString &tag, bool create);                 // 查询或创建标签ID
+    bool deleteTagRows(const QString &tag, int id);             // 删除标签的全部文件记录及标签本身
+    bool runInTransaction(const std::function<bool()> &body);   // 未处于事务中时为单次修改开启小事务
+
+    QSqlDatabase db;              // 数据库连接对象
+    QString connectionName;       // 连接名
+    QHash<QString, int> tagIds;   // 标签名到ID的缓存
+    bool inTransaction;           // 是否处于调用方开启的事务中
+};
+
+#endif // TAGDATABASE_H
@@ -0,0 +1,461 @@
+#include "TagIndex.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <utility>
+
+TagIdList::TagIdList(const TagIdList& other) : count(other.count), capacity(InlineCapacity) {
+    if (count > InlineCapacity) {
+        capacity = count;
+        heapIds = new uint32_t[capacity];
+    }
+    std::memcpy(data(), other.data(), count * sizeof(uint32_t));
+}
+
+TagIdList::TagIdList(TagIdList&& other) noexcept : count(other.count), capacity(other.capacity) {
+    if (other.isInline()) {
+        std::memcpy(inlineIds, other.inlineIds, sizeof(inlineIds));
+    } else {
+        heapIds = other.heapIds;
+        other.capacity = InlineCapacity;
+    }
+    other.count = 0;
+}
+
+TagIdList& TagIdList::operator=(TagIdList other) noexcept {
+    this->~TagIdList();
+    new (this) TagIdList(std::move(other));
+    return *this;
+}
+
+TagIdList::~TagIdList() {
+    if (!isInline()) {
+        delete[] heapIds;
+    }
+}
+
+bool TagIdList::contains(uint32_t id) const {
+    return std::find(begin(), end(), id) != end();
+}
+
+// 添加ID，内联空间用完后搬到堆上并按倍数扩容
+void TagIdList::push_back(uint32_t id) {
+    if (count == capacity) {
+        const uint32_t newCapacity = capacity * 2;
+        uint32_t* grown = new uint32_t[newCapacity];
+        std::memcpy(grown, data(), count * sizeof(uint32_t));
+        if (!isInline()) {
+            delete[] heapIds;
+        }
+        heapIds = grown;
+        capacity = newCapacity;
+    }
+    data()[count++] = id;
+}
+
+bool TagIdList::erase(uint32_t id) {
+    uint32_t* first = data();
+    uint32_t* last = first + count;
+    uint32_t* pos = std::find(first, last, id);
+    if (pos == last) {
+        return false;
+    }
+    std::memmove(pos, pos + 1, size_t(last - pos - 1) * sizeof(uint32_t));
+    --count;
+    return true;
+}
+
+// 将路径拆成目录（含末尾分隔符）与文件名，二者拼接即为原路径
+void TagIndex::splitPath(std::string_view filepath, std::string_view& directory, std::string_view& name) {
+    const size_t pos = filepath.find_last_of("/\\");
+    const size_t split = pos == std::string_view::npos ? 0 : pos + 1;
+    directory = filepath.substr(0, split);
+    name = filepath.substr(split);
+}
+
+size_t TagIndex::slotHash(uint32_t directory, uint32_t name) {
+    uint64_t key = (uint64_t(directory) << 32) | name;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return size_t(key);
+}
+
+size_t TagIndex::identityHash(const FileIdentity& identity) {
+    uint64_t key = identity.inode * 0x9e3779b97f4a7c15ull ^ identity.device;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return size_t(key);
+}
+
+// 查找文件ID
+uint32_t TagIndex::findFile(const std::string& filepath) const {
+    std::string_view directory, name;
+    splitPath(filepath, directory, name);
+    const uint32_t directoryId = directories.find(directory);
+    const uint32_t nameId = directoryId == npos ? npos : names.find(name);
+    if (nameId == npos) {
+        return npos;
+    }
+    return pathTable.find(slotHash(directoryId, nameId), [&](uint32_t id) {
+        return files[id].directory == directoryId && files[id].name == nameId;
+    });
+}
+
+// 获取或分配文件ID，ID 不回收，文件重新打标签时沿用原ID
+uint32_t TagIndex::fileId(const std::string& filepath) {
+    const uint32_t existing = findFile(filepath);
+    if (existing != npos) {
+        return existing;
+    }
+
+    std::string_view directory, name;
+    splitPath(filepath, directory, name);
+    const uint32_t id = uint32_t(files.size());
+    files.push_back({directories.intern(directory), names.intern(name), {}, {}});
+    pathTable.insert(id, pathHashOf(id), [this](uint32_t other) { return pathHashOf(other); });
+    return id;
+}
+
+uint32_t TagIndex::findIdentity(const FileIdentity& identity) const {
+    if (!identity.isValid()) {
+        return npos;
+    }
+    return identityTable.find(identityHash(identity), [&](uint32_t id) {
+        return files[id].identity == identity;
+    });
+}
+
+bool TagIndex::hasFile(const std::string& filepath) const {
+    return findFile(filepath) != npos;
+}
+
+FileIdentity TagIndex::identityOf(const std::string& filepath) const {
+    const uint32_t id = findFile(filepath);
+    return id == npos ? FileIdentity() : files[id].identity;
+}
+
+// 记录文件标识。同一标识已属于其他文件时（inode 被复用）以新记录为准
+void TagIndex::setIdentity(const std::string& filepath, const FileIdentity& identity) {
+    const uint32_t id = findFile(filepath);
+    if (id == npos || files[id].identity == identity) {
+        return;
+    }
+    auto identityHashFn = [this](uint32_t other) { return identityHashOf(other); };
+    if (files[id].identity.isValid()) {
+        identityTable.erase(id, identityHashOf(id), identityHashFn);
+    }
+    const uint32_t previous = findIdentity(identity);
+    if (previous != npos) {
+        identityTable.erase(previous, identityHashOf(previous), identityHashFn);
+        files[previous].identity = FileIdentity();
+    }
+    files[id].identity = identity;
+    if (identity.isValid()) {
+        identityTable.insert(id, identityHashOf(id), identityHashFn);
+    }
+}
+
+std::string TagIndex::pathForIdentity(const FileIdentity& identity) const {
+    const uint32_t id = findIdentity(identity);
+    return id == npos ? std::string() : pathOf(id);
+}
+
+// 清除文件的全部标签
+void TagIndex::clearTags(uint32_t id) {
+    for (uint32_t tagId : files[id].tags) {
+        postings[tagId].remove(id);
+    }
+    files[id].tags = TagIdList();
+    taggedFiles.remove(id);
+}
+
+// 修改缓存路径：先按旧键从路径表删除，改键后重新插入；文件ID与标签都不变
+void TagIndex::moveEntry(uint32_t id, std::string_view newPath) {
+    auto pathHashFn = [this](uint32_t other) { return pathHashOf(other); };
+    pathTable.erase(id, pathHashOf(id), pathHashFn);
+    std::string_view directory, name;
+    splitPath(newPath, directory, name);
+    files[id].directory = directories.intern(directory);
+    files[id].name = names.intern(name);
+    pathTable.insert(id, pathHashOf(id), pathHashFn);
+}
+
+// 文件移动。目标路径已在索引中时视为被覆盖：其标签清除，标识让给移动来的文件
+bool TagIndex::relocateFile(const std::string& oldPath, const std::string& newPath) {
+    const uint32_t id = findFile(oldPath);
+    if (id == npos || oldPath == newPath) {
+        return false;
+    }
+    const uint32_t target = findFile(newPath);
+    if (target != npos) {
+        clearTags(target);
+        pathTable.erase(target, pathHashOf(target), [this](uint32_t other) { return pathHashOf(other); });
+        if (files[target].identity.isValid()) {
+            identityTable.erase(target, identityHashOf(target), [this](uint32_t other) { return identityHashOf(other); });
+            files[target].identity = FileIdentity();
+        }
+        // 被覆盖的条目不再可按路径找到，保留在文件表中占住ID
+    }
+    moveEntry(id, newPath);
+    return true;
+}
+
+// 目录路径补上末尾分隔符，与驻留池中的目录字符串形式一致
+std::string TagIndex::directoryPrefix(std::string directory) {
+    if (!directory.empty() && directory.back() != '/' && directory.back() != '\\') {
+        const bool windowsStyle = directory.find('\\') != std::string::npos && directory.find('/') == std::string::npos;
+        directory += windowsStyle ? '\\' : '/';
+    }
+    return directory;
+}
+
+// 目录移动。目录在驻留池中只有一份，新路径未出现过时直接改名，其下文件无需逐个修改；
+// 否则（移动到已有目录）逐个移动该目录下的文件
+size_t TagIndex::relocateDirectory(const std::string& oldDirectory, const std::string& newDirectory) {
+    const std::string from = directoryPrefix(oldDirectory);
+    const std::string to = directoryPrefix(newDirectory);
+    if (from.empty() || from == to) {
+        return 0;
+    }
+
+    std::vector<uint32_t> affected;
+    for (uint32_t directoryId = 0; directoryId < directories.size(); ++directoryId) {
+        if (directories.view(directoryId).substr(0, from.size()) == from) {
+            affected.push_back(directoryId);
+        }
+    }
+
+    for (uint32_t directoryId : affected) {
+        const std::string target = to + std::string(directories.view(directoryId).substr(from.size()));
+        if (directories.find(target) == npos) {
+            // 路径表的键是 (目录 ID, 文件名 ID)，改名不影响
+            directories.rename(directoryId, target);
+            continue;
+        }
+        for (uint32_t id = 0; id < files.size(); ++id) {
+            if (files[id].directory == directoryId && findFile(pathOf(id)) == id) {
+                relocateFile(pathOf(id), target + std::string(names.view(files[id].name)));
+            }
+        }
+    }
+    return affected.size();
+}
+
+// 所有带标签文件的路径与标识
+std::vector<std::pair<std::string, FileIdentity>> TagIndex::taggedEntries() const {
+    std::vector<std::pair<std::string, FileIdentity>> entries;
+    entries.reserve(size_t(taggedFiles.cardinality()));
+    taggedFiles.forEach([&](uint32_t id) {
+        entries.emplace_back(pathOf(id), files[id].identity);
+    });
+    return entries;
+}
+
+// 查找在用的标签ID，所有文件都删除了该标签后视为不存在
+uint32_t TagIndex::findTag(const std::string& tag) const {
+    const uint32_t id = tagNames.find(tag);
+    return id != npos && !postings[id].empty() ? id : npos;
+}
+
+std::string TagIndex::pathOf(uint32_t id) const {
+    const std::string_view directory = directories.view(files[id].directory);
+    const std::string_view name = names.view(files[id].name);
+    std::string path;
+    path.reserve(directory.size() + name.size());
+    path.append(directory).append(name);
+    return path;
+}
+
+// 添加标签
+bool TagIndex::add(const std::string& filepath, const std::string& tag) {
+    const uint32_t tagId = tagNames.intern(tag);
+    if (tagId >= postings.size()) {
+        postings.resize(tagId + 1);
+    }
+    const uint32_t id = fileId(filepath);
+    auto& fileTags = files[id].tags;
+    if (fileTags.contains(tagId)) {
+        return false;
+    }
+    fileTags.push_back(tagId);
+    postings[tagId].add(id);
+    taggedFiles.add(id);
+    return true;
+}
+
+// 删除标签
+bool TagIndex::remove(const std::string& filepath, const std::string& tag) {
+    const uint32_t tagId = tagNames.find(tag);
+    const uint32_t id = tagId == npos ? npos : findFile(filepath);
+    if (id == npos || !files[id].tags.erase(tagId)) {
+        return false;
+    }
+    postings[tagId].remove(id);
+    if (files[id].tags.empty()) {
+        taggedFiles.remove(id);
+    }
+    return true;
+}
+
+// 替换标签，新标签已存在时只删除旧标签
+bool TagIndex::replace(const std::string& filepath, const std::string& oldTag, const std::string& newTag) {
+    if (oldTag == newTag || !hasTag(filepath, oldTag)) {
+        return false;
+    }
+    add(filepath, newTag);
+    remove(filepath, oldTag);
+    return true;
+}
+
+// 全局重命名标签。新名字从未出现过时只改驻留池中的名字，文件与位图都不动；
+// 否则把旧标签的文件并入新标签，只访问旧标签的倒排位图
+size_t TagIndex::renameTag(const std::string& oldTag, const std::string& newTag) {
+    const uint32_t oldId = findTag(oldTag);
+    if (oldId == npos || oldTag == newTag) {
+        return 0;
+    }
+    const size_t affected = size_t(postings[oldId].cardinality());
+
+    const uint32_t newId = tagNames.find(newTag);
+    if (newId == npos) {
+        tagNames.rename(oldId, newTag);
+        return affected;
+    }
+
+    postings[oldId].forEach([&](uint32_t id) {
+        auto& fileTags = files[id].tags;
+        fileTags.erase(oldId);
+        if (!fileTags.contains(newId)) {
+            fileTags.push_back(newId);
+        }
+    });
+    postings[newId] |= postings[oldId];
+    postings[oldId].clear();
+    return affected;
+}
+
+// 从所有文件删除标签，只访问该标签的倒排位图
+size_t TagIndex::deleteTag(const std::string& tag) {
+    const uint32_t tagId = findTag(tag);
+    if (tagId == npos) {
+        return 0;
+    }
+    const size_t affected = size_t(postings[tagId].cardinality());
+    postings[tagId].forEach([&](uint32_t id) {
+        auto& fileTags = files[id].tags;
+        fileTags.erase(tagId);
+        if (fileTags.empty()) {
+            taggedFiles.remove(id);
+        }
+    });
+    postings[tagId].clear();
+    return affected;
+}
+
+void TagIndex::clear() {
+    tagNames.clear();
+    directories.clear();
+    names.clear();
+    files.clear();
+    pathTable.clear();
+    identityTable.clear();
+    postings.clear();
+    taggedFiles.clear();
+}
+
+bool TagIndex::hasTag(const std::string& filepath, const std::string& tag) const {
+    const uint32_t tagId = tagNames.find(tag);
+    const uint32_t id = tagId == npos ? npos : findFile(filepath);
+    return id != npos && files[id].tags.contains(tagId);
+}
+
+// 查看某个文件的标签
+std::vector<std::string> TagIndex::tagsForFile(const std::string& filepath) const {
+    std::vector<std::string> result;
+    const uint32_t id = findFile(filepath);
+    if (id != npos) {
+        for (uint32_t tagId : files[id].tags) {
+            result.emplace_back(tagNames.view(tagId));
+        }
+    }
+    return result;
+}
+
+// 查看所有标签，跳过已无文件使用的标签
+std::vector<std::string> TagIndex::allTags() const {
+    std::vector<std::string> tags;
+    for (uint32_t tagId = 0; tagId < postings.size(); ++tagId) {
+        if (!postings[tagId].empty()) {
+            tags.emplace_back(tagNames.view(tagId));
+        }
+    }
+    return tags;
+}
+
+// 根据标签查找文件，只访问该标签的倒排位图
+std::vector<std::string> TagIndex::filesWithTag(const std::string& tag) const {
+    const uint32_t tagId = findTag(tag);
+    if (tagId == npos) {
+        return {};
+    }
+    return paths(postings[tagId]);
+}
+
+// 布尔查询
+TagBitmap TagIndex::evaluate(const TagQuery& query) const {
+    return query.evaluate([this](const std::string& tag) -> const TagBitmap* {
+        const uint32_t tagId = findTag(tag);
+        return tagId == npos ? nullptr : &postings[tagId];
+    }, taggedFiles);
+}
+
+// 将文件ID位图展开为路径
+std::vector<std::string> TagIndex::paths(const TagBitmap& fileIds) const {
+    std::vector<std::string> result;
+    result.reserve(size_t(fileIds.cardinality()));
+    fileIds.forEach([&](uint32_t id) {
+        if (id < files.size()) {
+            result.push_back(pathOf(id));
+        }
+    });
+    return result;
+}
+
+// 将一批文件ID展开为路径，用于分批输出查询结果
+std::vector<std::string> TagIndex::paths(const std::vector<uint32_t>& fileIds) const {
+    std::vector<std::string> result;
+    result.reserve(fileIds.size());
+    for (uint32_t id : fileIds) {
+        if (id < files.size()) {
+            result.push_back(pathOf(id));
+        }
+    }
+    return result;
+}
+
+// 文件是否在位图中：按路径查一次文件ID，再查位图
+bool TagIndex::contains(const TagBitmap& fileIds, const std::string& filepath) const {
+    const uint32_t id = findFile(filepath);
+    return id != npos && fileIds.contains(id);
+}
+
+// 带标签的文件数
+size_t TagIndex::fileCount() const {
+    return size_t(taggedFiles.cardinality());
+}
+
+// 估算占用字节数：驻留池、文件表、寻址表与所有位图
+size_t TagIndex::memoryUsage() const {
+    size_t bytes = sizeof(TagIndex) + tagNames.memoryUsage() + directories.memoryUsage() + names.memoryUsage()
+                   + files.capacity() * sizeof(FileEntry) + pathTable.memoryUsage() + identityTable.memoryUsage()
+                   + postings.capacity() * sizeof(TagBitmap) + taggedFiles.memoryUsage();
+    for (const auto& entry : files) {
+        bytes += entry.tags.heapBytes();
+    }
+    for (const auto& posting : postings) {
+        bytes += posting.memoryUsage() - sizeof(TagBitmap);
+    }
+    return bytes;
+}
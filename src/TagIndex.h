@@ -0,0 +1,124 @@
+/*
+ * TagIndex.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 内存标签索引，正向表（文件 -> 标签）与倒排表（标签 -> 文件ID位图）同步维护。
+ *          标签与路径均经过驻留：标签为整数 ID，路径拆成目录 ID + 文件名 ID，每个文件的标签为内联的小 ID 数组。
+ *          文件同时以 (设备号, inode) 标识，路径只是缓存属性，文件移动后可按标识找回并更新路径
+ */
+
+#ifndef TAG_INDEX_H
+#define TAG_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "FileIdentity.h"
+#include "IdHashTable.h"
+#include "StringPool.h"
+#include "TagBitmap.h"
+#include "TagQuery.h"
+
+// 标签 ID 列表，不超过 InlineCapacity 个时不分配堆内存（大多数文件只有几个标签）
+class TagIdList {
+public:
+    TagIdList() : count(0), capacity(InlineCapacity) {}
+    TagIdList(const TagIdList& other);
+    TagIdList(TagIdList&& other) noexcept;
+    TagIdList& operator=(TagIdList other) noexcept;
+    ~TagIdList();
+
+    const uint32_t* begin() const { return data(); }
+    const uint32_t* end() const { return data() + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool contains(uint32_t id) const;
+    void push_back(uint32_t id);
+    bool erase(uint32_t id);  // 删除并保持其余元素顺序，返回是否存在
+    size_t heapBytes() const { return isInline() ? 0 : capacity * sizeof(uint32_t); }
+
+private:
+    static constexpr uint32_t InlineCapacity = 4;
+
+    bool isInline() const { return capacity == InlineCapacity; }
+    uint32_t* data() { return isInline() ? inlineIds : heapIds; }
+    const uint32_t* data() const { return isInline() ? inlineIds : heapIds; }
+
+    union {
+        uint32_t inlineIds[InlineCapacity];
+        uint32_t* heapIds;
+    };
+    uint32_t count;
+    uint32_t capacity;
+};
+
+class TagIndex {
+public:
+    bool add(const std::string& filepath, const std::string& tag);     // 添加标签，返回是否有变化
+    bool remove(const std::string& filepath, const std::string& tag);  // 删除标签，返回是否有变化
+    bool replace(const std::string& filepath, const std::string& oldTag, const std::string& newTag);  // 替换标签
+    size_t renameTag(const std::string& oldTag, const std::string& newTag);  // 全局重命名，新标签已在用时合并；返回涉及的文件数
+    size_t deleteTag(const std::string& tag);                                // 从所有文件删除标签，返回涉及的文件数
+    void clear();
+
+    bool hasFile(const std::string& filepath) const;                                  // 路径是否在索引中
+    FileIdentity identityOf(const std::string& filepath) const;                      // 文件的标识，未记录时无效
+    void setIdentity(const std::string& filepath, const FileIdentity& identity);     // 记录文件标识，文件不在索引中时忽略
+    std::string pathForIdentity(const FileIdentity& identity) const;                 // 按标识查找缓存路径，不存在时返回空串
+    bool relocateFile(const std::string& oldPath, const std::string& newPath);       // 文件移动，目标路径原有的标签被覆盖
+    size_t relocateDirectory(const std::string& oldDirectory, const std::string& newDirectory);  // 目录移动，返回涉及的目录数
+    std::vector<std::pair<std::string, FileIdentity>> taggedEntries() const;          // 所有带标签文件的路径与标识
+    static std::string directoryPrefix(std::string directory);                       // 目录路径补上末尾分隔符
+
+    bool hasTag(const std::string& filepath, const std::string& tag) const;
+    std::vector<std::string> tagsForFile(const std::string& filepath) const;
+    std::vector<std::string> allTags() const;
+    std::vector<std::string> filesWithTag(const std::string& tag) const;
+
+    TagBitmap evaluate(const TagQuery& query) const;                   // 布尔查询，返回文件ID位图
+    std::vector<std::string> paths(const TagBitmap& fileIds) const;    // 将文件ID位图展开为路径
+    std::vector<std::string> paths(const std::vector<uint32_t>& fileIds) const;  // 将一批文件ID展开为路径
+    bool contains(const TagBitmap& fileIds, const std::string& filepath) const;  // 文件是否在位图中，不展开位图
+    size_t fileCount() const;                                          // 带标签的文件数
+    size_t memoryUsage() const;                                        // 估算占用字节数
+
+private:
+    static constexpr uint32_t npos = StringPool::npos;
+
+    struct FileEntry {
+        uint32_t directory;     // 目录 ID，目录字符串含末尾分隔符
+        uint32_t name;          // 文件名 ID
+        TagIdList tags;         // 标签 ID，保持添加顺序
+        FileIdentity identity;  // 文件标识，未记录时无效
+    };
+
+    static void splitPath(std::string_view filepath, std::string_view& directory, std::string_view& name);
+    static size_t slotHash(uint32_t directory, uint32_t name);
+    static size_t identityHash(const FileIdentity& identity);
+    size_t pathHashOf(uint32_t id) const { return slotHash(files[id].directory, files[id].name); }
+    size_t identityHashOf(uint32_t id) const { return identityHash(files[id].identity); }
+
+    uint32_t fileId(const std::string& filepath);       // 获取或分配文件ID，ID 不回收
+    uint32_t findFile(const std::string& filepath) const;  // 查找文件ID，不存在时返回 npos
+    uint32_t findTag(const std::string& tag) const;     // 查找在用的标签ID，不存在时返回 npos
+    uint32_t findIdentity(const FileIdentity& identity) const;  // 按标识查找文件ID
+    std::string pathOf(uint32_t id) const;
+    void clearTags(uint32_t id);                          // 清除文件的全部标签
+    void moveEntry(uint32_t id, std::string_view newPath);  // 修改文件的缓存路径
+
+    StringPool tagNames;                 // 标签 ID -> 标签名
+    StringPool directories;              // 目录 ID -> 目录
+    StringPool names;                    // 文件名 ID -> 文件名
+    std::vector<FileEntry> files;        // 文件ID -> 路径与标签（正向表）
+    IdHashTable pathTable;               // (目录 ID, 文件名 ID) -> 文件ID
+    IdHashTable identityTable;           // (设备号, inode) -> 文件ID
+    std::vector<TagBitmap> postings;     // 标签 ID -> 文件ID位图，空位图表示标签已不再使用
+    TagBitmap taggedFiles;               // 所有带标签的文件，NOT 的全集
+};
+
+#endif // TAG_INDEX_H
@@ -0,0 +1,611 @@
+/*
+ * TagJournal.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 标签修改追加日志实现
+ */
+
+#include <QtEndian>
+#include <QDebug>
+#include <QFileInfo>
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "TagJournal.h"
+#include "TagDatabase.h"
+#include "Logger.h"
+
+namespace {
+
+const char JournalMagic[8] = { 'F', 'T', 'J', 'R', 'N', 'L', '0', '2' };
+const char LegacyMagic[8] = { 'F', 'T', 'J', 'R', 'N', 'L', '0', '1' };  // 旧版文件头，不含序号
+const int HeaderSize = 16;       // magic + 日志序号
+const int RecordHeaderSize = 8;  // payload 长度 + CRC32
+
+quint32 crc32(const char *data, qsizetype length) {
+    static const std::array<quint32, 256> table = [] {
+        std::array<quint32, 256> values{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            values[i] = c;
+        }
+        return values;
+    }();
+    quint32 crc = 0xFFFFFFFFu;
+    for (qsizetype i = 0; i < length; ++i) {
+        crc = table[(crc ^ quint8(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void appendString(QByteArray &out, const std::string &value) {
+    const quint32 length = qToLittleEndian(quint32(value.size()));
+    out.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    out.append(value.data(), qsizetype(value.size()));
+}
+
+bool readString(const char *&cursor, const char *end, std::string &value) {
+    if (end - cursor < qsizetype(sizeof(quint32))) {
+        return false;
+    }
+    const quint32 length = qFromLittleEndian<quint32>(cursor);
+    cursor += sizeof(quint32);
+    if (quint64(end - cursor) < length) {
+        return false;
+    }
+    value.assign(cursor, length);
+    cursor += length;
+    return true;
+}
+
+/*
+ * Summary: 解析文件头。只写了一部分的文件头（创建日志时崩溃）视为空日志
+ * Parameters:
+ * const QByteArray &content - 日志文件开头的内容
+ * quint64 *sequence - 输出日志序号，旧版文件头为 0，可为空
+ * Return: qsizetype - 文件头长度；文件头不完整时返回 0，无效时返回 -1
+ */
+qsizetype parseHeader(const QByteArray &content, quint64 *sequence) {
+    if (sequence) {
+        *sequence = 0;
+    }
+    if (content.size() < qsizetype(sizeof(JournalMagic))) {
+        const size_t length = size_t(content.size());
+        return std::memcmp(content.constData(), JournalMagic, length) == 0
+               || std::memcmp(content.constData(), LegacyMagic, length) == 0 ? 0 : -1;
+    }
+    if (std::memcmp(content.constData(), LegacyMagic, sizeof(LegacyMagic)) == 0) {
+        return qsizetype(sizeof(LegacyMagic));
+    }
+    if (std::memcmp(content.constData(), JournalMagic, sizeof(JournalMagic)) != 0) {
+        return -1;
+    }
+    if (content.size() < HeaderSize) {
+        return 0;
+    }
+    if (sequence) {
+        *sequence = qFromLittleEndian<quint64>(content.constData() + sizeof(JournalMagic));
+    }
+    return HeaderSize;
+}
+
+/*
+ * Summary: 解析文件头之后的记录，直到残缺、校验失败或格式错误的记录为止
+ * Parameters:
+ * const QByteArray &content - 整个日志文件的内容，文件头已校验
+ * qsizetype headerSize - 文件头长度
+ * const std::function<void(const TagJournal::Record &)> &apply - 每条完整记录的处理函数，可为空
+ * Return: qsizetype - 最后一条完整记录的结束位置
+ */
+qsizetype scanRecords(const QByteArray &content, qsizetype headerSize,
+                      const std::function<void(const TagJournal::Record &)> &apply) {
+    const char *begin = content.constData();
+    const char *cursor = begin + headerSize;
+    const char *end = begin + content.size();
+    while (end - cursor >= RecordHeaderSize) {
+        const quint32 length = qFromLittleEndian<quint32>(cursor);
+        const quint32 checksum = qFromLittleEndian<quint32>(cursor + 4);
+        const char *payload = cursor + RecordHeaderSize;
+        if (length < 1 || quint64(end - payload) < length || crc32(payload, length) != checksum) {
+            break;
+        }
+
+        const char *field = payload + 1;
+        const char *payloadEnd = payload + length;
+        TagJournal::Record record{ TagJournal::Record::Op(quint8(payload[0])), {}, {}, {} };
+        if (!readString(field, payloadEnd, record.path) || !readString(field, payloadEnd, record.tag)
+            || !readString(field, payloadEnd, record.newTag)) {
+            break;
+        }
+        if (apply) {
+            apply(record);
+        }
+        cursor = payloadEnd;
+    }
+    return cursor - begin;
+}
+
+bool syncToDisk(QFile &file) {
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+} // namespace
+
+TagJournal::TagJournal(const QString &journalPath, const QString &databasePath, QObject *parent)
+    : QThread(parent),
+      journalPath(journalPath),
+      databasePath(databasePath),
+      database(nullptr),
+      checkpointedSequence(0),
+      appendedSequence(0),
+      syncedSequence(0),
+      failedBatches(0),
+      syncRequested(false),
+      running(true),
+      flushIntervalMs(50),
+      checkpointThreshold(4 * 1024 * 1024) {}
+
+TagJournal::~TagJournal() {
+    {
+        QMutexLocker locker(&mutex);
+        running = false;
+        condition.wakeAll();
+    }
+    wait();  // 线程退出前会写完剩余的缓冲
+}
+
+QString TagJournal::sealedPath() const {
+    return journalPath + ".checkpoint";
+}
+
+void TagJournal::setFlushInterval(int milliseconds) {
+    QMutexLocker locker(&mutex);
+    flushIntervalMs = milliseconds;
+}
+
+void TagJournal::setCheckpointThreshold(qint64 bytes) {
+    QMutexLocker locker(&mutex);
+    checkpointThreshold = bytes;
+}
+
+/*
+ * Summary: 编码一条记录：[payload 长度][CRC32][操作][路径][标签][新标签]
+ * Parameters:
+ * const Record &record - 修改记录
+ * Return: QByteArray - 编码后的字节
+ */
+QByteArray TagJournal::encode(const Record &record) {
+    QByteArray payload;
+    payload.reserve(qsizetype(1 + 12 + record.path.size() + record.tag.size() + record.newTag.size()));
+    payload.append(char(record.op));
+    appendString(payload, record.path);
+    appendString(payload, record.tag);
+    appendString(payload, record.newTag);
+
+    QByteArray out;
+    out.reserve(RecordHeaderSize + payload.size());
+    const quint32 length = qToLittleEndian(quint32(payload.size()));
+    const quint32 checksum = qToLittleEndian(crc32(payload.constData(), payload.size()));
+    out.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    out.append(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+    out.append(payload);
+    return out;
+}
+
+/*
+ * Summary: 追加一条修改记录。只做编码和一次短暂加锁，写盘由后台线程批量完成
+ * Parameters:
+ * const Record &record - 修改记录
+ * Return: void
+ */
+void TagJournal::append(const Record &record) {
+    const QByteArray encoded = encode(record);
+    QMutexLocker locker(&mutex);
+    const bool wasEmpty = pending.isEmpty();
+    pending.append(encoded);
+    ++appendedSequence;
+    if (wasEmpty) {
+        condition.wakeOne();  // 批次的第一条记录唤醒写线程，开始计时窗口
+    }
+}
+
+/*
+ * Summary: 批量追加修改记录，编码在锁外完成，整批只加一次锁
+ * Parameters:
+ * const std::vector<Record> &records - 修改记录
+ * Return: void
+ */
+void TagJournal::append(const std::vector<Record> &records) {
+    if (records.empty()) {
+        return;
+    }
+    QByteArray encoded;
+    for (const Record &record : records) {
+        encoded.append(encode(record));
+    }
+    QMutexLocker locker(&mutex);
+    const bool wasEmpty = pending.isEmpty();
+    pending.append(encoded);
+    appendedSequence += records.size();
+    if (wasEmpty) {
+        condition.wakeOne();
+    }
+}
+
+/*
+ * Summary: 立即写盘并等待 fsync 完成，用于需要确认持久化的批量操作。
+ *          写盘失败时不等重试结果，直接返回 false；失败的记录留在缓冲中，之后继续重试
+ * Parameters: 无
+ * Return: bool - 调用前追加的修改是否都已落盘
+ */
+bool TagJournal::sync() {
+    QMutexLocker locker(&mutex);
+    const quint64 target = appendedSequence;
+    if (syncedSequence >= target) {
+        return true;
+    }
+    const quint64 failures = failedBatches;
+    syncRequested = true;
+    condition.wakeOne();
+    while (syncedSequence < target && failedBatches == failures && isRunning()) {
+        synced.wait(&mutex, 100);
+    }
+    return syncedSequence >= target;
+}
+
+void TagJournal::run() {
+    TagDatabase db(databasePath, "tag_db_checkpoint");
+    database = &db;
+    if (!db.openDatabase()) {
+        LOG_ERROR("标签日志线程无法打开标签数据库，检查点将被跳过。");
+    } else {
+        db.loadJournalSequence(checkpointedSequence);
+    }
+
+    // 启动时把上次遗留的日志合并进数据库，然后从空日志开始
+    checkpoint();
+
+    while (true) {
+        QByteArray batch;
+        quint64 batchSequence;
+        qint64 threshold;
+        {
+            QMutexLocker locker(&mutex);
+            while (pending.isEmpty() && running && !syncRequested) {
+                condition.wait(&mutex);
+            }
+            // 等待一个时间窗口，把窗口内的修改合并为一次写盘和一次 fsync
+            if (running && !syncRequested) {
+                condition.wait(&mutex, flushIntervalMs);
+            }
+            if (pending.isEmpty() && !running) {
+                break;
+            }
+            batch.swap(pending);
+            batchSequence = appendedSequence;
+            syncRequested = false;
+            threshold = checkpointThreshold;
+        }
+
+        const bool written = writeBatch(batch);
+        finishBatch(batch, batchSequence, written);
+        if (!written) {
+            QMutexLocker locker(&mutex);
+            if (!running) {
+                LOG_ERROR(QString("退出时标签日志仍无法写入，%1 条修改未能保存。").arg(appendedSequence - syncedSequence));
+                break;
+            }
+            continue;
+        }
+
+        if (journalFile.size() >= threshold) {
+            checkpoint();
+        }
+    }
+
+    journalFile.close();
+    database = nullptr;
+}
+
+/*
+ * Summary: 打开日志文件，新文件写入文件头。上次写入中途崩溃会留下残缺尾部，
+ *          追加前先截到最后一条完整记录，否则回放停在残缺处，其后追加的记录全部丢失。
+ *          新文件的序号大于已合并的序号和待合并的封存日志序号
+ * Parameters: 无
+ * Return: bool - 是否成功
+ */
+bool TagJournal::openJournal() {
+    const qint64 valid = validLength(journalPath);
+    if (valid < 0) {
+        const QString aside = journalPath + ".corrupt";
+        QFile::remove(aside);
+        if (!QFile::rename(journalPath, aside)) {
+            LOG_ERROR("标签日志文件头无效且无法移走: " + journalPath);
+            return false;
+        }
+        LOG_ERROR("标签日志文件头无效，已移到 " + aside);
+    } else if (QFileInfo(journalPath).size() > valid) {
+        if (!QFile::resize(journalPath, valid)) {
+            LOG_ERROR("无法截掉标签日志的残缺尾部: " + journalPath);
+            return false;
+        }
+        LOG_WARNING(QString("标签日志尾部残缺，已截到 %1 字节。").arg(valid));
+    }
+
+    // 以追加方式打开：检查点失败时已有的日志内容仍需保留。不经 QFile 缓冲，写入失败后截断不会留下残余数据
+    journalFile.setFileName(journalPath);
+    if (!journalFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered)) {
+        LOG_ERROR("无法打开标签日志: " + journalFile.errorString());
+        return false;
+    }
+    if (journalFile.size() == 0) {
+        const quint64 sequence = std::max(checkpointedSequence, sequenceOf(sealedPath())) + 1;
+        QByteArray header(JournalMagic, sizeof(JournalMagic));
+        header.resize(HeaderSize);
+        qToLittleEndian(sequence, header.data() + sizeof(JournalMagic));
+        if (journalFile.write(header) != header.size() || !syncToDisk(journalFile)) {
+            LOG_ERROR("无法写入标签日志文件头: " + journalFile.errorString());
+            journalFile.close();
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Summary: 写入一批记录并 fsync。失败时截回写入前的长度，残缺的记录不能留在之后的记录前面
+ * Parameters:
+ * const QByteArray &batch - 编码好的记录
+ * Return: bool - 是否已落盘
+ */
+bool TagJournal::writeBatch(const QByteArray &batch) {
+    if (batch.isEmpty()) {
+        return true;
+    }
+    if (!journalFile.isOpen() && !openJournal()) {
+        return false;
+    }
+    const qint64 before = journalFile.size();
+    if (journalFile.write(batch) == batch.size() && syncToDisk(journalFile)) {
+        return true;
+    }
+    LOG_ERROR_LIMITED("写入标签日志失败，稍后重试: " + journalFile.errorString());
+    if (!journalFile.resize(before)) {
+        // 截不回去时关闭文件，下次打开时按校验截掉残缺尾部
+        journalFile.close();
+    }
+    return false;
+}
+
+/*
+ * Summary: 一批记录写盘结束后通知等待方。失败的批次放回缓冲最前面，下一个时间窗口按原顺序重试
+ * Parameters:
+ * QByteArray &batch - 本批记录
+ * quint64 batchSequence - 本批最后一条记录的序号
+ * bool written - 是否已落盘
+ * Return: void
+ */
+void TagJournal::finishBatch(QByteArray &batch, quint64 batchSequence, bool written) {
+    QMutexLocker locker(&mutex);
+    if (written) {
+        syncedSequence = batchSequence;
+    } else {
+        pending.prepend(batch);
+        ++failedBatches;
+    }
+    synced.wakeAll();
+}
+
+/*
+ * Summary: 检查点：封存当前日志，换用新日志继续接收修改，再把封存日志合并进数据库
+ * Parameters: 无
+ * Return: void
+ */
+void TagJournal::checkpoint() {
+    // 上次崩溃遗留的封存日志先合并，保证回放顺序
+    if (QFile::exists(sealedPath()) && !applySealed()) {
+        return;
+    }
+
+    if (journalFile.isOpen()) {
+        journalFile.close();
+    }
+    if (QFile::exists(journalPath) && !QFile::rename(journalPath, sealedPath())) {
+        LOG_ERROR("无法封存标签日志: " + journalPath);
+        openJournal();
+        return;
+    }
+    if (!openJournal()) {
+        return;
+    }
+
+    // 合并期间到达的修改先写进新日志
+    QByteArray batch;
+    quint64 batchSequence;
+    {
+        QMutexLocker locker(&mutex);
+        batch.swap(pending);
+        batchSequence = appendedSequence;
+    }
+    finishBatch(batch, batchSequence, writeBatch(batch));
+
+    applySealed();
+}
+
+/*
+ * Summary: 在一个事务中把封存日志及其序号写入数据库，成功后删除封存日志。
+ *          提交后、删除前崩溃时封存日志会留下来，其序号已记录在数据库中，下次直接删除而不再合并：
+ *          重命名、删除标签等记录重复执行的结果与执行一次不同
+ * Parameters: 无
+ * Return: bool - 是否成功
+ */
+bool TagJournal::applySealed() {
+    if (!QFile::exists(sealedPath())) {
+        return true;
+    }
+    if (!database || !database->beginTransaction()) {
+        return false;
+    }
+
+    const quint64 sequence = sequenceOf(sealedPath());
+    quint64 recorded = 0;
+    if (!database->loadJournalSequence(recorded)) {
+        database->rollbackTransaction();
+        return false;
+    }
+    checkpointedSequence = std::max(checkpointedSequence, recorded);
+    if (sequence != 0 && sequence <= recorded) {
+        database->rollbackTransaction();
+        QFile::remove(sealedPath());
+        LOG_INFO(QString("封存日志 %1 已在上次检查点合并，直接删除。").arg(sequence));
+        return true;
+    }
+
+    bool ok = true;
+    qint64 applied = 0;
+    replay(sealedPath(), [&](const Record &record) {
+        if (!ok) {
+            return;
+        }
+        const QString path = QString::fromStdString(record.path);
+        const QString tag = QString::fromStdString(record.tag);
+        switch (record.op) {
+            case Record::Op::AddTag:
+                ok = database->addFileTag(path, tag);
+                break;
+            case Record::Op::RemoveTag:
+                ok = database->removeFileTag(path, tag);
+                break;
+            case Record::Op::UpdateTag:
+                ok = database->updateFileTag(path, tag, QString::fromStdString(record.newTag));
+                break;
+            case Record::Op::RenameTag:
+                ok = database->renameTag(tag, QString::fromStdString(record.newTag));
+                break;
+            case Record::Op::DeleteTag:
+                ok = database->deleteTag(tag);
+                break;
+            case Record::Op::MoveFile:
+                ok = database->moveFile(path, QString::fromStdString(record.newTag));
+                break;
+            case Record::Op::MoveDirectory:
+                ok = database->moveDirectory(path, QString::fromStdString(record.newTag));
+                break;
+            case Record::Op::SetIdentity:
+                ok = database->setFileIdentity(path, FileIdentity::fromString(record.tag));
+                break;
+        }
+        ++applied;
+    });
+    // 旧版日志没有序号，合并后不更新记录
+    if (ok && sequence != 0) {
+        ok = database->setJournalSequence(sequence);
+    }
+
+    if (!ok || !database->commitTransaction()) {
+        if (ok) {
+            LOG_ERROR("标签检查点提交失败，将在下次检查点重试。");
+        } else {
+            database->rollbackTransaction();
+            LOG_ERROR("标签检查点写入失败，将在下次检查点重试。");
+        }
+        return false;
+    }
+
+    checkpointedSequence = std::max(checkpointedSequence, sequence);
+    QFile::remove(sealedPath());
+    LOG_INFO(QString("标签检查点完成，合并 %1 条记录。").arg(applied));
+    return true;
+}
+
+/*
+ * Summary: 回放日志。文件不存在视为空日志；残缺或校验失败的尾部记录（写入中途崩溃）被忽略
+ * Parameters:
+ * const QString &journalPath - 日志文件路径
+ * const std::function<void(const Record &)> &apply - 每条记录的处理函数
+ * Return: bool - 文件头是否有效
+ */
+bool TagJournal::replay(const QString &journalPath, const std::function<void(const Record &)> &apply) {
+    QFile file(journalPath);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        LOG_ERROR("无法读取标签日志: " + file.errorString());
+        return false;
+    }
+
+    const QByteArray content = file.readAll();
+    const qsizetype headerSize = parseHeader(content, nullptr);
+    if (headerSize < 0) {
+        LOG_WARNING("标签日志文件头无效，忽略：" + journalPath);
+        return false;
+    }
+    if (headerSize == 0) {
+        return true;
+    }
+
+    if (scanRecords(content, headerSize, apply) < content.size()) {
+        LOG_WARNING("标签日志尾部记录不完整，已忽略：" + journalPath);
+    }
+    return true;
+}
+
+/*
+ * Summary: 计算日志中文件头与完整记录的总长度。只写了一部分的文件头视为空文件
+ * Parameters:
+ * const QString &journalPath - 日志文件路径
+ * Return: qint64 - 有效长度，文件头无效或无法读取时返回 -1
+ */
+qint64 TagJournal::validLength(const QString &journalPath) {
+    QFile file(journalPath);
+    if (!file.exists()) {
+        return 0;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        LOG_ERROR("无法读取标签日志: " + file.errorString());
+        return -1;
+    }
+
+    const QByteArray content = file.readAll();
+    const qsizetype headerSize = parseHeader(content, nullptr);
+    if (headerSize <= 0) {
+        return headerSize;
+    }
+    return qint64(scanRecords(content, headerSize, {}));
+}
+
+/*
+ * Summary: 读取文件头中的日志序号
+ * Parameters:
+ * const QString &journalPath - 日志文件路径
+ * Return: quint64 - 日志序号，旧版日志、文件不存在或文件头无效时返回 0
+ */
+quint64 TagJournal::sequenceOf(const QString &journalPath) {
+    QFile file(journalPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    quint64 sequence = 0;
+    parseHeader(file.read(HeaderSize), &sequence);
+    return sequence;
+}
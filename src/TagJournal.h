@@ -0,0 +1,92 @@
+/*
+ * TagJournal.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 标签修改的追加日志。修改只追加到内存缓冲，后台线程按批写盘并 fsync；
+ *          日志超过阈值后封存并在后台合并进标签数据库（检查点）。每个日志文件头带递增的序号，
+ *          合并时序号与内容在同一事务中写入数据库，已合并的封存日志不会再次回放
+ */
+
+#ifndef TAGJOURNAL_H
+#define TAGJOURNAL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <functional>
+#include <string>
+#include <vector>
+
+class TagDatabase;
+
+class TagJournal : public QThread {
+Q_OBJECT
+public:
+    struct Record {
+        enum class Op : quint8 {
+            AddTag = 1, RemoveTag = 2, UpdateTag = 3, RenameTag = 4, DeleteTag = 5,
+            MoveFile = 6,       // path 移动到 newTag
+            MoveDirectory = 7,  // 目录 path 移动到 newTag，二者均含末尾分隔符
+            SetIdentity = 8     // 文件 path 的标识，tag 为 device:inode
+        } op;
+        std::string path;    // RenameTag、DeleteTag 为全局操作，路径为空
+        std::string tag;
+        std::string newTag;  // UpdateTag、RenameTag 的新标签，MoveFile、MoveDirectory 的新路径
+    };
+
+    TagJournal(const QString &journalPath, const QString &databasePath, QObject *parent = nullptr);
+    ~TagJournal();
+
+    void append(const Record &record);          // 追加一条修改，只写内存缓冲，耗时与数据量无关
+    void append(const std::vector<Record> &records);  // 批量追加，只加一次锁
+    bool sync();                                // 立即写盘并等待 fsync 完成，写盘失败时返回 false
+    void setFlushInterval(int milliseconds);    // 批量写盘的时间窗口
+    void setCheckpointThreshold(qint64 bytes);  // 日志超过该大小时做检查点
+
+    QString sealedPath() const;                 // 正在合并的封存日志路径
+
+    // 依次回放日志中的记录，遇到残缺或校验失败的尾部记录即停止
+    static bool replay(const QString &journalPath, const std::function<void(const Record &)> &apply);
+    // 文件头与完整记录的总字节数，其后为残缺尾部；文件头无效时返回 -1，文件不存在时返回 0
+    static qint64 validLength(const QString &journalPath);
+    // 文件头中的日志序号；旧版日志、文件不存在或文件头无效时返回 0
+    static quint64 sequenceOf(const QString &journalPath);
+
+protected:
+    void run() override;
+
+private:
+    bool openJournal();                     // 打开日志文件，先截掉残缺尾部，新文件写入带新序号的文件头
+    bool writeBatch(const QByteArray &batch);   // 失败时截回写入前的长度
+    void finishBatch(QByteArray &batch, quint64 batchSequence, bool written);  // 通知等待方，失败的批次放回缓冲重试
+    void checkpoint();                      // 封存当前日志并合并进数据库
+    bool applySealed();                     // 将封存日志在一个事务中写入数据库
+
+    static QByteArray encode(const Record &record);
+
+    QString journalPath;
+    QString databasePath;
+    QFile journalFile;
+    TagDatabase *database;      // 仅在日志线程中使用
+    quint64 checkpointedSequence;   // 已合并进数据库的最后一个日志序号，仅在日志线程中使用
+
+    QMutex mutex;
+    QWaitCondition condition;   // 唤醒写线程
+    QWaitCondition synced;      // 通知等待 fsync 的调用方
+    QByteArray pending;         // 尚未写盘的记录
+    quint64 appendedSequence;   // 已追加的记录数
+    quint64 syncedSequence;     // 已落盘的记录数
+    quint64 failedBatches;      // 写盘失败的批次数，sync() 据此得知等待的批次失败
+    bool syncRequested;
+    bool running;
+
+    int flushIntervalMs;
+    qint64 checkpointThreshold;
+};
+
+#endif // TAGJOURNAL_H
@@ -1,110 +1,533 @@
 #include "TagManager.h"
+#include "TagDatabase.h"
+#include "TagJournal.h"
+#include "Logger.h"
+#include <QLockFile>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
 #include <stdexcept>
-#include <unordered_set>
 #include <algorithm>
 
-// 构造函数，初始化标签文件名
-TagManager::TagManager(const std::string& filename) : filename(filename) {}
+// 构造函数，初始化标签文件名，数据库与日志文件与 CSV 文件同名
+TagManager::TagManager(const std::string& filename)
+        : store(&TagManager::applyRecord),
+          filename(filename),
+          databaseFile(std::filesystem::path(filename).replace_extension(".db").string()),
+          journalFile(std::filesystem::path(filename).replace_extension(".journal").string()) {}
+
+// 析构时日志线程写完剩余的修改后退出，之后才释放独占锁
+TagManager::~TagManager() {
+    journal.reset();
+}
+
+// 取得标签数据的独占锁。filetagd、界面与 filetag-cli --local 各自持有 TagManager，
+// 若同时打开同一份数据，各自的日志与检查点会互相覆盖，因此后来者直接报错。
+// 持有锁的进程退出后锁文件由 QLockFile 按进程号识别为失效，不会永久阻塞
+void TagManager::lockStore() {
+    if (ownerLock) {
+        return;
+    }
+    auto lock = std::make_unique<QLockFile>(QString::fromStdString(journalFile) + ".lock");
+    lock->setStaleLockTime(0);  // 常驻进程持锁时间不定，只按进程是否存在判断失效
+    if (!lock->tryLock(0)) {
+        qint64 pid = 0;
+        QString hostname;
+        QString appname;
+        lock->getLockInfo(&pid, &hostname, &appname);
+        throw std::runtime_error(QString("标签数据 %1 正由 %2（PID %3）使用，请通过 filetagd 操作或先退出该进程")
+                                         .arg(QString::fromStdString(journalFile), appname.isEmpty() ? "其他进程" : appname)
+                                         .arg(pid)
+                                         .toStdString());
+    }
+    ownerLock = std::move(lock);
+}
 
 // 加载标签
 void TagManager::loadTags() {
-    std::ifstream infile(filename);
-    std::string line;
+    lockStore();
+    journal.reset();
+    auto loaded = std::make_shared<TagIndex>();
+    quint64 checkpointed = 0;  // 已合并进数据库的最后一个日志序号
 
-    if (!infile.is_open()) {
-        std::cerr << "无法打开文件 " << filename << "，将创建一个新的文件。" << std::endl;
-        std::ofstream outfile(filename); // 创建一个新的CSV文件
-        if (!outfile.is_open()) {
-            throw std::runtime_error("无法创建文件 " + filename);
+    {
+        TagDatabase database(QString::fromStdString(databaseFile));
+        if (!database.openDatabase()) {
+            throw std::runtime_error("无法打开标签数据库 " + databaseFile);
+        }
+        if (!database.loadJournalSequence(checkpointed)) {
+            throw std::runtime_error("无法读取标签数据库 " + databaseFile + " 的日志序号");
+        }
+
+        // 首次运行时把旧版 CSV 中的标签迁移到数据库
+        if (database.isEmpty() && std::filesystem::exists(filename)) {
+            migrateCsv(database);
+        }
+
+        for (const auto& [filepath, tag] : database.loadFileTags()) {
+            loaded->add(filepath.toStdString(), tag.toStdString());
+        }
+        for (const auto& [filepath, identity] : database.loadFileIdentities()) {
+            loaded->setIdentity(filepath.toStdString(), identity);
+        }
+    }
+
+    // 数据库是最近一次检查点的快照，再按顺序回放尚未合并的封存日志和当前日志
+    const QString journalPath = QString::fromStdString(journalFile);
+    journal = std::make_unique<TagJournal>(journalPath, QString::fromStdString(databaseFile));
+    size_t replayed = 0;
+    auto apply = [&loaded, &replayed](const TagJournal::Record& record) {
+        applyRecord(*loaded, record);
+        ++replayed;
+    };
+    // 检查点提交后、删除封存日志前崩溃时，封存日志已包含在数据库中，再回放会重复执行重命名等修改
+    for (const QString& path : {journal->sealedPath(), journalPath}) {
+        const quint64 sequence = TagJournal::sequenceOf(path);
+        if (sequence != 0 && sequence <= checkpointed) {
+            LOG_INFO(QString("标签日志 %1 已合并进数据库，跳过回放。").arg(path));
+            continue;
+        }
+        TagJournal::replay(path, apply);
+    }
+    if (replayed > 0) {
+        LOG_INFO(QString("已回放 %1 条标签日志记录。").arg(replayed));
+    }
+
+    store.reset(std::move(loaded));
+    journal->start();
+}
+
+// 将一条修改记录作用到索引上，用于回放日志和补做副本的修改
+void TagManager::applyRecord(TagIndex& index, const TagJournal::Record& record) {
+    switch (record.op) {
+        case TagJournal::Record::Op::AddTag:
+            index.add(record.path, record.tag);
+            break;
+        case TagJournal::Record::Op::RemoveTag:
+            index.remove(record.path, record.tag);
+            break;
+        case TagJournal::Record::Op::UpdateTag:
+            index.replace(record.path, record.tag, record.newTag);
+            break;
+        case TagJournal::Record::Op::RenameTag:
+            index.renameTag(record.tag, record.newTag);
+            break;
+        case TagJournal::Record::Op::DeleteTag:
+            index.deleteTag(record.tag);
+            break;
+        case TagJournal::Record::Op::MoveFile:
+            index.relocateFile(record.path, record.newTag);
+            break;
+        case TagJournal::Record::Op::MoveDirectory:
+            index.relocateDirectory(record.path, record.newTag);
+            break;
+        case TagJournal::Record::Op::SetIdentity:
+            index.setIdentity(record.path, FileIdentity::fromString(record.tag));
+            break;
+    }
+}
+
+// 写操作：在副本上执行 body(index, changes)，修改记录在写锁内追加到日志，保证日志顺序与发布顺序一致
+template <typename Body>
+auto TagManager::mutate(Body&& body) {
+    return store.update([&](TagIndex& index, std::vector<TagJournal::Record>& changes) {
+        auto result = body(index, changes);
+        if (!changes.empty()) {
+            journal->append(changes);
         }
-        outfile.close();
+        return result;
+    });
+}
+
+// 当前标签数据的只读快照，持有期间不受后台写操作影响
+std::shared_ptr<const TagIndex> TagManager::snapshot() const {
+    return store.snapshot();
+}
+
+// 等待已做的修改写盘。失败时内存中的修改仍然有效，日志线程会继续重试写盘
+bool TagManager::sync() {
+    if (!journal) {
+        return true;
+    }
+    if (!journal->sync()) {
+        LOG_ERROR("标签修改写盘失败，修改已生效但尚未保存，将在后台重试。");
+        return false;
+    }
+    return true;
+}
+
+// 将旧版 CSV 标签文件在一个事务中导入数据库，成功后重命名为 .migrated
+void TagManager::migrateCsv(TagDatabase& database) {
+    std::ifstream infile(filename);
+    if (!infile.is_open()) {
         return;
     }
 
+    if (!database.beginTransaction()) {
+        throw std::runtime_error("无法迁移标签文件 " + filename);
+    }
+
+    std::string line;
+    size_t migrated = 0;
     while (std::getline(infile, line)) {
         std::istringstream iss(line);
         std::string filepath, tag;
         if (std::getline(iss, filepath, ',')) {
-            std::vector<std::string> fileTags;
+            const QString path = QString::fromStdString(filepath);
             while (std::getline(iss, tag, ',')) {
-                fileTags.push_back(tag);
+                if (!database.addFileTag(path, QString::fromStdString(tag))) {
+                    database.rollbackTransaction();
+                    throw std::runtime_error("迁移标签失败: " + filepath);
+                }
+                ++migrated;
             }
-            tags[filepath] = fileTags;
         }
     }
-}
+    infile.close();
+
+    if (!database.commitTransaction()) {
+        throw std::runtime_error("无法迁移标签文件 " + filename);
+    }
 
-// 保存标签
-void TagManager::saveTags() const {
-    std::ofstream outfile(filename);
+    std::error_code ec;
+    std::filesystem::rename(filename, filename + ".migrated", ec);
+    LOG_INFO(QString("已从 %1 迁移 %2 条标签记录。").arg(QString::fromStdString(filename)).arg(migrated));
+}
 
-    if (!outfile.is_open()) {
-        throw std::runtime_error("无法打开文件 " + filename);
+// 路径不在索引中（或没有标识）时读取文件标识，若该标识属于另一个已不存在的路径，说明文件被移动过，
+// 把旧路径的标签迁移到新路径。已知路径不访问文件系统
+FileIdentity TagManager::followMove(TagIndex& index, const std::string& filepath, std::vector<TagJournal::Record>& changes) {
+    FileIdentity identity = index.identityOf(filepath);
+    if (identity.isValid()) {
+        return identity;
     }
+    identity = FileIdentity::of(filepath);
+    if (!identity.isValid()) {
+        return identity;
+    }
+    const std::string oldPath = index.pathForIdentity(identity);
+    // 旧路径仍是同一文件时为硬链接，两个路径各自保留标签
+    if (!oldPath.empty() && oldPath != filepath && FileIdentity::of(oldPath) != identity
+        && index.relocateFile(oldPath, filepath)) {
+        changes.push_back({TagJournal::Record::Op::MoveFile, oldPath, {}, filepath});
+        LOG_INFO(QString("文件已移动，标签随之迁移：%1 -> %2").arg(QString::fromStdString(oldPath), QString::fromStdString(filepath)));
+    }
+    return identity;
+}
 
-    for (const auto& [filepath, fileTags] : tags) {
-        outfile << filepath;
-        for (const auto& tag : fileTags) {
-            outfile << "," << tag;
-        }
-        outfile << std::endl;
+// 为带标签的文件补记标识，identity 无效时读取文件系统
+void TagManager::rememberIdentity(TagIndex& index, const std::string& filepath, FileIdentity identity,
+                                  std::vector<TagJournal::Record>& changes) {
+    if (index.identityOf(filepath).isValid()) {
+        return;
+    }
+    if (!identity.isValid()) {
+        identity = FileIdentity::of(filepath);
+    }
+    if (identity.isValid()) {
+        index.setIdentity(filepath, identity);
+        changes.push_back({TagJournal::Record::Op::SetIdentity, filepath, identity.toString(), {}});
     }
 }
 
-// 添加标签
+// 添加标签，只更新内存并追加日志
 void TagManager::addTag(const std::string& filepath, const std::string& tag) {
-    if (std::find(tags[filepath].begin(), tags[filepath].end(), tag) == tags[filepath].end()) {
-        tags[filepath].push_back(tag);
-        saveTags();
-    }
+    mutate([&](TagIndex& index, std::vector<TagJournal::Record>& changes) {
+        const FileIdentity identity = followMove(index, filepath, changes);
+        if (!index.add(filepath, tag)) {
+            return false;
+        }
+        changes.push_back({TagJournal::Record::Op::AddTag, filepath, tag, {}});
+        rememberIdentity(index, filepath, identity, changes);
+        return true;
+    });
 }
 
 // 删除标签
 void TagManager::removeTag(const std::string& filepath, const std::string& tag) {
-    auto& fileTags = tags[filepath];
-    fileTags.erase(std::remove(fileTags.begin(), fileTags.end(), tag), fileTags.end());
-    saveTags();
+    mutate([&](TagIndex& index, std::vector<TagJournal::Record>& changes) {
+        followMove(index, filepath, changes);
+        if (!index.remove(filepath, tag)) {
+            return false;
+        }
+        changes.push_back({TagJournal::Record::Op::RemoveTag, filepath, tag, {}});
+        return true;
+    });
 }
 
 // 更新标签
 void TagManager::updateTag(const std::string& filepath, const std::string& oldTag, const std::string& newTag) {
-    auto it = std::find(tags[filepath].begin(), tags[filepath].end(), oldTag);
-    if (it != tags[filepath].end()) {
-        *it = newTag;
-        saveTags();
+    mutate([&](TagIndex& index, std::vector<TagJournal::Record>& changes) {
+        followMove(index, filepath, changes);
+        if (!index.replace(filepath, oldTag, newTag)) {
+            return false;
+        }
+        changes.push_back({TagJournal::Record::Op::UpdateTag, filepath, oldTag, newTag});
+        return true;
+    });
+}
+
+// 全局重命名标签，只访问该标签的倒排位图，整个操作只写一条日志
+size_t TagManager::renameTag(const std::string& oldTag, const std::string& newTag) {
+    const size_t affected = mutate([&](TagIndex& index, std::vector<TagJournal::Record>& changes) {
+        const size_t count = index.renameTag(oldTag, newTag);
+        if (count > 0) {
+            changes.push_back({TagJournal::Record::Op::RenameTag, {}, oldTag, newTag});
+        }
+        return count;
+    });
+    if (affected > 0) {
+        sync();
+    }
+    return affected;
+}
+
+// 将 source 合并到 target，与重命名为已有标签相同
+size_t TagManager::mergeTag(const std::string& source, const std::string& target) {
+    return renameTag(source, target);
+}
+
+// 从所有文件删除标签
+size_t TagManager::deleteTag(const std::string& tag) {
+    const size_t affected = mutate([&](TagIndex& index, std::vector<TagJournal::Record>& changes) {
+        const size_t count = index.deleteTag(tag);
+        if (count > 0) {
+            changes.push_back({TagJournal::Record::Op::DeleteTag, {}, tag, {}});
+        }
+        return count;
+    });
+    if (affected > 0) {
+        sync();
+    }
+    return affected;
+}
+
+// 目录已被移动：内存中只改目录字符串，整个操作只写一条日志
+size_t TagManager::moveDirectory(const std::string& oldDirectory, const std::string& newDirectory) {
+    const std::string from = TagIndex::directoryPrefix(oldDirectory);
+    const std::string to = TagIndex::directoryPrefix(newDirectory);
+    const size_t affected = mutate([&](TagIndex& index, std::vector<TagJournal::Record>& changes) {
+        const size_t count = index.relocateDirectory(from, to);
+        if (count > 0) {
+            changes.push_back({TagJournal::Record::Op::MoveDirectory, from, {}, to});
+        }
+        return count;
+    });
+    if (affected > 0) {
+        sync();
+    }
+    return affected;
+}
+
+/*
+ * 整理路径，用于大量文件被移动或重命名之后：
+ * 1. 路径仍存在的文件核对标识，缺少或已变化（例如编辑器以新文件替换）时以当前文件为准；
+ * 2. 路径已不存在的文件，把标识一次性交给 resolver（例如文件索引）查出新路径，确认标识一致后迁移标签。
+ * 文件系统与 resolver 的访问都在快照上进行，不占用写锁；最后一次写入、一次写盘
+ */
+size_t TagManager::reconcile(const IdentityResolver& resolver) {
+    struct Fix {
+        std::string path;
+        FileIdentity expected;  // 写入时该路径的标识仍为此值才生效，否则说明期间已被修改
+        FileIdentity identity;
+        std::string newPath;    // 为空时只更新标识
+    };
+    std::vector<Fix> fixes;
+    std::vector<std::string> missingPaths;
+    std::vector<FileIdentity> missingIdentities;
+
+    const std::shared_ptr<const TagIndex> current = snapshot();
+    for (const auto& [filepath, identity] : current->taggedEntries()) {
+        const FileIdentity actual = FileIdentity::of(filepath);
+        if (actual.isValid()) {
+            if (actual != identity) {
+                fixes.push_back({filepath, identity, actual, {}});
+            }
+        } else if (identity.isValid()) {
+            missingPaths.push_back(filepath);
+            missingIdentities.push_back(identity);
+        }
+    }
+    const size_t refreshed = fixes.size();
+
+    if (!missingPaths.empty() && resolver) {
+        const std::vector<std::string> candidates = resolver(missingIdentities);
+        for (size_t i = 0; i < missingPaths.size() && i < candidates.size(); ++i) {
+            // 解析结果可能已过期，以文件系统中的标识为准
+            if (!candidates[i].empty() && FileIdentity::of(candidates[i]) == missingIdentities[i]) {
+                fixes.push_back({missingPaths[i], missingIdentities[i], missingIdentities[i], candidates[i]});
+            }
+        }
+    }
+
+    const size_t relocated = mutate([&](TagIndex& index, std::vector<TagJournal::Record>& changes) {
+        size_t count = 0;
+        for (const Fix& fix : fixes) {
+            if (index.identityOf(fix.path) != fix.expected) {
+                continue;
+            }
+            if (fix.newPath.empty()) {
+                index.setIdentity(fix.path, fix.identity);
+                changes.push_back({TagJournal::Record::Op::SetIdentity, fix.path, fix.identity.toString(), {}});
+            } else if (index.tagsForFile(fix.newPath).empty() && index.relocateFile(fix.path, fix.newPath)) {
+                // 新路径已带标签时不覆盖
+                changes.push_back({TagJournal::Record::Op::MoveFile, fix.path, {}, fix.newPath});
+                ++count;
+            }
+        }
+        return count;
+    });
+    sync();
+
+    LOG_INFO(QString("标签路径整理完成：更新 %1 个文件标识，%2 个文件已不存在，找回 %3 个。")
+                     .arg(refreshed).arg(missingPaths.size()).arg(relocated));
+    return relocated;
+}
+
+// 批量添加标签
+std::optional<size_t> TagManager::addTagToFiles(const std::vector<std::string>& filepaths, const std::string& tag,
+                                                const std::atomic<bool>* cancelled, const ProgressCallback& progress) {
+    return applyBatch(true, filepaths, tag, cancelled, progress);
+}
+
+// 批量删除标签
+std::optional<size_t> TagManager::removeTagFromFiles(const std::vector<std::string>& filepaths, const std::string& tag,
+                                                     const std::atomic<bool>* cancelled, const ProgressCallback& progress) {
+    return applyBatch(false, filepaths, tag, cancelled, progress);
+}
+
+// 批量修改：在副本上逐个修改，完成后整批一次发布，读者在此期间继续读取旧快照；整批日志一次追加、一次 fsync。
+// 是否取消只在这里决定：最后一次检查之后才点的取消不再生效，返回值如实反映本批已发布
+std::optional<size_t> TagManager::applyBatch(bool adding, const std::vector<std::string>& filepaths, const std::string& tag,
+                                             const std::atomic<bool>* cancelled, const ProgressCallback& progress) {
+    constexpr size_t progressStep = 4096;  // 每处理这么多文件检查一次取消并报告进度
+    const size_t total = filepaths.size();
+
+    const std::optional<size_t> applied = mutate([&](TagIndex& index, std::vector<TagJournal::Record>& changes) -> std::optional<size_t> {
+        std::vector<const std::string*> changed;
+        std::vector<FileIdentity> identities;  // 与 changed 对应，添加标签时用于补记标识
+        changed.reserve(total);
+
+        for (size_t i = 0; i < total; ++i) {
+            if (i % progressStep == 0) {
+                if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+                    // 撤销本批已做的修改，批量操作要么全部生效要么不生效；期间找回的移动文件仍然保留
+                    for (const std::string* filepath : changed) {
+                        adding ? index.remove(*filepath, tag) : index.add(*filepath, tag);
+                    }
+                    LOG_INFO(QString("批量标签操作已取消，撤销 %1 个文件的修改。").arg(changed.size()));
+                    return std::nullopt;
+                }
+                if (progress) {
+                    progress(i, total);
+                }
+            }
+            const std::string& filepath = filepaths[i];
+            const FileIdentity identity = followMove(index, filepath, changes);
+            if (adding ? index.add(filepath, tag) : index.remove(filepath, tag)) {
+                changed.push_back(&filepath);
+                if (adding) {
+                    identities.push_back(identity);
+                }
+            }
+        }
+
+        const auto op = adding ? TagJournal::Record::Op::AddTag : TagJournal::Record::Op::RemoveTag;
+        changes.reserve(changes.size() + changed.size());
+        for (const std::string* filepath : changed) {
+            changes.push_back({op, *filepath, tag, {}});
+        }
+        for (size_t i = 0; i < identities.size(); ++i) {
+            rememberIdentity(index, *changed[i], identities[i], changes);
+        }
+        return changed.size();
+    });
+    sync();
+
+    if (progress && applied) {
+        progress(total, total);
     }
+    return applied;
 }
 
-// 根据标签搜索文件
+// 根据标签搜索文件，直接读取该标签的倒排位图
 std::vector<std::string> TagManager::searchFilesByTag(const std::string& tag) const {
-    std::vector<std::string> filepaths;
-    for (const auto& [filepath, fileTags] : tags) {
-        if (std::find(fileTags.begin(), fileTags.end(), tag) != fileTags.end()) {
-            filepaths.push_back(filepath);
+    return snapshot()->filesWithTag(tag);
+}
+
+// 按布尔表达式查询文件，例如 work AND 2024 AND NOT archived
+std::vector<std::string> TagManager::queryFiles(const std::string& expression) const {
+    const std::shared_ptr<const TagIndex> index = snapshot();
+    return index->paths(index->evaluate(TagQuery::parse(expression)));
+}
+
+// 按布尔表达式分批输出文件。位图逐个取出文件ID，攒满一批才展开为路径，
+// 调用方提前停止时其余结果不再展开
+size_t TagManager::queryFiles(const std::string& expression, size_t batchSize, const BatchCallback& onBatch) const {
+    const std::shared_ptr<const TagIndex> index = snapshot();
+    const TagBitmap matched = index->evaluate(TagQuery::parse(expression));
+    batchSize = std::max<size_t>(batchSize, 1);
+
+    std::vector<uint32_t> ids;
+    ids.reserve(std::min(batchSize, size_t(matched.cardinality())));
+    size_t emitted = 0;
+    bool stopped = false;
+    auto flush = [&]() {
+        const std::vector<std::string> batch = index->paths(ids);
+        ids.clear();
+        emitted += batch.size();
+        stopped = !onBatch(batch);
+    };
+    matched.forEach([&](uint32_t id) {
+        if (stopped) {
+            return;
         }
+        ids.push_back(id);
+        if (ids.size() == batchSize) {
+            flush();
+        }
+    });
+    if (!stopped && !ids.empty()) {
+        flush();
     }
-    return filepaths;
+    return emitted;
+}
+
+// 按布尔表达式统计文件数，只做位图运算，不展开路径
+size_t TagManager::countFiles(const std::string& expression) const {
+    return size_t(snapshot()->evaluate(TagQuery::parse(expression)).cardinality());
+}
+
+// 表达式在当前快照上求值一次，之后每次判断按路径查文件ID再查位图，不把结果展开为路径。
+// 返回的函数持有该快照；长期保存会让之后的写操作无法复用副本而整份复制，因此只在一次查询期间使用
+std::function<bool(const std::string&)> TagManager::matcher(const std::string& expression) const {
+    std::shared_ptr<const TagIndex> index = snapshot();
+    auto matched = std::make_shared<const TagBitmap>(index->evaluate(TagQuery::parse(expression)));
+    return [index = std::move(index), matched](const std::string& filepath) {
+        return index->contains(*matched, filepath);
+    };
 }
 
 // 查看所有标签
 std::vector<std::string> TagManager::listAllTags() const {
-    std::unordered_set<std::string> allTags;
-    for (const auto& [filepath, fileTags] : tags) {
-        allTags.insert(fileTags.begin(), fileTags.end());
-    }
-    return std::vector<std::string>(allTags.begin(), allTags.end());
+    return snapshot()->allTags();
 }
 
-// 查看某个文件的标签
-std::vector<std::string> TagManager::listTagsForFile(const std::string& filepath) const {
-    if (tags.find(filepath) != tags.end()) {
-        return tags.at(filepath);
+// 查看某个文件的标签。只有当文件的标识属于另一个已不存在的路径时才需要写入，其余情况只读快照
+std::vector<std::string> TagManager::listTagsForFile(const std::string& filepath) {
+    std::shared_ptr<const TagIndex> index = snapshot();
+    if (!index->identityOf(filepath).isValid()) {
+        const std::string oldPath = index->pathForIdentity(FileIdentity::of(filepath));
+        if (!oldPath.empty() && oldPath != filepath) {
+            mutate([&](TagIndex& writable, std::vector<TagJournal::Record>& changes) {
+                followMove(writable, filepath, changes);
+                return true;
+            });
+            index = snapshot();
+        }
     }
-    return {};
+    return index->tagsForFile(filepath);
 }
 
 // 获取有效的路径输入
@@ -1,25 +1,79 @@
 #ifndef TAG_MANAGER_H
 #define TAG_MANAGER_H
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
+#include "SnapshotStore.h"
+#include "TagIndex.h"
+#include "TagJournal.h"
+
+class QLockFile;
+class TagDatabase;
+
 class TagManager {
 public:
-    TagManager(const std::string& filename);  // 构造函数
-    void loadTags();  // 加载标签
-    void saveTags() const;  // 保存标签
+    using ProgressCallback = std::function<void(size_t done, size_t total)>;  // 批量操作进度回调
+    using BatchCallback = std::function<bool(const std::vector<std::string>& filepaths)>;  // 分批输出结果，返回 false 时停止
+    // 按文件标识批量查找当前路径，返回值与参数一一对应，找不到的为空串
+    using IdentityResolver = std::function<std::vector<std::string>(const std::vector<FileIdentity>&)>;
+
+    TagManager(const std::string& filename);  // 构造函数，filename 为旧版 CSV 标签文件，数据库文件与其同名
+    ~TagManager();
+    // 加载标签：读取数据库快照并回放日志，首次运行时从 CSV 迁移；
+    // 同一份标签数据只允许一个进程打开，已被其他进程持有时抛出 std::runtime_error
+    void loadTags();
+    bool sync();  // 等待已做的修改写盘，写盘失败时返回 false（修改已生效，日志线程会继续重试）
     void addTag(const std::string& filepath, const std::string& tag);  // 添加标签
     void removeTag(const std::string& filepath, const std::string& tag);  // 删除标签
     void updateTag(const std::string& filepath, const std::string& oldTag, const std::string& newTag);  // 更新标签
+    size_t renameTag(const std::string& oldTag, const std::string& newTag);  // 全局重命名标签，新标签已在用时合并；返回涉及的文件数
+    size_t mergeTag(const std::string& source, const std::string& target);  // 将标签 source 合并到 target
+    size_t deleteTag(const std::string& tag);  // 从所有文件删除标签，返回涉及的文件数
+    size_t moveDirectory(const std::string& oldDirectory, const std::string& newDirectory);  // 目录已被移动，标签随之迁移；返回涉及的目录数
+    // 整理路径：补记缺少的文件标识，已不存在的路径按标识经 resolver 批量找回新路径；返回找回的文件数
+    size_t reconcile(const IdentityResolver& resolver);
+    // 批量添加/删除标签：先全部修改内存，最后一次写盘；返回实际修改的文件数，取消时撤销本批修改并返回 std::nullopt
+    std::optional<size_t> addTagToFiles(const std::vector<std::string>& filepaths, const std::string& tag,
+                                        const std::atomic<bool>* cancelled = nullptr, const ProgressCallback& progress = {});
+    std::optional<size_t> removeTagFromFiles(const std::vector<std::string>& filepaths, const std::string& tag,
+                                             const std::atomic<bool>* cancelled = nullptr, const ProgressCallback& progress = {});
     std::vector<std::string> searchFilesByTag(const std::string& tag) const;  // 根据标签搜索文件
+    std::vector<std::string> queryFiles(const std::string& expression) const;  // 按布尔表达式搜索文件，语法错误时抛出 std::invalid_argument
+    // 按布尔表达式分批输出文件，每批不超过 batchSize 个，只展开已输出的部分；返回输出的文件数
+    size_t queryFiles(const std::string& expression, size_t batchSize, const BatchCallback& onBatch) const;
+    size_t countFiles(const std::string& expression) const;  // 按布尔表达式统计文件数
+    // 判断单个文件是否满足表达式，表达式只求值一次；返回的函数持有快照，只应在一次查询期间使用
+    std::function<bool(const std::string&)> matcher(const std::string& expression) const;
     std::vector<std::string> listAllTags() const;  // 查看所有标签
-    std::vector<std::string> listTagsForFile(const std::string& filepath) const;  // 查看某个文件的标签
+    std::vector<std::string> listTagsForFile(const std::string& filepath);  // 查看某个文件的标签，文件移动过时先找回标签
+    std::shared_ptr<const TagIndex> snapshot() const;  // 当前标签数据的只读快照，可在任意线程中使用
 
 private:
-    std::unordered_map<std::string, std::vector<std::string>> tags;  // 标签数据
-    std::string filename;  // 标签文件名
+    void lockStore();  // 取得标签数据的独占锁，失败时抛出 std::runtime_error
+    void migrateCsv(TagDatabase& database);  // 将旧版 CSV 标签文件导入数据库
+    std::optional<size_t> applyBatch(bool adding, const std::vector<std::string>& filepaths, const std::string& tag,
+                                     const std::atomic<bool>* cancelled, const ProgressCallback& progress);
+    static void applyRecord(TagIndex& index, const TagJournal::Record& record);  // 将一条修改记录作用到索引上
+    template <typename Body>
+    auto mutate(Body&& body);  // 写操作，body(index, changes) 修改副本并记下修改记录
+    // 路径未知时按标识找回移动前的标签，返回文件标识
+    static FileIdentity followMove(TagIndex& index, const std::string& filepath, std::vector<TagJournal::Record>& changes);
+    // 为带标签的文件补记标识
+    static void rememberIdentity(TagIndex& index, const std::string& filepath, FileIdentity identity,
+                                 std::vector<TagJournal::Record>& changes);
+
+    // 标签数据（正向表与倒排表）。读操作取快照后不加锁，写操作互斥并在副本上进行，完成后原子发布
+    SnapshotStore<TagIndex, TagJournal::Record> store;
+    std::string filename;  // 旧版 CSV 标签文件名
+    std::string databaseFile;  // 标签数据库（检查点快照）
+    std::string journalFile;  // 标签修改追加日志
+    std::unique_ptr<TagJournal> journal;  // 修改只追加日志，后台批量写盘并定期合并进数据库
+    std::unique_ptr<QLockFile> ownerLock;  // 标签数据的独占锁，避免多个进程各自写日志与检查点
 };
 
 std::string getValidPath();  // 获取有效的路径
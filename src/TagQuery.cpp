@@ -0,0 +1,250 @@
+#include "TagQuery.h"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+
+struct Token {
+    enum class Type { Word, Quoted, LeftParen, RightParen, End } type;
+    std::string text;
+};
+
+// 拆分表达式：括号单独成词，双引号内的内容原样保留
+std::vector<Token> tokenize(const std::string& expression) {
+    std::vector<Token> tokens;
+    size_t i = 0;
+    while (i < expression.size()) {
+        const char c = expression[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        } else if (c == '(') {
+            tokens.push_back({Token::Type::LeftParen, "("});
+            ++i;
+        } else if (c == ')') {
+            tokens.push_back({Token::Type::RightParen, ")"});
+            ++i;
+        } else if (c == '"') {
+            const size_t close = expression.find('"', i + 1);
+            if (close == std::string::npos) {
+                throw std::invalid_argument("标签表达式中的引号未闭合");
+            }
+            tokens.push_back({Token::Type::Quoted, expression.substr(i + 1, close - i - 1)});
+            i = close + 1;
+        } else {
+            size_t end = i;
+            while (end < expression.size() && !std::isspace(static_cast<unsigned char>(expression[end]))
+                   && expression[end] != '(' && expression[end] != ')' && expression[end] != '"') {
+                ++end;
+            }
+            tokens.push_back({Token::Type::Word, expression.substr(i, end - i)});
+            i = end;
+        }
+    }
+    tokens.push_back({Token::Type::End, ""});
+    return tokens;
+}
+
+bool isKeyword(const Token& token, const char* keyword) {
+    if (token.type != Token::Type::Word) {
+        return false;
+    }
+    const std::string& text = token.text;
+    size_t length = 0;
+    while (keyword[length]) {
+        ++length;
+    }
+    if (text.size() != length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        if (std::toupper(static_cast<unsigned char>(text[i])) != keyword[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// 递归下降解析器
+class TagQuery::Parser {
+public:
+    explicit Parser(std::vector<Token> tokens) : tokens(std::move(tokens)) {}
+
+    std::unique_ptr<Node> parseExpression() {
+        auto node = parseOr();
+        if (peek().type != Token::Type::End) {
+            throw std::invalid_argument("标签表达式在 '" + peek().text + "' 附近有多余内容");
+        }
+        return node;
+    }
+
+private:
+    const Token& peek() const { return tokens[position]; }
+    const Token& next() { return tokens[position++]; }
+
+    std::unique_ptr<Node> parseOr() {
+        auto left = parseAnd();
+        if (!isKeyword(peek(), "OR")) {
+            return left;
+        }
+        auto node = std::make_unique<Node>();
+        node->kind = Node::Kind::Or;
+        node->children.push_back(std::move(left));
+        while (isKeyword(peek(), "OR")) {
+            next();
+            node->children.push_back(parseAnd());
+        }
+        return node;
+    }
+
+    // AND 可以省略：两个相邻的操作数之间按 AND 处理
+    std::unique_ptr<Node> parseAnd() {
+        auto left = parseNot();
+        auto node = std::make_unique<Node>();
+        node->kind = Node::Kind::And;
+        node->children.push_back(std::move(left));
+        while (true) {
+            if (isKeyword(peek(), "AND")) {
+                next();
+            } else if (!startsOperand(peek())) {
+                break;
+            }
+            node->children.push_back(parseNot());
+        }
+        if (node->children.size() == 1) {
+            return std::move(node->children.front());
+        }
+        return node;
+    }
+
+    std::unique_ptr<Node> parseNot() {
+        if (isKeyword(peek(), "NOT")) {
+            next();
+            auto node = std::make_unique<Node>();
+            node->kind = Node::Kind::Not;
+            node->children.push_back(parseNot());
+            return node;
+        }
+        return parsePrimary();
+    }
+
+    std::unique_ptr<Node> parsePrimary() {
+        const Token& token = next();
+        if (token.type == Token::Type::LeftParen) {
+            auto node = parseOr();
+            if (next().type != Token::Type::RightParen) {
+                throw std::invalid_argument("标签表达式缺少右括号");
+            }
+            return node;
+        }
+        if (token.type == Token::Type::Quoted
+            || (token.type == Token::Type::Word && !isKeyword(token, "AND") && !isKeyword(token, "OR"))) {
+            auto node = std::make_unique<Node>();
+            node->kind = Node::Kind::Tag;
+            node->tag = token.text;
+            return node;
+        }
+        if (token.type == Token::Type::End) {
+            throw std::invalid_argument("标签表达式不完整");
+        }
+        throw std::invalid_argument("标签表达式在 '" + token.text + "' 处有语法错误");
+    }
+
+    static bool startsOperand(const Token& token) {
+        return token.type == Token::Type::LeftParen || token.type == Token::Type::Quoted
+               || (token.type == Token::Type::Word && !isKeyword(token, "AND") && !isKeyword(token, "OR"));
+    }
+
+    std::vector<Token> tokens;
+    size_t position = 0;
+};
+
+// 解析表达式
+TagQuery TagQuery::parse(const std::string& expression) {
+    Parser parser(tokenize(expression));
+    TagQuery query;
+    query.root = parser.parseExpression();
+    return query;
+}
+
+// 求值
+TagBitmap TagQuery::evaluate(const PostingsLookup& lookup, const TagBitmap& universe) const {
+    if (!root) {
+        return TagBitmap();
+    }
+    return evaluateNode(*root, lookup, universe);
+}
+
+// AND 节点先按基数从小到大求交集，NOT 子项直接做差集，不展开全集
+TagBitmap TagQuery::evaluateNode(const Node& node, const PostingsLookup& lookup, const TagBitmap& universe) {
+    switch (node.kind) {
+        case Node::Kind::Tag: {
+            const TagBitmap* postings = lookup(node.tag);
+            return postings ? *postings : TagBitmap();
+        }
+        case Node::Kind::Not: {
+            TagBitmap result = universe;
+            result -= evaluateNode(*node.children.front(), lookup, universe);
+            return result;
+        }
+        case Node::Kind::Or: {
+            TagBitmap result;
+            for (const auto& child : node.children) {
+                result |= evaluateNode(*child, lookup, universe);
+            }
+            return result;
+        }
+        case Node::Kind::And: {
+            std::vector<TagBitmap> positives;
+            std::vector<const Node*> negatives;
+            for (const auto& child : node.children) {
+                if (child->kind == Node::Kind::Not) {
+                    negatives.push_back(child->children.front().get());
+                } else {
+                    positives.push_back(evaluateNode(*child, lookup, universe));
+                }
+            }
+
+            TagBitmap result;
+            if (positives.empty()) {
+                result = universe;
+            } else {
+                std::sort(positives.begin(), positives.end(), [](const TagBitmap& a, const TagBitmap& b) {
+                    return a.cardinality() < b.cardinality();
+                });
+                result = std::move(positives.front());
+                for (size_t i = 1; i < positives.size() && !result.empty(); ++i) {
+                    result &= positives[i];
+                }
+            }
+            for (const Node* negative : negatives) {
+                if (result.empty()) {
+                    break;
+                }
+                result -= evaluateNode(*negative, lookup, universe);
+            }
+            return result;
+        }
+    }
+    return TagBitmap();
+}
+
+// 表达式中出现的全部标签
+std::vector<std::string> TagQuery::tags() const {
+    std::vector<std::string> out;
+    if (root) {
+        collectTags(*root, out);
+    }
+    return out;
+}
+
+void TagQuery::collectTags(const Node& node, std::vector<std::string>& out) {
+    if (node.kind == Node::Kind::Tag) {
+        out.push_back(node.tag);
+    }
+    for (const auto& child : node.children) {
+        collectTags(*child, out);
+    }
+}
@@ -0,0 +1,48 @@
+/*
+ * TagQuery.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 标签布尔查询，例如 work AND 2024 AND NOT archived
+ */
+
+#ifndef TAG_QUERY_H
+#define TAG_QUERY_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TagBitmap.h"
+
+// 语法：NOT 优先级最高，其次 AND，最后 OR；相邻的两个标签之间默认为 AND；
+// 可以用括号分组，包含空格或与关键字同名的标签用双引号括起来
+class TagQuery {
+public:
+    // 给定标签名返回其倒排位图，标签不存在时返回 nullptr
+    using PostingsLookup = std::function<const TagBitmap*(const std::string&)>;
+
+    static TagQuery parse(const std::string& expression);  // 解析表达式，语法错误时抛出 std::invalid_argument
+
+    // 以位图运算求值，universe 为 NOT 的全集（所有带标签的文件）
+    TagBitmap evaluate(const PostingsLookup& lookup, const TagBitmap& universe) const;
+    std::vector<std::string> tags() const;  // 表达式中出现的全部标签
+
+private:
+    struct Node {
+        enum class Kind { Tag, And, Or, Not } kind;
+        std::string tag;
+        std::vector<std::unique_ptr<Node>> children;
+    };
+
+    class Parser;
+
+    static TagBitmap evaluateNode(const Node& node, const PostingsLookup& lookup, const TagBitmap& universe);
+    static void collectTags(const Node& node, std::vector<std::string>& out);
+
+    std::shared_ptr<const Node> root;
+};
+
+#endif // TAG_QUERY_H
@@ -0,0 +1,148 @@
+/*
+ * Trace.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 性能跟踪实现。每个线程独占一个 PerThreadRing 环，线程退出后环保留到被新线程复用；
+ *          环在线程第一次记录时分配，从未开启跟踪时不占用内存
+ */
+
+#include "Trace.h"
+#include "PerThreadRing.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QThread>
+#include <chrono>
+#include <cstring>
+
+namespace TraceDetail {
+std::atomic<bool> enabled{false};
+} // namespace TraceDetail
+
+namespace {
+
+const quint64 SpansPerThread = 16384;  // 2 的幂
+
+struct Span {
+    const char *name;
+    qint64 begin;
+    qint64 end;
+    qint64 count;
+};
+
+// 环的 first 为开启跟踪之后的第一条记录，index 为导出时的线程编号
+using SpanRings = PerThreadRing<Span, SpansPerThread>;
+
+std::atomic<qint64> epoch{0};           // 开启跟踪的时刻，导出的时间戳相对于它
+
+// 线程名：QThread 的 objectName，没有时用类名，如 DatabaseThread；主线程为 GUI
+QString currentThreadName() {
+    QThread *thread = QThread::currentThread();
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+        return "GUI";
+    }
+    if (!thread) {
+        return QString();
+    }
+    return thread->objectName().isEmpty() ? QString(thread->metaObject()->className()) : thread->objectName();
+}
+
+// 线程取得环时记下线程名。复用的环保留上一个线程的记录，线程池回收空闲线程后它们的耗时段仍可导出，
+// 归在同一个线程编号下
+void nameRing(SpanRings::Ring &ring) {
+    const QByteArray name = currentThreadName().toUtf8();
+    std::strncpy(ring.threadName, name.constData(), sizeof(ring.threadName) - 1);
+}
+
+// 微秒，保留三位小数
+void appendMicros(QByteArray &out, qint64 nanoseconds) {
+    if (nanoseconds < 0) {
+        out += '-';
+        nanoseconds = -nanoseconds;
+    }
+    out += QByteArray::number(nanoseconds / 1000);
+    out += '.';
+    const int fraction = int(nanoseconds % 1000);
+    out += char('0' + fraction / 100);
+    out += char('0' + fraction / 10 % 10);
+    out += char('0' + fraction % 10);
+}
+
+} // namespace
+
+void Trace::setEnabled(bool enabled) {
+    if (enabled && !isEnabled()) {
+        epoch.store(now(), std::memory_order_relaxed);
+        for (SpanRings::Ring *ring = SpanRings::rings(); ring; ring = ring->next) {
+            ring->first.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+        }
+    }
+    TraceDetail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 Trace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::complete(const char *name, qint64 beginTicks, qint64 endTicks, qint64 count) {
+    quint64 head;
+    Span &span = SpanRings::claim(head, nameRing);
+    span.name = name;
+    span.begin = beginTicks;
+    span.end = endTicks;
+    span.count = count;
+    SpanRings::publish(head);
+}
+
+/*
+ * Summary: 导出 Chrome trace JSON。每段耗时为一个 "X" 事件，线程名以 thread_name 元数据事件给出；
+ *          导出时仍在记录的线程可能覆盖最旧的几段，这些记录会被跳过
+ * Parameters:
+ * const QString &path - 输出文件
+ * Return: bool - 是否成功写入
+ */
+bool Trace::exportChrome(const QString &path) {
+    const qint64 base = epoch.load(std::memory_order_relaxed);
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+
+    QByteArray out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool firstEvent = true;
+    for (SpanRings::Ring *ring = SpanRings::rings(); ring; ring = ring->next) {
+        const SpanRings::Range range = SpanRings::readable(*ring);
+        if (range.begin >= range.end) {
+            continue;
+        }
+        const QByteArray tid = QByteArray::number(ring->index);
+
+        QByteArray threadName(ring->threadName);
+        threadName.replace('\\', "\\\\").replace('"', "\\\"");
+        out += firstEvent ? "" : ",\n";
+        firstEvent = false;
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid
+               + ",\"args\":{\"name\":\"" + threadName + "\"}}";
+
+        SpanRings::read(*ring, range, [&](const Span &span) {
+            out += ",\n{\"name\":\"";
+            out += span.name;
+            out += "\",\"cat\":\"filetag\",\"ph\":\"X\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"ts\":";
+            appendMicros(out, span.begin - base);
+            out += ",\"dur\":";
+            appendMicros(out, span.end - span.begin);
+            out += ",\"args\":{\"count\":" + QByteArray::number(span.count) + "}}";
+        });
+    }
+    out += "\n]}\n";
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(out);
+    return file.commit();
+}
@@ -0,0 +1,55 @@
+/*
+ * Trace.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 性能跟踪。TraceSpan 在作用域结束时把一段耗时写入本线程的缓冲区，导出为 Chrome trace JSON，
+ *          可在 Perfetto（ui.perfetto.dev）或 chrome://tracing 中按线程查看；
+ *          跟踪默认关闭，关闭时每个 TraceSpan 只有一次原子读
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <atomic>
+
+namespace TraceDetail {
+extern std::atomic<bool> enabled;
+} // namespace TraceDetail
+
+class Trace {
+public:
+    static bool isEnabled() { return TraceDetail::enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled);  // 开启时清空之前的记录
+    static qint64 now();                   // 单调时钟，纳秒
+
+    // name 必须是字符串字面量（只含 ASCII），缓冲区中只保存指针
+    static void complete(const char *name, qint64 beginTicks, qint64 endTicks, qint64 count);
+
+    // 写出各线程缓冲区中的记录，返回是否成功；每个线程只保留最近的 16384 段
+    static bool exportChrome(const QString &path);
+};
+
+class TraceSpan {
+public:
+    explicit TraceSpan(const char *name, qint64 count = 0)
+        : name(Trace::isEnabled() ? name : nullptr), count(count), begin(this->name ? Trace::now() : 0) {}
+    ~TraceSpan() {
+        if (name) {
+            Trace::complete(name, begin, Trace::now(), count);
+        }
+    }
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+    void setCount(qint64 value) { count = value; }  // 导出为 args.count，如条目数、字节数
+
+private:
+    const char *name;
+    qint64 count;
+    qint64 begin;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,125 @@
+/*
+ * TreeGen.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetag-treegen：按种子生成可重复的合成目录树，供搜索、索引与内容相关的基准测试使用，
+ *          完成后以 JSON 输出参数与统计。先用 --dry-run 估计规模再生成，例如约一千万条目：
+ *          filetag-treegen --depth 7 --fanout 6 --files 30 /dev/shm/tree10m
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include "TreeGenerator.h"
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QTextStream errors(stderr);
+
+    const TreeSpec defaults;
+    QCommandLineParser parser;
+    parser.setApplicationDescription("按种子生成可重复的合成目录树");
+    parser.addHelpOption();
+    parser.addPositionalArgument("root", "生成目录树的位置");
+    parser.addOptions({
+            {"seed", "随机种子", "n", QString::number(defaults.seed)},
+            {"depth", "根目录以下的最大层数", "n", QString::number(defaults.depth)},
+            {"fanout", "每个目录的平均子目录数", "n", QString::number(defaults.fanout)},
+            {"files", "每个目录文件数的中位数", "n", QString::number(defaults.filesMedian)},
+            {"skew", "目录文件数的偏斜程度（对数正态分布的 sigma）", "sigma", QString::number(defaults.filesSkew)},
+            {"huge-ratio", "超大目录（如 node_modules）所占比例", "ratio", QString::number(defaults.hugeDirRatio)},
+            {"huge-files", "超大目录的文件数", "n", QString::number(defaults.hugeDirFiles)},
+            {"name-min", "名称最短字符数", "n", QString::number(defaults.nameLengthMin)},
+            {"name-max", "名称最长字符数", "n", QString::number(defaults.nameLengthMax)},
+            {"cjk", "纯中日韩字符名称的比例", "ratio", QString::number(defaults.cjkRatio)},
+            {"mixed", "混合字符名称的比例", "ratio", QString::number(defaults.mixedRatio)},
+            {"symlinks", "文件附带符号链接的概率", "ratio", QString::number(defaults.symlinkRatio)},
+            {"size-mode", "文件内容：empty、sparse 或 content", "mode", "empty"},
+            {"size", "文件大小的中位数（字节）", "bytes", QString::number(defaults.sizeMedian)},
+            {"threads", "创建线程数，0 表示 CPU 核数", "n", "0"},
+            {"dry-run", "只统计规模，不写盘"}
+    });
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    const bool dryRun = parser.isSet("dry-run");
+    if (arguments.size() != 1 && !dryRun) {
+        parser.showHelp(2);
+    }
+
+    TreeSpec spec;
+    spec.seed = parser.value("seed").toULongLong();
+    spec.depth = parser.value("depth").toInt();
+    spec.fanout = parser.value("fanout").toDouble();
+    spec.filesMedian = parser.value("files").toDouble();
+    spec.filesSkew = parser.value("skew").toDouble();
+    spec.hugeDirRatio = parser.value("huge-ratio").toDouble();
+    spec.hugeDirFiles = parser.value("huge-files").toInt();
+    spec.nameLengthMin = qMax(1, parser.value("name-min").toInt());
+    spec.nameLengthMax = parser.value("name-max").toInt();
+    spec.cjkRatio = parser.value("cjk").toDouble();
+    spec.mixedRatio = parser.value("mixed").toDouble();
+    spec.symlinkRatio = parser.value("symlinks").toDouble();
+    spec.sizeMedian = parser.value("size").toLongLong();
+    spec.threads = parser.value("threads").toInt();
+
+    const QString sizeMode = parser.value("size-mode");
+    if (sizeMode == "empty") {
+        spec.sizeMode = TreeSpec::SizeMode::Empty;
+    } else if (sizeMode == "sparse") {
+        spec.sizeMode = TreeSpec::SizeMode::Sparse;
+    } else if (sizeMode == "content") {
+        spec.sizeMode = TreeSpec::SizeMode::Content;
+    } else {
+        errors << "未知的 --size-mode: " << sizeMode << "\n";
+        return 2;
+    }
+
+    const QString root = arguments.value(0);
+    TreeGenerator generator(spec);
+    QElapsedTimer timer;
+    timer.start();
+    const bool ok = generator.generate(root, dryRun);
+    const qint64 elapsed = timer.elapsed();
+    const TreeStats stats = generator.stats();
+    if (!ok) {
+        errors << "生成失败: " << generator.errorString() << "\n";
+    }
+
+    const qint64 entries = stats.directories + stats.files + stats.symlinks;
+    const QJsonObject report{
+            {"root", root},
+            {"dryRun", dryRun},
+            {"spec", QJsonObject{{"seed", QString::number(spec.seed)},
+                                 {"depth", spec.depth},
+                                 {"fanout", spec.fanout},
+                                 {"filesMedian", spec.filesMedian},
+                                 {"filesSkew", spec.filesSkew},
+                                 {"hugeDirRatio", spec.hugeDirRatio},
+                                 {"hugeDirFiles", spec.hugeDirFiles},
+                                 {"nameLengthMin", spec.nameLengthMin},
+                                 {"nameLengthMax", spec.nameLengthMax},
+                                 {"cjkRatio", spec.cjkRatio},
+                                 {"mixedRatio", spec.mixedRatio},
+                                 {"symlinkRatio", spec.symlinkRatio},
+                                 {"sizeMode", sizeMode},
+                                 {"sizeMedian", spec.sizeMedian}}},
+            {"directories", stats.directories},
+            {"files", stats.files},
+            {"symlinks", stats.symlinks},
+            {"bytes", stats.bytes},
+            {"elapsedMs", elapsed},
+            {"entriesPerSec", elapsed > 0 ? entries * 1000.0 / elapsed : 0.0}
+    };
+    QFile output;
+    output.open(stdout, QIODevice::WriteOnly);
+    output.write(QJsonDocument(report).toJson());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,271 @@
+/*
+ * TreeGenerator.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 合成目录树生成器实现。随机数与分布都在本文件中实现，不依赖标准库分布的具体实现，
+ *          同一种子在不同编译器下生成相同的树；每个目录是线程池中的一个任务，创建完子目录后立即投递子目录任务
+ */
+
+#include "TreeGenerator.h"
+
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <cmath>
+
+#ifndef Q_OS_WIN
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char AsciiChars[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-";
+const char *const Extensions[] = {"txt", "md", "cpp", "h", "py", "js", "json", "png", "jpg", "pdf",
+                                  "docx", "xlsx", "zip", "log", "csv", ""};
+const char *const HugeDirNames[] = {"node_modules", ".git", "cache", "site-packages"};
+const int MaxFilesPerDirectory = 1000000;
+const qint64 ContentChunk = 64 * 1024;
+
+quint64 mix(quint64 value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// splitmix64
+class Random {
+public:
+    explicit Random(quint64 seed) : state(seed) {}
+
+    quint64 next() {
+        state += 0x9E3779B97F4A7C15ULL;
+        return mix(state);
+    }
+
+    double uniform() { return double(next() >> 11) / 9007199254740992.0; }  // [0, 1)
+    bool chance(double probability) { return uniform() < probability; }
+    int range(int low, int high) { return low + int(next() % quint64(high - low + 1)); }  // [low, high]
+
+    double normal() {
+        const double u1 = double((next() >> 11) + 1) / 9007199254740993.0;  // (0, 1)
+        const double u2 = uniform();
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    }
+
+    double logNormal(double median, double sigma) { return median * std::exp(sigma * normal()); }
+    double exponential(double mean) { return -mean * std::log(1.0 - uniform()); }
+
+private:
+    quint64 state;
+};
+
+/*
+ * Summary: 生成名称主体。纯 ASCII、纯中日韩字符或两者与空格混合，比例由 spec 决定
+ * Parameters:
+ * Random &random - 当前目录的随机数
+ * const TreeSpec &spec - 生成参数
+ * Return: QString - 名称主体，不含编号与扩展名
+ */
+QString randomName(Random &random, const TreeSpec &spec) {
+    const int length = random.range(spec.nameLengthMin, qMax(spec.nameLengthMin, spec.nameLengthMax));
+    const double kind = random.uniform();
+    const bool cjk = kind < spec.cjkRatio;
+    const bool mixed = !cjk && kind < spec.cjkRatio + spec.mixedRatio;
+
+    QString name;
+    name.reserve(length);
+    for (int i = 0; i < length; ++i) {
+        if (cjk || (mixed && random.chance(0.4))) {
+            name += QChar(char16_t(random.range(0x4E00, 0x9FFF)));
+        } else if (mixed && i > 0 && i < length - 1 && random.chance(0.1)) {
+            name += QChar(' ');
+        } else {
+            name += QChar(AsciiChars[random.range(0, int(sizeof(AsciiChars)) - 2)]);
+        }
+    }
+    return name;
+}
+
+bool makeDirectory(const QString &path) {
+#ifdef Q_OS_WIN
+    return QDir().mkdir(path);
+#else
+    return ::mkdir(QFile::encodeName(path).constData(), 0755) == 0;
+#endif
+}
+
+// 按大小模式创建文件：Empty 为空文件，Sparse 只设置长度，Content 写入由 seed 决定的单词文本
+bool writeFile(const QString &path, qint64 size, TreeSpec::SizeMode mode, quint64 seed) {
+    QByteArray chunk;
+    if (mode == TreeSpec::SizeMode::Content && size > 0) {
+        Random random(seed);
+        chunk.reserve(int(qMin(size, ContentChunk)));
+        while (chunk.size() < qMin(size, ContentChunk)) {
+            const int word = random.range(2, 10);
+            for (int i = 0; i < word; ++i) {
+                chunk += char('a' + random.range(0, 25));
+            }
+            chunk += random.chance(0.1) ? '\n' : ' ';
+        }
+        chunk.truncate(int(qMin(size, ContentChunk)));
+    }
+
+#ifdef Q_OS_WIN
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    if (mode == TreeSpec::SizeMode::Sparse) {
+        return file.resize(size);
+    }
+    for (qint64 written = 0; !chunk.isEmpty() && written < size; written += chunk.size()) {
+        if (file.write(chunk.constData(), qMin<qint64>(chunk.size(), size - written)) < 0) {
+            return false;
+        }
+    }
+    return true;
+#else
+    const int fd = ::open(QFile::encodeName(path).constData(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = true;
+    if (mode == TreeSpec::SizeMode::Sparse) {
+        ok = ::ftruncate(fd, off_t(size)) == 0;
+    }
+    for (qint64 written = 0; ok && !chunk.isEmpty() && written < size;) {
+        const ssize_t n = ::write(fd, chunk.constData(), size_t(qMin<qint64>(chunk.size(), size - written)));
+        ok = n > 0;
+        written += n;
+    }
+    return ::close(fd) == 0 && ok;
+#endif
+}
+
+} // namespace
+
+TreeGenerator::TreeGenerator(const TreeSpec &spec) : spec(spec) {}
+
+bool TreeGenerator::generate(const QString &root, bool dryRun) {
+    if (!dryRun && !QDir().mkpath(root)) {
+        fail("无法创建根目录: " + root);
+        return false;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(spec.threads > 0 ? spec.threads : QThread::idealThreadCount());
+    generateDirectory(QDir(root).absolutePath(), spec.seed, 0, false, dryRun, &pool);
+    pool.waitForDone();
+    return !hasError.load();
+}
+
+TreeStats TreeGenerator::stats() const {
+    TreeStats result;
+    result.directories = counters.directories.load();
+    result.files = counters.files.load();
+    result.symlinks = counters.symlinks.load();
+    result.bytes = counters.bytes.load();
+    return result;
+}
+
+QString TreeGenerator::errorString() const {
+    if (!hasError.load()) {
+        return QString();
+    }
+    return QString("%1（共 %2 处失败）").arg(firstError).arg(counters.failures.load());
+}
+
+// 只保留第一处错误的说明，其余只计数
+void TreeGenerator::fail(const QString &message) {
+    counters.failures.fetch_add(1);
+    bool expected = false;
+    if (hasError.compare_exchange_strong(expected, true)) {
+        firstError = message;
+    }
+}
+
+/*
+ * Summary: 生成一个目录的内容。先确定并创建全部子目录，把子目录投递到线程池，再创建文件与符号链接；
+ *          子目录的种子由本目录种子与子目录序号得出，与创建顺序无关
+ * Parameters:
+ * const QString &path - 目录路径，已存在
+ * quint64 seed - 本目录的种子
+ * int level - 层数，根目录为 0
+ * bool huge - 是否为超大目录，超大目录只有文件
+ * bool dryRun - 只统计不写盘
+ * QThreadPool *pool - 子目录任务使用的线程池
+ * Return: void
+ */
+void TreeGenerator::generateDirectory(const QString &path, quint64 seed, int level, bool huge, bool dryRun,
+                                      QThreadPool *pool) {
+    Random random(seed);
+
+    int subdirectories = 0;
+    if (!huge && level < spec.depth) {
+        subdirectories = qMin(int(random.exponential(spec.fanout) + 0.5), int(spec.fanout * 4));
+    }
+    const int files = huge ? spec.hugeDirFiles
+                           : int(qMin(random.logNormal(spec.filesMedian, spec.filesSkew) + 0.5,
+                                      double(MaxFilesPerDirectory)));
+
+    QStringList directoryNames;
+    for (int i = 0; i < subdirectories; ++i) {
+        const bool childHuge = random.chance(spec.hugeDirRatio);
+        const QString base = childHuge ? QString(HugeDirNames[random.range(0, 3)]) : randomName(random, spec);
+        const QString name = QString("%1_d%2").arg(base).arg(i);
+        const QString childPath = path + '/' + name;
+        const quint64 childSeed = mix(seed ^ mix(quint64(i) + 1));
+        directoryNames << name;
+
+        if (!dryRun && !makeDirectory(childPath)) {
+            fail("无法创建目录: " + childPath);
+            continue;
+        }
+        counters.directories.fetch_add(1, std::memory_order_relaxed);
+        pool->start([this, childPath, childSeed, level, childHuge, dryRun, pool] {
+            generateDirectory(childPath, childSeed, level + 1, childHuge, dryRun, pool);
+        });
+    }
+
+    const int extensionCount = int(sizeof(Extensions) / sizeof(Extensions[0]));
+    for (int i = 0; i < files; ++i) {
+        const QString extension = Extensions[random.range(0, extensionCount - 1)];
+        const QString name = QString("%1_%2").arg(randomName(random, spec)).arg(i)
+                             + (extension.isEmpty() ? QString() : "." + extension);
+        const qint64 size = qint64(random.logNormal(double(spec.sizeMedian), 1.5));
+        const quint64 contentSeed = random.next();
+        const bool link = random.chance(spec.symlinkRatio);
+        const bool linkToDirectory = random.chance(0.2) && !directoryNames.isEmpty();
+        const QString linkTarget = linkToDirectory ? directoryNames[random.range(0, directoryNames.size() - 1)] : name;
+
+        const QString filePath = path + '/' + name;
+        if (!dryRun && !writeFile(filePath, size, spec.sizeMode, contentSeed)) {
+            fail("无法创建文件: " + filePath);
+            continue;
+        }
+        counters.files.fetch_add(1, std::memory_order_relaxed);
+        if (spec.sizeMode != TreeSpec::SizeMode::Empty) {
+            counters.bytes.fetch_add(size, std::memory_order_relaxed);
+        }
+
+#ifndef Q_OS_WIN
+        if (link) {
+            // 相对路径的链接，整棵树移动后仍然有效；指向同级目录时不会形成环
+            const QString linkPath = filePath + ".link";
+            if (!dryRun && ::symlink(QFile::encodeName(linkTarget).constData(), QFile::encodeName(linkPath).constData()) != 0) {
+                fail("无法创建符号链接: " + linkPath);
+                continue;
+            }
+            counters.symlinks.fetch_add(1, std::memory_order_relaxed);
+        }
+#else
+        Q_UNUSED(link);
+#endif
+    }
+}
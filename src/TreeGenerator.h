@@ -0,0 +1,73 @@
+/*
+ * TreeGenerator.h
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 合成目录树生成器。由种子确定整棵树：每个目录的子目录数、文件数、名称、符号链接与文件大小
+ *          只取决于种子和它在树中的位置，因此多线程并行创建的结果与线程数、调度无关，可用于可重复的基准测试
+ */
+
+#ifndef TREE_GENERATOR_H
+#define TREE_GENERATOR_H
+
+#include <QString>
+#include <atomic>
+
+class QThreadPool;
+
+struct TreeSpec {
+    enum class SizeMode { Empty, Sparse, Content };
+
+    quint64 seed = 1;
+    int depth = 4;                  // 根目录以下的最大层数
+    double fanout = 6;              // 每个目录的平均子目录数（指数分布，上限为 4 倍）
+    double filesMedian = 20;        // 每个目录文件数的中位数（对数正态分布）
+    double filesSkew = 1.0;         // 对数正态分布的 sigma，越大少数目录越大
+    double hugeDirRatio = 0.002;    // 类似 node_modules 的超大目录所占比例
+    int hugeDirFiles = 20000;       // 超大目录的文件数
+    int nameLengthMin = 4;          // 名称长度（字符数，不含编号与扩展名）
+    int nameLengthMax = 24;
+    double cjkRatio = 0.15;         // 名称全部为中日韩字符的比例
+    double mixedRatio = 0.15;       // 名称混合 ASCII、中日韩字符与空格的比例，其余为纯 ASCII
+    double symlinkRatio = 0.01;     // 每个文件附带一个符号链接的概率，Windows 下忽略
+    SizeMode sizeMode = SizeMode::Empty;
+    qint64 sizeMedian = 4096;       // 文件大小的中位数（对数正态分布，sigma 为 1.5）
+    int threads = 0;                // 创建线程数，0 表示 CPU 核数
+};
+
+struct TreeStats {
+    qint64 directories = 0;
+    qint64 files = 0;
+    qint64 symlinks = 0;
+    qint64 bytes = 0;               // 文件的逻辑大小之和
+};
+
+class TreeGenerator {
+public:
+    explicit TreeGenerator(const TreeSpec &spec);
+
+    // 在 root 下生成目录树，root 不存在时创建；dryRun 时只统计不写盘，可用于调整参数
+    bool generate(const QString &root, bool dryRun = false);
+    TreeStats stats() const;
+    QString errorString() const;
+
+private:
+    struct Counters {
+        std::atomic<qint64> directories{0};
+        std::atomic<qint64> files{0};
+        std::atomic<qint64> symlinks{0};
+        std::atomic<qint64> bytes{0};
+        std::atomic<qint64> failures{0};
+    };
+
+    void generateDirectory(const QString &path, quint64 seed, int level, bool huge, bool dryRun, QThreadPool *pool);
+    void fail(const QString &message);
+
+    TreeSpec spec;
+    Counters counters;
+    QString firstError;
+    std::atomic<bool> hasError{false};
+};
+
+#endif // TREE_GENERATOR_H
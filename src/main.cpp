@@ -9,12 +9,16 @@
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QDebug>
+#include <QFileSystemWatcher>
+#include <QMessageBox>
 
 #include "mainwindow.h"
 #include "Logger.h"
+#include "FlightRecorder.h"
+#include "Metrics.h"
+#include "Trace.h"
 #include "about.h"
 #include "FileSearch.h"
-#include "FileSearchCore.h"
 
 void applyStyleSheet(QApplication &app) {
     QFile file(":/stylesheet.qss");
@@ -41,6 +45,27 @@ int main(int argc, char *argv[]) {
 
     QApplication app(argc, argv);
 
+    // 日志设置在其他模块输出日志之前读取，修改 settings.ini 后无需重启即可生效
+    QString settingsFile = QDir::currentPath() + "/settings.ini";
+    Logger::instance().loadSettings(settingsFile);
+    QFileSystemWatcher settingsWatcher(QStringList() << settingsFile);
+    QObject::connect(&settingsWatcher, &QFileSystemWatcher::fileChanged, [&settingsWatcher](const QString &path) {
+        Logger::instance().loadSettings(path);
+        if (!settingsWatcher.files().contains(path)) {
+            settingsWatcher.addPath(path);  // 部分编辑器以替换文件的方式保存，需要重新监视
+        }
+    });
+
+    // 运行记录只在内存中保留，收到 SIGUSR1 或崩溃时导出到 logs 目录
+    FlightRecorder::installSignalHandlers("logs");
+
+    // 指标定期写入 logs/metrics.prom（Prometheus 文本格式），间隔为 0 时不导出
+    const int metricsInterval = QSettings(settingsFile, QSettings::IniFormat).value("Metrics/exportIntervalSec", 15).toInt();
+    MetricsExporter metricsExporter("logs/metrics.prom", metricsInterval);
+
+    // 性能跟踪也可以在“帮助”菜单中开启，停止时导出
+    Trace::setEnabled(QSettings(settingsFile, QSettings::IniFormat).value("Trace/enabled", false).toBool());
+
     // 测试 SQLite 驱动是否可用
     if (!QSqlDatabase::isDriverAvailable("QSQLITE")) {
         LOG_ERROR("SQLite 驱动不可用。请检查插件路径和 Qt 安装。");
@@ -52,10 +77,17 @@ int main(int argc, char *argv[]) {
     applyStyleSheet(app);
     app.setWindowIcon(QIcon(":/logo.png")); // 确保图标路径正确
 
-    MainWindow w;
-    w.show();
+    // filetagd 正在运行时标签操作交给它；标签数据被另一个实例占用且 filetagd 不可用时无法启动，直接告知用户
+    std::unique_ptr<MainWindow> w;
+    try {
+        w = std::make_unique<MainWindow>();
+    } catch (const std::exception &e) {
+        LOG_ERROR(QString("主窗口创建失败：%1").arg(e.what()));
+        QMessageBox::critical(nullptr, "无法启动", QString::fromStdString(e.what()));
+        return 1;
+    }
+    w->show();
 
-    QString settingsFile = QDir::currentPath() + "/settings.ini";
     QSettings settings(settingsFile, QSettings::IniFormat);
 
     bool showAbout = settings.value("showAbout", true).toBool();
@@ -74,11 +106,8 @@ int main(int argc, char *argv[]) {
     }
 
     if (about) {
-        QObject::connect(&w, &MainWindow::mainWindowClosed, about.get(), &QWidget::close);
+        QObject::connect(w.get(), &MainWindow::mainWindowClosed, about.get(), &QWidget::close);
     }
 
-    FileSearchCore* searchCore = new FileSearchCore(nullptr);
-    //searchCore->initFileDatabase();
-
     return app.exec();
 }
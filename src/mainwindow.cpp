@@ -7,19 +7,31 @@
 #include <QPixmap>
 #include <QCloseEvent>
 #include <QStringListModel>
+#include <QProgressDialog>
+#include <QEventLoop>
+#include <QThread>
+#include <QPointer>
+#include <QApplication>
+#include <QDateTime>
+#include <QFileInfo>
+#include <unordered_set>
+#include <algorithm>
 
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "MultiSelectDialog.h"
 #include "FileSearch.h"
 #include "Logger.h"
+#include "FlightRecorder.h"
+#include "MetricsPanel.h"
+#include "Trace.h"
 #include "FileTransfer.h"
 
 MainWindow::MainWindow(QWidget *parent)
         : QMainWindow(parent),
           ui(new Ui::MainWindow),
           fileModel(new QFileSystemModel(this)),
-          fileTagSystem("tags.csv", "users.csv"),
+          fileTagSystem("tags.csv", "users.csv", IndexProtocol::DefaultServerName),
           homeWidget(nullptr) {
 
     ui->setupUi(this); // 确保 setupUi 被正确调用
@@ -38,11 +50,17 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->actionFileSearch, &QAction::triggered, this, &MainWindow::onFileSearchClicked);
     connect(ui->actionFileTransfer, &QAction::triggered, this, &MainWindow::onFileTransferClicked);
     connect(ui->actionAddTag, &QAction::triggered, this, &MainWindow::onAddTagClicked);
+    connect(ui->actionAddFolderTag, &QAction::triggered, this, &MainWindow::onAddFolderTagClicked);
     connect(ui->actionSearchTag, &QAction::triggered, this, &MainWindow::onSearchTagClicked);
     connect(ui->actionRemoveTag, &QAction::triggered, this, &MainWindow::onRemoveTagClicked);
     connect(ui->actionUpdateTag, &QAction::triggered, this, &MainWindow::onUpdateTagClicked);
+    connect(ui->actionReconcileTags, &QAction::triggered, this, &MainWindow::onReconcileTagsClicked);
     connect(ui->actionAbout, &QAction::triggered, this, &MainWindow::showAboutDialog);
     connect(ui->actionDocumentation, &QAction::triggered, this, &MainWindow::showDocumentation);
+    connect(ui->actionDumpFlightRecorder, &QAction::triggered, this, &MainWindow::onDumpFlightRecorderClicked);
+    connect(ui->actionShowMetrics, &QAction::triggered, this, &MainWindow::onShowMetricsClicked);
+    ui->actionRecordTrace->setChecked(Trace::isEnabled());  // 可能已由 settings.ini 开启
+    connect(ui->actionRecordTrace, &QAction::toggled, this, &MainWindow::onRecordTraceToggled);
 
     // 设置文件系统模型和视图
     fileModel->setRootPath(QDir::currentPath());
@@ -73,6 +91,12 @@ MainWindow::MainWindow(QWidget *parent)
 }
 
 MainWindow::~MainWindow() {
+    // 取消尚未完成的后台标签任务，本批修改全部撤销
+    if (tagJob) {
+        *tagJobCancelled = true;
+        tagJob->wait();
+        delete tagJob;
+    }
     delete ui;
 }
 
@@ -152,6 +176,9 @@ void MainWindow::initializeView() {
 
 // 添加标签按钮点击事件处理
 void MainWindow::onAddTagClicked() {
+    if (tagJobRunning()) {
+        return;
+    }
     QString filePath = QFileDialog::getOpenFileName(this, "选择文件", "", "所有文件 (*)");
     if (filePath.isEmpty()) {
         return;
@@ -159,21 +186,190 @@ void MainWindow::onAddTagClicked() {
     QString tag = QInputDialog::getText(this, "添加标签", "请输入标签:");
 
     if (!filePath.isEmpty() && !tag.isEmpty()) {
-        fileTagSystem.addTags(filePath.toStdString(), tag.toStdString());
+        try {
+            fileTagSystem.addTags(filePath.toStdString(), tag.toStdString());
+        } catch (const std::exception &e) {
+            showTagError(QString::fromStdString(e.what()));
+            return;
+        }
         QMessageBox::information(this, "标签已添加", "标签已添加到文件: " + filePath);
         LOG_INFO("标签已添加到文件: " + filePath);
         populateTags();
     }
 }
 
-// 搜索标签按钮点击事件处理
+// 文件夹批量添加标签：枚举与修改在工作线程中进行，进度对话框可随时取消
+void MainWindow::onAddFolderTagClicked() {
+    if (tagJobRunning()) {
+        return;
+    }
+    QString directory = QFileDialog::getExistingDirectory(this, "选择文件夹");
+    if (directory.isEmpty()) {
+        return;
+    }
+    QString tag = QInputDialog::getText(this, "批量添加标签", "请输入标签:");
+    if (tag.isEmpty()) {
+        return;
+    }
+
+    TagBatchOptions options;
+    options.recursive = QMessageBox::question(this, "批量添加标签", "是否包含子文件夹？") == QMessageBox::Yes;
+
+    // 扩展名过滤：集合只读，可在多个枚举线程中同时使用
+    QString suffixText = QInputDialog::getText(this, "批量添加标签", "只处理这些扩展名（空格分隔，留空处理全部文件）:");
+    std::unordered_set<std::string> suffixes;
+    for (QString suffix : suffixText.split(' ', Qt::SkipEmptyParts)) {
+        if (suffix.startsWith('.')) {
+            suffix.remove(0, 1);
+        }
+        suffixes.insert(suffix.toLower().toStdString());
+    }
+    if (!suffixes.empty()) {
+        options.filter = [suffixes](const std::filesystem::path &path) {
+            QString suffix = QString::fromStdString(path.extension().string()).toLower();
+            if (suffix.startsWith('.')) {
+                suffix.remove(0, 1);
+            }
+            return suffixes.count(suffix.toStdString()) > 0;
+        };
+    }
+
+    // 进度对话框不模态，任务进行中标签列表与标签搜索照常可用（读取的是修改前的快照）
+    tagJobCancelled = std::make_shared<std::atomic<bool>>(false);
+    auto cancelled = tagJobCancelled;
+    auto *progressDialog = new QProgressDialog("正在枚举文件...", "取消", 0, 0, this);
+    progressDialog->setWindowModality(Qt::NonModal);
+    progressDialog->setAutoReset(false);
+    progressDialog->setAttribute(Qt::WA_DeleteOnClose);
+    progressDialog->show();
+    connect(progressDialog, &QProgressDialog::canceled, this, [cancelled] { *cancelled = true; });
+
+    options.cancelled = cancelled.get();
+    QPointer<QProgressDialog> progressTarget(progressDialog);
+    options.progress = [progressTarget](size_t done, size_t total) {
+        QMetaObject::invokeMethod(qApp, [progressTarget, done, total] {
+            if (!progressTarget) {
+                return;
+            }
+            if (total == 0) {
+                progressTarget->setLabelText(QString("正在枚举文件... 已找到 %1 个").arg(done));
+            } else {
+                progressTarget->setLabelText(QString("正在添加标签... %1 / %2").arg(done).arg(total));
+                progressTarget->setMaximum(int(total));
+                progressTarget->setValue(int(done));
+            }
+        }, Qt::QueuedConnection);
+    };
+
+    auto added = std::make_shared<std::optional<size_t>>();
+    auto error = std::make_shared<QString>();
+    tagJob = QThread::create([this, directory, tag, options, added, error] {
+        try {
+            *added = fileTagSystem.addTagsToDirectory(directory.toStdString(), tag.toStdString(), options);
+        } catch (const std::exception &e) {
+            *error = QString::fromStdString(e.what());
+        }
+    });
+    // 以批量操作的返回值为准：最后一次检查之后才点的取消不会撤销已发布的修改
+    connect(tagJob, &QThread::finished, this, [this, progressTarget, added, error, directory, tag] {
+        tagJob->deleteLater();
+        tagJob = nullptr;
+        if (progressTarget) {
+            progressTarget->close();
+        }
+        if (!error->isEmpty()) {
+            showTagError(*error);
+            return;
+        }
+        if (!*added) {
+            LOG_INFO("文件夹批量添加标签已取消: " + directory);
+            return;
+        }
+        QMessageBox::information(this, "标签已添加", QString("已为 %1 个文件添加标签。").arg(**added));
+        LOG_INFO(QString("标签 %1 已添加到 %2 中的 %3 个文件。").arg(tag, directory).arg(**added));
+        populateTags();
+    });
+    tagJob->start();
+}
+
+// 后台批量任务持有标签写锁，期间的修改操作会阻塞界面，直接提示用户稍后再试
+bool MainWindow::tagJobRunning() {
+    if (!tagJob) {
+        return false;
+    }
+    QMessageBox::information(this, "请稍候", "后台批量标签任务进行中，完成后再修改标签。查看与搜索标签不受影响。");
+    return true;
+}
+
+void MainWindow::showTagError(const QString &error) {
+    LOG_ERROR("标签操作失败: " + error);
+    QMessageBox::warning(this, "标签操作失败", error);
+}
+
+// 整理标签路径：文件被移动或重命名后，按 (设备号, inode) 在文件索引中找回新路径
+void MainWindow::onReconcileTagsClicked() {
+    if (tagJobRunning()) {
+        return;
+    }
+    QProgressDialog progressDialog("正在整理标签路径...", QString(), 0, 0, this);
+    progressDialog.setWindowModality(Qt::WindowModal);
+    progressDialog.show();
+
+    size_t relocated = 0;
+    QString error;
+    QThread *worker = QThread::create([&] {
+        try {
+            relocated = fileTagSystem.reconcileTags();
+        } catch (const std::exception &e) {
+            error = QString::fromStdString(e.what());
+        }
+    });
+    QEventLoop loop;
+    connect(worker, &QThread::finished, &loop, &QEventLoop::quit);
+    worker->start();
+    loop.exec();
+    delete worker;
+    progressDialog.close();
+
+    if (!error.isEmpty()) {
+        showTagError(error);
+        return;
+    }
+    QMessageBox::information(this, "整理标签路径", QString("已找回 %1 个移动过的文件的标签。").arg(relocated));
+    populateTags();
+}
+
+// 搜索标签按钮点击事件处理，表达式中含文件属性条件时走联合查询
 void MainWindow::onSearchTagClicked() {
-    QString tag = QInputDialog::getText(this, "搜索标签", "请输入标签:");
-    if (!tag.isEmpty()) {
-        std::vector<std::string> files = fileTagSystem.searchFilesByTag(tag.toStdString());
+    QString expression = QInputDialog::getText(this, "搜索标签",
+                                               "请输入标签或表达式（如 work AND 2024 AND NOT archived，"
+                                               "可附加 name:、ext:、modified:month 等文件条件）:");
+    if (!expression.isEmpty()) {
         QStringList fileList;
-        for (const auto &file : files) {
-            fileList.append(QString::fromStdString(file));
+        try {
+            FileQueryEngine::Query query = FileQueryEngine::parse(expression);
+            if (!query.filter.isEmpty()) {
+                if (!queryEngine) {
+                    queryEngine = std::make_unique<FileQueryEngine>(fileTagSystem);
+                }
+                queryEngine->run(query, [&fileList](const QString &file) {
+                    fileList.append(file);
+                    return true;
+                });
+            } else {
+                // 表达式只求值一次，没有匹配时 queryFiles 不展开任何路径
+                const std::vector<std::string> files = fileTagSystem.queryFiles(query.tagExpression);
+                LOG_INFO(QString("标签查询 \"%1\" 匹配 %2 个文件。").arg(expression).arg(files.size()));
+                for (const auto &file : files) {
+                    fileList.append(QString::fromStdString(file));
+                }
+            }
+        } catch (const std::invalid_argument &e) {
+            QMessageBox::warning(this, "表达式错误", QString::fromStdString(e.what()));
+            return;
+        } catch (const std::exception &e) {
+            showTagError(QString::fromStdString(e.what()));
+            return;
         }
         displayFiles(fileList);  // 显示文件列表
     }
@@ -181,9 +377,18 @@ void MainWindow::onSearchTagClicked() {
 
 // 删除标签按钮点击事件处理
 void MainWindow::onRemoveTagClicked() {
+    if (tagJobRunning()) {
+        return;
+    }
     QString tag = QInputDialog::getText(this, "删除标签", "请输入标签:");
     if (!tag.isEmpty()) {
-        std::vector<std::string> files = fileTagSystem.searchFilesByTag(tag.toStdString());
+        std::vector<std::string> files;
+        try {
+            files = fileTagSystem.searchFilesByTag(tag.toStdString());
+        } catch (const std::exception &e) {
+            showTagError(QString::fromStdString(e.what()));
+            return;
+        }
         if (files.empty()) {
             QMessageBox::information(this, "无文件", "没有文件包含此标签。");
             LOG_INFO("没有文件包含此标签。");
@@ -196,36 +401,67 @@ void MainWindow::onRemoveTagClicked() {
         MultiSelectDialog dialog(fileList, this);
         if (dialog.exec() == QDialog::Accepted) {
             QStringList selectedFiles = dialog.selectedItems();
-            if (selectedFiles.contains("删除所有文件")) {
-                for (const auto &file : files) {
-                    fileTagSystem.removeTag(file, tag.toStdString());
-                }
-                QMessageBox::information(this, "标签已删除", "标签已从所有文件删除。");
-                LOG_INFO("标签已从所有文件删除。");
-            } else {
-                for (const auto &selectedFile : selectedFiles) {
-                    fileTagSystem.removeTag(selectedFile.toStdString(), tag.toStdString());
+            try {
+                if (selectedFiles.contains("删除所有文件")) {
+                    fileTagSystem.deleteTag(tag.toStdString());
+                    QMessageBox::information(this, "标签已删除", "标签已从所有文件删除。");
+                    LOG_INFO("标签已从所有文件删除。");
+                } else {
+                    std::vector<std::string> selectedPaths;
+                    for (const auto &selectedFile : selectedFiles) {
+                        selectedPaths.push_back(selectedFile.toStdString());
+                    }
+                    fileTagSystem.removeTags(selectedPaths, tag.toStdString());
+                    QMessageBox::information(this, "标签已删除", "标签已从选中的文件中删除。");
+                    LOG_INFO("标签已从选中的文件中删除。");
                 }
-                QMessageBox::information(this, "标签已删除", "标签已从选中的文件中删除。");
-                LOG_INFO("标签已从选中的文件中删除。");
+            } catch (const std::exception &e) {
+                showTagError(QString::fromStdString(e.what()));
             }
             populateTags();
         }
     }
 }
 
-// 更新标签按钮点击事件处理
+// 更新标签按钮点击事件处理，文件路径留空时重命名所有文件上的标签
 void MainWindow::onUpdateTagClicked() {
-    QString filePath = QInputDialog::getText(this, "更新标签", "请输入文件路径:");
+    if (tagJobRunning()) {
+        return;
+    }
+    QString filePath = QInputDialog::getText(this, "更新标签", "请输入文件路径（留空则重命名所有文件上的该标签）:");
     QString oldTag = QInputDialog::getText(this, "更新标签", "请输入旧标签:");
     QString newTag = QInputDialog::getText(this, "更新标签", "请输入新标签:");
 
-    if (!filePath.isEmpty() && !oldTag.isEmpty() && !newTag.isEmpty()) {
+    if (oldTag.isEmpty() || newTag.isEmpty()) {
+        return;
+    }
+
+    try {
+        if (filePath.isEmpty()) {
+            // 新标签已在用时重命名即合并，先让用户确认
+            std::vector<std::string> tags = fileTagSystem.listAllTags();
+            const bool merging = std::find(tags.begin(), tags.end(), newTag.toStdString()) != tags.end();
+            if (merging && QMessageBox::question(this, "合并标签",
+                                                 QString("标签 %1 已存在，是否将 %2 合并到 %1？").arg(newTag, oldTag))
+                           != QMessageBox::Yes) {
+                return;
+            }
+            size_t count = merging ? fileTagSystem.mergeTag(oldTag.toStdString(), newTag.toStdString())
+                                   : fileTagSystem.renameTag(oldTag.toStdString(), newTag.toStdString());
+            QMessageBox::information(this, "标签已更新", QString("已更新 %1 个文件的标签。").arg(count));
+            LOG_INFO(QString("标签 %1 已%2为 %3，涉及 %4 个文件。").arg(oldTag, merging ? "合并" : "重命名", newTag).arg(count));
+            populateTags();
+            return;
+        }
+
         fileTagSystem.updateTag(filePath.toStdString(), oldTag.toStdString(), newTag.toStdString());
-        QMessageBox::information(this, "标签已更新", "文件中的标签已更新: " + filePath);
-        LOG_INFO("文件中的标签已更新: " + filePath);
-        populateTags();
+    } catch (const std::exception &e) {
+        showTagError(QString::fromStdString(e.what()));
+        return;
     }
+    QMessageBox::information(this, "标签已更新", "文件中的标签已更新: " + filePath);
+    LOG_INFO("文件中的标签已更新: " + filePath);
+    populateTags();
 }
 
 // 标签列表项被选中事件处理
@@ -233,7 +469,13 @@ void MainWindow::onTagSelected() {
     QListWidgetItem *item = ui->tagListWidget->currentItem();
     if (item) {
         std::string tag = item->text().toStdString();
-        std::vector<std::string> files = fileTagSystem.searchFilesByTag(tag);
+        std::vector<std::string> files;
+        try {
+            files = fileTagSystem.searchFilesByTag(tag);
+        } catch (const std::exception &e) {
+            showTagError(QString::fromStdString(e.what()));
+            return;
+        }
         QStringList fileList;
         for (const auto &file : files) {
             fileList.append(QString::fromStdString(file));
@@ -245,7 +487,13 @@ void MainWindow::onTagSelected() {
 // 填充标签列表
 void MainWindow::populateTags() {
     ui->tagListWidget->clear();
-    std::vector<std::string> tags = fileTagSystem.listAllTags();
+    std::vector<std::string> tags;
+    try {
+        tags = fileTagSystem.listAllTags();
+    } catch (const std::exception &e) {
+        showTagError(QString::fromStdString(e.what()));
+        return;
+    }
     for (const auto &tag : tags) {
         ui->tagListWidget->addItem(QString::fromStdString(tag));
     }
@@ -349,6 +597,42 @@ void MainWindow::showDocumentation() {
                                                "邮件：2605958732@qq.com");
 }
 
+// 导出各线程最近的运行事件，用于分析缓慢或卡住的搜索
+void MainWindow::onDumpFlightRecorderClicked() {
+    const QString path = FlightRecorder::dump();
+    if (path.isEmpty()) {
+        QMessageBox::warning(this, "导出运行记录", "无法写入运行记录文件。");
+        return;
+    }
+    QMessageBox::information(this, "导出运行记录", "运行记录已导出到：\n" + path);
+}
+
+// 打开运行统计面板，面板为非模态窗口，关闭后再次打开时复用
+void MainWindow::onShowMetricsClicked() {
+    if (!metricsPanel) {
+        metricsPanel = new MetricsPanel(this);
+    }
+    metricsPanel->show();
+    metricsPanel->raise();
+    metricsPanel->activateWindow();
+}
+
+// 勾选时开始记录各线程的耗时段，取消勾选时停止并导出为 Chrome trace JSON
+void MainWindow::onRecordTraceToggled(bool checked) {
+    if (checked) {
+        Trace::setEnabled(true);
+        return;
+    }
+    Trace::setEnabled(false);
+    const QString path = "logs/trace_" + QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss") + ".json";
+    if (!Trace::exportChrome(path)) {
+        QMessageBox::warning(this, "性能跟踪", "无法写入跟踪文件。");
+        return;
+    }
+    QMessageBox::information(this, "性能跟踪", "跟踪已导出到：\n" + QFileInfo(path).absoluteFilePath()
+                                               + "\n可在 ui.perfetto.dev 中打开。");
+}
+
 // 回到主窗口
 void MainWindow::on_actionHome_triggered() {
     // 检查 homeWidget 指针是否有效
@@ -3,9 +3,14 @@
 
 #include <QMainWindow>
 #include <QFileSystemModel>
+#include <atomic>
+#include <memory>
 
 #include "FileTagSystem.h"
 #include "FileTransfer.h"
+#include "FileQueryEngine.h"
+
+class MetricsPanel;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -23,14 +28,19 @@ signals:
 
 private slots:
     void onAddTagClicked();
+    void onAddFolderTagClicked();
     void onSearchTagClicked();
     void onRemoveTagClicked();
     void onUpdateTagClicked();
+    void onReconcileTagsClicked();
     void onFileActionClicked();
     void onTagSelected();
     void onFileClicked(const QModelIndex &index);
     void showAboutDialog();
     void showDocumentation();
+    void onDumpFlightRecorderClicked();
+    void onShowMetricsClicked();
+    void onRecordTraceToggled(bool checked);
     void initializeView();
     void onFileSearchClicked();
     void onFileTransferClicked();
@@ -44,9 +54,15 @@ private:
 
     QFileSystemModel *fileModel;
     QWidget *homeWidget;
-    FileTagSystem fileTagSystem;
+    FileTagSystem fileTagSystem;                    // filetagd 正在运行时标签操作都交给它
+    std::unique_ptr<FileQueryEngine> queryEngine;  // 标签与文件索引联合查询，首次使用时创建
+    QThread *tagJob = nullptr;                      // 后台批量标签任务，同一时间只有一个
+    std::shared_ptr<std::atomic<bool>> tagJobCancelled;  // 后台任务的取消标志
+    MetricsPanel *metricsPanel = nullptr;           // 运行统计面板，首次打开时创建
 
     void populateTags();
+    bool tagJobRunning();  // 后台批量任务进行中时提示用户并返回 true，避免界面线程等待写锁
+    void showTagError(const QString &error);  // 标签操作失败（例如 filetagd 回复错误或标签数据被占用）时提示用户
     void displayFiles(const QStringList& filepaths);
     void showFilePreview(const QString &filePath);
 
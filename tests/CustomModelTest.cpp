@@ -0,0 +1,133 @@
+/*
+ * CustomModelTest.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 搜索结果模型的单元测试：按列排序时持久索引跟随文件移动，按路径过滤，
+ *          按大小排序时属性在后台读到后自动重排
+ */
+
+#include <QFile>
+#include <QLocale>
+#include <QPersistentModelIndex>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <memory>
+
+#include "CustomModel.h"
+
+namespace {
+
+bool writeFile(const QString &path, int bytes) {
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(QByteArray(bytes, 'x')) == bytes;
+}
+
+// 当前显示顺序下的全部路径
+QStringList rowsOf(const CustomModel &model) {
+    QStringList paths;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        paths << model.filePath(row);
+    }
+    return paths;
+}
+
+} // namespace
+
+class CustomModelTest : public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void sortMovesPersistentIndexes();
+    void filterKeepsSortOrder();
+    void sortBySizeAfterMetadata();
+
+private:
+    std::unique_ptr<QTemporaryDir> directory;
+};
+
+void CustomModelTest::init() {
+    directory = std::make_unique<QTemporaryDir>();
+    QVERIFY(directory->isValid());
+}
+
+// 选中的行在排序后仍指向同一个文件，其余列的持久索引同样跟随
+void CustomModelTest::sortMovesPersistentIndexes() {
+    CustomModel model;
+    model.addFiles({"/data/c.txt", "/data/a.cpp", "/other/B.md"});
+    model.addFile("/data/d");
+    QCOMPARE(model.rowCount(), 4);
+
+    const QPersistentModelIndex selected(model.index(1, CustomModel::NameColumn));
+    const QPersistentModelIndex typeCell(model.index(2, CustomModel::TypeColumn));
+    QCOMPARE(selected.data().toString(), QString("a.cpp"));
+
+    model.sort(CustomModel::NameColumn, Qt::AscendingOrder);
+    QCOMPARE(rowsOf(model), QStringList({"/data/a.cpp", "/other/B.md", "/data/c.txt", "/data/d"}));
+    QCOMPARE(selected.row(), 0);
+    QCOMPARE(selected.data().toString(), QString("a.cpp"));
+    QCOMPARE(typeCell.row(), 1);
+    QCOMPARE(typeCell.data().toString(), QString("md"));
+
+    model.sort(CustomModel::TypeColumn, Qt::DescendingOrder);
+    QCOMPARE(rowsOf(model), QStringList({"/data/c.txt", "/other/B.md", "/data/a.cpp", "/data/d"}));
+    QCOMPARE(selected.row(), 2);
+    QCOMPARE(selected.data().toString(), QString("a.cpp"));
+    QCOMPARE(model.data(model.index(3, CustomModel::IndexColumn)).toInt(), 4);
+}
+
+// 过滤不区分大小写且只影响显示的行；之后追加的结果同样经过过滤
+void CustomModelTest::filterKeepsSortOrder() {
+    CustomModel model;
+    model.addFiles({"/src/main.CPP", "/src/util.cpp", "/doc/readme.md", "/src/app.cpp"});
+    model.sort(CustomModel::PathColumn, Qt::DescendingOrder);
+
+    model.setFilterWildcard("*.cpp");
+    QCOMPARE(rowsOf(model), QStringList({"/src/util.cpp", "/src/main.CPP", "/src/app.cpp"}));
+    QCOMPARE(model.fileCount(), 4);
+
+    model.addFiles({"/src/zeta.cpp", "/doc/zeta.md"});
+    QCOMPARE(rowsOf(model), QStringList({"/src/util.cpp", "/src/main.CPP", "/src/app.cpp", "/src/zeta.cpp"}));
+    QCOMPARE(model.fileCount(), 6);
+
+    model.setFilterWildcard("doc/");
+    QCOMPARE(rowsOf(model), QStringList({"/doc/zeta.md", "/doc/readme.md"}));
+
+    model.setFilterWildcard(QString());
+    QCOMPARE(model.rowCount(), 6);
+    QCOMPARE(model.filePath(0), QString("/src/zeta.cpp"));
+
+    model.clear();
+    QCOMPARE(model.rowCount(), 0);
+    QCOMPARE(model.fileCount(), 0);
+}
+
+// 按大小排序时属性尚未读到，先保持原顺序并在后台预读，全部读到后再排一次
+void CustomModelTest::sortBySizeAfterMetadata() {
+    const QString large = directory->filePath("large.bin");
+    const QString small = directory->filePath("small.bin");
+    const QString medium = directory->filePath("medium.bin");
+    QVERIFY(writeFile(large, 3000));
+    QVERIFY(writeFile(small, 10));
+    QVERIFY(writeFile(medium, 500));
+
+    CustomModel model;
+    model.addFiles({large, small, medium});
+    const QPersistentModelIndex selected(model.index(0, CustomModel::PathColumn));
+    QSignalSpy layouts(&model, &QAbstractItemModel::layoutChanged);
+
+    model.sort(CustomModel::SizeColumn, Qt::AscendingOrder);
+    QCOMPARE(layouts.count(), 1);
+    QTRY_COMPARE(layouts.count(), 2);
+    QCOMPARE(rowsOf(model), QStringList({small, medium, large}));
+    QCOMPARE(selected.row(), 2);
+    QCOMPARE(selected.data().toString(), large);
+    QCOMPARE(model.data(model.index(0, CustomModel::SizeColumn)).toString(), QLocale().formattedDataSize(10));
+}
+
+QTEST_GUILESS_MAIN(CustomModelTest)
+#include "CustomModelTest.moc"
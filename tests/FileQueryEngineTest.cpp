@@ -0,0 +1,171 @@
+/*
+ * FileQueryEngineTest.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 标签与文件索引联合查询的单元测试：按两侧结果数选择执行计划，各计划输出正确的文件，
+ *          回调返回 false 时停止；以及标签查询分批输出、判断函数持有快照
+ */
+
+#include <QFile>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FileIndexDatabase.h"
+#include "FileQueryEngine.h"
+#include "FileTagSystem.h"
+
+namespace {
+
+using Plan = FileQueryEngine::Plan;
+
+bool touch(const QString &path) {
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write("content") > 0;
+}
+
+} // namespace
+
+class FileQueryEngineTest : public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void choosesPlanBySmallerSide();
+    void stopsWhenCallbackReturnsFalse();
+    void queryFilesInBatches();
+    void matcherKeepsSnapshot();
+
+private:
+    QString file(const QString &name) const;   // 临时目录中的文件路径
+    Plan plan(const QString &text);           // 查询选择的执行计划
+    QSet<QString> run(const QString &text);   // 执行查询，返回全部结果
+
+    std::unique_ptr<QTemporaryDir> directory;
+    std::unique_ptr<FileTagSystem> tagSystem;
+    std::unique_ptr<FileQueryEngine> engine;
+};
+
+QString FileQueryEngineTest::file(const QString &name) const {
+    return directory->filePath(name);
+}
+
+/*
+ * 索引中有 2 个 .md、1 个 .txt、4 个 .cpp；loose.cpp 在磁盘上但不在索引中。
+ * 标签：work 3 个文件（含 loose.cpp），misc 5 个文件
+ */
+void FileQueryEngineTest::init() {
+    directory = std::make_unique<QTemporaryDir>();
+    QVERIFY(directory->isValid());
+    const QStringList indexed{"report.txt", "notes.md", "readme.md", "main.cpp", "util.cpp", "a.cpp", "b.cpp"};
+    for (const QString &name : indexed + QStringList{"loose.cpp"}) {
+        QVERIFY(touch(file(name)));
+    }
+
+    const QString indexPath = file("file_index.db");
+    {
+        FileIndexDatabase database(indexPath, "query_test_writer");
+        QVERIFY(database.openDatabase());
+        for (const QString &name : indexed) {
+            QVERIFY(database.insertFileInfo(file(name)));
+        }
+        database.closeDatabase();
+    }
+
+    tagSystem = std::make_unique<FileTagSystem>(file("tags.csv").toStdString(), file("users.csv").toStdString());
+    for (const QString &name : {"report.txt", "main.cpp", "loose.cpp"}) {
+        tagSystem->addTags(file(name).toStdString(), "work");
+    }
+    for (const QString &name : {"report.txt", "notes.md", "main.cpp", "util.cpp", "a.cpp"}) {
+        tagSystem->addTags(file(name).toStdString(), "misc");
+    }
+    engine = std::make_unique<FileQueryEngine>(*tagSystem, indexPath);
+}
+
+void FileQueryEngineTest::cleanup() {
+    engine.reset();
+    tagSystem.reset();
+    directory.reset();
+}
+
+FileQueryEngine::Plan FileQueryEngineTest::plan(const QString &text) {
+    return engine->explain(FileQueryEngine::parse(text)).plan;
+}
+
+QSet<QString> FileQueryEngineTest::run(const QString &text) {
+    QSet<QString> results;
+    engine->run(FileQueryEngine::parse(text), [&results](const QString &path) {
+        results.insert(path);
+        return true;
+    });
+    return results;
+}
+
+// 只有一侧条件时不需要比较；两侧都有时从结果较少的一侧出发，先标签时不在索引中的文件读取文件系统属性
+void FileQueryEngineTest::choosesPlanBySmallerSide() {
+    QVERIFY(plan("work") == Plan::TagOnly);
+    QCOMPARE(run("work"), QSet<QString>({file("report.txt"), file("main.cpp"), file("loose.cpp")}));
+    QVERIFY(plan("ext:md") == Plan::IndexOnly);
+    QCOMPARE(run("ext:md"), QSet<QString>({file("notes.md"), file("readme.md")}));
+
+    const FileQueryEngine::Explain explain = engine->explain(FileQueryEngine::parse("work ext:cpp"));
+    QCOMPARE(explain.tagCardinality, qint64(3));
+    QCOMPARE(explain.indexEstimate, qint64(4));
+    QVERIFY(explain.plan == Plan::TagFirst);
+    QCOMPARE(run("work ext:cpp"), QSet<QString>({file("main.cpp"), file("loose.cpp")}));
+
+    QVERIFY(plan("misc ext:txt") == Plan::IndexFirst);
+    QCOMPARE(run("misc ext:txt"), QSet<QString>({file("report.txt")}));
+    QVERIFY(plan("misc AND NOT work ext:cpp") == Plan::TagFirst);
+    QCOMPARE(run("misc AND NOT work ext:cpp"), QSet<QString>({file("util.cpp"), file("a.cpp")}));
+    QVERIFY(plan("nothing ext:md") == Plan::TagFirst);
+    QVERIFY(run("nothing ext:md").isEmpty());
+}
+
+void FileQueryEngineTest::stopsWhenCallbackReturnsFalse() {
+    for (const QString &text : {"misc", "ext:cpp", "misc ext:cpp", "misc ext:txt"}) {
+        int calls = 0;
+        const qint64 emitted = engine->run(FileQueryEngine::parse(text), [&calls](const QString &) {
+            ++calls;
+            return false;
+        });
+        QCOMPARE(calls, 1);
+        QCOMPARE(emitted, qint64(1));
+    }
+}
+
+// 每批不超过 batchSize 个，回调返回 false 后不再展开剩余的文件
+void FileQueryEngineTest::queryFilesInBatches() {
+    std::vector<size_t> sizes;
+    size_t emitted = tagSystem->queryFiles("misc", 2, [&sizes](const std::vector<std::string> &files) {
+        sizes.push_back(files.size());
+        return true;
+    });
+    QCOMPARE(emitted, size_t(5));
+    QCOMPARE(sizes, std::vector<size_t>({2, 2, 1}));
+
+    emitted = tagSystem->queryFiles("misc", 2, [](const std::vector<std::string> &) { return false; });
+    QCOMPARE(emitted, size_t(2));
+}
+
+// 判断函数使用创建时的快照，之后的修改不影响本次查询
+void FileQueryEngineTest::matcherKeepsSnapshot() {
+    const auto tagged = tagSystem->tagMatcher("work AND NOT misc");
+    QVERIFY(tagged(file("loose.cpp").toStdString()));
+    QVERIFY(!tagged(file("main.cpp").toStdString()));
+    QVERIFY(!tagged(file("missing.cpp").toStdString()));
+
+    tagSystem->addTags(file("loose.cpp").toStdString(), "misc");
+    QVERIFY(tagged(file("loose.cpp").toStdString()));
+    QVERIFY(!tagSystem->tagMatcher("work AND NOT misc")(file("loose.cpp").toStdString()));
+}
+
+QTEST_GUILESS_MAIN(FileQueryEngineTest)
+#include "FileQueryEngineTest.moc"
@@ -0,0 +1,185 @@
+/*
+ * IndexProtocolTest.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: filetagd 协议编解码的单元测试：分段到达、截断的消息、超长与格式错误的长度前缀
+ */
+
+#include <QtEndian>
+#include <QtTest>
+
+#include "IndexProtocol.h"
+
+using namespace IndexProtocol;
+
+namespace {
+
+Message sample() {
+    Message message;
+    message.type = Type::Search;
+    message.id = 300;          // 变长编码占两个字节
+    message.value = -12345;    // zigzag 编码
+    message.strings = {"报告", "", "work AND NOT archived", QString(1000, 'x')};
+    return message;
+}
+
+bool sameMessage(const Message &a, const Message &b) {
+    return a.type == b.type && a.id == b.id && a.value == b.value && a.strings == b.strings;
+}
+
+QByteArray lengthPrefix(quint32 length) {
+    QByteArray prefix(4, '\0');
+    qToLittleEndian(length, prefix.data());
+    return prefix;
+}
+
+} // namespace
+
+class IndexProtocolTest : public QObject {
+Q_OBJECT
+
+private slots:
+    void roundTrip();
+    void byteByByte();
+    void severalMessagesInOneRead();
+    void truncatedMessageWaits();
+    void oversizedLengthIsError();
+    void malformedBodyIsError();
+};
+
+void IndexProtocolTest::roundTrip() {
+    MessageReader reader;
+    reader.append(encode(sample()));
+    Message decoded;
+    QVERIFY(reader.next(decoded));
+    QVERIFY(sameMessage(decoded, sample()));
+    QVERIFY(!reader.next(decoded));
+    QVERIFY(!reader.hasError());
+}
+
+void IndexProtocolTest::byteByByte() {
+    const QByteArray bytes = encode(sample());
+    MessageReader reader;
+    Message decoded;
+    for (qsizetype i = 0; i < bytes.size() - 1; ++i) {
+        reader.append(bytes.mid(i, 1));
+        QVERIFY(!reader.next(decoded));
+    }
+    reader.append(bytes.right(1));
+    QVERIFY(reader.next(decoded));
+    QVERIFY(sameMessage(decoded, sample()));
+    QVERIFY(!reader.hasError());
+}
+
+void IndexProtocolTest::severalMessagesInOneRead() {
+    QByteArray bytes;
+    for (quint32 id = 1; id <= 100; ++id) {
+        Message message;
+        message.type = Type::Results;
+        message.id = id;
+        message.strings = {QString::number(id)};
+        bytes += encode(message);
+    }
+
+    // 分两次到达，切点落在消息中间
+    MessageReader reader;
+    reader.append(bytes.left(bytes.size() / 2 + 1));
+    Message decoded;
+    quint32 expected = 1;
+    while (reader.next(decoded)) {
+        QCOMPARE(decoded.id, expected++);
+    }
+    reader.append(bytes.mid(bytes.size() / 2 + 1));
+    while (reader.next(decoded)) {
+        QCOMPARE(decoded.id, expected);
+        QCOMPARE(decoded.strings, QStringList{QString::number(expected)});
+        ++expected;
+    }
+    QCOMPARE(expected, 101u);
+    QVERIFY(!reader.hasError());
+}
+
+// 消息体不完整时只是等待更多数据，不算错误
+void IndexProtocolTest::truncatedMessageWaits() {
+    const QByteArray bytes = encode(sample());
+    MessageReader reader;
+    reader.append(bytes.left(bytes.size() - 1));
+    Message decoded;
+    QVERIFY(!reader.next(decoded));
+    QVERIFY(!reader.hasError());
+
+    // 长度前缀本身也可能分段到达
+    MessageReader prefixOnly;
+    prefixOnly.append(bytes.left(3));
+    QVERIFY(!prefixOnly.next(decoded));
+    QVERIFY(!prefixOnly.hasError());
+    prefixOnly.append(bytes.mid(3));
+    QVERIFY(prefixOnly.next(decoded));
+    QVERIFY(sameMessage(decoded, sample()));
+}
+
+// 长度超过上限时立即报错，不会为其分配或等待 4 GB 数据
+void IndexProtocolTest::oversizedLengthIsError() {
+    MessageReader reader;
+    reader.append(lengthPrefix(quint32(MaxMessageBytes) + 1));
+    Message decoded;
+    QVERIFY(!reader.next(decoded));
+    QVERIFY(reader.hasError());
+
+    // 出错后后续数据一律不再解析
+    reader.append(encode(sample()));
+    QVERIFY(!reader.next(decoded));
+}
+
+void IndexProtocolTest::malformedBodyIsError() {
+    const QByteArray valid = encode(sample());
+    const QByteArray body = valid.mid(4);
+
+    // 声明的字符串个数超过消息体剩余字节
+    {
+        QByteArray forged;
+        forged.append(char(Type::Search));
+        forged.append(char(1));     // id
+        forged.append(char(0));     // value
+        forged.append(char(100));   // 字符串个数
+        forged.append(char(1));
+        forged.append('a');
+        MessageReader reader;
+        reader.append(lengthPrefix(quint32(forged.size())) + forged);
+        Message decoded;
+        QVERIFY(!reader.next(decoded));
+        QVERIFY(reader.hasError());
+    }
+
+    // 长度前缀比实际内容短：最后一个字符串越界
+    {
+        MessageReader reader;
+        reader.append(lengthPrefix(quint32(body.size() - 1)) + body.left(body.size() - 1));
+        Message decoded;
+        QVERIFY(!reader.next(decoded));
+        QVERIFY(reader.hasError());
+    }
+
+    // 长度前缀比实际内容长：消息体末尾有多余字节
+    {
+        MessageReader reader;
+        reader.append(lengthPrefix(quint32(body.size() + 1)) + body + 'z');
+        Message decoded;
+        QVERIFY(!reader.next(decoded));
+        QVERIFY(reader.hasError());
+    }
+
+    // 空消息体
+    {
+        MessageReader reader;
+        reader.append(lengthPrefix(0));
+        Message decoded;
+        QVERIFY(!reader.next(decoded));
+        QVERIFY(reader.hasError());
+    }
+}
+
+QTEST_GUILESS_MAIN(IndexProtocolTest)
+#include "IndexProtocolTest.moc"
@@ -0,0 +1,96 @@
+/*
+ * SnapshotStoreTest.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 快照容器的单元测试：副本无读者时补做上次修改而不复制，有读者时复制当前版本，
+ *          没有修改记录时不发布新版本
+ */
+
+#include <QtTest>
+
+#include <memory>
+#include <vector>
+
+#include "SnapshotStore.h"
+
+namespace {
+
+using Values = std::vector<int>;
+using Store = SnapshotStore<Values, int>;
+
+void append(Values &values, const int &value) {
+    values.push_back(value);
+}
+
+// 追加一个值并记下修改
+void push(Store &store, int value) {
+    store.update([value](Values &values, std::vector<int> &changes) {
+        values.push_back(value);
+        changes.push_back(value);
+        return true;
+    });
+}
+
+} // namespace
+
+class SnapshotStoreTest : public QObject {
+Q_OBJECT
+
+private slots:
+    void spareReplaysBacklog();
+    void heldSpareIsCopied();
+    void unchangedKeepsVersion();
+};
+
+// 第一次写入复制初始版本，之后两份数据轮流使用，每次只补做上一次的修改
+void SnapshotStoreTest::spareReplaysBacklog() {
+    Store store(append);
+    Values expected;
+    for (int value = 1; value <= 5; ++value) {
+        push(store, value);
+        expected.push_back(value);
+        QCOMPARE(*store.snapshot(), expected);
+    }
+    QCOMPARE(store.copies(), size_t(1));
+}
+
+// 读者仍持有上一个版本时不能在其上补做修改，只能复制当前版本；读者释放后恢复复用
+void SnapshotStoreTest::heldSpareIsCopied() {
+    Store store(append);
+    push(store, 1);
+    std::shared_ptr<const Values> reader = store.snapshot();
+    push(store, 2);
+    QCOMPARE(store.copies(), size_t(1));
+
+    // 上一个版本 {1} 被 reader 持有
+    push(store, 3);
+    QCOMPARE(store.copies(), size_t(2));
+    QCOMPARE(*reader, Values({1}));
+    QCOMPARE(*store.snapshot(), Values({1, 2, 3}));
+
+    reader.reset();
+    push(store, 4);
+    push(store, 5);
+    QCOMPARE(store.copies(), size_t(2));
+    QCOMPARE(*store.snapshot(), Values({1, 2, 3, 4, 5}));
+}
+
+// 没有修改记录时返回值照常返回，当前版本不变，副本留给下一次写入
+void SnapshotStoreTest::unchangedKeepsVersion() {
+    Store store(append);
+    push(store, 1);
+    const std::shared_ptr<const Values> before = store.snapshot();
+    const int result = store.update([](Values &, std::vector<int> &) { return 42; });
+    QCOMPARE(result, 42);
+    QVERIFY(store.snapshot() == before);
+
+    push(store, 2);
+    QCOMPARE(*store.snapshot(), Values({1, 2}));
+    QCOMPARE(*before, Values({1}));
+    QCOMPARE(store.copies(), size_t(1));
+}
+
+QTEST_GUILESS_MAIN(SnapshotStoreTest)
+#include "SnapshotStoreTest.moc"
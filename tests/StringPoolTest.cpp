@@ -0,0 +1,115 @@
+/*
+ * StringPoolTest.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 字符串驻留池与 ID 哈希表的单元测试，重点是删除时后移填补空洞后探测链仍然完整
+ */
+
+#include <QtTest>
+
+#include <string>
+#include <vector>
+
+#include "IdHashTable.h"
+#include "StringPool.h"
+
+class StringPoolTest : public QObject {
+Q_OBJECT
+
+private slots:
+    void internAndFind();
+    void renameKeepsProbeChains();
+    void eraseWithCollisions();
+    void eraseAcrossWrapAround();
+};
+
+void StringPoolTest::internAndFind() {
+    StringPool pool;
+    std::vector<uint32_t> ids;
+    for (int i = 0; i < 1000; ++i) {
+        ids.push_back(pool.intern("tag" + std::to_string(i)));
+    }
+    QCOMPARE(pool.size(), size_t(1000));
+    for (int i = 0; i < 1000; ++i) {
+        const std::string value = "tag" + std::to_string(i);
+        QCOMPARE(pool.intern(value), ids[size_t(i)]);
+        QCOMPARE(pool.find(value), ids[size_t(i)]);
+        QVERIFY(pool.view(ids[size_t(i)]) == value);
+    }
+    QCOMPARE(pool.find("missing"), StringPool::npos);
+}
+
+// 重命名从寻址表中删除旧位置，负载较高时必然遇到探测链；其余字符串都必须仍能找到
+void StringPoolTest::renameKeepsProbeChains() {
+    StringPool pool;
+    const int count = 3000;
+    for (int i = 0; i < count; ++i) {
+        pool.intern("file" + std::to_string(i));
+    }
+    for (int i = 0; i < count; i += 3) {
+        const uint32_t id = pool.find("file" + std::to_string(i));
+        pool.rename(id, "renamed" + std::to_string(i));
+    }
+
+    for (int i = 0; i < count; ++i) {
+        const std::string original = "file" + std::to_string(i);
+        const std::string renamed = "renamed" + std::to_string(i);
+        if (i % 3 == 0) {
+            QCOMPARE(pool.find(original), StringPool::npos);
+            QCOMPARE(pool.find(renamed), uint32_t(i));
+        } else {
+            QCOMPARE(pool.find(original), uint32_t(i));
+            QCOMPARE(pool.find(renamed), StringPool::npos);
+        }
+    }
+    QCOMPARE(pool.size(), size_t(count));
+}
+
+// 所有键落在同一个起始槽附近，删除链头与链中元素后其余元素仍可找到
+void StringPoolTest::eraseWithCollisions() {
+    const std::vector<size_t> hashes = {5, 5, 5, 6, 5, 7, 6, 5};
+    const auto hashOf = [&hashes](uint32_t id) { return hashes[id]; };
+    IdHashTable table;
+    for (uint32_t id = 0; id < hashes.size(); ++id) {
+        table.insert(id, hashes[id], hashOf);
+    }
+
+    std::vector<bool> present(hashes.size(), true);
+    for (uint32_t id : {0u, 3u, 4u}) {
+        table.erase(id, hashes[id], hashOf);
+        present[id] = false;
+    }
+    for (uint32_t id = 0; id < hashes.size(); ++id) {
+        const uint32_t found = table.find(hashes[id], [id](uint32_t candidate) { return candidate == id; });
+        QCOMPARE(found, present[id] ? id : IdHashTable::npos);
+    }
+
+    // 删除不存在的 ID 不影响表
+    table.erase(0, hashes[0], hashOf);
+    QCOMPARE(table.find(hashes[7], [](uint32_t candidate) { return candidate == 7; }), 7u);
+}
+
+// 探测链越过表尾回到表头时，后移判断按环形距离计算
+void StringPoolTest::eraseAcrossWrapAround() {
+    const size_t last = 15;  // 初始容量为 16
+    const std::vector<size_t> hashes = {last, last, last, 0, last, 1};
+    const auto hashOf = [&hashes](uint32_t id) { return hashes[id]; };
+    IdHashTable table;
+    for (uint32_t id = 0; id < hashes.size(); ++id) {
+        table.insert(id, hashes[id], hashOf);
+    }
+
+    for (uint32_t erased = 0; erased < hashes.size(); ++erased) {
+        table.erase(erased, hashes[erased], hashOf);
+        QCOMPARE(table.find(hashes[erased], [erased](uint32_t candidate) { return candidate == erased; }),
+                 IdHashTable::npos);
+        for (uint32_t id = erased + 1; id < hashes.size(); ++id) {
+            QCOMPARE(table.find(hashes[id], [id](uint32_t candidate) { return candidate == id; }), id);
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(StringPoolTest)
+#include "StringPoolTest.moc"
@@ -0,0 +1,183 @@
+/*
+ * TagJournalTest.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 标签日志的单元测试：写盘后回放、残缺尾部、校验失败的记录、无效文件头与文件头中的日志序号
+ */
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <memory>
+
+#include "TagJournal.h"
+
+namespace {
+
+using Record = TagJournal::Record;
+
+const std::vector<Record> Records = {
+        {Record::Op::AddTag, "/home/user/a.txt", "work", ""},
+        {Record::Op::UpdateTag, "/home/user/b.txt", "draft", "final"},
+        {Record::Op::MoveDirectory, "/home/user/old/", "", "/home/user/new/"},
+};
+
+bool sameRecord(const Record &a, const Record &b) {
+    return a.op == b.op && a.path == b.path && a.tag == b.tag && a.newTag == b.newTag;
+}
+
+std::vector<Record> replayAll(const QString &path, bool *headerValid = nullptr) {
+    std::vector<Record> records;
+    const bool valid = TagJournal::replay(path, [&records](const Record &record) { records.push_back(record); });
+    if (headerValid) {
+        *headerValid = valid;
+    }
+    return records;
+}
+
+QByteArray readAll(const QString &path) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+bool writeFile(const QString &path, const QByteArray &content) {
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(content) == content.size();
+}
+
+} // namespace
+
+class TagJournalTest : public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void roundTrip();
+    void tornTailIsIgnored();
+    void corruptRecordStopsReplay();
+    void invalidHeader();
+    void sequenceHeader();
+
+private:
+    QString writeJournal(const QString &name, size_t count);  // 用 TagJournal 写入前 count 条记录，返回日志路径
+
+    std::unique_ptr<QTemporaryDir> directory;
+};
+
+void TagJournalTest::init() {
+    directory = std::make_unique<QTemporaryDir>();
+    QVERIFY(directory->isValid());
+}
+
+QString TagJournalTest::writeJournal(const QString &name, size_t count) {
+    const QString path = directory->filePath(name + ".journal");
+    TagJournal journal(path, directory->filePath(name + ".db"));
+    journal.setCheckpointThreshold(qint64(1) << 40);  // 测试期间不做检查点，记录留在日志中
+    journal.start();
+    journal.append(std::vector<Record>(Records.begin(), Records.begin() + std::ptrdiff_t(count)));
+    return journal.sync() ? path : QString();
+}
+
+void TagJournalTest::roundTrip() {
+    const QString path = writeJournal("full", Records.size());
+    QVERIFY(!path.isEmpty());
+
+    bool headerValid = false;
+    const std::vector<Record> replayed = replayAll(path, &headerValid);
+    QVERIFY(headerValid);
+    QCOMPARE(replayed.size(), Records.size());
+    for (size_t i = 0; i < Records.size(); ++i) {
+        QVERIFY(sameRecord(replayed[i], Records[i]));
+    }
+    QCOMPARE(TagJournal::validLength(path), QFileInfo(path).size());
+}
+
+// 写到一半的最后一条记录在任何截断位置都被整条忽略，有效长度停在前一条记录末尾
+void TagJournalTest::tornTailIsIgnored() {
+    const QString twoRecords = writeJournal("two", 2);
+    const QString threeRecords = writeJournal("three", 3);
+    QVERIFY(!twoRecords.isEmpty() && !threeRecords.isEmpty());
+
+    // 编码是确定的，两条记录的日志正好是三条记录日志的前缀
+    const QByteArray prefix = readAll(twoRecords);
+    const QByteArray full = readAll(threeRecords);
+    QVERIFY(full.startsWith(prefix));
+    QVERIFY(full.size() > prefix.size());
+
+    const QString torn = directory->filePath("torn.journal");
+    for (qsizetype cut = prefix.size(); cut < full.size(); ++cut) {
+        QVERIFY(writeFile(torn, full.left(cut)));
+        const std::vector<Record> replayed = replayAll(torn);
+        QCOMPARE(replayed.size(), size_t(2));
+        QVERIFY(sameRecord(replayed[1], Records[1]));
+        QCOMPARE(TagJournal::validLength(torn), qint64(prefix.size()));
+    }
+}
+
+// 中间一条记录校验失败时从它开始停止，之后的记录即使完整也不回放
+void TagJournalTest::corruptRecordStopsReplay() {
+    const QString oneRecord = writeJournal("one", 1);
+    const QString twoRecords = writeJournal("two", 2);
+    const QString threeRecords = writeJournal("three", 3);
+    QVERIFY(!oneRecord.isEmpty() && !twoRecords.isEmpty() && !threeRecords.isEmpty());
+
+    const qsizetype firstEnd = readAll(oneRecord).size();
+    const qsizetype secondEnd = readAll(twoRecords).size();
+    QByteArray content = readAll(threeRecords);
+    content[(firstEnd + secondEnd) / 2] = char(content[(firstEnd + secondEnd) / 2] ^ 0x5A);
+
+    const QString corrupt = directory->filePath("corrupt.journal");
+    QVERIFY(writeFile(corrupt, content));
+    const std::vector<Record> replayed = replayAll(corrupt);
+    QCOMPARE(replayed.size(), size_t(1));
+    QVERIFY(sameRecord(replayed[0], Records[0]));
+    QCOMPARE(TagJournal::validLength(corrupt), qint64(firstEnd));
+}
+
+void TagJournalTest::invalidHeader() {
+    const QString missing = directory->filePath("missing.journal");
+    bool headerValid = false;
+    QVERIFY(replayAll(missing, &headerValid).empty());
+    QVERIFY(headerValid);
+    QCOMPARE(TagJournal::validLength(missing), qint64(0));
+
+    const QString garbage = directory->filePath("garbage.journal");
+    QVERIFY(writeFile(garbage, "not a journal file"));
+    QVERIFY(replayAll(garbage, &headerValid).empty());
+    QVERIFY(!headerValid);
+    QCOMPARE(TagJournal::validLength(garbage), qint64(-1));
+
+    // 只写了一部分的文件头按空日志处理
+    const QString path = writeJournal("header", 0);
+    QVERIFY(!path.isEmpty());
+    const QString partial = directory->filePath("partial.journal");
+    QVERIFY(writeFile(partial, readAll(path).left(3)));
+    QCOMPARE(TagJournal::validLength(partial), qint64(0));
+}
+
+// 新日志带序号；不含序号的旧版日志仍能回放，序号视为 0
+void TagJournalTest::sequenceHeader() {
+    const QString path = writeJournal("current", Records.size());
+    QVERIFY(!path.isEmpty());
+    QCOMPARE(TagJournal::sequenceOf(path), quint64(1));
+
+    const QString legacy = directory->filePath("legacy.journal");
+    QVERIFY(writeFile(legacy, QByteArray("FTJRNL01") + readAll(path).mid(16)));
+    QCOMPARE(TagJournal::sequenceOf(legacy), quint64(0));
+    QCOMPARE(replayAll(legacy).size(), Records.size());
+    QCOMPARE(TagJournal::validLength(legacy), QFileInfo(legacy).size());
+
+    // 只写了 magic、序号不完整的文件头按空日志处理
+    const QString partial = directory->filePath("partial.journal");
+    QVERIFY(writeFile(partial, readAll(path).left(12)));
+    QCOMPARE(TagJournal::validLength(partial), qint64(0));
+    QVERIFY(replayAll(partial).empty());
+    QCOMPARE(TagJournal::sequenceOf(directory->filePath("missing.journal")), quint64(0));
+}
+
+QTEST_GUILESS_MAIN(TagJournalTest)
+#include "TagJournalTest.moc"
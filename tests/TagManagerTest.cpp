@@ -0,0 +1,257 @@
+/*
+ * TagManagerTest.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 标签管理的单元测试：重启后回放日志、检查点合并，检查点提交后、删除封存日志前崩溃的恢复，
+ *          批量添加/删除标签取消后整批撤销，全局重命名、合并与删除标签，以及文件移动后按文件标识找回标签
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "FileIdentity.h"
+#include "TagJournal.h"
+#include "TagManager.h"
+
+namespace {
+
+using TagSet = std::set<std::string>;
+
+TagSet tagsOf(TagManager &manager, const std::string &filepath) {
+    const std::vector<std::string> tags = manager.listTagsForFile(filepath);
+    return TagSet(tags.begin(), tags.end());
+}
+
+QByteArray readAll(const QString &path) {
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+bool writeFile(const QString &path, const QByteArray &content) {
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(content) == content.size();
+}
+
+} // namespace
+
+class TagManagerTest : public QObject {
+Q_OBJECT
+
+private slots:
+    void init();
+    void restartReplaysJournal();
+    void crashBetweenCommitAndDelete();
+    void cancelledBatchRollsBack();
+    void renameMergeAndDelete();
+    void reconcileFollowsMovedFiles();
+
+private:
+    std::string path(const QString &name) const;  // 临时目录中的路径
+    std::unique_ptr<TagManager> open() const;     // 打开临时目录中的标签数据
+
+    std::unique_ptr<QTemporaryDir> directory;
+};
+
+void TagManagerTest::init() {
+    directory = std::make_unique<QTemporaryDir>();
+    QVERIFY(directory->isValid());
+}
+
+std::string TagManagerTest::path(const QString &name) const {
+    return directory->filePath(name).toStdString();
+}
+
+std::unique_ptr<TagManager> TagManagerTest::open() const {
+    auto manager = std::make_unique<TagManager>(path("tags.csv"));
+    manager->loadTags();
+    return manager;
+}
+
+// 第一次重启时修改来自日志回放，第二次重启时已由检查点合并进数据库，结果相同
+void TagManagerTest::restartReplaysJournal() {
+    {
+        auto manager = open();
+        manager->addTag(path("a.txt"), "work");
+        manager->addTag(path("a.txt"), "draft");
+        manager->addTag(path("b.txt"), "work");
+        manager->updateTag(path("a.txt"), "draft", "final");
+        manager->removeTag(path("b.txt"), "work");
+        QVERIFY(manager->sync());
+    }
+    QVERIFY(TagJournal::validLength(directory->filePath("tags.journal")) > 0);
+
+    for (int restart = 0; restart < 2; ++restart) {
+        auto manager = open();
+        QCOMPARE(tagsOf(*manager, path("a.txt")), TagSet({"work", "final"}));
+        QVERIFY(tagsOf(*manager, path("b.txt")).empty());
+        QCOMPARE(manager->searchFilesByTag("work"), std::vector<std::string>{path("a.txt")});
+    }
+    QVERIFY(!QFile::exists(directory->filePath("tags.journal.checkpoint")));
+}
+
+// 检查点已提交、封存日志尚未删除时崩溃：重启后不能再次回放或合并该日志。
+// 日志 [添加 a:A, 重命名 A->B, 添加 b:A] 重复执行时 b 会同时带上 A 和 B
+void TagManagerTest::crashBetweenCommitAndDelete() {
+    const QString journalPath = directory->filePath("tags.journal");
+    const QString sealedPath = journalPath + ".checkpoint";
+    {
+        auto manager = open();
+        manager->addTag(path("a.txt"), "A");
+        QCOMPARE(manager->renameTag("A", "B"), size_t(1));
+        manager->addTag(path("b.txt"), "A");
+        QVERIFY(manager->sync());
+    }
+    const QByteArray journal = readAll(journalPath);
+    QVERIFY(TagJournal::sequenceOf(journalPath) > 0);
+
+    // 日志线程启动时做检查点：合并上面的日志并删除封存日志
+    open().reset();
+    QVERIFY(!QFile::exists(sealedPath));
+
+    // 模拟删除之前崩溃：已合并的日志原样留在封存位置
+    QVERIFY(writeFile(sealedPath, journal));
+    for (int restart = 0; restart < 2; ++restart) {
+        auto manager = open();
+        QCOMPARE(tagsOf(*manager, path("a.txt")), TagSet({"B"}));
+        QCOMPARE(tagsOf(*manager, path("b.txt")), TagSet({"A"}));
+    }
+    QVERIFY(!QFile::exists(sealedPath));
+}
+
+// 批量操作每 4096 个文件检查一次取消：第二次检查前请求取消，已修改的 4096 个文件必须全部撤销，
+// 之后的写入在复用的副本上补做修改，结果仍与撤销后的状态一致
+void TagManagerTest::cancelledBatchRollsBack() {
+    std::vector<std::string> files;
+    for (int i = 0; i < 10000; ++i) {
+        files.push_back(path(QString("batch/%1.txt").arg(i)));
+    }
+    std::atomic<bool> cancelled{false};
+    auto cancelAfterFirstStep = [&cancelled](size_t done, size_t) {
+        if (done > 0) {
+            cancelled = true;
+        }
+    };
+
+    {
+        auto manager = open();
+        manager->addTag(files.front(), "keep");
+
+        QVERIFY(!manager->addTagToFiles(files, "batch", &cancelled, cancelAfterFirstStep).has_value());
+        QVERIFY(manager->searchFilesByTag("batch").empty());
+        QCOMPARE(tagsOf(*manager, files.front()), TagSet({"keep"}));
+
+        cancelled = false;
+        QCOMPARE(manager->addTagToFiles(files, "batch"), std::optional<size_t>(files.size()));
+        QVERIFY(!manager->removeTagFromFiles(files, "batch", &cancelled, cancelAfterFirstStep).has_value());
+        QCOMPARE(manager->countFiles("batch"), files.size());
+
+        manager->addTag(files.back(), "keep");
+        QCOMPARE(manager->countFiles("batch"), files.size());
+        QCOMPARE(manager->countFiles("keep"), size_t(2));
+        QVERIFY(manager->sync());
+    }
+
+    auto manager = open();
+    QCOMPARE(manager->countFiles("batch"), files.size());
+    QCOMPARE(tagsOf(*manager, files.front()), TagSet({"keep", "batch"}));
+}
+
+// 重命名为新标签、合并到已在用的标签（同时带两个标签的文件只保留一个）、删除标签，重启后结果不变
+void TagManagerTest::renameMergeAndDelete() {
+    const std::string a = path("a.txt");
+    const std::string b = path("b.txt");
+    const std::string c = path("c.txt");
+    {
+        auto manager = open();
+        manager->addTag(a, "A");
+        manager->addTag(a, "C");
+        manager->addTag(b, "B");
+        manager->addTag(c, "A");
+        manager->addTag(c, "B");
+
+        QCOMPARE(manager->renameTag("A", "X"), size_t(2));
+        QCOMPARE(tagsOf(*manager, a), TagSet({"X", "C"}));
+        QCOMPARE(tagsOf(*manager, c), TagSet({"X", "B"}));
+        QVERIFY(manager->searchFilesByTag("A").empty());
+        QCOMPARE(manager->renameTag("missing", "Y"), size_t(0));
+
+        QCOMPARE(manager->mergeTag("X", "B"), size_t(2));
+        QCOMPARE(tagsOf(*manager, a), TagSet({"B", "C"}));
+        QCOMPARE(tagsOf(*manager, c), TagSet({"B"}));
+        QCOMPARE(manager->countFiles("B"), size_t(3));
+        QCOMPARE(manager->countFiles("X OR A"), size_t(0));
+
+        QCOMPARE(manager->deleteTag("C"), size_t(1));
+        QVERIFY(manager->sync());
+    }
+
+    auto manager = open();
+    const std::vector<std::string> tags = manager->listAllTags();
+    QCOMPARE(TagSet(tags.begin(), tags.end()), TagSet({"B"}));
+    for (const std::string &file : {a, b, c}) {
+        QCOMPARE(tagsOf(*manager, file), TagSet({"B"}));
+    }
+}
+
+// 文件在标签程序之外被移动或被替换：
+// 查看移动后文件的标签时按标识找回；整理时移动过的文件经 resolver 找回，被替换的文件只更新标识
+void TagManagerTest::reconcileFollowsMovedFiles() {
+    QVERIFY(QDir(directory->path()).mkpath("moved"));
+    const std::string a = path("a.txt");
+    const std::string b = path("b.txt");
+    const std::string c = path("c.txt");
+    for (const std::string &file : {a, b, c}) {
+        QVERIFY(writeFile(QString::fromStdString(file), "content"));
+    }
+    auto manager = open();
+    manager->addTag(a, "A");
+    manager->addTag(b, "B");
+    manager->addTag(c, "C");
+
+    const std::string movedA = path("moved/a.txt");
+    QVERIFY(QFile::rename(QString::fromStdString(a), QString::fromStdString(movedA)));
+    QCOMPARE(tagsOf(*manager, movedA), TagSet({"A"}));
+    QVERIFY(tagsOf(*manager, a).empty());
+
+    // c 被移动，b 被新文件替换（先写新文件再改名覆盖，保证 inode 不同）
+    const std::string movedC = path("moved/c.txt");
+    const FileIdentity oldB = FileIdentity::of(b);
+    QVERIFY(QFile::rename(QString::fromStdString(c), QString::fromStdString(movedC)));
+    QVERIFY(writeFile(directory->filePath("b.new"), "replaced"));
+    QVERIFY(QFile::remove(QString::fromStdString(b)));
+    QVERIFY(QFile::rename(directory->filePath("b.new"), QString::fromStdString(b)));
+    QVERIFY(FileIdentity::of(b) != oldB);
+
+    size_t resolved = 0;
+    auto resolver = [&](const std::vector<FileIdentity> &identities) {
+        std::vector<std::string> found;
+        for (const FileIdentity &identity : identities) {
+            ++resolved;
+            found.push_back(identity == FileIdentity::of(movedC) ? movedC : std::string());
+        }
+        return found;
+    };
+    QCOMPARE(manager->reconcile(resolver), size_t(1));
+    QCOMPARE(resolved, size_t(1));
+    QCOMPARE(tagsOf(*manager, movedC), TagSet({"C"}));
+    QVERIFY(tagsOf(*manager, c).empty());
+    QCOMPARE(tagsOf(*manager, b), TagSet({"B"}));
+    QCOMPARE(manager->snapshot()->identityOf(b), FileIdentity::of(b));
+
+    // 再次整理时没有需要处理的文件
+    QCOMPARE(manager->reconcile(resolver), size_t(0));
+    QCOMPARE(resolved, size_t(1));
+}
+
+QTEST_GUILESS_MAIN(TagManagerTest)
+#include "TagManagerTest.moc"
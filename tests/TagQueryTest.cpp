@@ -0,0 +1,156 @@
+/*
+ * TagQueryTest.cpp
+ * Author: Montee
+ * CreateDate: 2026-10-19
+ * Updater: Montee
+ * UpdateDate: 2026-10-19
+ * Summary: 压缩位图与标签布尔查询的单元测试：数组与位图两种容器的增删和集合运算、表达式的优先级与语法错误
+ */
+
+#include <QtTest>
+
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#include "TagBitmap.h"
+#include "TagQuery.h"
+
+namespace {
+
+TagBitmap bitmapOf(const std::set<uint32_t> &values) {
+    TagBitmap bitmap;
+    for (uint32_t value : values) {
+        bitmap.add(value);
+    }
+    return bitmap;
+}
+
+std::vector<uint32_t> sorted(const std::set<uint32_t> &values) {
+    return std::vector<uint32_t>(values.begin(), values.end());
+}
+
+// 稀疏、跨桶与稠密（超过 4096 个，转为位图容器）三种分布混合
+std::set<uint32_t> mixedValues(uint32_t seed) {
+    std::set<uint32_t> values{seed, 70000 + seed, 0xFFFF0000u + seed};
+    for (uint32_t i = 0; i < 6000; ++i) {
+        values.insert((3u << 16) + (i * 7 + seed) % 65536);
+    }
+    return values;
+}
+
+} // namespace
+
+class TagQueryTest : public QObject {
+Q_OBJECT
+
+private slots:
+    void bitmapAddRemove();
+    void bitmapSetOperations();
+    void queryPrecedence();
+    void queryQuotedTags();
+    void querySyntaxErrors();
+
+private:
+    std::vector<uint32_t> run(const std::string &expression) const;
+
+    std::map<std::string, TagBitmap> postings = {
+            {"work", bitmapOf({1, 2, 3, 4})},
+            {"2024", bitmapOf({2, 3, 5})},
+            {"archived", bitmapOf({3, 6})},
+            {"my tag", bitmapOf({4, 6})},
+            {"AND", bitmapOf({5})},
+    };
+    TagBitmap universe = bitmapOf({1, 2, 3, 4, 5, 6});
+};
+
+std::vector<uint32_t> TagQueryTest::run(const std::string &expression) const {
+    const TagQuery query = TagQuery::parse(expression);
+    return query.evaluate([this](const std::string &tag) -> const TagBitmap * {
+        const auto it = postings.find(tag);
+        return it == postings.end() ? nullptr : &it->second;
+    }, universe).toVector();
+}
+
+void TagQueryTest::bitmapAddRemove() {
+    const std::set<uint32_t> values = mixedValues(1);
+    TagBitmap bitmap = bitmapOf(values);
+    QCOMPARE(bitmap.cardinality(), uint64_t(values.size()));
+    QVERIFY(bitmap.toVector() == sorted(values));
+    QVERIFY(!bitmap.add(*values.begin()));
+    QVERIFY(!bitmap.contains(2));
+
+    // 删到 4096 个以下时位图容器退回数组，内容不变
+    std::set<uint32_t> remaining = values;
+    for (uint32_t i = 0; i < 3000; ++i) {
+        const uint32_t value = (3u << 16) + (i * 7 + 1) % 65536;
+        QVERIFY(bitmap.remove(value));
+        remaining.erase(value);
+    }
+    QVERIFY(!bitmap.remove(2));
+    QCOMPARE(bitmap.cardinality(), uint64_t(remaining.size()));
+    QVERIFY(bitmap.toVector() == sorted(remaining));
+
+    for (uint32_t value : remaining) {
+        QVERIFY(bitmap.remove(value));
+    }
+    QVERIFY(bitmap.empty());
+}
+
+void TagQueryTest::bitmapSetOperations() {
+    const std::set<uint32_t> a = mixedValues(1);
+    const std::set<uint32_t> b = mixedValues(4);
+    std::set<uint32_t> both, either, onlyA;
+    for (uint32_t value : a) {
+        (b.count(value) ? both : onlyA).insert(value);
+    }
+    either = a;
+    either.insert(b.begin(), b.end());
+
+    TagBitmap intersection = bitmapOf(a);
+    intersection &= bitmapOf(b);
+    QVERIFY(intersection.toVector() == sorted(both));
+
+    TagBitmap unionSet = bitmapOf(a);
+    unionSet |= bitmapOf(b);
+    QVERIFY(unionSet.toVector() == sorted(either));
+    QCOMPARE(unionSet.cardinality(), uint64_t(either.size()));
+
+    TagBitmap difference = bitmapOf(a);
+    difference -= bitmapOf(b);
+    QVERIFY(difference.toVector() == sorted(onlyA));
+
+    std::vector<uint32_t> visited;
+    difference.forEach([&visited](uint32_t value) { visited.push_back(value); });
+    QVERIFY(visited == sorted(onlyA));
+}
+
+void TagQueryTest::queryPrecedence() {
+    QVERIFY(run("work") == std::vector<uint32_t>({1, 2, 3, 4}));
+    QVERIFY(run("work AND 2024") == std::vector<uint32_t>({2, 3}));
+    QVERIFY(run("work 2024") == std::vector<uint32_t>({2, 3}));  // 省略的 AND
+    QVERIFY(run("work AND NOT archived") == std::vector<uint32_t>({1, 2, 4}));
+    // AND 优先于 OR
+    QVERIFY(run("archived OR work AND 2024") == std::vector<uint32_t>({2, 3, 6}));
+    QVERIFY(run("(archived OR work) AND 2024") == std::vector<uint32_t>({2, 3}));
+    QVERIFY(run("NOT work") == std::vector<uint32_t>({5, 6}));
+    QVERIFY(run("missing").empty());
+    QVERIFY(run("NOT missing") == universe.toVector());
+}
+
+void TagQueryTest::queryQuotedTags() {
+    QVERIFY(run("\"my tag\"") == std::vector<uint32_t>({4, 6}));
+    QVERIFY(run("\"AND\" OR archived") == std::vector<uint32_t>({3, 5, 6}));
+
+    const std::vector<std::string> tags = TagQuery::parse("work AND (\"my tag\" OR NOT 2024)").tags();
+    QVERIFY(std::set<std::string>(tags.begin(), tags.end()) == std::set<std::string>({"work", "my tag", "2024"}));
+}
+
+void TagQueryTest::querySyntaxErrors() {
+    for (const char *expression : {"work AND", "(work", "work)", "\"open", "OR work", "NOT"}) {
+        QVERIFY_THROWS_EXCEPTION(std::invalid_argument, TagQuery::parse(expression));
+    }
+}
+
+QTEST_GUILESS_MAIN(TagQueryTest)
+#include "TagQueryTest.moc"